@@ -0,0 +1,202 @@
+// Compares the swizzle folding driven by the virtual ast::Visitor with the
+// folding driven by ast::Static_Visitor.
+//
+// The AST is a single function whose body consists of expression statements,
+// each a chain of swizzles of a vec4. Every run folds a freshly generated
+// AST, hence both visitors do the same rewrites. The runs of the visitors are
+// interleaved to even out the effects of the state of the machine.
+//
+// Configure with -DVUSH_BUILD_BENCHMARKS=ON and run vush_benchmark_visitor
+// from a release build.
+//
+
+#include <chrono>
+#include <stdlib.h>
+
+#include <anton/format.hpp>
+#include <anton/stdio.hpp>
+#include <anton/string7_view.hpp>
+
+#include <vush_ast/ast.hpp>
+#include <vush_ast/static_visitor.hpp>
+#include <vush_ast/visitor.hpp>
+#include <vush_ast_opt/opts.hpp>
+#include <vush_core/memory.hpp>
+
+namespace vush {
+  using namespace anton::literals;
+
+  struct Virtual_Fold_Swizzles_Visitor: public ast::Visitor {
+  private:
+    Allocator* allocator;
+
+  public:
+    bool changed = false;
+
+  public:
+    Virtual_Fold_Swizzles_Visitor(Allocator* allocator): allocator(allocator)
+    {
+    }
+
+    [[nodiscard]] virtual ast::Visitor_Status
+    visit(ast::Expr_Field* expr) override
+    {
+      while(rewrite_fold_swizzles(allocator, expr)) {
+        changed = true;
+      }
+      return ast::Visitor_Status::e_continue;
+    }
+  };
+
+  struct Static_Fold_Swizzles_Visitor
+    : public ast::Static_Visitor<Static_Fold_Swizzles_Visitor> {
+  private:
+    Allocator* allocator;
+
+  public:
+    bool changed = false;
+
+  public:
+    Static_Fold_Swizzles_Visitor(Allocator* allocator): allocator(allocator) {}
+
+    [[nodiscard]] ast::Visitor_Status visit(ast::Expr_Field* expr)
+    {
+      while(rewrite_fold_swizzles(allocator, expr)) {
+        changed = true;
+      }
+      return ast::Visitor_Status::e_continue;
+    }
+  };
+
+  // generate_ast
+  // Generate a function of statement_count statements, each a chain of
+  // chain_length swizzles of a vec4 identifier.
+  //
+  [[nodiscard]] static ast::Node_List generate_ast(Allocator* const allocator,
+                                                   i64 const statement_count,
+                                                   i64 const chain_length)
+  {
+    Source_Info const source_info{};
+    auto const vec4 = VUSH_ALLOCATE(ast::Type_Builtin, allocator, source_info,
+                                    ast::Type_Builtin_Kind::e_vec4);
+    auto const void_type = VUSH_ALLOCATE(ast::Type_Builtin, allocator,
+                                         source_info,
+                                         ast::Type_Builtin_Kind::e_void);
+    ast::Stmt_List body;
+    for(i64 i = 0; i < statement_count; i += 1) {
+      ast::Expr* expr =
+        VUSH_ALLOCATE(ast::Expr_Identifier, allocator, "v"_sv, source_info);
+      expr->evaluated_type = vec4;
+      for(i64 j = 0; j < chain_length; j += 1) {
+        expr = VUSH_ALLOCATE(ast::Expr_Field, allocator, expr,
+                             ast::Identifier{"wzyx"_sv, source_info},
+                             source_info);
+        expr->evaluated_type = vec4;
+      }
+      body.insert_back(
+        VUSH_ALLOCATE(ast::Stmt_Expression, allocator, expr, source_info));
+    }
+
+    ast::Node_List nodes;
+    nodes.insert_back(VUSH_ALLOCATE(
+      ast::Decl_Function, allocator, ast::Attr_List{},
+      ast::Identifier{"f"_sv, source_info}, ast::Fn_Parameter_List{},
+      void_type, ANTON_MOV(body), false, source_info));
+    return nodes;
+  }
+
+  [[nodiscard]] static i64 get_time_ns()
+  {
+    auto const now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+  }
+
+  struct Timings {
+    i64 min_ns = -1;
+    i64 total_ns = 0;
+
+    void add(i64 const time_ns)
+    {
+      if(min_ns < 0 || time_ns < min_ns) {
+        min_ns = time_ns;
+      }
+      total_ns += time_ns;
+    }
+  };
+
+  template<typename Visitor>
+  [[nodiscard]] static i64 time_run(i64 const statement_count,
+                                    i64 const chain_length)
+  {
+    anton::Arena_Allocator allocator(16384);
+    ast::Node_List nodes =
+      generate_ast(&allocator, statement_count, chain_length);
+    Visitor visitor(&allocator);
+    i64 const start = get_time_ns();
+    visitor.run(nodes);
+    i64 const time_ns = get_time_ns() - start;
+    if(!visitor.changed) {
+      anton::print("error: no swizzles have been folded\n"_sv);
+      exit(EXIT_FAILURE);
+    }
+    return time_ns;
+  }
+
+  static void print_timings(Allocator* const allocator,
+                            anton::String_View const name,
+                            Timings const& timings, i64 const run_count)
+  {
+    anton::print(anton::format(allocator, "{}: min {} us, mean {} us\n"_sv,
+                               name, timings.min_ns / 1000,
+                               timings.total_ns / run_count / 1000));
+  }
+
+  i32 benchmark_visitor_main(i32 const argc, char const* const* const argv)
+  {
+    i64 statement_count = 100000;
+    i64 chain_length = 4;
+    i64 run_count = 20;
+    if(argc > 1) {
+      statement_count = atoll(argv[1]);
+    }
+
+    if(argc > 2) {
+      chain_length = atoll(argv[2]);
+    }
+
+    if(argc > 3) {
+      run_count = atoll(argv[3]);
+    }
+
+    if(argc > 4 || statement_count <= 0 || chain_length < 2 ||
+       run_count <= 0) {
+      anton::print(
+        "Usage: vush_benchmark_visitor [STATEMENTS [CHAIN_LENGTH [RUNS]]]\n"
+        "CHAIN_LENGTH must be at least 2.\n"_sv);
+      return EXIT_FAILURE;
+    }
+
+    anton::Allocator allocator;
+    anton::print(anton::format(&allocator,
+                               "{} statements, {} swizzles each, {} runs\n"_sv,
+                               statement_count, chain_length, run_count));
+    Timings virtual_timings;
+    Timings static_timings;
+    for(i64 i = 0; i < run_count; i += 1) {
+      virtual_timings.add(time_run<Virtual_Fold_Swizzles_Visitor>(
+        statement_count, chain_length));
+      static_timings.add(time_run<Static_Fold_Swizzles_Visitor>(
+        statement_count, chain_length));
+    }
+
+    print_timings(&allocator, "ast::Visitor"_sv, virtual_timings, run_count);
+    print_timings(&allocator, "ast::Static_Visitor"_sv, static_timings,
+                  run_count);
+    return EXIT_SUCCESS;
+  }
+} // namespace vush
+
+int main(int argc, char** argv)
+{
+  return vush::benchmark_visitor_main(argc, argv);
+}
@@ -14,13 +14,16 @@
 #include <vush_ast/ast.hpp>
 #include <vush_ast_lowering/lower_ast.hpp>
 #include <vush_ast_opt/opts.hpp>
+#include <vush_ast_opt/pass_manager.hpp>
 #include <vush_core/context.hpp>
 #include <vush_core/memory.hpp>
+#include <vush_core/recycling_allocator.hpp>
 #include <vush_core/source_registry.hpp>
 #include <vush_diagnostics/diagnostics.hpp>
 #include <vush_expansion/expansion.hpp>
 #include <vush_ir/ir.hpp>
 #include <vush_ir/prettyprint.hpp>
+#include <vush_ir_opt/pass_manager.hpp>
 #include <vush_parser/parser.hpp>
 #include <vush_sema/sema.hpp>
 #include <vush_spirv/lower_ir.hpp>
@@ -56,51 +59,142 @@ namespace vush {
   //     }
   // }
 
+  // Thread_Allocators
+  // Owns the bump allocators of the worker threads for the duration of a
+  // compilation.
+  //
+  struct Thread_Allocators {
+  private:
+    Allocator* allocator;
+    Array<Allocator*> allocators;
+
+  public:
+    Thread_Allocators(Allocator* allocator, i64 const count)
+      : allocator(allocator), allocators(allocator)
+    {
+      for(i64 i = 0; i < count; i += 1) {
+        // Same block size as the arena of vushc.
+        auto const arena =
+          VUSH_ALLOCATE(anton::Arena_Allocator, allocator, 16384);
+        allocators.push_back(arena);
+      }
+    }
+
+    Thread_Allocators(Thread_Allocators const&) = delete;
+    Thread_Allocators& operator=(Thread_Allocators const&) = delete;
+
+    ~Thread_Allocators()
+    {
+      for(Allocator* const v: allocators) {
+        auto const arena = static_cast<anton::Arena_Allocator*>(v);
+        arena->~Arena_Allocator();
+        deallocate(allocator, arena);
+      }
+    }
+
+    [[nodiscard]] anton::Slice<Allocator* const> get_allocators() const
+    {
+      return anton::Slice<Allocator* const>(
+        allocators.data(), allocators.data() + allocators.size());
+    }
+  };
+
+  // add_constant_defines
+  // Create global constants for the defines passed via config and prepend them
+  // to the AST. The defines are given a synthetic source "<defines>" with one
+  // 'NAME = VALUE' line per define, so that diagnostics can refer to them.
+  //
+  static void add_constant_defines(Context& ctx,
+                                   Array<Constant_Define> const& defines,
+                                   ast::Node_List& ast)
+  {
+    if(defines.size() == 0) {
+      return;
+    }
+
+    anton::String text(ctx.source_allocator);
+    for(Constant_Define const& define: defines) {
+      text += define.name;
+      text += u8" = "_sv;
+      text += anton::to_string(ctx.bump_allocator, define.value);
+      text += u8"\n"_sv;
+    }
+
+    auto const source =
+      VUSH_ALLOCATE(Source_Data, ctx.source_allocator,
+                    anton::String("<defines>"_sv, ctx.source_allocator),
+                    ANTON_MOV(text));
+    ctx.source_registry->add_source(source);
+
+    char8 const* const data = source->data.bytes_begin();
+    i32 offset = 0;
+    i32 line = 1;
+    ast::Node* previous = nullptr;
+    for(Constant_Define const& define: defines) {
+      i32 const name_size = define.name.size_bytes();
+      anton::String value_string =
+        anton::to_string(ctx.bump_allocator, define.value);
+      i32 const value_offset = offset + name_size + 3;
+      i32 const end_offset = value_offset + value_string.size_bytes();
+      Source_Info const name_info{.source = source,
+                                  .line = line,
+                                  .column = 1,
+                                  .offset = offset,
+                                  .end_offset = offset + name_size};
+      Source_Info const value_info{.source = source,
+                                   .line = line,
+                                   .column = name_size + 4,
+                                   .offset = value_offset,
+                                   .end_offset = end_offset};
+      Source_Info const decl_info{.source = source,
+                                  .line = line,
+                                  .column = 1,
+                                  .offset = offset,
+                                  .end_offset = end_offset};
+      auto const type = VUSH_ALLOCATE(ast::Type_Builtin, ctx.bump_allocator,
+                                      decl_info, ast::Type_Builtin_Kind::e_int);
+      auto const value =
+        VUSH_ALLOCATE(ast::Lt_Integer, ctx.bump_allocator, ast::lt_integer_i32,
+                      define.value, value_info);
+      ast::Identifier const identifier{
+        anton::String_View{data + offset, data + offset + name_size},
+        name_info};
+      auto const variable =
+        VUSH_ALLOCATE(ast::Variable, ctx.bump_allocator, ast::Attr_List{},
+                      type, identifier, value, decl_info);
+      if(previous == nullptr) {
+        ast.insert_front(variable);
+      } else {
+        anton::ilist_insert_after(previous, variable);
+      }
+      previous = variable;
+      // Skip the newline.
+      offset = end_offset + 1;
+      line += 1;
+    }
+  }
+
 #define RETURN_ON_FAIL(variable, fn, ...)                        \
   auto variable = fn(__VA_ARGS__);                               \
   if(!variable) {                                                \
     return {anton::expected_error, ANTON_MOV(variable.error())}; \
   }
 
-  anton::Expected<Build_Result, Error>
-  compile_to_spirv(Configuration const& config, Allocator& allocator,
-                   Allocator& bump_allocator, Source_Callbacks callbacks)
+  // build_ast
+  // Import, parse and expand the main source, then lower its syntax tree to
+  // the AST. The syntax trees are allocated from an arena which is released
+  // once the AST has been built.
+  //
+  [[nodiscard]] static anton::Expected<ast::Node_List, Error>
+  build_ast(Context& ctx, anton::String_View const source_name)
   {
-    Source_Registry registry(&allocator);
-
-    Context ctx{
-      .raii_allocator = &allocator,
-      .bump_allocator = &bump_allocator,
-      .source_registry = &registry,
-      .diagnostics = config.diagnostics,
-      .buffer_definition_cb = config.buffer_definition_cb,
-      .buffer_definition_user_data = config.buffer_definition_user_data,
-
-      .query_source_cb = callbacks.query_source_cb,
-      .query_main_source_user_data = callbacks.query_main_source_user_data,
-      .query_source_user_data = callbacks.query_source_user_data,
-      .import_source_cb = callbacks.import_source_cb,
-      .import_main_source_user_data = callbacks.import_main_source_user_data,
-      .import_source_user_data = callbacks.import_source_user_data,
-    };
+    anton::Arena_Allocator syntax_allocator(16384);
+    ctx.syntax_allocator = &syntax_allocator;
 
-    // TODO: Fix constant defines.
-    // Create symbols for the constant defines passed via config.
-    // for(Constant_Define const& define: config.defines) {
-    // Source_Info src = {"<defines>", 1, 1, 0};
-    // Owning_Ptr decl = allocate_owning<Constant_Declaration>(
-    //     ctx.allocator, allocate_owning<Builtin_Type>(ctx.allocator, Builtin_Type_Builtin_Kind::e_int, src),
-    //     allocate_owning<Identifier>(ctx.allocator, anton::String(define.name), src),
-    //     allocate_owning<Integer_Literal>(ctx.allocator, anton::to_string(define.value), Integer_Literal_Type::i32, Integer_Literal_Base::dec, src),
-    //     src);
-    // ast::Variable const* const node = nullptr;
-    // ctx.add_symbol(Symbol{define.name, node});
-    // }
-
-    RETURN_ON_FAIL(import_result, import_main_source, ctx, config.source_name);
+    RETURN_ON_FAIL(import_result, import_main_source, ctx, source_name);
 
     Source_Data const* const source = import_result.value();
-    RETURN_ON_FAIL(lex_result, lex_source, ctx, config.source_name,
+    RETURN_ON_FAIL(lex_result, lex_source, ctx, source_name,
                    anton::String7_View{source->data.bytes_begin(),
                                        source->data.bytes_end()});
 
@@ -115,33 +209,140 @@ namespace vush {
     RETURN_ON_FAIL(expand_result, full_expand, ctx,
                    ANTON_MOV(parse_result.value()));
 
-    RETURN_ON_FAIL(syntax_lower_result, lower_syntax, ctx,
-                   expand_result.value());
+    anton::Expected<ast::Node_List, Error> result =
+      lower_syntax(ctx, expand_result.value());
+    ctx.syntax_allocator = nullptr;
+    return result;
+  }
+
+  // Stage_IR
+  // The IR module of a stage along with the arena it is allocated from. The
+  // IR and the temporaries of the passes do not accumulate in the bump
+  // allocator and the erased instructions and the temporaries of a pass are
+  // reused by the subsequent passes.
+  //
+  struct Stage_IR {
+    anton::Arena_Allocator ir_allocator;
+    Recycling_Allocator module_allocator;
+    ir::Module module;
+
+    Stage_IR(ast::Decl_Stage_Function const* const stage)
+      : ir_allocator(16384), module_allocator(&ir_allocator),
+        module(lower_ast_to_ir(&module_allocator, stage))
+    {
+    }
+  };
 
-    ast::Node_List& ast_nodes = syntax_lower_result.value();
-    RETURN_ON_FAIL(sema_result, run_sema, ctx, ast_nodes);
+  // lower_stages
+  // Build and analyse the AST of the main source and lower its stages to IR.
+  // The AST and the temporaries of the frontend are allocated from an arena
+  // which is released once all stages have been lowered, before any IR pass
+  // runs. The errors are copied to error_allocator.
+  //
+  [[nodiscard]] static anton::Expected<void, Error>
+  lower_stages(Context& ctx, Configuration const& config,
+               Allocator* const error_allocator,
+               Array<Pass_Statistics>& statistics, Array<Stage_IR*>& stages)
+  {
+    anton::Arena_Allocator ast_allocator(16384);
+    ctx.bump_allocator = &ast_allocator;
+
+    anton::Expected<ast::Node_List, Error> build_result =
+      build_ast(ctx, config.source_name);
+    if(!build_result) {
+      return {anton::expected_error,
+              build_result.error().copy(error_allocator)};
+    }
+
+    ast::Node_List& ast_nodes = build_result.value();
+    add_constant_defines(ctx, config.defines, ast_nodes);
+    anton::Expected<void, Error> sema_result = run_sema(ctx, ast_nodes);
+    if(!sema_result) {
+      return {anton::expected_error, sema_result.error().copy(error_allocator)};
+    }
 
     {
-      bool changed = false;
-      do {
-        changed = false;
-        changed |= run_opt_ast_fold_swizzles(ctx.bump_allocator, ast_nodes);
-      } while(changed);
+      Ast_Rewrite const rewrites[] = {
+        {"fold-swizzles"_sv, rewrite_fold_swizzles},
+      };
+      run_ast_rewrites(ctx.bump_allocator, ast_nodes, rewrites, statistics);
+    }
+
+    for(ast::Node const& node: ast_nodes) {
+      if(node.node_kind != ast::Node_Kind::decl_stage_function) {
+        continue;
+      }
+
+      auto const stage = static_cast<ast::Decl_Stage_Function const*>(&node);
+      stages.push_back(VUSH_ALLOCATE(Stage_IR, ctx.raii_allocator, stage));
+    }
+
+    ctx.bump_allocator = nullptr;
+    return anton::expected_value;
+  }
+
+  anton::Expected<Build_Result, Error>
+  compile_to_spirv(Configuration const& config, Allocator& allocator,
+                   Allocator& bump_allocator, Source_Callbacks callbacks)
+  {
+    Source_Registry registry(&allocator);
+    // Single-threaded compilation does not need any thread allocators.
+    Thread_Allocators const thread_allocators(
+      &allocator, config.sema_threads > 1 ? config.sema_threads : 0);
+    // The sources are referred to by the source information of the IR, hence
+    // they outlive the AST.
+    anton::Arena_Allocator source_allocator(16384);
+
+    Context ctx{
+      .raii_allocator = &allocator,
+      .source_allocator = &source_allocator,
+      .thread_allocators = thread_allocators.get_allocators(),
+      .source_registry = &registry,
+      .diagnostics = config.diagnostics,
+      .buffer_definition_cb = config.buffer_definition_cb,
+      .buffer_definition_user_data = config.buffer_definition_user_data,
+
+      .query_source_cb = callbacks.query_source_cb,
+      .query_main_source_user_data = callbacks.query_main_source_user_data,
+      .query_source_user_data = callbacks.query_source_user_data,
+      .import_source_cb = callbacks.import_source_cb,
+      .import_main_source_user_data = callbacks.import_main_source_user_data,
+      .import_source_user_data = callbacks.import_source_user_data,
+      .module_cache_directory = config.module_cache_directory,
+    };
+
+    Array<Pass_Statistics> statistics{&allocator};
+    Array<Stage_IR*> stages{&allocator};
+    anton::Expected<void, Error> lower_result =
+      lower_stages(ctx, config, &bump_allocator, statistics, stages);
+    if(!lower_result) {
+      for(Stage_IR* const stage: stages) {
+        stage->~Stage_IR();
+        deallocate(&allocator, stage);
+      }
+      return {anton::expected_error, ANTON_MOV(lower_result.error())};
     }
 
-    Array<ir::Module> ir_modules =
-      lower_ast_to_ir(ctx.bump_allocator, ast_nodes);
     Array<Shader> shaders{&allocator};
-    for(ir::Module const& ir_module: ir_modules) {
+    ir::Pass_Manager pass_manager(&bump_allocator);
+    ir::build_pipeline(pass_manager, config.optimisation_level, config.flatten);
+    for(Stage_IR* const stage: stages) {
+      pass_manager.run(&stage->module_allocator, &stage->module);
       spirv::Module spirv_module =
-        lower_ir_module(ctx.bump_allocator, &ir_module);
+        lower_ir_module(&bump_allocator, &stage->module);
       shaders.push_back(
-        Shader{anton::String{ir_module.pass_identifier, &allocator},
-               ir_module.stage, ANTON_MOV(spirv_module)});
+        Shader{anton::String{stage->module.pass_identifier, &allocator},
+               stage->module.stage, ANTON_MOV(spirv_module)});
+      // The arena of the module is released as soon as the module has been
+      // lowered to SPIR-V.
+      stage->~Stage_IR();
+      deallocate(&allocator, stage);
     }
+    pass_manager.append_statistics(statistics);
 
     return {anton::expected_value,
-            Build_Result{Array<Pass_Settings>{&allocator}, ANTON_MOV(shaders)}};
+            Build_Result{Array<Pass_Settings>{&allocator}, ANTON_MOV(shaders),
+                         ANTON_MOV(statistics)}};
   }
 
   [[nodiscard]] static anton::Expected<anton::String, anton::String>
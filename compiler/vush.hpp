@@ -87,12 +87,34 @@ namespace vush {
                                                       anton::String_View path,
                                                       void* user_data);
 
+  enum struct Optimisation_Level : u8 {
+    // No optimisations.
+    o0,
+    // Optimisations that clean up the lowered IR.
+    o1,
+    // All optimisations.
+    o2,
+  };
+
   struct Configuration {
     anton::String source_name;
     Array<Constant_Define> defines;
     buffer_definition_callback buffer_definition_cb = nullptr;
     void* buffer_definition_user_data = nullptr;
     Diagnostics_Options diagnostics;
+    // The number of threads used to analyse function bodies. Values less than
+    // 2 result in the bodies being analysed serially on the calling thread.
+    // The allocator passed to compile_to_spirv must be thread-safe when more
+    // than 1 thread is requested.
+    i32 sema_threads = 1;
+    // The directory in which the precompiled modules of the imported sources
+    // are stored. The directory must exist. Empty disables the modules.
+    anton::String module_cache_directory;
+    Optimisation_Level optimisation_level = Optimisation_Level::o0;
+    // Whether all calls, except those to the functions marked @noinline, are
+    // inlined into the stage entry at o1 and o2. Otherwise the calls are
+    // inlined by the cost model at o2 only. Has no effect at o0.
+    bool flatten = false;
   };
 
   struct Source_Callbacks {
@@ -111,9 +133,21 @@ namespace vush {
     spirv::Module spirv;
   };
 
+  struct Pass_Statistics {
+    // Names of the passes are static strings.
+    anton::String_View pass_name;
+    // The number of changes made by the pass.
+    i64 changes = 0;
+    // The time spent in the pass in nanoseconds. The AST rewrites run fused
+    // in a single traversal and do not record time.
+    i64 time_ns = 0;
+  };
+
   struct Build_Result {
     Array<Pass_Settings> settings;
     Array<Shader> shaders;
+    // Statistics of the optimisation passes in the order they have been run.
+    Array<Pass_Statistics> statistics;
   };
 
   // compile_to_spirv
@@ -106,6 +106,9 @@ namespace vush::ast {
     Identifier identifier;
     // nullptr when Variable does not have an initializer.
     Expr* initializer;
+    // Whether the variable is a compile-time constant. The initializer of a
+    // constant has been folded into a literal of the type of the variable.
+    bool constant = false;
 
     Variable(Attr_List&& attributes, Type* type, Identifier identifier,
              Expr* initializer, Source_Info const& source_info)
@@ -487,7 +490,7 @@ namespace vush::ast {
 
     Lt_Float(detail::Lt_Float_Tag<Lt_Float_Kind::f64>, f64 value,
              Source_Info const& source_info)
-      : Expr(source_info, Node_Kind::lt_float), f32_value(value),
+      : Expr(source_info, Node_Kind::lt_float), f64_value(value),
         kind(Lt_Float_Kind::f64)
     {
     }
@@ -574,39 +577,46 @@ namespace vush::ast {
   };
 
   struct Stmt_While: public Stmt {
+    Attr_List attributes;
     Expr* condition;
     Stmt_List statements;
 
-    Stmt_While(Expr* condition, Stmt_List&& statements,
+    Stmt_While(Attr_List&& attributes, Expr* condition, Stmt_List&& statements,
                Source_Info const& source_info)
-      : Stmt(source_info, Node_Kind::stmt_while), condition(condition),
+      : Stmt(source_info, Node_Kind::stmt_while),
+        attributes(ANTON_MOV(attributes)), condition(condition),
         statements(ANTON_MOV(statements))
     {
     }
   };
 
   struct Stmt_Do_While: public Stmt {
+    Attr_List attributes;
     Expr* condition;
     Stmt_List statements;
 
-    Stmt_Do_While(Expr* condition, Stmt_List&& statements,
-                  Source_Info const& source_info)
-      : Stmt(source_info, Node_Kind::stmt_do_while), condition(condition),
+    Stmt_Do_While(Attr_List&& attributes, Expr* condition,
+                  Stmt_List&& statements, Source_Info const& source_info)
+      : Stmt(source_info, Node_Kind::stmt_do_while),
+        attributes(ANTON_MOV(attributes)), condition(condition),
         statements(ANTON_MOV(statements))
     {
     }
   };
 
   struct Stmt_For: public Stmt {
+    Attr_List attributes;
     // nullptr if the loop does not have a condition.
     Expr* condition;
     Variable_List declarations;
     Expr_List actions;
     Stmt_List statements;
 
-    Stmt_For(Expr* condition, Variable_List&& declarations, Expr_List&& actions,
+    Stmt_For(Attr_List&& attributes, Expr* condition,
+             Variable_List&& declarations, Expr_List&& actions,
              Stmt_List&& statements, Source_Info const& source_info)
-      : Stmt(source_info, Node_Kind::stmt_for), condition(condition),
+      : Stmt(source_info, Node_Kind::stmt_for),
+        attributes(ANTON_MOV(attributes)), condition(condition),
         declarations(ANTON_MOV(declarations)), actions(ANTON_MOV(actions)),
         statements(ANTON_MOV(statements))
     {
@@ -0,0 +1,454 @@
+#pragma once
+
+#include <anton/intrinsics.hpp>
+
+#include <vush_ast/ast.hpp>
+#include <vush_ast/visitor.hpp>
+
+namespace vush::ast {
+  // Static_Visitor
+  // A visitor whose traversal is instantiated for every derived visitor. The
+  // derived visitor implements visit for the node kinds it is interested in
+  // with the same signatures as Visitor, but without virtual. The visits must
+  // be public. Visits of the node kinds the derived visitor does not implement
+  // are compiled out.
+  //
+  // Usage:
+  //   struct My_Visitor: public ast::Static_Visitor<My_Visitor> {
+  //     ast::Visitor_Status visit(ast::Expr_Field* expr);
+  //   };
+  //
+  template<typename Derived>
+  struct Static_Visitor {
+  public:
+    void run(ast::Node_List& list)
+    {
+      for(ast::Node& node: list) {
+        Visitor_Status const status = traverse_decl(&node);
+        if(status == Visitor_Status::e_stop) {
+          return;
+        }
+      }
+    }
+
+  private:
+    [[nodiscard]] Derived& derived()
+    {
+      return *static_cast<Derived*>(this);
+    }
+
+    template<typename T>
+    [[nodiscard]] Visitor_Status visit_node(T* const node)
+    {
+      if constexpr(requires(Derived& d, T* n) { d.visit(n); }) {
+        return derived().visit(node);
+      } else {
+        ANTON_UNUSED(node);
+        return Visitor_Status::e_continue;
+      }
+    }
+
+    [[nodiscard]] static Visitor_Status
+    continue_parent_to_continue(Visitor_Status const status)
+    {
+      return status == Visitor_Status::e_continue_parent
+               ? Visitor_Status::e_continue
+               : status;
+    }
+
+    // traverse_types
+    // Visit the types of a list. The list is skipped entirely when the derived
+    // visitor does not visit types.
+    //
+    template<typename List>
+    [[nodiscard]] Visitor_Status traverse_types(List& list)
+    {
+      if constexpr(requires(Derived& d, Type* t) { d.visit(t); }) {
+        for(auto& node: list) {
+          Visitor_Status const status = visit_node(node.type);
+          if(status != Visitor_Status::e_continue) {
+            return status;
+          }
+        }
+      } else {
+        ANTON_UNUSED(list);
+      }
+      return Visitor_Status::e_continue;
+    }
+
+    template<typename List>
+    [[nodiscard]] Visitor_Status traverse_stmt_list(List& list)
+    {
+      for(auto& node: list) {
+        Visitor_Status const status = traverse_stmt(&node);
+        if(status != Visitor_Status::e_continue) {
+          return status;
+        }
+      }
+      return Visitor_Status::e_continue;
+    }
+
+    template<typename List>
+    [[nodiscard]] Visitor_Status traverse_expr_list(List& list)
+    {
+      for(auto& node: list) {
+        Visitor_Status const status = traverse_expr(&node);
+        if(status != Visitor_Status::e_continue) {
+          return status;
+        }
+      }
+      return Visitor_Status::e_continue;
+    }
+
+    [[nodiscard]] Visitor_Status traverse_decl(ast::Node* const generic_decl)
+    {
+      switch(generic_decl->node_kind) {
+      case Node_Kind::decl_function: {
+        auto const node = static_cast<Decl_Function*>(generic_decl);
+        Visitor_Status const node_status = visit_node(node);
+        if(node_status != Visitor_Status::e_continue) {
+          return continue_parent_to_continue(node_status);
+        }
+
+        Visitor_Status const return_status = visit_node(node->return_type);
+        if(return_status != Visitor_Status::e_continue) {
+          return continue_parent_to_continue(return_status);
+        }
+
+        Visitor_Status const parameters_status =
+          traverse_types(node->parameters);
+        if(parameters_status == Visitor_Status::e_stop) {
+          return parameters_status;
+        }
+
+        Visitor_Status const body_status = traverse_stmt_list(node->body);
+        if(body_status == Visitor_Status::e_stop) {
+          return body_status;
+        }
+        return Visitor_Status::e_continue;
+      }
+
+      case Node_Kind::decl_stage_function: {
+        auto const node = static_cast<Decl_Stage_Function*>(generic_decl);
+        Visitor_Status const node_status = visit_node(node);
+        if(node_status != Visitor_Status::e_continue) {
+          return continue_parent_to_continue(node_status);
+        }
+
+        Visitor_Status const parameters_status =
+          traverse_types(node->parameters);
+        if(parameters_status == Visitor_Status::e_stop) {
+          return parameters_status;
+        }
+
+        Visitor_Status const body_status = traverse_stmt_list(node->body);
+        if(body_status == Visitor_Status::e_stop) {
+          return body_status;
+        }
+        return Visitor_Status::e_continue;
+      }
+
+      case Node_Kind::decl_struct: {
+        auto const node = static_cast<Decl_Struct*>(generic_decl);
+        Visitor_Status const node_status = visit_node(node);
+        if(node_status != Visitor_Status::e_continue) {
+          return continue_parent_to_continue(node_status);
+        }
+
+        Visitor_Status const fields_status = traverse_types(node->fields);
+        if(fields_status == Visitor_Status::e_stop) {
+          return fields_status;
+        }
+        return Visitor_Status::e_continue;
+      }
+
+      default:
+        return Visitor_Status::e_continue;
+      }
+    }
+
+    [[nodiscard]] Visitor_Status traverse_stmt(ast::Node* const generic_stmt)
+    {
+      // The status of a nested list. e_continue_parent stops the traversal of
+      // the list, but not of its parent.
+      Visitor_Status status = Visitor_Status::e_continue;
+      switch(generic_stmt->node_kind) {
+      case Node_Kind::variable: {
+        auto const stmt = static_cast<Variable*>(generic_stmt);
+        status = visit_node(stmt);
+        if(status != Visitor_Status::e_continue) {
+          return continue_parent_to_continue(status);
+        }
+
+        status = visit_node(stmt->type);
+        if(status != Visitor_Status::e_continue) {
+          return continue_parent_to_continue(status);
+        }
+
+        if(stmt->initializer) {
+          status = traverse_expr(stmt->initializer);
+        }
+        return continue_parent_to_continue(status);
+      }
+
+      case Node_Kind::stmt_block: {
+        auto const stmt = static_cast<Stmt_Block*>(generic_stmt);
+        status = traverse_stmt_list(stmt->statements);
+        break;
+      }
+
+      case Node_Kind::stmt_assignment: {
+        auto const stmt = static_cast<Stmt_Assignment*>(generic_stmt);
+        status = traverse_expr(stmt->lhs);
+        if(status != Visitor_Status::e_continue) {
+          return continue_parent_to_continue(status);
+        }
+
+        status = traverse_expr(stmt->rhs);
+        return continue_parent_to_continue(status);
+      }
+
+      case Node_Kind::stmt_if: {
+        auto const stmt = static_cast<Stmt_If*>(generic_stmt);
+        status = traverse_expr(stmt->condition);
+        if(status != Visitor_Status::e_continue) {
+          return continue_parent_to_continue(status);
+        }
+
+        status = traverse_stmt_list(stmt->then_branch);
+        if(status == Visitor_Status::e_stop) {
+          return status;
+        }
+
+        status = traverse_stmt_list(stmt->else_branch);
+        break;
+      }
+
+      case Node_Kind::stmt_switch: {
+        auto const stmt = static_cast<Stmt_Switch*>(generic_stmt);
+        status = traverse_expr(stmt->expression);
+        if(status != Visitor_Status::e_continue) {
+          return continue_parent_to_continue(status);
+        }
+
+        for(Switch_Arm& arm: stmt->arms) {
+          status = traverse_expr_list(arm.labels);
+          if(status == Visitor_Status::e_stop) {
+            return status;
+          }
+
+          status = traverse_stmt_list(arm.statements);
+          if(status == Visitor_Status::e_stop) {
+            return status;
+          }
+        }
+        break;
+      }
+
+      case Node_Kind::stmt_for: {
+        auto const stmt = static_cast<Stmt_For*>(generic_stmt);
+        for(Variable& declaration: stmt->declarations) {
+          status = visit_node(&declaration);
+          if(status == Visitor_Status::e_stop) {
+            return status;
+          }
+
+          if(status == Visitor_Status::e_continue_parent) {
+            break;
+          }
+        }
+
+        if(stmt->condition) {
+          status = traverse_expr(stmt->condition);
+          if(status != Visitor_Status::e_continue) {
+            return continue_parent_to_continue(status);
+          }
+        }
+
+        status = traverse_expr_list(stmt->actions);
+        if(status == Visitor_Status::e_stop) {
+          return status;
+        }
+
+        status = traverse_stmt_list(stmt->statements);
+        break;
+      }
+
+      case Node_Kind::stmt_while: {
+        auto const stmt = static_cast<Stmt_While*>(generic_stmt);
+        status = traverse_expr(stmt->condition);
+        if(status != Visitor_Status::e_continue) {
+          return continue_parent_to_continue(status);
+        }
+
+        status = traverse_stmt_list(stmt->statements);
+        break;
+      }
+
+      case Node_Kind::stmt_do_while: {
+        auto const stmt = static_cast<Stmt_Do_While*>(generic_stmt);
+        status = traverse_stmt_list(stmt->statements);
+        if(status == Visitor_Status::e_stop) {
+          return status;
+        }
+
+        status = traverse_expr(stmt->condition);
+        return continue_parent_to_continue(status);
+      }
+
+      case Node_Kind::stmt_return: {
+        auto const stmt = static_cast<Stmt_Return*>(generic_stmt);
+        if(stmt->expression) {
+          status = traverse_expr(stmt->expression);
+        }
+        return continue_parent_to_continue(status);
+      }
+
+      case Node_Kind::stmt_expression: {
+        auto const stmt = static_cast<Stmt_Expression*>(generic_stmt);
+        status = traverse_expr(stmt->expression);
+        return continue_parent_to_continue(status);
+      }
+
+      case Node_Kind::stmt_break:
+      case Node_Kind::stmt_continue:
+      case Node_Kind::stmt_discard:
+        return Visitor_Status::e_continue;
+
+      default:
+        ANTON_UNREACHABLE("unreachable");
+      }
+
+      return status == Visitor_Status::e_stop ? status
+                                              : Visitor_Status::e_continue;
+    }
+
+    [[nodiscard]] Visitor_Status traverse_expr(ast::Expr* const generic_expr)
+    {
+      Visitor_Status status = Visitor_Status::e_continue;
+      switch(generic_expr->node_kind) {
+      case Node_Kind::expr_if: {
+        auto const expr = static_cast<Expr_If*>(generic_expr);
+        status = visit_node(expr);
+        if(status != Visitor_Status::e_continue) {
+          return continue_parent_to_continue(status);
+        }
+
+        status = traverse_expr(expr->condition);
+        if(status != Visitor_Status::e_continue) {
+          return continue_parent_to_continue(status);
+        }
+
+        status = traverse_expr(expr->then_branch);
+        if(status != Visitor_Status::e_continue) {
+          return continue_parent_to_continue(status);
+        }
+
+        status = traverse_expr(expr->else_branch);
+        return continue_parent_to_continue(status);
+      }
+
+      case Node_Kind::expr_identifier: {
+        auto const expr = static_cast<Expr_Identifier*>(generic_expr);
+        status = visit_node(expr);
+        return continue_parent_to_continue(status);
+      }
+
+      case Node_Kind::expr_init: {
+        auto const expr = static_cast<Expr_Init*>(generic_expr);
+        status = visit_node(expr->type);
+        if(status != Visitor_Status::e_continue) {
+          return continue_parent_to_continue(status);
+        }
+
+        for(Initializer& node: expr->initializers) {
+          if(node.node_kind == Node_Kind::basic_initializer) {
+            auto const initializer = static_cast<Basic_Initializer*>(&node);
+            status = traverse_expr(initializer->expression);
+          } else if(node.node_kind == Node_Kind::field_initializer) {
+            auto const initializer = static_cast<Field_Initializer*>(&node);
+            status = traverse_expr(initializer->expression);
+          } else { // Node_Kind::index_initializer
+            auto const initializer = static_cast<Index_Initializer*>(&node);
+            status = traverse_expr(initializer->expression);
+            if(status == Visitor_Status::e_continue) {
+              status = visit_node(initializer->index);
+            }
+          }
+
+          if(status != Visitor_Status::e_continue) {
+            break;
+          }
+        }
+        break;
+      }
+
+      case Node_Kind::expr_call: {
+        auto const expr = static_cast<Expr_Call*>(generic_expr);
+        status = visit_node(expr);
+        if(status != Visitor_Status::e_continue) {
+          return continue_parent_to_continue(status);
+        }
+
+        status = traverse_expr_list(expr->arguments);
+        break;
+      }
+
+      case Node_Kind::expr_field: {
+        auto const expr = static_cast<Expr_Field*>(generic_expr);
+        status = visit_node(expr);
+        if(status != Visitor_Status::e_continue) {
+          return continue_parent_to_continue(status);
+        }
+
+        status = traverse_expr(expr->base);
+        return continue_parent_to_continue(status);
+      }
+
+      case Node_Kind::expr_index: {
+        auto const expr = static_cast<Expr_Index*>(generic_expr);
+        status = visit_node(expr);
+        if(status != Visitor_Status::e_continue) {
+          return continue_parent_to_continue(status);
+        }
+
+        status = traverse_expr(expr->base);
+        if(status != Visitor_Status::e_continue) {
+          return continue_parent_to_continue(status);
+        }
+
+        status = traverse_expr(expr->index);
+        return continue_parent_to_continue(status);
+      }
+
+      case Node_Kind::expr_reinterpret:
+      case Node_Kind::expr_default:
+        return Visitor_Status::e_continue;
+
+      case Node_Kind::lt_bool: {
+        auto const expr = static_cast<Lt_Bool*>(generic_expr);
+        status = visit_node(expr);
+        return continue_parent_to_continue(status);
+      }
+
+      case Node_Kind::lt_integer: {
+        auto const expr = static_cast<Lt_Integer*>(generic_expr);
+        status = visit_node(expr);
+        return continue_parent_to_continue(status);
+      }
+
+      case Node_Kind::lt_float: {
+        auto const expr = static_cast<Lt_Float*>(generic_expr);
+        status = visit_node(expr);
+        return continue_parent_to_continue(status);
+      }
+
+      default:
+        ANTON_UNREACHABLE("unreachable");
+      }
+
+      return status == Visitor_Status::e_stop ? status
+                                              : Visitor_Status::e_continue;
+    }
+  };
+} // namespace vush::ast
@@ -399,14 +399,22 @@ namespace vush::ast {
 
   bool is_sized_array(Type const& type)
   {
-    return type.type_kind == Type_Kind::type_array &&
-           static_cast<Type_Array const&>(type).size;
+    if(type.type_kind != Type_Kind::type_array) {
+      return false;
+    }
+
+    auto const& array = static_cast<Type_Array const&>(type);
+    return array.size || array.size_expression;
   }
 
   bool is_unsized_array(Type const& type)
   {
-    return type.type_kind == Type_Kind::type_array &&
-           !static_cast<Type_Array const&>(type).size;
+    if(type.type_kind != Type_Kind::type_array) {
+      return false;
+    }
+
+    auto const& array = static_cast<Type_Array const&>(type);
+    return !array.size && !array.size_expression;
   }
 
   bool is_image_type(Type const& type)
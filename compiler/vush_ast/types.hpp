@@ -321,8 +321,12 @@ namespace vush::ast {
 
   struct Type_Array: public Type {
     Type* base;
-    // nullptr when the array is unsized.
+    // nullptr when the array is unsized or its size has not been evaluated
+    // yet.
     Lt_Integer* size;
+    // The constant expression specifying the size when the size is not a
+    // literal. nullptr otherwise. Evaluated into size by sema.
+    Expr* size_expression = nullptr;
 
     Type_Array(Source_Info const& source_info, Type* base, Lt_Integer* size)
       : Type(source_info, Type_Kind::type_array), base(base), size(size)
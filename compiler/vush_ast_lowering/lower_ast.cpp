@@ -1,7 +1,6 @@
 #include <vush_ast_lowering/lower_ast.hpp>
 
 #include <anton/expected.hpp>
-#include <anton/flat_hash_set.hpp>
 #include <anton/iterators/zip.hpp>
 #include <anton/math/math.hpp>
 #include <anton/ranges.hpp>
@@ -11,9 +10,9 @@
 #include <vush_ast/ast.hpp>
 #include <vush_autogen/builtin_symbols.hpp>
 #include <vush_core/memory.hpp>
-#include <vush_core/running_hash.hpp>
 #include <vush_core/scoped_map.hpp>
 #include <vush_core/utility.hpp>
+#include <vush_ir/analysis.hpp>
 #include <vush_ir/ir.hpp>
 #include <vush_ir/types.hpp>
 
@@ -21,7 +20,8 @@ namespace vush {
   using namespace anton::literals;
 
   namespace {
-    using Fn_Table = Scoped_Map<anton::String_View, ir::Function*>;
+    using Fn_Table =
+      anton::Flat_Hash_Map<ast::Decl_Function const*, ir::Function*>;
     using Symbol_Table = Scoped_Map<anton::String_View, ir::Value*>;
     // Maps namespace (pass) to table of symbols.
     using Buffer_Table = anton::Flat_Hash_Map<
@@ -32,30 +32,50 @@ namespace vush {
     public:
       Allocator* allocator;
       Fn_Table fntable;
+      // The functions that have been called, but not lowered yet.
+      Array<ast::Decl_Function const*> pending_functions;
       Symbol_Table symtable;
       Buffer_Table buftable;
-      anton::Flat_Hash_Map<u64, ir::Type*> type_table;
+      // Caches the lowered types of the AST type nodes.
+      anton::Flat_Hash_Map<ast::Type const*, ir::Type*> type_table;
+      ir::Type_Interner types;
 
       ir::Basic_Block* nearest_converge_block = nullptr;
       ir::Basic_Block* nearest_continuation_block = nullptr;
       ast::Type const* current_function_return_type = nullptr;
 
     private:
-      i64 id = 0;
+      u32 id = 0;
+      u32 buffer_id = 0;
 
     public:
       Lowering_Context(Allocator* allocator)
-        : allocator(allocator), fntable(allocator), symtable(allocator),
-          buftable(allocator), type_table(allocator)
+        : allocator(allocator), fntable(allocator),
+          pending_functions(allocator), symtable(allocator),
+          buftable(allocator), type_table(allocator), types(allocator)
       {
       }
 
-      [[nodiscard]] i64 next_id()
+      [[nodiscard]] u32 next_id()
       {
-        i64 const value = id;
+        u32 const value = id;
         id += 1;
         return value;
       }
+
+      // The ids of the lowered module continue from this id.
+      [[nodiscard]] u32 get_id_bound() const
+      {
+        return id;
+      }
+
+      // Buffers are numbered separately to keep their ids dense.
+      [[nodiscard]] u32 next_buffer_id()
+      {
+        u32 const value = buffer_id;
+        buffer_id += 1;
+        return value;
+      }
     };
 
     struct Builder {
@@ -713,50 +733,13 @@ namespace vush {
     }
   }
 
-  static void hash_type(Running_Hash& hash, ast::Type const* const type)
-  {
-    switch(type->type_kind) {
-    case ast::Type_Kind::type_builtin: {
-      auto const t = static_cast<ast::Type_Builtin const*>(type);
-      hash.feed("builtin"_sv);
-      hash.feed(static_cast<u8>(t->value));
-    } break;
-
-    case ast::Type_Kind::type_array: {
-      auto const t = static_cast<ast::Type_Array const*>(type);
-      hash.feed("array"_sv);
-      if(t->size) {
-        hash.feed(ast::get_lt_integer_value_as_u32(*t->size));
-      } else {
-        hash.feed((u8)0);
-      }
-      hash_type(hash, t->base);
-    } break;
-
-    case ast::Type_Kind::type_struct: {
-      auto const t = static_cast<ast::Type_Struct const*>(type);
-      hash.feed("struct"_sv);
-      // TODO: Ignores attributes. On the other hand, an identifier is unique,
-      //       so a type must be unique regardless of the attributes.
-      hash.feed(t->definition->identifier.value);
-      for(ast::Struct_Field const& field: t->definition->fields) {
-        hash_type(hash, field.type);
-      }
-    } break;
-    }
-  }
-
   [[nodiscard]] static ir::Type* lower_type(Lowering_Context& ctx,
                                             ast::Type const* const type)
   {
-    Running_Hash hash;
-    hash.start();
-    hash_type(hash, type);
-    u64 const value = hash.finish();
-    auto iter = ctx.type_table.find(value);
+    auto iter = ctx.type_table.find(type);
     if(iter == ctx.type_table.end()) {
-      auto const result = make_new_type_instance(ctx, type);
-      iter = ctx.type_table.emplace(value, result);
+      auto const result = ctx.types.intern(make_new_type_instance(ctx, type));
+      iter = ctx.type_table.emplace(type, result);
     }
     return iter->value;
   }
@@ -1231,10 +1214,8 @@ namespace vush {
     builder.set_insert_block(converge_block);
     auto const phi = ir::make_instr_phi(ctx.allocator, ctx.next_id(),
                                         ir::get_type_ptr(), expr->source_info);
-    phi->srcs.push_back(then_result);
-    then_result->add_referrer(phi);
-    phi->srcs.push_back(else_result);
-    else_result->add_referrer(phi);
+    phi->add_source(then_result, branch_from_then->block);
+    phi->add_source(else_result, branch_from_else->block);
     builder.insert(phi);
     return phi;
   }
@@ -1546,8 +1527,7 @@ namespace vush {
             auto const extract = ir::make_instr_composite_extract(
               ctx.allocator, ctx.next_id(), source_type->column_type, value, i,
               initializer->source_info);
-            auto const column_type = VUSH_ALLOCATE(
-              ir::Type_Vec, ctx.allocator,
+            auto const column_type = ir::get_type_vec(
               constructed_type->column_type->element_type, matrix_rows);
             auto const column = construct_vec_from_vec(
               ctx, builder, column_type, extract, initializer->source_info);
@@ -1565,19 +1545,18 @@ namespace vush {
           // TODO: Propagate error.
           ANTON_ASSERT(element.holds_value(), "invalid conversion");
           for(i64 i = 0; i < matrix_cols; i += 1) {
-            auto const column_type = VUSH_ALLOCATE(
-              ir::Type_Vec, ctx.allocator,
+            auto const column_type = ir::get_type_vec(
               constructed_type->column_type->element_type, matrix_rows);
             auto const column = ir::make_instr_composite_construct(
               ctx.allocator, ctx.next_id(), column_type, expr->source_info);
-            // Fill the column with 0s.
+            // Fill the column with 0s and set the correct element to the
+            // value.
             for(i64 r = 0; r < matrix_rows; r += 1) {
-              column->add_element(zero);
-            }
-
-            // Set the correct element to the value.
-            if(i < matrix_rows) {
-              column->elements[i] = element.value();
+              if(r == i) {
+                column->add_element(element.value());
+              } else {
+                column->add_element(zero);
+              }
             }
 
             construct->add_element(column);
@@ -1592,8 +1571,7 @@ namespace vush {
         auto initializer =
           safe_cast<ast::Basic_Initializer const*>(expr->initializers.front());
         for(i64 col_idx = 0; col_idx < matrix_cols; col_idx += 1) {
-          auto const column_type = VUSH_ALLOCATE(
-            ir::Type_Vec, ctx.allocator,
+          auto const column_type = ir::get_type_vec(
             constructed_type->column_type->element_type, matrix_rows);
           auto const column = ir::make_instr_composite_construct(
             ctx.allocator, ctx.next_id(), column_type, expr->source_info);
@@ -1614,8 +1592,7 @@ namespace vush {
             static_cast<ast::Basic_Initializer const&>(ginitializer);
           auto const source =
             lower_expression(ctx, builder, initializer.expression);
-          auto const column_type = VUSH_ALLOCATE(
-            ir::Type_Vec, ctx.allocator,
+          auto const column_type = ir::get_type_vec(
             constructed_type->column_type->element_type, matrix_rows);
           auto const column = construct_vec_from_vec(
             ctx, builder, column_type, source, initializer.source_info);
@@ -1628,19 +1605,17 @@ namespace vush {
       auto const one = make_constant_for_type(
         ctx.allocator, constructed_type->column_type->element_type->kind, 1);
       for(i64 i = construct->elements.size(); i < matrix_cols; i += 1) {
-        auto const column_type = VUSH_ALLOCATE(
-          ir::Type_Vec, ctx.allocator,
+        auto const column_type = ir::get_type_vec(
           constructed_type->column_type->element_type, matrix_rows);
         auto const column = ir::make_instr_composite_construct(
           ctx.allocator, ctx.next_id(), column_type, expr->source_info);
-        // Fill the column with 0s.
+        // Fill the column with 0s and set the correct element to 1.
         for(i64 r = 0; r < matrix_rows; r += 1) {
-          column->add_element(zero);
-        }
-
-        // Set the correct element to 1.
-        if(i < matrix_rows) {
-          column->elements[i] = one;
+          if(r == i) {
+            column->add_element(one);
+          } else {
+            column->add_element(zero);
+          }
         }
 
         construct->add_element(column);
@@ -1846,8 +1821,8 @@ namespace vush {
       builder.set_insert_block(converge_block);
       auto const phi = ir::make_instr_phi(
         ctx.allocator, ctx.next_id(), ir::get_type_bool(), expr->source_info);
-      phi->add_source(lhs);
-      phi->add_source(rhs);
+      phi->add_source(lhs, brcond->block);
+      phi->add_source(rhs, branch->block);
       builder.insert(phi);
       return phi;
     }
@@ -1903,6 +1878,47 @@ namespace vush {
     return call;
   }
 
+  [[nodiscard]] static ir::Inline_Hint
+  select_inline_hint(ast::Decl_Function const* const fn)
+  {
+    for(ast::Attribute const& attribute: fn->attributes) {
+      if(attribute.identifier.value == "inline"_sv) {
+        return ir::Inline_Hint::e_inline;
+      }
+
+      if(attribute.identifier.value == "noinline"_sv) {
+        return ir::Inline_Hint::e_noinline;
+      }
+    }
+    return ir::Inline_Hint::e_none;
+  }
+
+  // get_function
+  // Get the IR function of the AST function. The function is created and
+  // queued for lowering when it is called for the first time, hence only the
+  // functions reachable from the stage are lowered.
+  //
+  [[nodiscard]] static ir::Function*
+  get_function(Lowering_Context& ctx, ast::Decl_Function const* const ast_fn)
+  {
+    auto iterator = ctx.fntable.find(ast_fn);
+    if(iterator != ctx.fntable.end()) {
+      return iterator->value;
+    }
+
+    auto const return_type = lower_type(ctx, ast_fn->return_type);
+    auto const entry_block =
+      VUSH_ALLOCATE(ir::Basic_Block, ctx.allocator, ctx.next_id());
+    anton::String identifier{ast_fn->identifier.value, ctx.allocator};
+    auto const fn = VUSH_ALLOCATE(ir::Function, ctx.allocator, ctx.next_id(),
+                                  return_type, entry_block,
+                                  ANTON_MOV(identifier), ast_fn->source_info);
+    fn->inline_hint = select_inline_hint(ast_fn);
+    ctx.fntable.emplace(ast_fn, fn);
+    ctx.pending_functions.push_back(ast_fn);
+    return fn;
+  }
+
   [[nodiscard]] static ir::Instr*
   lower_expr_call(Lowering_Context& ctx, Builder& builder,
                   ast::Expr_Call const* const expr)
@@ -1915,12 +1931,10 @@ namespace vush {
         return lower_builtin_function_call(ctx, builder, expr);
       }
     } else {
-      ir::Function* const* const function =
-        ctx.fntable.find_entry(expr->identifier.value);
-      ANTON_ASSERT(function != nullptr, "call has no function");
+      ir::Function* const function = get_function(ctx, fn);
       ir::Type* const type = lower_type(ctx, expr->evaluated_type);
       auto const call = ir::make_instr_call(ctx.allocator, ctx.next_id(),
-                                            *function, type, expr->source_info);
+                                            function, type, expr->source_info);
       for(auto [arg, param]:
           anton::zip(expr->arguments, expr->function->parameters)) {
         auto const value =
@@ -1975,14 +1989,8 @@ namespace vush {
     builder.set_insert_block(converge_block);
     auto const phi = ir::make_instr_phi(ctx.allocator, ctx.next_id(),
                                         then_result->type, expr->source_info);
-    ANTON_ASSERT(instanceof<ir::Instr>(then_result),
-                 "phi argument is not an instruction");
-    phi->srcs.push_back(static_cast<ir::Instr*>(then_result));
-    then_result->add_referrer(phi);
-    ANTON_ASSERT(instanceof<ir::Instr>(else_result),
-                 "phi argument is not an instruction");
-    phi->srcs.push_back(static_cast<ir::Instr*>(else_result));
-    else_result->add_referrer(phi);
+    phi->add_source(then_result, jmp_from_then->block);
+    phi->add_source(else_result, jmp_from_else->block);
     builder.insert(phi);
     return phi;
   }
@@ -2010,7 +2018,9 @@ namespace vush {
       }
 
       case ast::Lt_Integer_Kind::u32: {
-        return nullptr;
+        auto const value =
+          ir::make_constant_u32(ctx.allocator, expr->u32_value);
+        return value;
       }
       }
     } break;
@@ -2034,6 +2044,15 @@ namespace vush {
 
     case ast::Node_Kind::expr_identifier: {
       auto const expr = static_cast<ast::Expr_Identifier const*>(generic_expr);
+      // Constants have their initializers folded into literals by sema, hence
+      // we lower the literal instead of loading from the variable.
+      if(expr->definition->node_kind == ast::Node_Kind::variable) {
+        auto const variable =
+          static_cast<ast::Variable const*>(expr->definition);
+        if(variable->constant) {
+          return lower_expression(ctx, builder, variable->initializer);
+        }
+      }
       return lower_expr_identifier(ctx, builder, expr);
     }
 
@@ -2312,9 +2331,56 @@ namespace vush {
     return stopped_then && stopped_else;
   }
 
+  // make_scf_loop_head
+  // Create the loop head of a loop carrying the unroll attribute of the loop.
+  //
+  [[nodiscard]] static ir::Intrinsic_scf_loop_head*
+  make_scf_loop_head(Lowering_Context& ctx, ast::Attr_List const& attributes,
+                     ir::Basic_Block* const merge_block,
+                     ir::Basic_Block* const continue_block)
+  {
+    ir::Unroll_Hint unroll_hint = ir::Unroll_Hint::e_none;
+    i64 unroll_count = 0;
+    for(ast::Attribute const& attribute: attributes) {
+      if(attribute.identifier.value == "unroll"_sv) {
+        unroll_hint = ir::Unroll_Hint::e_unroll;
+        for(ast::Attribute_Parameter const& parameter: attribute.parameters) {
+          auto const& count =
+            static_cast<ast::Lt_Integer const&>(*parameter.value);
+          unroll_count = ast::get_lt_integer_value_as_u32(count);
+        }
+      }
+
+      if(attribute.identifier.value == "nounroll"_sv) {
+        unroll_hint = ir::Unroll_Hint::e_nounroll;
+      }
+    }
+    return ir::make_intrinsic_scf_loop_head(ctx.allocator, merge_block,
+                                            continue_block, unroll_hint,
+                                            unroll_count);
+  }
+
+  // Loops are lowered into the following blocks:
+  //   header - contains only the loop head and a branch into the loop. The
+  //            target of the back edge.
+  //   condition - evaluates the condition of the loop and branches either to
+  //               the loop block or the converge block. Precedes the loop
+  //               block in for and while loops and follows it in do-while
+  //               loops.
+  //   loop - the statements of the loop.
+  //   continuation - the target of continue statements which contains the back
+  //                  edge. The condition block in do-while loops.
+  //   converge - the target of break statements.
+  //
+  // The nearest converge and continuation blocks are saved and restored around
+  // the lowering of the loop so that break and continue statements following
+  // nested loops jump to the correct blocks.
+
   static void lower_stmt_for(Lowering_Context& ctx, Builder& builder,
                              ast::Stmt_For const* const stmt)
   {
+    auto const header_block =
+      VUSH_ALLOCATE(ir::Basic_Block, ctx.allocator, ctx.next_id());
     auto const condition_block =
       VUSH_ALLOCATE(ir::Basic_Block, ctx.allocator, ctx.next_id());
     auto const loop_block =
@@ -2324,21 +2390,9 @@ namespace vush {
     auto const converge_block =
       VUSH_ALLOCATE(ir::Basic_Block, ctx.allocator, ctx.next_id());
 
-    // TODO: Nested loops will overwrite that and cause incorrrect jumps from
-    //       continue and break. Example:
-    //
-    //         for(...) { #1
-    //           if(x) {
-    //             break;
-    //           }
-    //           for(...) { #2
-    //             ...
-    //           }
-    //           if(y) {
-    //             break; <- jumps to the converge block of #2 instead of #1
-    //           }
-    //         }
-    //
+    ir::Basic_Block* const previous_continuation_block =
+      ctx.nearest_continuation_block;
+    ir::Basic_Block* const previous_converge_block = ctx.nearest_converge_block;
     ctx.nearest_continuation_block = continuation_block;
     ctx.nearest_converge_block = converge_block;
 
@@ -2347,26 +2401,43 @@ namespace vush {
       lower_variable(ctx, builder, &variable);
     }
 
-    // Branch to the condition block from wherever we are.
+    // Branch to the header block from wherever we are.
     ir::Instr* branch = ir::make_instr_branch(
-      ctx.allocator, ctx.next_id(), condition_block, stmt->source_info);
+      ctx.allocator, ctx.next_id(), header_block, stmt->source_info);
     builder.insert(branch);
 
-    // Lower the condition.
+    builder.set_insert_block(header_block);
+    auto const scf_loop_head = make_scf_loop_head(
+      ctx, stmt->attributes, converge_block, continuation_block);
+    builder.insert(scf_loop_head);
+    auto const branch_to_condition = ir::make_instr_branch(
+      ctx.allocator, ctx.next_id(), condition_block, stmt->source_info);
+    builder.insert(branch_to_condition);
+
+    // Lower the condition. A loop without a condition is entered
+    // unconditionally.
     builder.set_insert_block(condition_block);
-    ir::Value* const condition =
-      lower_expression(ctx, builder, stmt->condition);
-    auto const brcond =
-      ir::make_instr_brcond(ctx.allocator, ctx.next_id(), condition, loop_block,
-                            converge_block, stmt->source_info);
-    builder.insert(brcond);
+    if(stmt->condition != nullptr) {
+      ir::Value* const condition =
+        lower_expression(ctx, builder, stmt->condition);
+      auto const brcond =
+        ir::make_instr_brcond(ctx.allocator, ctx.next_id(), condition,
+                              loop_block, converge_block, stmt->source_info);
+      builder.insert(brcond);
+    } else {
+      auto const branch_to_loop = ir::make_instr_branch(
+        ctx.allocator, ctx.next_id(), loop_block, stmt->source_info);
+      builder.insert(branch_to_loop);
+    }
 
     // Lower the loop block and branch to continuation.
     builder.set_insert_block(loop_block);
-    lower_statement_block(ctx, builder, stmt->statements);
-    auto const branch_to_continuation = ir::make_instr_branch(
-      ctx.allocator, ctx.next_id(), continuation_block, stmt->source_info);
-    builder.insert(branch_to_continuation);
+    bool const stopped = lower_statement_block(ctx, builder, stmt->statements);
+    if(!stopped) {
+      auto const branch_to_continuation = ir::make_instr_branch(
+        ctx.allocator, ctx.next_id(), continuation_block, stmt->source_info);
+      builder.insert(branch_to_continuation);
+    }
 
     // Lower the actions in the continuation block.
     builder.set_insert_block(continuation_block);
@@ -2375,28 +2446,48 @@ namespace vush {
       // Result is discarded.
       ANTON_UNUSED(instr);
     }
+    auto const branch_to_header = ir::make_instr_branch(
+      ctx.allocator, ctx.next_id(), header_block, stmt->source_info);
+    builder.insert(branch_to_header);
 
+    ctx.nearest_continuation_block = previous_continuation_block;
+    ctx.nearest_converge_block = previous_converge_block;
     builder.set_insert_block(converge_block);
   }
 
   static void lower_stmt_while(Lowering_Context& ctx, Builder& builder,
                                ast::Stmt_While const* const stmt)
   {
+    auto const header_block =
+      VUSH_ALLOCATE(ir::Basic_Block, ctx.allocator, ctx.next_id());
     auto const condition_block =
       VUSH_ALLOCATE(ir::Basic_Block, ctx.allocator, ctx.next_id());
     auto const loop_block =
       VUSH_ALLOCATE(ir::Basic_Block, ctx.allocator, ctx.next_id());
+    auto const continuation_block =
+      VUSH_ALLOCATE(ir::Basic_Block, ctx.allocator, ctx.next_id());
     auto const converge_block =
       VUSH_ALLOCATE(ir::Basic_Block, ctx.allocator, ctx.next_id());
 
-    ctx.nearest_continuation_block = condition_block;
+    ir::Basic_Block* const previous_continuation_block =
+      ctx.nearest_continuation_block;
+    ir::Basic_Block* const previous_converge_block = ctx.nearest_converge_block;
+    ctx.nearest_continuation_block = continuation_block;
     ctx.nearest_converge_block = converge_block;
 
-    // Branch to the condition block from wherever we are.
+    // Branch to the header block from wherever we are.
     ir::Instr* branch = ir::make_instr_branch(
-      ctx.allocator, ctx.next_id(), condition_block, stmt->source_info);
+      ctx.allocator, ctx.next_id(), header_block, stmt->source_info);
     builder.insert(branch);
 
+    builder.set_insert_block(header_block);
+    auto const scf_loop_head = make_scf_loop_head(
+      ctx, stmt->attributes, converge_block, continuation_block);
+    builder.insert(scf_loop_head);
+    auto const branch_to_condition = ir::make_instr_branch(
+      ctx.allocator, ctx.next_id(), condition_block, stmt->source_info);
+    builder.insert(branch_to_condition);
+
     // Lower the condition.
     builder.set_insert_block(condition_block);
     ir::Value* const condition =
@@ -2408,48 +2499,74 @@ namespace vush {
 
     // Lower the loop block.
     builder.set_insert_block(loop_block);
-    lower_statement_block(ctx, builder, stmt->statements);
-    auto const branch_to_condition = ir::make_instr_branch(
-      ctx.allocator, ctx.next_id(), condition_block, stmt->source_info);
-    builder.insert(branch_to_condition);
+    bool const stopped = lower_statement_block(ctx, builder, stmt->statements);
+    if(!stopped) {
+      auto const branch_to_continuation = ir::make_instr_branch(
+        ctx.allocator, ctx.next_id(), continuation_block, stmt->source_info);
+      builder.insert(branch_to_continuation);
+    }
 
+    builder.set_insert_block(continuation_block);
+    auto const branch_to_header = ir::make_instr_branch(
+      ctx.allocator, ctx.next_id(), header_block, stmt->source_info);
+    builder.insert(branch_to_header);
+
+    ctx.nearest_continuation_block = previous_continuation_block;
+    ctx.nearest_converge_block = previous_converge_block;
     builder.set_insert_block(converge_block);
   }
 
   static void lower_stmt_do_while(Lowering_Context& ctx, Builder& builder,
                                   ast::Stmt_Do_While const* const stmt)
   {
-    auto const condition_block =
+    auto const header_block =
       VUSH_ALLOCATE(ir::Basic_Block, ctx.allocator, ctx.next_id());
     auto const loop_block =
       VUSH_ALLOCATE(ir::Basic_Block, ctx.allocator, ctx.next_id());
+    auto const condition_block =
+      VUSH_ALLOCATE(ir::Basic_Block, ctx.allocator, ctx.next_id());
     auto const converge_block =
       VUSH_ALLOCATE(ir::Basic_Block, ctx.allocator, ctx.next_id());
 
+    ir::Basic_Block* const previous_continuation_block =
+      ctx.nearest_continuation_block;
+    ir::Basic_Block* const previous_converge_block = ctx.nearest_converge_block;
     ctx.nearest_continuation_block = condition_block;
     ctx.nearest_converge_block = converge_block;
 
-    // Branch to the loop block from wherever we are.
-    ir::Instr* branch = ir::make_instr_branch(ctx.allocator, ctx.next_id(),
-                                              loop_block, stmt->source_info);
+    // Branch to the header block from wherever we are.
+    ir::Instr* branch = ir::make_instr_branch(
+      ctx.allocator, ctx.next_id(), header_block, stmt->source_info);
     builder.insert(branch);
 
+    builder.set_insert_block(header_block);
+    auto const scf_loop_head = make_scf_loop_head(
+      ctx, stmt->attributes, converge_block, condition_block);
+    builder.insert(scf_loop_head);
+    auto const branch_to_loop = ir::make_instr_branch(
+      ctx.allocator, ctx.next_id(), loop_block, stmt->source_info);
+    builder.insert(branch_to_loop);
+
     // Lower the loop block.
     builder.set_insert_block(loop_block);
-    lower_statement_block(ctx, builder, stmt->statements);
-    auto const branch_to_condition = ir::make_instr_branch(
-      ctx.allocator, ctx.next_id(), condition_block, stmt->source_info);
-    builder.insert(branch_to_condition);
+    bool const stopped = lower_statement_block(ctx, builder, stmt->statements);
+    if(!stopped) {
+      auto const branch_to_condition = ir::make_instr_branch(
+        ctx.allocator, ctx.next_id(), condition_block, stmt->source_info);
+      builder.insert(branch_to_condition);
+    }
 
     // Lower the condition.
     builder.set_insert_block(condition_block);
     ir::Value* const condition =
       lower_expression(ctx, builder, stmt->condition);
     auto const brcond =
-      ir::make_instr_brcond(ctx.allocator, ctx.next_id(), condition, loop_block,
-                            converge_block, stmt->source_info);
+      ir::make_instr_brcond(ctx.allocator, ctx.next_id(), condition,
+                            header_block, converge_block, stmt->source_info);
     builder.insert(brcond);
 
+    ctx.nearest_continuation_block = previous_continuation_block;
+    ctx.nearest_converge_block = previous_converge_block;
     builder.set_insert_block(converge_block);
   }
 
@@ -2532,6 +2649,7 @@ namespace vush {
                                                  ctx.nearest_converge_block,
                                                  generic_stmt.source_info);
         builder.insert(instr);
+        return true;
       } break;
 
       case ast::Node_Kind::stmt_continue: {
@@ -2541,6 +2659,7 @@ namespace vush {
                                                  ctx.nearest_continuation_block,
                                                  generic_stmt.source_info);
         builder.insert(instr);
+        return true;
       } break;
 
       case ast::Node_Kind::variable: {
@@ -2590,50 +2709,27 @@ namespace vush {
     return false;
   }
 
-  using Block_Set = anton::Flat_Hash_Set<ir::Basic_Block*>;
-
+  // insert_implicit_returns
+  // Terminate the reachable blocks that do not end with a control flow
+  // instruction with a return.
+  //
   static void insert_implicit_returns(Lowering_Context& ctx,
-                                      Block_Set& visited_blocks,
-                                      ir::Basic_Block* const block)
+                                      ir::Function* const fn)
   {
-    // Ensure we do not visit duplicates.
-    {
-      auto const iterator = visited_blocks.find(block);
-      if(iterator != visited_blocks.end()) {
-        return;
+    ir::CFG const* const cfg = ir::build_cfg(ctx.allocator, fn);
+    for(ir::Basic_Block* const block: cfg->blocks) {
+      if(block->empty()) {
+        auto const instr =
+          ir::make_instr_return(ctx.allocator, ctx.next_id(), Source_Info{});
+        block->insert(instr);
+        continue;
       }
 
-      visited_blocks.emplace(block);
-    }
-
-    // Ensure the last block ends with a return instruction.
-    if(block->empty()) {
-      auto const instr =
-        ir::make_instr_return(ctx.allocator, ctx.next_id(), Source_Info{});
-      block->insert(instr);
-      return;
-    } else {
       ir::Instr* const last_instr = block->get_last();
       if(!ir::is_control_flow_instruction(last_instr)) {
         auto const instr = ir::make_instr_return(ctx.allocator, ctx.next_id(),
                                                  last_instr->source_info);
         block->insert(instr);
-        return;
-      }
-    }
-
-    auto const last_instr = block->get_last();
-    if(instanceof<ir::Instr_branch>(last_instr)) {
-      auto const instr = static_cast<ir::Instr_branch const*>(last_instr);
-      insert_implicit_returns(ctx, visited_blocks, instr->target);
-    } else if(instanceof<ir::Instr_brcond>(last_instr)) {
-      auto const instr = static_cast<ir::Instr_brcond const*>(last_instr);
-      insert_implicit_returns(ctx, visited_blocks, instr->then_target);
-      insert_implicit_returns(ctx, visited_blocks, instr->else_target);
-    } else if(instanceof<ir::Instr_switch>(last_instr)) {
-      auto const instr = static_cast<ir::Instr_switch const*>(last_instr);
-      for(auto const label: instr->labels) {
-        insert_implicit_returns(ctx, visited_blocks, label.target);
       }
     }
   }
@@ -2650,8 +2746,8 @@ namespace vush {
     // TODO: Unsized array parametrs.
     for(ast::Fn_Parameter const& parameter: ast_fn->parameters) {
       ir::Type* const type = lower_type(ctx, parameter.type);
-      auto const argument = VUSH_ALLOCATE(
-        ir::Argument, ctx.allocator, ctx.next_id(), type, fn, ctx.allocator);
+      auto const argument =
+        VUSH_ALLOCATE(ir::Argument, ctx.allocator, ctx.next_id(), type, fn);
       fn->arguments.insert_back(*argument);
       auto const alloc = ir::make_instr_alloc(ctx.allocator, ctx.next_id(),
                                               type, parameter.source_info);
@@ -2667,8 +2763,7 @@ namespace vush {
     ANTON_UNUSED(stopped);
     ctx.symtable.pop_scope();
 
-    Block_Set visited_blocks(ctx.allocator);
-    insert_implicit_returns(ctx, visited_blocks, fn->entry_block);
+    insert_implicit_returns(ctx, fn);
   }
 
   [[nodiscard]] ir::Storage_Class
@@ -2723,7 +2818,8 @@ namespace vush {
       }
 
       auto const result =
-        VUSH_ALLOCATE(ir::Buffer, ctx.allocator, composite,
+        VUSH_ALLOCATE(ir::Buffer, ctx.allocator, ctx.next_buffer_id(),
+                      ctx.types.intern(composite),
                       anton::String(buffer->identifier.value, ctx.allocator),
                       buffer->source_info);
       // TODO: Smarter assignment of bindings, etc.
@@ -2736,9 +2832,9 @@ namespace vush {
     return entry->value;
   }
 
-  [[nodiscard]] static ir::Module
-  lower_module(Lowering_Context& ctx,
-               ast::Decl_Stage_Function const* const stage)
+  [[nodiscard]] static ir::Function*
+  lower_stage(Lowering_Context& ctx,
+              ast::Decl_Stage_Function const* const stage)
   {
     // Stage always returns void.
     auto const return_type = ir::get_type_void();
@@ -2756,7 +2852,7 @@ namespace vush {
     for(ast::Fn_Parameter const& parameter: stage->parameters) {
       auto const argument =
         VUSH_ALLOCATE(ir::Argument, ctx.allocator, ctx.next_id(),
-                      ir::get_type_ptr(), fn, ctx.allocator);
+                      ir::get_type_ptr(), fn);
       argument->storage_class = select_storage_class(&parameter);
       argument->pointee_type = lower_type(ctx, parameter.type);
       if(parameter.buffer != nullptr) {
@@ -2781,45 +2877,22 @@ namespace vush {
 
     // TODO: This could be done during lowering. Check whether a block ends with
     //       a CF instruction, if not, insert return.
-    Block_Set visited_blocks(ctx.allocator);
-    insert_implicit_returns(ctx, visited_blocks, fn->entry_block);
-
-    return ir::Module(anton::String(stage->pass.value, ctx.allocator),
-                      stage->stage.value, fn);
+    insert_implicit_returns(ctx, fn);
+    return fn;
   }
 
-  Array<ir::Module> lower_ast_to_ir(Allocator* const allocator,
-                                    ast::Node_List const& ast)
+  ir::Module lower_ast_to_ir(Allocator* const allocator,
+                             ast::Decl_Stage_Function const* const stage)
   {
-    Array<ir::Module> modules{allocator};
     Lowering_Context ctx{allocator};
-    for(ast::Node const& node: ast) {
-      if(node.node_kind == ast::Node_Kind::decl_function) {
-        auto const ast_fn = static_cast<ast::Decl_Function const*>(&node);
-        auto const return_type = lower_type(ctx, ast_fn->return_type);
-        auto const entry_block =
-          VUSH_ALLOCATE(ir::Basic_Block, ctx.allocator, ctx.next_id());
-        anton::String identifier{ast_fn->identifier.value, ctx.allocator};
-        auto const ir_fn = VUSH_ALLOCATE(
-          ir::Function, allocator, ctx.next_id(), return_type, entry_block,
-          ANTON_MOV(identifier), ast_fn->source_info);
-        ctx.fntable.add_entry(ir_fn->identifier, ir_fn);
-      }
+    ir::Function* const entry = lower_stage(ctx, stage);
+    // The list grows while the callees are lowered.
+    for(i64 i = 0; i < ctx.pending_functions.size(); i += 1) {
+      ast::Decl_Function const* const ast_fn = ctx.pending_functions[i];
+      ir::Function* const fn = ctx.fntable.find(ast_fn)->value;
+      lower_function(ctx, ast_fn, fn);
     }
-
-    for(ast::Node const& node: ast) {
-      if(node.node_kind == ast::Node_Kind::decl_stage_function) {
-        auto const stage = static_cast<ast::Decl_Stage_Function const*>(&node);
-        ir::Module module = lower_module(ctx, stage);
-        modules.push_back(ANTON_MOV(module));
-      }
-
-      if(node.node_kind == ast::Node_Kind::decl_function) {
-        auto const ast_fn = static_cast<ast::Decl_Function const*>(&node);
-        auto const fn = *ctx.fntable.find_entry(ast_fn->identifier.value);
-        lower_function(ctx, ast_fn, fn);
-      }
-    }
-    return modules;
+    return ir::Module(anton::String(stage->pass.value, ctx.allocator),
+                      stage->stage.value, entry, ctx.get_id_bound());
   }
 } // namespace vush
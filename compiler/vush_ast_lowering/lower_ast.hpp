@@ -4,6 +4,12 @@
 #include <vush_ir/fwd.hpp>
 
 namespace vush {
-  [[nodiscard]] Array<ir::Module> lower_ast_to_ir(Allocator* allocator,
-                                                  ast::Node_List const& ast);
+  // lower_ast_to_ir
+  // Lower the stage and the functions reachable from it into an IR module. All
+  // nodes of the module are allocated from allocator, which is expected to be
+  // owned by the module, hence the module is released together with the
+  // allocator.
+  //
+  [[nodiscard]] ir::Module
+  lower_ast_to_ir(Allocator* allocator, ast::Decl_Stage_Function const* stage);
 }
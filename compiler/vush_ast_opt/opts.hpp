@@ -3,5 +3,10 @@
 #include <vush_ast/ast.hpp>
 
 namespace vush {
-  bool run_opt_ast_fold_swizzles(Allocator* allocator, ast::Node_List& nodes);
-}
+  // Local rewrites for run_ast_rewrites.
+
+  // rewrite_fold_swizzles
+  // Fold a swizzle of a swizzle into a single swizzle.
+  //
+  bool rewrite_fold_swizzles(Allocator* allocator, ast::Expr* expr);
+} // namespace vush
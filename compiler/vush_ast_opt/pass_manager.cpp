@@ -0,0 +1,288 @@
+#include <vush_ast_opt/pass_manager.hpp>
+
+#include <vush_ast/ast.hpp>
+
+namespace vush {
+  struct Rewrite_Context {
+    Allocator* allocator;
+    anton::Slice<Ast_Rewrite const> rewrites;
+    // The number of applications of each rewrite.
+    Array<i64> counts;
+    // Statements whose expressions have changed during the current sweep.
+    Array<ast::Node*> dirty;
+  };
+
+  // rewrite_node
+  // Apply each rewrite to the expression once. The subexpressions are not
+  // visited. A rewrite that applies may expose further rewrites of the
+  // expression or its subexpressions, which are applied in the next sweep.
+  //
+  [[nodiscard]] static bool rewrite_node(Rewrite_Context& ctx,
+                                         ast::Expr* const expr)
+  {
+    bool changed = false;
+    for(i64 i = 0; i < ctx.rewrites.size(); i += 1) {
+      if(ctx.rewrites[i].rewrite(ctx.allocator, expr)) {
+        ctx.counts[i] += 1;
+        changed = true;
+      }
+    }
+    return changed;
+  }
+
+  // rewrite_expr
+  // Rewrite the expression tree in post-order.
+  //
+  [[nodiscard]] static bool rewrite_expr(Rewrite_Context& ctx,
+                                         ast::Expr* const generic_expr)
+  {
+    bool changed = false;
+    switch(generic_expr->node_kind) {
+    case ast::Node_Kind::expr_if: {
+      auto const expr = static_cast<ast::Expr_If*>(generic_expr);
+      changed |= rewrite_expr(ctx, expr->condition);
+      changed |= rewrite_expr(ctx, expr->then_branch);
+      changed |= rewrite_expr(ctx, expr->else_branch);
+    } break;
+
+    case ast::Node_Kind::expr_init: {
+      auto const expr = static_cast<ast::Expr_Init*>(generic_expr);
+      for(ast::Initializer& node: expr->initializers) {
+        if(node.node_kind == ast::Node_Kind::basic_initializer) {
+          auto const initializer = static_cast<ast::Basic_Initializer*>(&node);
+          changed |= rewrite_expr(ctx, initializer->expression);
+        } else if(node.node_kind == ast::Node_Kind::field_initializer) {
+          auto const initializer = static_cast<ast::Field_Initializer*>(&node);
+          changed |= rewrite_expr(ctx, initializer->expression);
+        } else { // Node_Kind::index_initializer
+          auto const initializer = static_cast<ast::Index_Initializer*>(&node);
+          changed |= rewrite_expr(ctx, initializer->expression);
+        }
+      }
+    } break;
+
+    case ast::Node_Kind::expr_call: {
+      auto const expr = static_cast<ast::Expr_Call*>(generic_expr);
+      for(ast::Expr& argument: expr->arguments) {
+        changed |= rewrite_expr(ctx, &argument);
+      }
+    } break;
+
+    case ast::Node_Kind::expr_field: {
+      auto const expr = static_cast<ast::Expr_Field*>(generic_expr);
+      changed |= rewrite_expr(ctx, expr->base);
+    } break;
+
+    case ast::Node_Kind::expr_index: {
+      auto const expr = static_cast<ast::Expr_Index*>(generic_expr);
+      changed |= rewrite_expr(ctx, expr->base);
+      changed |= rewrite_expr(ctx, expr->index);
+    } break;
+
+    case ast::Node_Kind::expr_reinterpret: {
+      auto const expr = static_cast<ast::Expr_Reinterpret*>(generic_expr);
+      changed |= rewrite_expr(ctx, expr->source);
+      if(expr->index != nullptr) {
+        changed |= rewrite_expr(ctx, expr->index);
+      }
+    } break;
+
+    default:
+      // Leaves.
+      break;
+    }
+
+    changed |= rewrite_node(ctx, generic_expr);
+    return changed;
+  }
+
+  // rewrite_stmt_expressions
+  // Rewrite the expressions owned directly by the statement. The nested
+  // statements are not visited.
+  //
+  [[nodiscard]] static bool
+  rewrite_stmt_expressions(Rewrite_Context& ctx, ast::Node* const generic_stmt)
+  {
+    bool changed = false;
+    switch(generic_stmt->node_kind) {
+    case ast::Node_Kind::variable: {
+      auto const stmt = static_cast<ast::Variable*>(generic_stmt);
+      if(stmt->initializer != nullptr) {
+        changed |= rewrite_expr(ctx, stmt->initializer);
+      }
+    } break;
+
+    case ast::Node_Kind::stmt_assignment: {
+      auto const stmt = static_cast<ast::Stmt_Assignment*>(generic_stmt);
+      changed |= rewrite_expr(ctx, stmt->lhs);
+      changed |= rewrite_expr(ctx, stmt->rhs);
+    } break;
+
+    case ast::Node_Kind::stmt_if: {
+      auto const stmt = static_cast<ast::Stmt_If*>(generic_stmt);
+      changed |= rewrite_expr(ctx, stmt->condition);
+    } break;
+
+    case ast::Node_Kind::stmt_switch: {
+      auto const stmt = static_cast<ast::Stmt_Switch*>(generic_stmt);
+      changed |= rewrite_expr(ctx, stmt->expression);
+      for(ast::Switch_Arm& arm: stmt->arms) {
+        for(ast::Expr& label: arm.labels) {
+          changed |= rewrite_expr(ctx, &label);
+        }
+      }
+    } break;
+
+    case ast::Node_Kind::stmt_for: {
+      auto const stmt = static_cast<ast::Stmt_For*>(generic_stmt);
+      for(ast::Variable& declaration: stmt->declarations) {
+        changed |= rewrite_stmt_expressions(ctx, &declaration);
+      }
+      if(stmt->condition != nullptr) {
+        changed |= rewrite_expr(ctx, stmt->condition);
+      }
+      for(ast::Expr& action: stmt->actions) {
+        changed |= rewrite_expr(ctx, &action);
+      }
+    } break;
+
+    case ast::Node_Kind::stmt_while: {
+      auto const stmt = static_cast<ast::Stmt_While*>(generic_stmt);
+      changed |= rewrite_expr(ctx, stmt->condition);
+    } break;
+
+    case ast::Node_Kind::stmt_do_while: {
+      auto const stmt = static_cast<ast::Stmt_Do_While*>(generic_stmt);
+      changed |= rewrite_expr(ctx, stmt->condition);
+    } break;
+
+    case ast::Node_Kind::stmt_return: {
+      auto const stmt = static_cast<ast::Stmt_Return*>(generic_stmt);
+      if(stmt->expression != nullptr) {
+        changed |= rewrite_expr(ctx, stmt->expression);
+      }
+    } break;
+
+    case ast::Node_Kind::stmt_expression: {
+      auto const stmt = static_cast<ast::Stmt_Expression*>(generic_stmt);
+      changed |= rewrite_expr(ctx, stmt->expression);
+    } break;
+
+    default:
+      // Statements without expressions.
+      break;
+    }
+    return changed;
+  }
+
+  // sweep_statements
+  // Rewrite the expressions of the statements and all of their nested
+  // statements. Changed statements are added to the dirty list.
+  //
+  static void sweep_statements(Rewrite_Context& ctx,
+                               ast::Stmt_List& statements)
+  {
+    for(ast::Node& generic_stmt: statements) {
+      if(rewrite_stmt_expressions(ctx, &generic_stmt)) {
+        ctx.dirty.push_back(&generic_stmt);
+      }
+
+      switch(generic_stmt.node_kind) {
+      case ast::Node_Kind::stmt_block: {
+        auto const stmt = static_cast<ast::Stmt_Block*>(&generic_stmt);
+        sweep_statements(ctx, stmt->statements);
+      } break;
+
+      case ast::Node_Kind::stmt_if: {
+        auto const stmt = static_cast<ast::Stmt_If*>(&generic_stmt);
+        sweep_statements(ctx, stmt->then_branch);
+        sweep_statements(ctx, stmt->else_branch);
+      } break;
+
+      case ast::Node_Kind::stmt_switch: {
+        auto const stmt = static_cast<ast::Stmt_Switch*>(&generic_stmt);
+        for(ast::Switch_Arm& arm: stmt->arms) {
+          sweep_statements(ctx, arm.statements);
+        }
+      } break;
+
+      case ast::Node_Kind::stmt_for: {
+        auto const stmt = static_cast<ast::Stmt_For*>(&generic_stmt);
+        sweep_statements(ctx, stmt->statements);
+      } break;
+
+      case ast::Node_Kind::stmt_while: {
+        auto const stmt = static_cast<ast::Stmt_While*>(&generic_stmt);
+        sweep_statements(ctx, stmt->statements);
+      } break;
+
+      case ast::Node_Kind::stmt_do_while: {
+        auto const stmt = static_cast<ast::Stmt_Do_While*>(&generic_stmt);
+        sweep_statements(ctx, stmt->statements);
+      } break;
+
+      default:
+        // No nested statements.
+        break;
+      }
+    }
+  }
+
+  void run_ast_rewrites(Allocator* const allocator, ast::Node_List& nodes,
+                        anton::Slice<Ast_Rewrite const> const rewrites,
+                        Array<Pass_Statistics>& statistics)
+  {
+    Rewrite_Context ctx{.allocator = allocator,
+                        .rewrites = rewrites,
+                        .counts = Array<i64>(allocator),
+                        .dirty = Array<ast::Node*>(allocator)};
+    for(i64 i = 0; i < rewrites.size(); i += 1) {
+      ctx.counts.push_back(0);
+    }
+
+    // The initial sweep visits the entire AST.
+    for(ast::Node& decl: nodes) {
+      switch(decl.node_kind) {
+      case ast::Node_Kind::variable: {
+        if(rewrite_stmt_expressions(ctx, &decl)) {
+          ctx.dirty.push_back(&decl);
+        }
+      } break;
+
+      case ast::Node_Kind::decl_function: {
+        auto const node = static_cast<ast::Decl_Function*>(&decl);
+        sweep_statements(ctx, node->body);
+      } break;
+
+      case ast::Node_Kind::decl_stage_function: {
+        auto const node = static_cast<ast::Decl_Stage_Function*>(&decl);
+        sweep_statements(ctx, node->body);
+      } break;
+
+      default:
+        // Nothing to rewrite.
+        break;
+      }
+    }
+
+    // Revisit only the statements that have changed in the previous sweep.
+    // Each sweep appends its dirty statements past the end of the previous
+    // one.
+    i64 sweep_begin = 0;
+    while(sweep_begin < ctx.dirty.size()) {
+      i64 const sweep_end = ctx.dirty.size();
+      for(i64 i = sweep_begin; i < sweep_end; i += 1) {
+        ast::Node* const stmt = ctx.dirty[i];
+        if(rewrite_stmt_expressions(ctx, stmt)) {
+          ctx.dirty.push_back(stmt);
+        }
+      }
+      sweep_begin = sweep_end;
+    }
+
+    for(i64 i = 0; i < rewrites.size(); i += 1) {
+      statistics.push_back(Pass_Statistics{.pass_name = rewrites[i].name,
+                                           .changes = ctx.counts[i]});
+    }
+  }
+} // namespace vush
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <anton/slice.hpp>
+#include <anton/string_view.hpp>
+
+#include <vush.hpp>
+#include <vush_ast/fwd.hpp>
+
+namespace vush {
+  // ast_rewrite_fn
+  // A local rewrite of an expression. The rewrite may modify the expression
+  // and its subexpressions in place, but must not replace the expression node
+  // itself as the parent is not available.
+  //
+  // Returns:
+  // Whether the expression has been changed.
+  //
+  using ast_rewrite_fn = bool (*)(Allocator* allocator, ast::Expr* expr);
+
+  struct Ast_Rewrite {
+    anton::String_View name;
+    ast_rewrite_fn rewrite;
+  };
+
+  // run_ast_rewrites
+  // Run the rewrites over the AST until none of them applies. Each sweep
+  // traverses the expressions in post-order and applies every rewrite once to
+  // each node. Statements whose expressions have changed are marked dirty and
+  // only those are revisited in the subsequent sweeps.
+  //
+  // Parameters:
+  //  allocator - Allocator used by the rewrites and the pass manager.
+  //      nodes - The AST to rewrite.
+  //   rewrites - The rewrites to run.
+  // statistics - The rewrite counts are appended in the order of rewrites.
+  //
+  void run_ast_rewrites(Allocator* allocator, ast::Node_List& nodes,
+                        anton::Slice<Ast_Rewrite const> rewrites,
+                        Array<Pass_Statistics>& statistics);
+} // namespace vush
@@ -6,7 +6,7 @@
 #include <vush_ir/ir.hpp>
 
 namespace vush {
-  ir::Instr_ext_call* select_ext(Allocator* const allocator, i64 const id,
+  ir::Instr_ext_call* select_ext(Allocator* const allocator, u32 const id,
                                  ir::Type* const type,
                                  ast::Expr_Call const* const expr)
   {
@@ -28,7 +28,7 @@ namespace vush {
 
   // select_ext
   //
-  ir::Instr_ext_call* select_ext(Allocator* const allocator, i64 const id,
+  ir::Instr_ext_call* select_ext(Allocator* const allocator, u32 const id,
                                  ir::Type* const type,
                                  ast::Expr_Call const* const expr);
 } // namespace vush
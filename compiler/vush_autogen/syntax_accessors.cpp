@@ -1471,23 +1471,23 @@ namespace vush {
     ANTON_UNREACHABLE("member stmt_block not present in switch_arm");
   }
 
-  SNOT const* get_stmt_while_condition(SNOT const* node)
+  SNOT const* get_stmt_while_attribute_list(SNOT const* node)
   {
     ANTON_ASSERT(node->kind == SNOT_Kind::stmt_while, "node is not stmt_while");
     SNOT* child = node->children;
     i64 index = 0;
     ANTON_UNUSED(index);
     while(child != nullptr) {
-      if(index == 1) {
+      if(index == 0) {
         return child;
       }
       child = anton::ilist_next(child);
       index += 1;
     }
-    ANTON_UNREACHABLE("member 1 not present in stmt_while");
+    ANTON_UNREACHABLE("member 0 not present in stmt_while");
   }
 
-  SNOT const* get_stmt_while_statements(SNOT const* node)
+  SNOT const* get_stmt_while_condition(SNOT const* node)
   {
     ANTON_ASSERT(node->kind == SNOT_Kind::stmt_while, "node is not stmt_while");
     SNOT* child = node->children;
@@ -1503,6 +1503,38 @@ namespace vush {
     ANTON_UNREACHABLE("member 2 not present in stmt_while");
   }
 
+  SNOT const* get_stmt_while_statements(SNOT const* node)
+  {
+    ANTON_ASSERT(node->kind == SNOT_Kind::stmt_while, "node is not stmt_while");
+    SNOT* child = node->children;
+    i64 index = 0;
+    ANTON_UNUSED(index);
+    while(child != nullptr) {
+      if(index == 3) {
+        return child;
+      }
+      child = anton::ilist_next(child);
+      index += 1;
+    }
+    ANTON_UNREACHABLE("member 3 not present in stmt_while");
+  }
+
+  SNOT const* get_stmt_for_attribute_list(SNOT const* node)
+  {
+    ANTON_ASSERT(node->kind == SNOT_Kind::stmt_for, "node is not stmt_for");
+    SNOT* child = node->children;
+    i64 index = 0;
+    ANTON_UNUSED(index);
+    while(child != nullptr) {
+      if(index == 0) {
+        return child;
+      }
+      child = anton::ilist_next(child);
+      index += 1;
+    }
+    ANTON_UNREACHABLE("member 0 not present in stmt_for");
+  }
+
   SNOT const* get_stmt_for_variable(SNOT const* node)
   {
     ANTON_ASSERT(node->kind == SNOT_Kind::stmt_for, "node is not stmt_for");
@@ -1567,6 +1599,23 @@ namespace vush {
     ANTON_UNREACHABLE("member stmt_block not present in stmt_for");
   }
 
+  SNOT const* get_stmt_do_while_attribute_list(SNOT const* node)
+  {
+    ANTON_ASSERT(node->kind == SNOT_Kind::stmt_do_while,
+                 "node is not stmt_do_while");
+    SNOT* child = node->children;
+    i64 index = 0;
+    ANTON_UNUSED(index);
+    while(child != nullptr) {
+      if(index == 0) {
+        return child;
+      }
+      child = anton::ilist_next(child);
+      index += 1;
+    }
+    ANTON_UNREACHABLE("member 0 not present in stmt_do_while");
+  }
+
   SNOT const* get_stmt_do_while_body(SNOT const* node)
   {
     ANTON_ASSERT(node->kind == SNOT_Kind::stmt_do_while,
@@ -1575,13 +1624,13 @@ namespace vush {
     i64 index = 0;
     ANTON_UNUSED(index);
     while(child != nullptr) {
-      if(index == 1) {
+      if(index == 2) {
         return child;
       }
       child = anton::ilist_next(child);
       index += 1;
     }
-    ANTON_UNREACHABLE("member 1 not present in stmt_do_while");
+    ANTON_UNREACHABLE("member 2 not present in stmt_do_while");
   }
 
   SNOT const* get_stmt_do_while_condition(SNOT const* node)
@@ -1592,13 +1641,13 @@ namespace vush {
     i64 index = 0;
     ANTON_UNUSED(index);
     while(child != nullptr) {
-      if(index == 3) {
+      if(index == 4) {
         return child;
       }
       child = anton::ilist_next(child);
       index += 1;
     }
-    ANTON_UNREACHABLE("member 3 not present in stmt_do_while");
+    ANTON_UNREACHABLE("member 4 not present in stmt_do_while");
   }
 
   SNOT const* get_stmt_return_expression(SNOT const* node)
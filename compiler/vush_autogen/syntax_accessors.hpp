@@ -99,12 +99,15 @@ namespace vush {
   [[nodiscard]] SNOT const* get_stmt_switch_expression(SNOT const* node);
   [[nodiscard]] SNOT const* get_stmt_switch_arm_list(SNOT const* node);
   [[nodiscard]] SNOT const* get_switch_arm_body(SNOT const* node);
+  [[nodiscard]] SNOT const* get_stmt_while_attribute_list(SNOT const* node);
   [[nodiscard]] SNOT const* get_stmt_while_condition(SNOT const* node);
   [[nodiscard]] SNOT const* get_stmt_while_statements(SNOT const* node);
+  [[nodiscard]] SNOT const* get_stmt_for_attribute_list(SNOT const* node);
   [[nodiscard]] SNOT const* get_stmt_for_variable(SNOT const* node);
   [[nodiscard]] SNOT const* get_stmt_for_condition(SNOT const* node);
   [[nodiscard]] SNOT const* get_stmt_for_expression(SNOT const* node);
   [[nodiscard]] SNOT const* get_stmt_for_body(SNOT const* node);
+  [[nodiscard]] SNOT const* get_stmt_do_while_attribute_list(SNOT const* node);
   [[nodiscard]] SNOT const* get_stmt_do_while_body(SNOT const* node);
   [[nodiscard]] SNOT const* get_stmt_do_while_condition(SNOT const* node);
   [[nodiscard]] SNOT const* get_stmt_return_expression(SNOT const* node);
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <anton/slice.hpp>
+
 #include <vush.hpp>
 #include <vush_core/source_info.hpp>
 #include <vush_core/source_registry.hpp>
@@ -8,6 +10,17 @@ namespace vush {
   struct Context {
     Allocator* raii_allocator = nullptr;
     Allocator* bump_allocator = nullptr;
+    // The allocator of the sources. The source information of every tree,
+    // including the IR, refers to the sources, hence the allocator lives for
+    // the entire compilation.
+    Allocator* source_allocator = nullptr;
+    // The allocator of the syntax trees. The syntax trees are not needed once
+    // the AST has been built, hence the allocator is released afterwards.
+    Allocator* syntax_allocator = nullptr;
+    // Bump allocators for the worker threads of the passes that run in
+    // parallel, one per thread. Empty when the compilation is single-threaded.
+    // The allocators live as long as bump_allocator.
+    anton::Slice<Allocator* const> thread_allocators;
     Source_Registry* source_registry = nullptr;
     Diagnostics_Options diagnostics = {};
     buffer_definition_callback buffer_definition_cb = nullptr;
@@ -18,6 +31,9 @@ namespace vush {
     source_import_callback import_source_cb;
     void* import_main_source_user_data;
     void* import_source_user_data;
+    // The directory of the precompiled modules of the imported sources. The
+    // modules are not used when empty.
+    anton::String_View module_cache_directory;
   };
 
   [[nodiscard]] anton::Expected<Source_Data const*, Error>
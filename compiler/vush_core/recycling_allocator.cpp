@@ -0,0 +1,67 @@
+#include <vush_core/recycling_allocator.hpp>
+
+namespace vush {
+  Recycling_Allocator::Recycling_Allocator(Allocator* const allocator)
+    : allocator(allocator), deallocated(allocator)
+  {
+  }
+
+  void* Recycling_Allocator::allocate(isize const size, isize const alignment)
+  {
+    i64 const size_class = get_size_class(size, alignment);
+    if(size_class < 0) {
+      return allocator->allocate(size, alignment);
+    }
+
+    Free_Block* const block = free_lists[size_class];
+    if(block != nullptr) {
+      free_lists[size_class] = block->next;
+      return block;
+    }
+
+    // The block is allocated with the size and the alignment of its class,
+    // hence it may serve any allocation of the class once it is recycled.
+    return allocator->allocate((size_class + 1) * granularity, granularity);
+  }
+
+  void Recycling_Allocator::deallocate(void* const memory, isize const size,
+                                       isize const alignment)
+  {
+    i64 const size_class = get_size_class(size, alignment);
+    if(size_class < 0) {
+      allocator->deallocate(memory, size, alignment);
+      return;
+    }
+
+    // The block is not linked into its free list yet as that would overwrite
+    // its contents.
+    deallocated.push_back(
+      Deallocated_Block{.memory = memory, .size_class = size_class});
+  }
+
+  bool Recycling_Allocator::is_equal(Allocator const& other) const
+  {
+    return this == &other;
+  }
+
+  void Recycling_Allocator::recycle()
+  {
+    for(Deallocated_Block const& block: deallocated) {
+      auto const free_block = static_cast<Free_Block*>(block.memory);
+      free_block->next = free_lists[block.size_class];
+      free_lists[block.size_class] = free_block;
+    }
+    deallocated.clear();
+  }
+
+  i64 Recycling_Allocator::get_size_class(isize const size,
+                                          isize const alignment)
+  {
+    if(size <= 0 || size > size_class_count * granularity ||
+       alignment > granularity) {
+      return -1;
+    }
+
+    return (size + granularity - 1) / granularity - 1;
+  }
+} // namespace vush
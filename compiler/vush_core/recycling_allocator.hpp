@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vush_core/types.hpp>
+
+namespace vush {
+  // Recycling_Allocator
+  // Serves the small blocks from the free lists of the blocks that have been
+  // deallocated and everything else from the underlying allocator. The
+  // deallocated blocks are not handed out again until recycle is called,
+  // hence a block that is still referred to after its deallocation, e.g. an
+  // erased instruction used as a key of a map, is not aliased by a new
+  // allocation before the owner of the allocator allows it.
+  //
+  struct Recycling_Allocator: public Allocator {
+  private:
+    struct Free_Block {
+      Free_Block* next;
+    };
+
+    struct Deallocated_Block {
+      void* memory;
+      i64 size_class;
+    };
+
+    // The sizes of the recycled blocks are multiples of the granularity up to
+    // granularity * size_class_count bytes.
+    static constexpr i64 granularity = 8;
+    static constexpr i64 size_class_count = 32;
+
+    Allocator* allocator;
+    Free_Block* free_lists[size_class_count] = {};
+    Array<Deallocated_Block> deallocated;
+
+  public:
+    Recycling_Allocator(Allocator* allocator);
+    Recycling_Allocator(Recycling_Allocator const&) = delete;
+    Recycling_Allocator& operator=(Recycling_Allocator const&) = delete;
+
+    [[nodiscard]] void* allocate(isize size, isize alignment) override;
+    void deallocate(void* memory, isize size, isize alignment) override;
+    [[nodiscard]] bool is_equal(Allocator const& other) const override;
+
+    // recycle
+    // Make the blocks deallocated since the previous call available to the
+    // subsequent allocations.
+    //
+    void recycle();
+
+  private:
+    // get_size_class
+    //
+    // Returns:
+    // The size class of the block or -1 if the block is not recycled.
+    //
+    [[nodiscard]] static i64 get_size_class(isize size, isize alignment);
+  };
+} // namespace vush
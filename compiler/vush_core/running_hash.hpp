@@ -1,5 +1,8 @@
 #pragma once
 
+#include <bit>
+#include <string.h>
+
 #include <anton/string_view.hpp>
 
 #include <vush_core/types.hpp>
@@ -7,57 +10,114 @@
 namespace vush {
   // Running_Hash
   //
-  // Implements the murmurhash.
+  // Implements the streaming xxhash64. The input is consumed in stripes of 32
+  // bytes by 4 independent lanes, hence bulk input is hashed at close to
+  // memory bandwidth. The input is buffered until a whole stripe is
+  // available, hence the result does not depend on how the input is split
+  // into the calls to feed. Multibyte values are fed in the native byte
+  // order.
   //
   struct Running_Hash {
   private:
-    static constexpr u64 m = 0xc6a4a7935bd1e995;
-    static constexpr i64 r = 47;
-
-    u64 h = 0;
-    u64 buffer = 0;
+    static constexpr u64 prime1 = 0x9E3779B185EBCA87;
+    static constexpr u64 prime2 = 0xC2B2AE3D27D4EB4F;
+    static constexpr u64 prime3 = 0x165667B19E3779F9;
+    static constexpr u64 prime4 = 0x85EBCA77C2B2AE63;
+    static constexpr u64 prime5 = 0x27D4EB2F165667C5;
+    static constexpr i64 stripe_size = 32;
+
+    u64 lanes[4] = {};
+    u8 buffer[stripe_size] = {};
     i64 buffer_length = 0;
+    i64 length = 0;
 
   public:
     void start(u64 seed = 0x1F0D3804)
     {
-      h = seed;
-      buffer = 0;
+      lanes[0] = seed + prime1 + prime2;
+      lanes[1] = seed + prime2;
+      lanes[2] = seed;
+      lanes[3] = seed - prime1;
       buffer_length = 0;
+      length = 0;
     }
 
-    u64 finish()
+    // finish
+    // Does not modify the state, hence more input may be fed afterwards.
+    //
+    [[nodiscard]] u64 finish() const
     {
-      switch(buffer_length) {
-      case 7:
-        h ^= buffer & 0xFF000000000000;
-      case 6:
-        h ^= buffer & 0xFF0000000000;
-      case 5:
-        h ^= buffer & 0xFF00000000;
-      case 4:
-        h ^= buffer & 0xFF000000;
-      case 3:
-        h ^= buffer & 0xFF0000;
-      case 2:
-        h ^= buffer & 0xFF00;
-      case 1:
-        h ^= buffer & 0xFF;
-        h *= m;
+      u64 h = 0;
+      if(length >= stripe_size) {
+        h = std::rotl(lanes[0], 1) + std::rotl(lanes[1], 7) +
+            std::rotl(lanes[2], 12) + std::rotl(lanes[3], 18);
+        for(u64 const lane: lanes) {
+          h ^= round(0, lane);
+          h = h * prime1 + prime4;
+        }
+      } else {
+        // No stripe has been consumed, hence the lane holds the seed.
+        h = lanes[2] + prime5;
+      }
+
+      h += length;
+      u8 const* bytes = buffer;
+      i64 remaining = buffer_length;
+      for(; remaining >= 8; remaining -= 8, bytes += 8) {
+        h ^= round(0, load_u64(bytes));
+        h = std::rotl(h, 27) * prime1 + prime4;
+      }
+
+      if(remaining >= 4) {
+        h ^= static_cast<u64>(load_u32(bytes)) * prime1;
+        h = std::rotl(h, 23) * prime2 + prime3;
+        remaining -= 4;
+        bytes += 4;
       }
 
-      h ^= h >> r;
-      h *= m;
-      h ^= h >> r;
+      for(; remaining > 0; remaining -= 1, bytes += 1) {
+        h ^= *bytes * prime5;
+        h = std::rotl(h, 11) * prime1;
+      }
 
+      h ^= h >> 33;
+      h *= prime2;
+      h ^= h >> 29;
+      h *= prime3;
+      h ^= h >> 32;
       return h;
     }
 
-    void feed(anton::String_View const data)
+    void feed(void const* const data, i64 const size)
     {
-      for(char8 const c: data.bytes()) {
-        feed(c);
+      u8 const* bytes = static_cast<u8 const*>(data);
+      u8 const* const end = bytes + size;
+      length += size;
+      if(buffer_length + size < stripe_size) {
+        memcpy(buffer + buffer_length, bytes, size);
+        buffer_length += size;
+        return;
+      }
+
+      if(buffer_length > 0) {
+        i64 const fill = stripe_size - buffer_length;
+        memcpy(buffer + buffer_length, bytes, fill);
+        consume_stripe(buffer);
+        bytes += fill;
+        buffer_length = 0;
       }
+
+      for(; end - bytes >= stripe_size; bytes += stripe_size) {
+        consume_stripe(bytes);
+      }
+
+      buffer_length = end - bytes;
+      memcpy(buffer, bytes, buffer_length);
+    }
+
+    void feed(anton::String_View const data)
+    {
+      feed(data.bytes_begin(), data.size_bytes());
     }
 
     void feed(char8 const data)
@@ -67,51 +127,45 @@ namespace vush {
 
     void feed(u8 const data)
     {
-      buffer = buffer << 8 | data;
-      buffer_length += 1;
-
-      if(buffer_length == 8) {
-        flush_buffer();
-      }
+      feed(&data, sizeof(data));
     }
 
     void feed(u32 const data)
     {
-      if(buffer_length + 4 >= 8) {
-        i32 const rem = 8 * ((buffer_length + 4) % 8);
-        i32 const size = 32 - rem;
-        buffer = buffer << size | data >> (32 - size);
-        flush_buffer();
-        buffer = data & (((u32)0x1 << rem) - 1);
-      } else {
-        buffer = buffer << 32 | data;
-      }
-      buffer_length = (buffer_length + 4) % 8;
+      feed(&data, sizeof(data));
     }
 
     void feed(u64 const data)
     {
-      // buffer_length remains unchanged.
-      // v + 8 mod 8 = v
-      i32 const rem = 64 * buffer_length;
-      i32 const size = 64 - rem;
-      buffer = buffer << size | data >> (64 - size);
-      flush_buffer();
-      buffer = data & (((u32)0x1 << rem) - 1);
+      feed(&data, sizeof(data));
     }
 
   private:
-    void flush_buffer()
+    [[nodiscard]] static u64 round(u64 const lane, u64 const input)
     {
-      buffer *= m;
-      buffer ^= buffer >> r;
-      buffer *= m;
+      return std::rotl(lane + input * prime2, 31) * prime1;
+    }
 
-      h ^= buffer;
-      h *= m;
+    [[nodiscard]] static u64 load_u64(u8 const* const bytes)
+    {
+      u64 value;
+      memcpy(&value, bytes, sizeof(value));
+      return value;
+    }
 
-      buffer = 0;
-      buffer_length = 0;
+    [[nodiscard]] static u32 load_u32(u8 const* const bytes)
+    {
+      u32 value;
+      memcpy(&value, bytes, sizeof(value));
+      return value;
+    }
+
+    void consume_stripe(u8 const* const bytes)
+    {
+      lanes[0] = round(lanes[0], load_u64(bytes));
+      lanes[1] = round(lanes[1], load_u64(bytes + 8));
+      lanes[2] = round(lanes[2], load_u64(bytes + 16));
+      lanes[3] = round(lanes[3], load_u64(bytes + 24));
     }
   };
 } // namespace vush
@@ -12,6 +12,7 @@ namespace vush {
 
     Array<Entry_Map> scopes;
     Allocator* allocator;
+    Scoped_Map const* parent = nullptr;
 
   public:
     Scoped_Map(Allocator* allocator): scopes(allocator), allocator(allocator)
@@ -20,9 +21,23 @@ namespace vush {
       push_scope();
     }
 
+    // Scoped_Map
+    // Create a map that falls back to parent when a lookup fails. The parent
+    // is never modified through the child map, therefore multiple children may
+    // share a single parent as long as nothing adds entries to the parent while
+    // the children are in use.
+    //
+    Scoped_Map(Allocator* allocator, Scoped_Map const* parent)
+      : scopes(allocator), allocator(allocator), parent(parent)
+    {
+      // Push global scope.
+      push_scope();
+    }
+
     // find_entry
     // Looks up an entry with the given key in the scopes starting from the
-    // innermost and progressing towards the outermost.
+    // innermost and progressing towards the outermost. If the entry is not
+    // found, the lookup continues in the parent map.
     //
     // Returns:
     // Pointer to the value of the entry or nullptr if not found.
@@ -36,6 +51,11 @@ namespace vush {
           return &result->value;
         }
       }
+
+      if(parent != nullptr) {
+        return parent->find_entry(name);
+      }
+
       return nullptr;
     }
 
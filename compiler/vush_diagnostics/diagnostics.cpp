@@ -322,6 +322,34 @@ namespace vush {
     return error;
   }
 
+  Error err_unexpected_attribute_parameter(Context const& ctx,
+                                           Source_Info const& parameter)
+  {
+    Error error = error_from_source(ctx.bump_allocator, parameter);
+    anton::String_View const source =
+      ctx.source_registry->find_source(parameter.source->path)->data;
+    error.diagnostic = anton::format(
+      ctx.bump_allocator, "error: unexpected attribute parameter '{}'"_sv,
+      get_source_bit(source, parameter));
+    print_source_snippet(ctx, error.extended_diagnostic, source, parameter);
+    error.extended_diagnostic += " parameter not allowed"_sv;
+    return error;
+  }
+
+  Error err_invalid_unroll_count(Context const& ctx, Source_Info const& count)
+  {
+    Error error = error_from_source(ctx.bump_allocator, count);
+    anton::String_View const source =
+      ctx.source_registry->find_source(count.source->path)->data;
+    error.diagnostic = anton::format(
+      ctx.bump_allocator, "error: invalid unroll count '{}'"_sv,
+      get_source_bit(source, count));
+    print_source_snippet(ctx, error.extended_diagnostic, source, count);
+    error.extended_diagnostic +=
+      " the unroll count must be a positive integer literal"_sv;
+    return error;
+  }
+
   Error err_empty_struct(Context const& ctx, Source_Info const& struct_name)
   {
     Error error = error_from_source(ctx.bump_allocator, struct_name);
@@ -97,6 +97,10 @@ namespace vush {
                                               Source_Info const& new_attr);
   [[nodiscard]] Error err_illegal_attribute(Context const& ctx,
                                             Source_Info const& attr);
+  [[nodiscard]] Error err_unexpected_attribute_parameter(
+    Context const& ctx, Source_Info const& parameter);
+  [[nodiscard]] Error err_invalid_unroll_count(Context const& ctx,
+                                               Source_Info const& count);
   [[nodiscard]] Error err_empty_struct(Context const& ctx,
                                        Source_Info const& struct_name);
   [[nodiscard]] Error
@@ -22,4 +22,14 @@ namespace vush {
     }
     return error_message;
   }
+
+  Error Error::copy(Allocator* const allocator) const
+  {
+    return Error{.source = anton::String(source, allocator),
+                 .diagnostic = anton::String(diagnostic, allocator),
+                 .extended_diagnostic =
+                   anton::String(extended_diagnostic, allocator),
+                 .line = line,
+                 .column = column};
+  }
 } // namespace vush
@@ -35,5 +35,11 @@ namespace vush {
     //
     [[nodiscard]] anton::String format(Allocator* allocator,
                                        bool include_extended_diagnostic) const;
+
+    // copy
+    // Copy the error into allocator. Used to move the error out of an arena
+    // that does not outlive the compilation.
+    //
+    [[nodiscard]] Error copy(Allocator* allocator) const;
   };
 } // namespace vush
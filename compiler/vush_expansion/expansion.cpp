@@ -5,6 +5,7 @@
 #include <vush_autogen/syntax_accessors.hpp>
 #include <vush_core/context.hpp>
 #include <vush_lexer/lexer.hpp>
+#include <vush_module/module.hpp>
 #include <vush_parser/parser.hpp>
 
 namespace vush {
@@ -14,6 +15,27 @@ namespace vush {
     return {anton::expected_error, ANTON_MOV(variable.error())}; \
   }
 
+  [[nodiscard]] static anton::Expected<SNOT*, Error>
+  parse_imported_source(Context& ctx, Source_Data const* const source)
+  {
+    SNOT* const module = load_module(ctx, source);
+    if(module != nullptr) {
+      return {anton::expected_value, module};
+    }
+
+    RETURN_ON_FAIL(lex_result, lex_source, ctx, source->path,
+                   anton::String7_View{source->data.bytes_begin(),
+                                       source->data.bytes_end()});
+
+    Parse_Syntax_Options parse_options{.include_whitespace_and_comments =
+                                         false};
+    RETURN_ON_FAIL(parse_result, parse_tokens, ctx, source, lex_result.value(),
+                   parse_options);
+
+    store_module(ctx, source, parse_result.value());
+    return {anton::expected_value, parse_result.value()};
+  }
+
   anton::Expected<SNOT*, Error> full_expand(Context& ctx, SNOT* snots)
   {
     while(true) {
@@ -29,14 +51,7 @@ namespace vush {
           continue;
         }
 
-        RETURN_ON_FAIL(lex_result, lex_source, ctx, source->path,
-                       anton::String7_View{source->data.bytes_begin(),
-                                           source->data.bytes_end()});
-
-        Parse_Syntax_Options parse_options{.include_whitespace_and_comments =
-                                             false};
-        RETURN_ON_FAIL(parse_result, parse_tokens, ctx, source,
-                       lex_result.value(), parse_options);
+        RETURN_ON_FAIL(parse_result, parse_imported_source, ctx, source);
 
         anton::ilist_splice_after(snots, parse_result.value());
         anton::ilist_erase(snots);
@@ -0,0 +1,474 @@
+#include <vush_ir/analysis.hpp>
+
+#include <vush_core/memory.hpp>
+#include <vush_ir/ir.hpp>
+
+// The dominators and post-dominators are computed with the algorithm from
+//   Cooper, Harvey, Kennedy, "A Simple, Fast Dominance Algorithm".
+
+namespace vush::ir {
+  static void append_unique(Array<i64>& array, i64 const value)
+  {
+    for(i64 const element: array) {
+      if(element == value) {
+        return;
+      }
+    }
+    array.push_back(value);
+  }
+
+  static void append_successors(Array<Basic_Block*>& successors,
+                                Basic_Block* const block)
+  {
+    if(block->empty()) {
+      return;
+    }
+
+    Instr* const last = block->get_last();
+    switch(last->instr_kind) {
+    case Instr_Kind::e_branch: {
+      auto const instr = static_cast<Instr_branch*>(last);
+      successors.push_back(instr->target);
+    } break;
+
+    case Instr_Kind::e_brcond: {
+      auto const instr = static_cast<Instr_brcond*>(last);
+      successors.push_back(instr->then_target);
+      successors.push_back(instr->else_target);
+    } break;
+
+    case Instr_Kind::e_switch: {
+      auto const instr = static_cast<Instr_switch*>(last);
+      successors.push_back(instr->default_label);
+      for(Switch_Label const& label: instr->labels) {
+        successors.push_back(label.target);
+      }
+    } break;
+
+    default:
+      // return and die have no successors.
+      break;
+    }
+  }
+
+  CFG::CFG(Allocator* allocator)
+    : blocks(allocator), successors(allocator), predecessors(allocator),
+      indices(allocator)
+  {
+  }
+
+  i64 CFG::size() const
+  {
+    return blocks.size();
+  }
+
+  i64 CFG::get_index(Basic_Block const* const block) const
+  {
+    auto const iterator = indices.find(block);
+    if(iterator != indices.end()) {
+      return iterator->value;
+    } else {
+      return -1;
+    }
+  }
+
+  static void collect_postorder(Allocator* const allocator, CFG& cfg,
+                                Array<Basic_Block*>& postorder,
+                                Basic_Block* const block)
+  {
+    // The final numbers are assigned once the order is known.
+    cfg.indices.emplace(block, -1);
+    Array<Basic_Block*> successors(allocator);
+    append_successors(successors, block);
+    for(Basic_Block* const successor: successors) {
+      if(cfg.indices.find(successor) == cfg.indices.end()) {
+        collect_postorder(allocator, cfg, postorder, successor);
+      }
+    }
+    postorder.push_back(block);
+  }
+
+  CFG* build_cfg(Allocator* const allocator, Function* const function)
+  {
+    auto const cfg = VUSH_ALLOCATE(CFG, allocator, allocator);
+    Array<Basic_Block*> postorder(allocator);
+    collect_postorder(allocator, *cfg, postorder, function->entry_block);
+    for(i64 i = postorder.size() - 1; i >= 0; i -= 1) {
+      Basic_Block* const block = postorder[i];
+      cfg->indices.find(block)->value = cfg->blocks.size();
+      cfg->blocks.push_back(block);
+      cfg->successors.push_back(Array<i64>(allocator));
+      cfg->predecessors.push_back(Array<i64>(allocator));
+    }
+
+    Array<Basic_Block*> successors(allocator);
+    for(i64 i = 0; i < cfg->size(); i += 1) {
+      successors.clear();
+      append_successors(successors, cfg->blocks[i]);
+      // A block branching to the same successor multiple times is a single
+      // predecessor of that successor.
+      for(Basic_Block* const successor: successors) {
+        i64 const index = cfg->get_index(successor);
+        append_unique(cfg->successors[i], index);
+        append_unique(cfg->predecessors[index], i);
+      }
+    }
+    return cfg;
+  }
+
+  void deallocate_cfg(Allocator* const allocator, CFG* const cfg)
+  {
+    cfg->~CFG();
+    deallocate(allocator, cfg);
+  }
+
+  Dominator_Tree::Dominator_Tree(Allocator* allocator)
+    : idoms(allocator), children(allocator), frontiers(allocator)
+  {
+  }
+
+  bool Dominator_Tree::dominates(i64 const a, i64 b) const
+  {
+    // Dominators always have lower numbers than the blocks they dominate.
+    while(b > a) {
+      b = idoms[b];
+    }
+    return a == b;
+  }
+
+  [[nodiscard]] static i64 intersect(Array<i64> const& idoms, i64 b1, i64 b2)
+  {
+    while(b1 != b2) {
+      while(b1 > b2) {
+        b1 = idoms[b1];
+      }
+      while(b2 > b1) {
+        b2 = idoms[b2];
+      }
+    }
+    return b1;
+  }
+
+  Dominator_Tree* build_dominator_tree(Allocator* const allocator,
+                                       CFG const& cfg)
+  {
+    auto const tree = VUSH_ALLOCATE(Dominator_Tree, allocator, allocator);
+    for(i64 i = 0; i < cfg.size(); i += 1) {
+      tree->idoms.push_back(-1);
+      tree->children.push_back(Array<i64>(allocator));
+      tree->frontiers.push_back(Array<i64>(allocator));
+    }
+    tree->idoms[0] = 0;
+
+    // Blocks are numbered in reverse postorder, hence a single sweep suffices
+    // unless the CFG contains loops.
+    bool changed = true;
+    while(changed) {
+      changed = false;
+      for(i64 b = 1; b < cfg.size(); b += 1) {
+        i64 new_idom = -1;
+        for(i64 const p: cfg.predecessors[b]) {
+          if(tree->idoms[p] == -1) {
+            continue;
+          }
+
+          if(new_idom == -1) {
+            new_idom = p;
+          } else {
+            new_idom = intersect(tree->idoms, p, new_idom);
+          }
+        }
+
+        if(tree->idoms[b] != new_idom) {
+          tree->idoms[b] = new_idom;
+          changed = true;
+        }
+      }
+    }
+
+    for(i64 b = 1; b < cfg.size(); b += 1) {
+      tree->children[tree->idoms[b]].push_back(b);
+    }
+
+    for(i64 b = 0; b < cfg.size(); b += 1) {
+      if(cfg.predecessors[b].size() < 2) {
+        continue;
+      }
+
+      for(i64 const p: cfg.predecessors[b]) {
+        i64 runner = p;
+        while(runner != tree->idoms[b]) {
+          append_unique(tree->frontiers[runner], b);
+          runner = tree->idoms[runner];
+        }
+      }
+    }
+
+    return tree;
+  }
+
+  void deallocate_dominator_tree(Allocator* const allocator,
+                                 Dominator_Tree* const tree)
+  {
+    tree->~Dominator_Tree();
+    deallocate(allocator, tree);
+  }
+
+  Post_Dominator_Tree::Post_Dominator_Tree(Allocator* allocator)
+    : ipdoms(allocator), children(allocator), order(allocator)
+  {
+  }
+
+  bool Post_Dominator_Tree::post_dominates(i64 const a, i64 b) const
+  {
+    if(order[a] == -1 || order[b] == -1) {
+      return false;
+    }
+
+    // Post-dominators always have lower numbers than the nodes they
+    // post-dominate.
+    while(order[b] > order[a]) {
+      b = ipdoms[b];
+    }
+    return a == b;
+  }
+
+  static void collect_reverse_postorder(CFG const& cfg,
+                                        Post_Dominator_Tree& tree,
+                                        Array<i64>& postorder, i64 const node)
+  {
+    // Mark the node as visited. The final numbers are assigned once the order
+    // is known.
+    tree.order[node] = 0;
+    for(i64 const predecessor: cfg.predecessors[node]) {
+      if(tree.order[predecessor] == -1) {
+        collect_reverse_postorder(cfg, tree, postorder, predecessor);
+      }
+    }
+    postorder.push_back(node);
+  }
+
+  [[nodiscard]] static i64 intersect_post(Post_Dominator_Tree const& tree,
+                                          i64 b1, i64 b2)
+  {
+    while(b1 != b2) {
+      while(tree.order[b1] > tree.order[b2]) {
+        b1 = tree.ipdoms[b1];
+      }
+      while(tree.order[b2] > tree.order[b1]) {
+        b2 = tree.ipdoms[b2];
+      }
+    }
+    return b1;
+  }
+
+  Post_Dominator_Tree* build_post_dominator_tree(Allocator* const allocator,
+                                                 CFG const& cfg)
+  {
+    auto const tree =
+      VUSH_ALLOCATE(Post_Dominator_Tree, allocator, allocator);
+    i64 const exit = cfg.size();
+    tree->exit = exit;
+    for(i64 i = 0; i <= exit; i += 1) {
+      tree->ipdoms.push_back(-1);
+      tree->children.push_back(Array<i64>(allocator));
+      tree->order.push_back(-1);
+    }
+
+    // The postorder of the reversed CFG. The virtual exit node is the entry of
+    // the reversed CFG and its successors are the blocks without successors.
+    Array<i64> postorder(allocator);
+    tree->order[exit] = 0;
+    for(i64 b = 0; b < exit; b += 1) {
+      if(cfg.successors[b].size() == 0 && tree->order[b] == -1) {
+        collect_reverse_postorder(cfg, *tree, postorder, b);
+      }
+    }
+    postorder.push_back(exit);
+
+    Array<i64> reverse_postorder(allocator);
+    for(i64 i = postorder.size() - 1; i >= 0; i -= 1) {
+      tree->order[postorder[i]] = reverse_postorder.size();
+      reverse_postorder.push_back(postorder[i]);
+    }
+
+    tree->ipdoms[exit] = exit;
+    bool changed = true;
+    while(changed) {
+      changed = false;
+      for(i64 i = 1; i < reverse_postorder.size(); i += 1) {
+        i64 const b = reverse_postorder[i];
+        i64 new_ipdom = -1;
+        if(cfg.successors[b].size() == 0) {
+          new_ipdom = exit;
+        }
+
+        for(i64 const s: cfg.successors[b]) {
+          if(tree->ipdoms[s] == -1) {
+            continue;
+          }
+
+          if(new_ipdom == -1) {
+            new_ipdom = s;
+          } else {
+            new_ipdom = intersect_post(*tree, s, new_ipdom);
+          }
+        }
+
+        if(tree->ipdoms[b] != new_ipdom) {
+          tree->ipdoms[b] = new_ipdom;
+          changed = true;
+        }
+      }
+    }
+
+    for(i64 b = 0; b < exit; b += 1) {
+      if(tree->ipdoms[b] != -1) {
+        tree->children[tree->ipdoms[b]].push_back(b);
+      }
+    }
+
+    return tree;
+  }
+
+  void deallocate_post_dominator_tree(Allocator* const allocator,
+                                      Post_Dominator_Tree* const tree)
+  {
+    tree->~Post_Dominator_Tree();
+    deallocate(allocator, tree);
+  }
+
+  Loop::Loop(Allocator* allocator, i64 const header)
+    : header(header), latches(allocator), blocks(allocator),
+      children(allocator)
+  {
+  }
+
+  Loop_Info::Loop_Info(Allocator* allocator)
+    : loops(allocator), block_loops(allocator)
+  {
+  }
+
+  Loop* Loop_Info::get_loop(i64 const block) const
+  {
+    return block_loops[block];
+  }
+
+  i64 Loop_Info::get_depth(i64 const block) const
+  {
+    Loop const* const loop = block_loops[block];
+    if(loop != nullptr) {
+      return loop->depth;
+    } else {
+      return 0;
+    }
+  }
+
+  bool Loop_Info::is_header(i64 const block) const
+  {
+    Loop const* const loop = block_loops[block];
+    return loop != nullptr && loop->header == block;
+  }
+
+  bool Loop_Info::contains(Loop const* const loop, i64 const block) const
+  {
+    for(Loop const* l = block_loops[block]; l != nullptr; l = l->parent) {
+      if(l == loop) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  [[nodiscard]] static Loop* get_outermost_loop(Loop* loop)
+  {
+    while(loop->parent != nullptr) {
+      loop = loop->parent;
+    }
+    return loop;
+  }
+
+  Loop_Info* build_loop_info(Allocator* const allocator, CFG const& cfg,
+                             Dominator_Tree const& dominator_tree)
+  {
+    auto const info = VUSH_ALLOCATE(Loop_Info, allocator, allocator);
+    for(i64 b = 0; b < cfg.size(); b += 1) {
+      info->block_loops.push_back(nullptr);
+    }
+
+    // The header of an enclosing loop dominates the headers of the nested
+    // loops and therefore has a lower number. Visiting the headers in the
+    // reverse order discovers the nested loops first.
+    Array<i64> worklist(allocator);
+    for(i64 h = cfg.size() - 1; h >= 0; h -= 1) {
+      worklist.clear();
+      for(i64 const p: cfg.predecessors[h]) {
+        if(dominator_tree.dominates(h, p)) {
+          worklist.push_back(p);
+        }
+      }
+
+      if(worklist.size() == 0) {
+        continue;
+      }
+
+      auto const loop = VUSH_ALLOCATE(Loop, allocator, allocator, h);
+      for(i64 const latch: worklist) {
+        loop->latches.push_back(latch);
+      }
+      loop->blocks.push_back(h);
+      info->block_loops[h] = loop;
+      info->loops.push_back(loop);
+
+      // Walk the CFG backwards from the latches until the header is reached.
+      // The nested loops are collapsed into their headers.
+      while(worklist.size() > 0) {
+        i64 const b = worklist.back();
+        worklist.pop_back();
+        Loop* const block_loop = info->block_loops[b];
+        if(block_loop == nullptr) {
+          info->block_loops[b] = loop;
+          loop->blocks.push_back(b);
+          for(i64 const p: cfg.predecessors[b]) {
+            worklist.push_back(p);
+          }
+          continue;
+        }
+
+        Loop* const nested = get_outermost_loop(block_loop);
+        if(nested == loop) {
+          continue;
+        }
+
+        nested->parent = loop;
+        loop->children.push_back(nested);
+        for(i64 const block: nested->blocks) {
+          loop->blocks.push_back(block);
+        }
+        for(i64 const p: cfg.predecessors[nested->header]) {
+          worklist.push_back(p);
+        }
+      }
+    }
+
+    // The enclosing loops follow the nested ones.
+    for(i64 i = info->loops.size() - 1; i >= 0; i -= 1) {
+      Loop* const loop = info->loops[i];
+      if(loop->parent != nullptr) {
+        loop->depth = loop->parent->depth + 1;
+      }
+    }
+
+    return info;
+  }
+
+  void deallocate_loop_info(Allocator* const allocator, Loop_Info* const info)
+  {
+    for(Loop* const loop: info->loops) {
+      loop->~Loop();
+      deallocate(allocator, loop);
+    }
+    info->~Loop_Info();
+    deallocate(allocator, info);
+  }
+} // namespace vush::ir
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <anton/flat_hash_map.hpp>
+
+#include <vush_core/types.hpp>
+#include <vush_ir/fwd.hpp>
+
+namespace vush::ir {
+  // CFG
+  // The control flow graph of the blocks reachable from the entry of a
+  // function. The blocks are numbered densely in reverse postorder. All
+  // per-block arrays, including those of the analyses built on top of the CFG,
+  // are indexed by the number of the block. The entry block is always 0.
+  //
+  struct CFG {
+    Array<Basic_Block*> blocks;
+    Array<Array<i64>> successors;
+    Array<Array<i64>> predecessors;
+    anton::Flat_Hash_Map<Basic_Block const*, i64> indices;
+
+    CFG(Allocator* allocator);
+
+    [[nodiscard]] i64 size() const;
+
+    // get_index
+    //
+    // Returns:
+    // The number of the block or -1 if the block is unreachable.
+    //
+    [[nodiscard]] i64 get_index(Basic_Block const* block) const;
+  };
+
+  [[nodiscard]] CFG* build_cfg(Allocator* allocator, Function* function);
+
+  // deallocate_cfg
+  // Destroy the CFG built with the allocator and return its memory.
+  //
+  void deallocate_cfg(Allocator* allocator, CFG* cfg);
+
+  // Dominator_Tree
+  // The immediate dominators and dominance frontiers of the blocks of a CFG.
+  //
+  struct Dominator_Tree {
+    // The entry block is its own immediate dominator.
+    Array<i64> idoms;
+    Array<Array<i64>> children;
+    Array<Array<i64>> frontiers;
+
+    Dominator_Tree(Allocator* allocator);
+
+    // dominates
+    //
+    // Returns:
+    // Whether block a dominates block b. A block dominates itself.
+    //
+    [[nodiscard]] bool dominates(i64 a, i64 b) const;
+  };
+
+  [[nodiscard]] Dominator_Tree* build_dominator_tree(Allocator* allocator,
+                                                     CFG const& cfg);
+
+  void deallocate_dominator_tree(Allocator* allocator, Dominator_Tree* tree);
+
+  // Post_Dominator_Tree
+  // The immediate post-dominators of the blocks of a CFG. The blocks that
+  // leave the function are post-dominated by a virtual exit node, which is
+  // numbered after the last block of the CFG and is its own immediate
+  // post-dominator. Blocks from which the function cannot be left, i.e.
+  // infinite loops, have no post-dominators.
+  //
+  struct Post_Dominator_Tree {
+    i64 exit;
+    // The immediate post-dominators of the blocks and the exit node. -1 for
+    // blocks without post-dominators.
+    Array<i64> ipdoms;
+    Array<Array<i64>> children;
+    // The reverse postorder numbers of the nodes in the reversed CFG. -1 for
+    // blocks without post-dominators.
+    Array<i64> order;
+
+    Post_Dominator_Tree(Allocator* allocator);
+
+    // post_dominates
+    //
+    // Returns:
+    // Whether block a post-dominates block b. A block post-dominates itself.
+    //
+    [[nodiscard]] bool post_dominates(i64 a, i64 b) const;
+  };
+
+  [[nodiscard]] Post_Dominator_Tree*
+  build_post_dominator_tree(Allocator* allocator, CFG const& cfg);
+
+  void deallocate_post_dominator_tree(Allocator* allocator,
+                                      Post_Dominator_Tree* tree);
+
+  // Loop
+  // A natural loop of a CFG. Loops sharing a header are merged.
+  //
+  struct Loop {
+    i64 header;
+    // The blocks with back edges to the header.
+    Array<i64> latches;
+    // All blocks of the loop including those of the nested loops. The header
+    // is always the first one.
+    Array<i64> blocks;
+    Loop* parent = nullptr;
+    Array<Loop*> children;
+    // The number of loops enclosing the loop including itself.
+    i64 depth = 1;
+
+    Loop(Allocator* allocator, i64 header);
+  };
+
+  // Loop_Info
+  // The loop nest of a CFG.
+  //
+  struct Loop_Info {
+    // The loops ordered such that the nested loops precede the enclosing ones.
+    Array<Loop*> loops;
+    // The innermost loop of each block. nullptr for blocks outside of loops.
+    Array<Loop*> block_loops;
+
+    Loop_Info(Allocator* allocator);
+
+    [[nodiscard]] Loop* get_loop(i64 block) const;
+
+    // get_depth
+    //
+    // Returns:
+    // The number of loops enclosing the block. 0 if the block is not in a
+    // loop.
+    //
+    [[nodiscard]] i64 get_depth(i64 block) const;
+
+    [[nodiscard]] bool is_header(i64 block) const;
+
+    // contains
+    //
+    // Returns:
+    // Whether the block belongs to the loop or any of its nested loops.
+    //
+    [[nodiscard]] bool contains(Loop const* loop, i64 block) const;
+  };
+
+  [[nodiscard]] Loop_Info*
+  build_loop_info(Allocator* allocator, CFG const& cfg,
+                  Dominator_Tree const& dominator_tree);
+
+  // deallocate_loop_info
+  // Destroy the loop info along with its loops and return their memory.
+  //
+  void deallocate_loop_info(Allocator* allocator, Loop_Info* info);
+} // namespace vush::ir
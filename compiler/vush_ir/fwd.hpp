@@ -7,6 +7,7 @@ namespace vush::ir {
   struct Basic_Block;
   struct Function;
   struct Buffer;
+  struct Use;
   struct Value;
   struct Argument;
   struct Constant;
@@ -1,5 +1,7 @@
 #include <vush_ir/ir.hpp>
 
+#include <bit>
+
 #include <vush_core/memory.hpp>
 #include <vush_core/utility.hpp>
 #include <vush_ir/opcodes.hpp>
@@ -249,6 +251,13 @@ namespace vush::ir {
              Instr_Kind::e_cvt_fp2ui;
   }
 
+  template<>
+  bool instanceof<Instr_select>(Value const* value)
+  {
+    return value->value_kind == Value_Kind::e_instr &&
+           static_cast<Instr const*>(value)->instr_kind == Instr_Kind::e_select;
+  }
+
   template<>
   bool instanceof<Instr_call>(Value const* value)
   {
@@ -306,45 +315,631 @@ namespace vush::ir {
            static_cast<Instr const*>(value)->instr_kind == Instr_Kind::e_die;
   }
 
+  // get_operand
+  //
+  // Returns:
+  // The operand of the instruction at the index.
+  //
+  [[nodiscard]] static Value*& get_operand(Instr* const generic_instr,
+                                           i64 const index)
+  {
+#define CASE_SINGLE_OPERAND(KIND, TYPE, OPERAND)          \
+  case Instr_Kind::KIND: {                                \
+    return static_cast<TYPE*>(generic_instr)->OPERAND;    \
+  }
+#define CASE_TWO_OPERANDS(KIND, TYPE, OPERAND0, OPERAND1) \
+  case Instr_Kind::KIND: {                                \
+    auto const instr = static_cast<TYPE*>(generic_instr); \
+    if(index == 0) {                                      \
+      return instr->OPERAND0;                             \
+    } else {                                              \
+      return instr->OPERAND1;                             \
+    }                                                     \
+  }
+
+    switch(generic_instr->instr_kind) {
+      CASE_SINGLE_OPERAND(e_load, Instr_load, address)
+      CASE_SINGLE_OPERAND(e_vector_extract, Instr_vector_extract, value)
+      CASE_SINGLE_OPERAND(e_composite_extract, Instr_composite_extract, value)
+      CASE_SINGLE_OPERAND(e_cvt_sext, Instr_cvt_sext, value)
+      CASE_SINGLE_OPERAND(e_cvt_zext, Instr_cvt_zext, value)
+      CASE_SINGLE_OPERAND(e_cvt_trunc, Instr_cvt_trunc, value)
+      CASE_SINGLE_OPERAND(e_cvt_fpext, Instr_cvt_fpext, value)
+      CASE_SINGLE_OPERAND(e_cvt_fptrunc, Instr_cvt_fptrunc, value)
+      CASE_SINGLE_OPERAND(e_cvt_si2fp, Instr_cvt_si2fp, value)
+      CASE_SINGLE_OPERAND(e_cvt_fp2si, Instr_cvt_fp2si, value)
+      CASE_SINGLE_OPERAND(e_cvt_ui2fp, Instr_cvt_ui2fp, value)
+      CASE_SINGLE_OPERAND(e_cvt_fp2ui, Instr_cvt_fp2ui, value)
+      CASE_SINGLE_OPERAND(e_brcond, Instr_brcond, condition)
+      CASE_SINGLE_OPERAND(e_switch, Instr_switch, selector)
+      CASE_SINGLE_OPERAND(e_return, Instr_return, value)
+      CASE_TWO_OPERANDS(e_store, Instr_store, dst, src)
+      CASE_TWO_OPERANDS(e_alu, Instr_ALU, src1, src2)
+      CASE_TWO_OPERANDS(e_vector_insert, Instr_vector_insert, dst, value)
+
+    case Instr_Kind::e_getptr: {
+      auto const instr = static_cast<Instr_getptr*>(generic_instr);
+      if(index == 0) {
+        return instr->address;
+      } else {
+        return instr->indices[index - 1];
+      }
+    }
+
+    case Instr_Kind::e_composite_construct:
+      return static_cast<Instr_composite_construct*>(generic_instr)
+        ->elements[index];
+
+    case Instr_Kind::e_select: {
+      auto const instr = static_cast<Instr_select*>(generic_instr);
+      if(index == 0) {
+        return instr->condition;
+      } else if(index == 1) {
+        return instr->then_value;
+      } else {
+        return instr->else_value;
+      }
+    }
+
+    case Instr_Kind::e_call:
+      return static_cast<Instr_call*>(generic_instr)->args[index];
+
+    case Instr_Kind::e_ext_call:
+      return static_cast<Instr_ext_call*>(generic_instr)->args[index];
+
+    case Instr_Kind::e_phi:
+      return static_cast<Instr_phi*>(generic_instr)->srcs[index].value;
+
+    case Instr_Kind::e_intrinsic:
+    case Instr_Kind::e_alloc:
+    case Instr_Kind::e_branch:
+    case Instr_Kind::e_die:
+      ANTON_UNREACHABLE("instruction has no operands");
+    }
+
+#undef CASE_SINGLE_OPERAND
+#undef CASE_TWO_OPERANDS
+  }
+
+  // link_use
+  // Insert the use at the head of the list of the uses of its value.
+  //
+  static void link_use(Use* const use)
+  {
+    Value* const value = use->value;
+    use->prev = nullptr;
+    use->next = value->uses;
+    if(value->uses != nullptr) {
+      value->uses->prev = use;
+    }
+    value->uses = use;
+  }
+
+  Use* add_use(Allocator* const allocator, Instr* const user,
+               Value* const value, i64 const operand)
+  {
+    auto const use =
+      VUSH_ALLOCATE(Use, allocator, .value = value, .user = user,
+                    .operand = operand, .next_operand = user->operands);
+    user->operands = use;
+    link_use(use);
+    return use;
+  }
+
+  void remove_use(Use* const use)
+  {
+    if(use->prev != nullptr) {
+      use->prev->next = use->next;
+    } else if(use->value->uses == use) {
+      use->value->uses = use->next;
+    }
+
+    if(use->next != nullptr) {
+      use->next->prev = use->prev;
+    }
+
+    use->prev = nullptr;
+    use->next = nullptr;
+  }
+
+  void set_use(Use* const use, Value* const replacement)
+  {
+    remove_use(use);
+    get_operand(use->user, use->operand) = replacement;
+    use->value = replacement;
+    link_use(use);
+  }
+
+  void drop_operands(Allocator* const allocator, Instr* const instruction)
+  {
+    Use* use = instruction->operands;
+    while(use != nullptr) {
+      Use* const next = use->next_operand;
+      remove_use(use);
+      deallocate(allocator, use);
+      use = next;
+    }
+    instruction->operands = nullptr;
+  }
+
+  // deallocate_instruction
+  // Destroy the instruction and return its memory to the allocator.
+  //
+  static void deallocate_instruction(Allocator* const allocator,
+                                     Instr* const generic_instr)
+  {
+#define CASE_DEALLOCATE(KIND, TYPE)                       \
+  case Instr_Kind::KIND: {                                \
+    auto const instr = static_cast<TYPE*>(generic_instr); \
+    instr->~TYPE();                                       \
+    deallocate(allocator, instr);                         \
+  } break;
+
+    switch(generic_instr->instr_kind) {
+    case Instr_Kind::e_intrinsic: {
+      auto const instr = static_cast<Instr_intrinsic*>(generic_instr);
+      switch(instr->intrinsic_kind) {
+      case Intrinsic_Kind::e_scf_branch_head:
+        deallocate(allocator,
+                   static_cast<Intrinsic_scf_branch_head*>(generic_instr));
+        break;
+
+      case Intrinsic_Kind::e_scf_loop_head:
+        deallocate(allocator,
+                   static_cast<Intrinsic_scf_loop_head*>(generic_instr));
+        break;
+      }
+    } break;
+
+      CASE_DEALLOCATE(e_alloc, Instr_alloc)
+      CASE_DEALLOCATE(e_load, Instr_load)
+      CASE_DEALLOCATE(e_store, Instr_store)
+      CASE_DEALLOCATE(e_getptr, Instr_getptr)
+      CASE_DEALLOCATE(e_alu, Instr_ALU)
+      CASE_DEALLOCATE(e_vector_extract, Instr_vector_extract)
+      CASE_DEALLOCATE(e_vector_insert, Instr_vector_insert)
+      CASE_DEALLOCATE(e_composite_extract, Instr_composite_extract)
+      CASE_DEALLOCATE(e_composite_construct, Instr_composite_construct)
+      CASE_DEALLOCATE(e_cvt_sext, Instr_cvt_sext)
+      CASE_DEALLOCATE(e_cvt_zext, Instr_cvt_zext)
+      CASE_DEALLOCATE(e_cvt_trunc, Instr_cvt_trunc)
+      CASE_DEALLOCATE(e_cvt_fpext, Instr_cvt_fpext)
+      CASE_DEALLOCATE(e_cvt_fptrunc, Instr_cvt_fptrunc)
+      CASE_DEALLOCATE(e_cvt_si2fp, Instr_cvt_si2fp)
+      CASE_DEALLOCATE(e_cvt_fp2si, Instr_cvt_fp2si)
+      CASE_DEALLOCATE(e_cvt_ui2fp, Instr_cvt_ui2fp)
+      CASE_DEALLOCATE(e_cvt_fp2ui, Instr_cvt_fp2ui)
+      CASE_DEALLOCATE(e_select, Instr_select)
+      CASE_DEALLOCATE(e_call, Instr_call)
+      CASE_DEALLOCATE(e_ext_call, Instr_ext_call)
+      CASE_DEALLOCATE(e_branch, Instr_branch)
+      CASE_DEALLOCATE(e_brcond, Instr_brcond)
+      CASE_DEALLOCATE(e_switch, Instr_switch)
+      CASE_DEALLOCATE(e_phi, Instr_phi)
+      CASE_DEALLOCATE(e_return, Instr_return)
+      CASE_DEALLOCATE(e_die, Instr_die)
+    }
+
+#undef CASE_DEALLOCATE
+  }
+
+  void erase_instruction(Allocator* const allocator, Instr* const instruction)
+  {
+    ANTON_ASSERT(!instruction->has_uses(), "erased instruction has uses");
+    drop_operands(allocator, instruction);
+    anton::ilist_erase(instruction);
+    deallocate_instruction(allocator, instruction);
+  }
+
+  void replace_uses_with(Value* const value, Value* const replacement)
+  {
+    ANTON_ASSERT(value != replacement, "value must not replace itself");
+    Use* use = value->uses;
+    if(use == nullptr) {
+      return;
+    }
+
+    // Retarget the operands and find the tail of the list in a single pass,
+    // then splice the whole list in front of the uses of the replacement.
+    Use* last = nullptr;
+    for(; use != nullptr; use = use->next) {
+      get_operand(use->user, use->operand) = replacement;
+      use->value = replacement;
+      last = use;
+    }
+
+    last->next = replacement->uses;
+    if(replacement->uses != nullptr) {
+      replacement->uses->prev = last;
+    }
+    replacement->uses = value->uses;
+    value->uses = nullptr;
+  }
+
+  void remove_phi_sources(Basic_Block* const block,
+                          Basic_Block const* const predecessor)
+  {
+    // Phis are always placed at the start of the block.
+    for(Instr& instruction: block->instructions) {
+      if(instruction.instr_kind != Instr_Kind::e_phi) {
+        break;
+      }
+
+      auto const phi = static_cast<Instr_phi*>(&instruction);
+      for(i64 i = phi->srcs.size() - 1; i >= 0; i -= 1) {
+        if(phi->srcs[i].block == predecessor) {
+          phi->remove_source(i);
+        }
+      }
+    }
+  }
+
+  void get_successors(Instr const* const terminator,
+                      Array<Basic_Block*>& successors)
+  {
+    switch(terminator->instr_kind) {
+    case Instr_Kind::e_branch: {
+      auto const branch = static_cast<Instr_branch const*>(terminator);
+      successors.push_back(branch->target);
+    } break;
+
+    case Instr_Kind::e_brcond: {
+      auto const brcond = static_cast<Instr_brcond const*>(terminator);
+      successors.push_back(brcond->then_target);
+      successors.push_back(brcond->else_target);
+    } break;
+
+    case Instr_Kind::e_switch: {
+      auto const instr_switch = static_cast<Instr_switch const*>(terminator);
+      successors.push_back(instr_switch->default_label);
+      for(Switch_Label const& label: instr_switch->labels) {
+        successors.push_back(label.target);
+      }
+    } break;
+
+    default:
+      break;
+    }
+  }
+
+  void retarget_terminator(Instr* const terminator,
+                           Basic_Block const* const block,
+                           Basic_Block* const replacement)
+  {
+    switch(terminator->instr_kind) {
+    case Instr_Kind::e_branch: {
+      auto const branch = static_cast<Instr_branch*>(terminator);
+      if(branch->target == block) {
+        branch->target = replacement;
+      }
+    } break;
+
+    case Instr_Kind::e_brcond: {
+      auto const brcond = static_cast<Instr_brcond*>(terminator);
+      if(brcond->then_target == block) {
+        brcond->then_target = replacement;
+      }
+
+      if(brcond->else_target == block) {
+        brcond->else_target = replacement;
+      }
+    } break;
+
+    case Instr_Kind::e_switch: {
+      auto const instr_switch = static_cast<Instr_switch*>(terminator);
+      if(instr_switch->default_label == block) {
+        instr_switch->default_label = replacement;
+      }
+
+      for(Switch_Label& label: instr_switch->labels) {
+        if(label.target == block) {
+          label.target = replacement;
+        }
+      }
+    } break;
+
+    default:
+      break;
+    }
+  }
+
+  void replace_terminator_with_branch(Allocator* const allocator,
+                                      Basic_Block* const block,
+                                      Basic_Block* const target)
+  {
+    Instr* const last = block->get_last();
+    if(last->instr_kind == Instr_Kind::e_brcond) {
+      auto const brcond = static_cast<Instr_brcond*>(last);
+      if(brcond->then_target != target) {
+        remove_phi_sources(brcond->then_target, block);
+      }
+
+      if(brcond->else_target != target &&
+         brcond->else_target != brcond->then_target) {
+        remove_phi_sources(brcond->else_target, block);
+      }
+    } else if(last->instr_kind == Instr_Kind::e_switch) {
+      auto const instr_switch = static_cast<Instr_switch*>(last);
+      // Each distinct target is visited once, i.e. at its first occurrence.
+      Basic_Block* const default_label = instr_switch->default_label;
+      if(default_label != target) {
+        remove_phi_sources(default_label, block);
+      }
+
+      Array<Switch_Label> const& labels = instr_switch->labels;
+      for(i64 i = 0; i < labels.size(); i += 1) {
+        Basic_Block* const label_target = labels[i].target;
+        bool visited = label_target == target || label_target == default_label;
+        for(i64 j = 0; j < i && !visited; j += 1) {
+          visited = labels[j].target == label_target;
+        }
+
+        if(!visited) {
+          remove_phi_sources(label_target, block);
+        }
+      }
+    }
+
+    for(Instr& instruction: block->instructions) {
+      if(instruction.instr_kind == Instr_Kind::e_intrinsic &&
+         static_cast<Instr_intrinsic&>(instruction).intrinsic_kind ==
+           Intrinsic_Kind::e_scf_branch_head) {
+        erase_instruction(allocator, &instruction);
+        break;
+      }
+    }
+
+    auto const branch =
+      make_instr_branch(allocator, last->id, target, last->source_info);
+    erase_instruction(allocator, last);
+    block->insert(branch);
+  }
+
+  Instr* clone_instruction(Allocator* const allocator,
+                           Instr const* const generic_instr, u32 const id)
+  {
+    Source_Info const& source_info = generic_instr->source_info;
+#define CASE_CVT(KIND, TYPE, MAKE)                                      \
+  case Instr_Kind::KIND: {                                              \
+    auto const instr = static_cast<TYPE const*>(generic_instr);         \
+    return MAKE(allocator, id, instr->type, instr->value, source_info); \
+  }
+
+    switch(generic_instr->instr_kind) {
+    case Instr_Kind::e_intrinsic: {
+      auto const instr = static_cast<Instr_intrinsic const*>(generic_instr);
+      switch(instr->intrinsic_kind) {
+      case Intrinsic_Kind::e_scf_branch_head: {
+        auto const head =
+          static_cast<Intrinsic_scf_branch_head const*>(generic_instr);
+        return make_intrinsic_scf_branch_head(allocator, head->converge_block);
+      }
+
+      case Intrinsic_Kind::e_scf_loop_head: {
+        auto const head =
+          static_cast<Intrinsic_scf_loop_head const*>(generic_instr);
+        return make_intrinsic_scf_loop_head(
+          allocator, head->merge_block, head->continue_block,
+          head->unroll_hint, head->unroll_count);
+      }
+      }
+      ANTON_UNREACHABLE("unknown intrinsic");
+    }
+
+    case Instr_Kind::e_alloc: {
+      auto const instr = static_cast<Instr_alloc const*>(generic_instr);
+      return make_instr_alloc(allocator, id, instr->alloc_type, source_info);
+    }
+
+    case Instr_Kind::e_load: {
+      auto const instr = static_cast<Instr_load const*>(generic_instr);
+      return make_instr_load(allocator, id, instr->type, instr->address,
+                             source_info);
+    }
+
+    case Instr_Kind::e_store: {
+      auto const instr = static_cast<Instr_store const*>(generic_instr);
+      return make_instr_store(allocator, id, instr->dst, instr->src,
+                              source_info);
+    }
+
+    case Instr_Kind::e_getptr: {
+      auto const instr = static_cast<Instr_getptr const*>(generic_instr);
+      anton::Slice<Value* const> const indices(
+        instr->indices.data(), instr->indices.data() + instr->indices.size());
+      return make_instr_getptr(allocator, id, instr->addressed_type,
+                               instr->address, indices, source_info);
+    }
+
+    case Instr_Kind::e_alu: {
+      auto const instr = static_cast<Instr_ALU const*>(generic_instr);
+      return make_instr_alu(allocator, id, instr->type, instr->op, instr->src1,
+                            instr->src2, source_info);
+    }
+
+    case Instr_Kind::e_vector_extract: {
+      auto const instr =
+        static_cast<Instr_vector_extract const*>(generic_instr);
+      return make_instr_vector_extract(allocator, id, instr->type,
+                                       instr->value, instr->index, source_info);
+    }
+
+    case Instr_Kind::e_vector_insert: {
+      auto const instr = static_cast<Instr_vector_insert const*>(generic_instr);
+      return make_instr_vector_insert(allocator, id, instr->type, instr->dst,
+                                      instr->value, instr->index, source_info);
+    }
+
+    case Instr_Kind::e_composite_extract: {
+      auto const instr =
+        static_cast<Instr_composite_extract const*>(generic_instr);
+      anton::Slice<i64 const> const indices(
+        instr->indices.data(), instr->indices.data() + instr->indices.size());
+      return make_instr_composite_extract(allocator, id, instr->type,
+                                          instr->value, indices, source_info);
+    }
+
+    case Instr_Kind::e_composite_construct: {
+      auto const instr =
+        static_cast<Instr_composite_construct const*>(generic_instr);
+      auto const clone =
+        make_instr_composite_construct(allocator, id, instr->type, source_info);
+      for(Value* const element: instr->elements) {
+        clone->add_element(element);
+      }
+      return clone;
+    }
+
+      CASE_CVT(e_cvt_sext, Instr_cvt_sext, make_instr_cvt_sext)
+      CASE_CVT(e_cvt_zext, Instr_cvt_zext, make_instr_cvt_zext)
+      CASE_CVT(e_cvt_trunc, Instr_cvt_trunc, make_instr_cvt_trunc)
+      CASE_CVT(e_cvt_fpext, Instr_cvt_fpext, make_instr_cvt_fpext)
+      CASE_CVT(e_cvt_fptrunc, Instr_cvt_fptrunc, make_instr_cvt_fptrunc)
+      CASE_CVT(e_cvt_si2fp, Instr_cvt_si2fp, make_instr_cvt_si2fp)
+      CASE_CVT(e_cvt_fp2si, Instr_cvt_fp2si, make_instr_cvt_fp2si)
+      CASE_CVT(e_cvt_ui2fp, Instr_cvt_ui2fp, make_instr_cvt_ui2fp)
+      CASE_CVT(e_cvt_fp2ui, Instr_cvt_fp2ui, make_instr_cvt_fp2ui)
+
+    case Instr_Kind::e_select: {
+      auto const instr = static_cast<Instr_select const*>(generic_instr);
+      return make_instr_select(allocator, id, instr->type, instr->condition,
+                               instr->then_value, instr->else_value,
+                               source_info);
+    }
+
+    case Instr_Kind::e_call: {
+      auto const instr = static_cast<Instr_call const*>(generic_instr);
+      auto const clone = make_instr_call(allocator, id, instr->function,
+                                         instr->type, source_info);
+      for(Value* const arg: instr->args) {
+        clone->add_argument(arg);
+      }
+      return clone;
+    }
+
+    case Instr_Kind::e_ext_call: {
+      auto const instr = static_cast<Instr_ext_call const*>(generic_instr);
+      auto const clone = make_instr_ext_call(allocator, id, instr->ext,
+                                             instr->type, source_info);
+      for(Value* const arg: instr->args) {
+        clone->add_argument(arg);
+      }
+      return clone;
+    }
+
+    case Instr_Kind::e_branch: {
+      auto const instr = static_cast<Instr_branch const*>(generic_instr);
+      return make_instr_branch(allocator, id, instr->target, source_info);
+    }
+
+    case Instr_Kind::e_brcond: {
+      auto const instr = static_cast<Instr_brcond const*>(generic_instr);
+      return make_instr_brcond(allocator, id, instr->condition,
+                               instr->then_target, instr->else_target,
+                               source_info);
+    }
+
+    case Instr_Kind::e_switch: {
+      auto const instr = static_cast<Instr_switch const*>(generic_instr);
+      auto const clone = make_instr_switch(allocator, id, instr->selector,
+                                           instr->default_label, source_info);
+      for(Switch_Label const& label: instr->labels) {
+        clone->add_label(label);
+      }
+      return clone;
+    }
+
+    case Instr_Kind::e_phi: {
+      auto const instr = static_cast<Instr_phi const*>(generic_instr);
+      auto const clone =
+        make_instr_phi(allocator, id, instr->type, source_info);
+      for(Phi_Source const& src: instr->srcs) {
+        clone->add_source(src.value, src.block);
+      }
+      return clone;
+    }
+
+    case Instr_Kind::e_return: {
+      auto const instr = static_cast<Instr_return const*>(generic_instr);
+      if(instr->value != nullptr) {
+        return make_instr_return(allocator, id, instr->value, source_info);
+      } else {
+        return make_instr_return(allocator, id, source_info);
+      }
+    }
+
+    case Instr_Kind::e_die:
+      return make_instr_die(allocator, id, source_info);
+    }
+
+#undef CASE_CVT
+    ANTON_UNREACHABLE("unknown instruction kind");
+  }
+
   Constant_bool* make_constant_bool(Allocator* const allocator,
                                     bool const value)
   {
-    auto const instr =
-      VUSH_ALLOCATE(Constant_bool, allocator, value, allocator);
+    auto const instr = VUSH_ALLOCATE(Constant_bool, allocator, value);
     return instr;
   }
 
   Constant_i32* make_constant_i32(Allocator* const allocator, i32 const value)
   {
-    auto const instr = VUSH_ALLOCATE(Constant_i32, allocator, value, allocator);
+    auto const instr = VUSH_ALLOCATE(Constant_i32, allocator, value);
     return instr;
   }
 
   Constant_u32* make_constant_u32(Allocator* allocator, u32 value)
   {
-    auto const instr = VUSH_ALLOCATE(Constant_u32, allocator, value, allocator);
+    auto const instr = VUSH_ALLOCATE(Constant_u32, allocator, value);
     return instr;
   }
 
   Constant_f32* make_constant_f32(Allocator* const allocator, f32 const value)
   {
-    auto const instr = VUSH_ALLOCATE(Constant_f32, allocator, value, allocator);
+    auto const instr = VUSH_ALLOCATE(Constant_f32, allocator, value);
     return instr;
   }
 
   Constant_f64* make_constant_f64(Allocator* const allocator, f64 const value)
   {
-    auto const instr = VUSH_ALLOCATE(Constant_f64, allocator, value, allocator);
+    auto const instr = VUSH_ALLOCATE(Constant_f64, allocator, value);
     return instr;
   }
 
   Constant_undef* make_constant_undef(Allocator* allocator, Type* const type)
   {
-    auto const value =
-      VUSH_ALLOCATE(Constant_undef, allocator, type, allocator);
+    auto const value = VUSH_ALLOCATE(Constant_undef, allocator, type);
     return value;
   }
 
+  bool compare_constants_equal(Constant const& lhs, Constant const& rhs)
+  {
+    if(lhs.constant_kind != rhs.constant_kind) {
+      return false;
+    }
+
+    switch(lhs.constant_kind) {
+    case Constant_Kind::e_constant_bool:
+      return static_cast<Constant_bool const&>(lhs).value ==
+             static_cast<Constant_bool const&>(rhs).value;
+    case Constant_Kind::e_constant_i32:
+      return static_cast<Constant_i32 const&>(lhs).value ==
+             static_cast<Constant_i32 const&>(rhs).value;
+    case Constant_Kind::e_constant_u32:
+      return static_cast<Constant_u32 const&>(lhs).value ==
+             static_cast<Constant_u32 const&>(rhs).value;
+    case Constant_Kind::e_constant_f32:
+      return std::bit_cast<u32>(static_cast<Constant_f32 const&>(lhs).value) ==
+             std::bit_cast<u32>(static_cast<Constant_f32 const&>(rhs).value);
+    case Constant_Kind::e_constant_f64:
+      return std::bit_cast<u64>(static_cast<Constant_f64 const&>(lhs).value) ==
+             std::bit_cast<u64>(static_cast<Constant_f64 const&>(rhs).value);
+    case Constant_Kind::e_undef:
+      return false;
+    }
+  }
+
   bool is_control_flow_instruction(Instr const* const instruction)
   {
     return instanceof<Instr_branch>(instruction) ||
@@ -358,117 +953,180 @@ namespace vush::ir {
   make_intrinsic_scf_branch_head(Allocator* allocator,
                                  Basic_Block* converge_block)
   {
-    auto const instr = VUSH_ALLOCATE(Intrinsic_scf_branch_head, allocator,
-                                     converge_block, allocator);
+    auto const instr =
+      VUSH_ALLOCATE(Intrinsic_scf_branch_head, allocator, converge_block);
+    return instr;
+  }
+
+  Intrinsic_scf_loop_head*
+  make_intrinsic_scf_loop_head(Allocator* allocator, Basic_Block* merge_block,
+                               Basic_Block* continue_block,
+                               Unroll_Hint unroll_hint, i64 unroll_count)
+  {
+    auto const instr =
+      VUSH_ALLOCATE(Intrinsic_scf_loop_head, allocator, merge_block,
+                    continue_block, unroll_hint, unroll_count);
     return instr;
   }
 
-  Instr_alloc* make_instr_alloc(Allocator* const allocator, i64 const id,
+  Instr_alloc* make_instr_alloc(Allocator* const allocator, u32 const id,
                                 Type* const alloc_type,
                                 Source_Info const& source_info)
   {
-    auto const instr = VUSH_ALLOCATE(Instr_alloc, allocator, id, alloc_type,
-                                     allocator, source_info);
+    auto const instr =
+      VUSH_ALLOCATE(Instr_alloc, allocator, id, alloc_type, source_info);
     return instr;
   }
 
-  Instr_load* make_instr_load(Allocator* const allocator, i64 const id,
+  Instr_load* make_instr_load(Allocator* const allocator, u32 const id,
                               Type* const type, Value* const address,
                               Source_Info const& source_info)
   {
-    auto const instr = VUSH_ALLOCATE(Instr_load, allocator, id, type, address,
-                                     allocator, source_info);
-    address->add_referrer(instr);
+    auto const instr =
+      VUSH_ALLOCATE(Instr_load, allocator, id, type, address, source_info);
+    add_use(allocator, instr, address, 0);
     return instr;
   }
 
-  Instr_store* make_instr_store(Allocator* const allocator, i64 const id,
+  Instr_store* make_instr_store(Allocator* const allocator, u32 const id,
                                 Value* const dst, Value* const src,
                                 Source_Info const& source_info)
   {
-    auto const instr = VUSH_ALLOCATE(Instr_store, allocator, id, dst, src,
-                                     allocator, source_info);
-    dst->add_referrer(instr);
-    src->add_referrer(instr);
+    auto const instr =
+      VUSH_ALLOCATE(Instr_store, allocator, id, dst, src, source_info);
+    add_use(allocator, instr, dst, 0);
+    add_use(allocator, instr, src, 1);
     return instr;
   }
 
-  Instr_getptr* make_instr_getptr(Allocator* const allocator, i64 const id,
+  Instr_getptr* make_instr_getptr(Allocator* const allocator, u32 const id,
                                   Type* addressed_type, Value* const address,
                                   Value* const index,
                                   Source_Info const& source_info)
   {
-    auto const instr =
-      VUSH_ALLOCATE(Instr_getptr, allocator, id, addressed_type, address, index,
-                    allocator, source_info);
-    address->add_referrer(instr);
+    auto const instr = VUSH_ALLOCATE(Instr_getptr, allocator, id,
+                                     addressed_type, address, allocator,
+                                     source_info);
+    instr->indices.push_back(index);
+    add_use(allocator, instr, address, 0);
+    add_use(allocator, instr, index, 1);
     return instr;
   }
 
-  Instr_ALU* make_instr_alu(Allocator* const allocator, i64 const id,
+  Instr_getptr* make_instr_getptr(Allocator* const allocator, u32 const id,
+                                  Type* addressed_type, Value* const address,
+                                  anton::Slice<Value* const> const indices,
+                                  Source_Info const& source_info)
+  {
+    auto const instr = VUSH_ALLOCATE(Instr_getptr, allocator, id,
+                                     addressed_type, address, allocator,
+                                     source_info);
+    add_use(allocator, instr, address, 0);
+    for(i64 i = 0; i < indices.size(); i += 1) {
+      instr->indices.push_back(indices[i]);
+      add_use(allocator, instr, indices[i], i + 1);
+    }
+    return instr;
+  }
+
+  Type* get_indexed_type(Instr_getptr const* const getptr)
+  {
+    Type* type = getptr->addressed_type;
+    for(Value const* const index: getptr->indices) {
+      switch(type->kind) {
+      case Type_Kind::e_composite: {
+        // The indices into composites are constant integers.
+        i64 i = 0;
+        if(instanceof<Constant_i32>(index)) {
+          i = static_cast<Constant_i32 const*>(index)->value;
+        } else {
+          i = static_cast<Constant_u32 const*>(index)->value;
+        }
+        type = static_cast<Type_Composite*>(type)->elements[i];
+      } break;
+
+      case Type_Kind::e_array:
+        type = static_cast<Type_Array*>(type)->element_type;
+        break;
+
+      case Type_Kind::e_mat:
+        type = static_cast<Type_Mat*>(type)->column_type;
+        break;
+
+      case Type_Kind::e_vec:
+        type = static_cast<Type_Vec*>(type)->element_type;
+        break;
+
+      default:
+        ANTON_UNREACHABLE("invalid getptr base type");
+      }
+    }
+    return type;
+  }
+
+  Instr_ALU* make_instr_alu(Allocator* const allocator, u32 const id,
                             Type* const type, ALU_Opcode const op,
                             Value* const src1, Value* const src2,
                             Source_Info const& source_info)
   {
     auto const instr = VUSH_ALLOCATE(Instr_ALU, allocator, id, type, op, src1,
-                                     src2, allocator, source_info);
-    src1->add_referrer(instr);
+                                     src2, source_info);
+    add_use(allocator, instr, src1, 0);
     if(src2 != nullptr) {
-      src2->add_referrer(instr);
+      add_use(allocator, instr, src2, 1);
     }
     return instr;
   }
 
   Instr_vector_extract*
-  make_instr_vector_extract(Allocator* allocator, i64 id, Type* type,
+  make_instr_vector_extract(Allocator* allocator, u32 id, Type* type,
                             Value* value, i64 index,
                             Source_Info const& source_info)
   {
     auto const instr = VUSH_ALLOCATE(Instr_vector_extract, allocator, id, type,
-                                     value, index, allocator, source_info);
-    value->add_referrer(instr);
+                                     value, index, source_info);
+    add_use(allocator, instr, value, 0);
     return instr;
   }
 
-  Instr_vector_insert* make_instr_vector_insert(Allocator* allocator, i64 id,
+  Instr_vector_insert* make_instr_vector_insert(Allocator* allocator, u32 id,
                                                 Type* type, Value* dst,
                                                 Value* value, i64 index,
                                                 Source_Info const& source_info)
   {
     auto const instr = VUSH_ALLOCATE(Instr_vector_insert, allocator, id, type,
-                                     dst, value, index, allocator, source_info);
-    dst->add_referrer(instr);
-    value->add_referrer(instr);
+                                     dst, value, index, source_info);
+    add_use(allocator, instr, dst, 0);
+    add_use(allocator, instr, value, 1);
     return instr;
   }
 
   Instr_composite_extract*
-  make_instr_composite_extract(Allocator* allocator, i64 id, Type* type,
+  make_instr_composite_extract(Allocator* allocator, u32 id, Type* type,
                                Value* value, i64 index,
                                Source_Info const& source_info)
   {
     auto const instr =
       VUSH_ALLOCATE(Instr_composite_extract, allocator, id, type, value, index,
                     allocator, source_info);
-    instr->indices.push_back(index);
-    value->add_referrer(instr);
+    add_use(allocator, instr, value, 0);
     return instr;
   }
 
   Instr_composite_extract*
-  make_instr_composite_extract(Allocator* allocator, i64 id, Type* type,
+  make_instr_composite_extract(Allocator* allocator, u32 id, Type* type,
                                Value* value, anton::Slice<i64 const> indices,
                                Source_Info const& source_info)
   {
     auto const instr =
       VUSH_ALLOCATE(Instr_composite_extract, allocator, id, type, value,
                     indices, allocator, source_info);
-    value->add_referrer(instr);
+    add_use(allocator, instr, value, 0);
     return instr;
   }
 
   Instr_composite_construct*
-  make_instr_composite_construct(Allocator* allocator, i64 id, Type* type,
+  make_instr_composite_construct(Allocator* allocator, u32 id, Type* type,
                                  Source_Info const& source_info)
   {
     auto const instr = VUSH_ALLOCATE(Instr_composite_construct, allocator, id,
@@ -477,7 +1135,7 @@ namespace vush::ir {
   }
 
   Instr_composite_construct*
-  make_instr_composite_construct(Allocator* allocator, i64 id, Type* type,
+  make_instr_composite_construct(Allocator* allocator, u32 id, Type* type,
                                  anton::Slice<Value* const> elements,
                                  Source_Info const& source_info)
   {
@@ -489,104 +1147,118 @@ namespace vush::ir {
     return instr;
   }
 
-  Instr_cvt_sext* make_instr_cvt_sext(Allocator* allocator, i64 id,
+  Instr_cvt_sext* make_instr_cvt_sext(Allocator* allocator, u32 id,
                                       Type* target_type, Value* value,
                                       Source_Info const& source_info)
   {
     auto const instr = VUSH_ALLOCATE(Instr_cvt_sext, allocator, id, target_type,
-                                     value, allocator, source_info);
-    value->add_referrer(instr);
+                                     value, source_info);
+    add_use(allocator, instr, value, 0);
     return instr;
   }
 
-  Instr_cvt_zext* make_instr_cvt_zext(Allocator* allocator, i64 id,
+  Instr_cvt_zext* make_instr_cvt_zext(Allocator* allocator, u32 id,
                                       Type* target_type, Value* value,
                                       Source_Info const& source_info)
   {
     auto const instr = VUSH_ALLOCATE(Instr_cvt_zext, allocator, id, target_type,
-                                     value, allocator, source_info);
-    value->add_referrer(instr);
+                                     value, source_info);
+    add_use(allocator, instr, value, 0);
     return instr;
   }
 
-  Instr_cvt_trunc* make_instr_cvt_trunc(Allocator* allocator, i64 id,
+  Instr_cvt_trunc* make_instr_cvt_trunc(Allocator* allocator, u32 id,
                                         Type* target_type, Value* value,
                                         Source_Info const& source_info)
   {
     auto const instr =
       VUSH_ALLOCATE(Instr_cvt_trunc, allocator, id, target_type, value,
-                    allocator, source_info);
-    value->add_referrer(instr);
+                    source_info);
+    add_use(allocator, instr, value, 0);
     return instr;
   }
 
-  Instr_cvt_fpext* make_instr_cvt_fpext(Allocator* allocator, i64 id,
+  Instr_cvt_fpext* make_instr_cvt_fpext(Allocator* allocator, u32 id,
                                         Type* target_type, Value* value,
                                         Source_Info const& source_info)
   {
     auto const instr =
       VUSH_ALLOCATE(Instr_cvt_fpext, allocator, id, target_type, value,
-                    allocator, source_info);
-    value->add_referrer(instr);
+                    source_info);
+    add_use(allocator, instr, value, 0);
     return instr;
   }
 
-  Instr_cvt_fptrunc* make_instr_cvt_fptrunc(Allocator* allocator, i64 id,
+  Instr_cvt_fptrunc* make_instr_cvt_fptrunc(Allocator* allocator, u32 id,
                                             Type* target_type, Value* value,
                                             Source_Info const& source_info)
   {
     auto const instr =
       VUSH_ALLOCATE(Instr_cvt_fptrunc, allocator, id, target_type, value,
-                    allocator, source_info);
-    value->add_referrer(instr);
+                    source_info);
+    add_use(allocator, instr, value, 0);
     return instr;
   }
 
-  Instr_cvt_si2fp* make_instr_cvt_si2fp(Allocator* allocator, i64 id,
+  Instr_cvt_si2fp* make_instr_cvt_si2fp(Allocator* allocator, u32 id,
                                         Type* target_type, Value* value,
                                         Source_Info const& source_info)
   {
     auto const instr =
       VUSH_ALLOCATE(Instr_cvt_si2fp, allocator, id, target_type, value,
-                    allocator, source_info);
-    value->add_referrer(instr);
+                    source_info);
+    add_use(allocator, instr, value, 0);
     return instr;
   }
 
-  Instr_cvt_ui2fp* make_instr_cvt_ui2fp(Allocator* allocator, i64 id,
+  Instr_cvt_ui2fp* make_instr_cvt_ui2fp(Allocator* allocator, u32 id,
                                         Type* target_type, Value* value,
                                         Source_Info const& source_info)
   {
     auto const instr =
       VUSH_ALLOCATE(Instr_cvt_ui2fp, allocator, id, target_type, value,
-                    allocator, source_info);
-    value->add_referrer(instr);
+                    source_info);
+    add_use(allocator, instr, value, 0);
     return instr;
   }
 
-  Instr_cvt_fp2si* make_instr_cvt_fp2si(Allocator* allocator, i64 id,
+  Instr_cvt_fp2si* make_instr_cvt_fp2si(Allocator* allocator, u32 id,
                                         Type* target_type, Value* value,
                                         Source_Info const& source_info)
   {
     auto const instr =
       VUSH_ALLOCATE(Instr_cvt_fp2si, allocator, id, target_type, value,
-                    allocator, source_info);
-    value->add_referrer(instr);
+                    source_info);
+    add_use(allocator, instr, value, 0);
     return instr;
   }
 
-  Instr_cvt_fp2ui* make_instr_cvt_fp2ui(Allocator* allocator, i64 id,
+  Instr_cvt_fp2ui* make_instr_cvt_fp2ui(Allocator* allocator, u32 id,
                                         Type* target_type, Value* value,
                                         Source_Info const& source_info)
   {
     auto const instr =
       VUSH_ALLOCATE(Instr_cvt_fp2ui, allocator, id, target_type, value,
-                    allocator, source_info);
-    value->add_referrer(instr);
+                    source_info);
+    add_use(allocator, instr, value, 0);
+    return instr;
+  }
+
+  Instr_select* make_instr_select(Allocator* allocator, u32 id, Type* type,
+                                  Value* condition, Value* then_value,
+                                  Value* else_value,
+                                  Source_Info const& source_info)
+  {
+    auto const instr =
+      VUSH_ALLOCATE(Instr_select, allocator, id, type, condition, then_value,
+                    else_value, source_info);
+    add_use(allocator, instr, condition, 0);
+    add_use(allocator, instr, then_value, 1);
+    add_use(allocator, instr, else_value, 2);
     return instr;
   }
 
-  Instr_call* make_instr_call(Allocator* allocator, i64 id, Function* function,
+  Instr_call* make_instr_call(Allocator* allocator, u32 id, Function* function,
                               Type* type, Source_Info const& source_info)
   {
     auto const instr = VUSH_ALLOCATE(Instr_call, allocator, id, function, type,
@@ -594,7 +1266,7 @@ namespace vush::ir {
     return instr;
   }
 
-  Instr_call* make_instr_call(Allocator* allocator, i64 id, Function* function,
+  Instr_call* make_instr_call(Allocator* allocator, u32 id, Function* function,
                               Type* type, anton::Slice<Value* const> args,
                               Source_Info const& source_info)
   {
@@ -606,7 +1278,7 @@ namespace vush::ir {
     return instr;
   }
 
-  Instr_ext_call* make_instr_ext_call(Allocator* allocator, i64 id,
+  Instr_ext_call* make_instr_ext_call(Allocator* allocator, u32 id,
                                       Ext_Kind ext, Type* type,
                                       Source_Info const& source_info)
   {
@@ -615,7 +1287,7 @@ namespace vush::ir {
     return instr;
   }
 
-  Instr_ext_call* make_instr_ext_call(Allocator* allocator, i64 id,
+  Instr_ext_call* make_instr_ext_call(Allocator* allocator, u32 id,
                                       Ext_Kind ext, Type* type,
                                       anton::Slice<Value* const> args,
                                       Source_Info const& source_info)
@@ -628,16 +1300,16 @@ namespace vush::ir {
     return instr;
   }
 
-  Instr_branch* make_instr_branch(Allocator* const allocator, i64 const id,
+  Instr_branch* make_instr_branch(Allocator* const allocator, u32 const id,
                                   Basic_Block* const target,
                                   Source_Info const& source_info)
   {
-    auto const instr = VUSH_ALLOCATE(ir::Instr_branch, allocator, id, target,
-                                     allocator, source_info);
+    auto const instr =
+      VUSH_ALLOCATE(ir::Instr_branch, allocator, id, target, source_info);
     return instr;
   }
 
-  Instr_brcond* make_instr_brcond(Allocator* const allocator, i64 const id,
+  Instr_brcond* make_instr_brcond(Allocator* const allocator, u32 const id,
                                   Value* const condition,
                                   Basic_Block* const then_target,
                                   Basic_Block* const else_target,
@@ -645,23 +1317,23 @@ namespace vush::ir {
   {
     auto const instr =
       VUSH_ALLOCATE(ir::Instr_brcond, allocator, id, condition, then_target,
-                    else_target, allocator, source_info);
-    condition->add_referrer(instr);
+                    else_target, source_info);
+    add_use(allocator, instr, condition, 0);
     return instr;
   }
 
-  ir::Instr_switch* make_instr_switch(Allocator* allocator, i64 id,
+  ir::Instr_switch* make_instr_switch(Allocator* allocator, u32 id,
                                       Value* selector,
                                       Basic_Block* default_label,
                                       Source_Info const& source_info)
   {
     auto const instr = VUSH_ALLOCATE(Instr_switch, allocator, id, selector,
                                      default_label, allocator, source_info);
-    selector->add_referrer(instr);
+    add_use(allocator, instr, selector, 0);
     return instr;
   }
 
-  ir::Instr_switch* make_instr_switch(Allocator* allocator, i64 id,
+  ir::Instr_switch* make_instr_switch(Allocator* allocator, u32 id,
                                       Value* selector,
                                       Basic_Block* default_label,
                                       anton::Slice<Switch_Label const> labels,
@@ -669,12 +1341,12 @@ namespace vush::ir {
   {
     auto const instr = VUSH_ALLOCATE(Instr_switch, allocator, id, selector,
                                      default_label, allocator, source_info);
-    selector->add_referrer(instr);
+    add_use(allocator, instr, selector, 0);
     instr->labels.assign(labels.begin(), labels.end());
     return instr;
   }
 
-  Instr_phi* make_instr_phi(Allocator* const allocator, i64 const id,
+  Instr_phi* make_instr_phi(Allocator* const allocator, u32 const id,
                             Type* const type, Source_Info const& source_info)
   {
     auto const instr =
@@ -682,42 +1354,68 @@ namespace vush::ir {
     return instr;
   }
 
-  Instr_phi* make_instr_phi(Allocator* const allocator, i64 const id,
+  Instr_phi* make_instr_phi(Allocator* const allocator, u32 const id,
                             Type* const type,
-                            anton::Slice<Value* const> const srcs,
+                            anton::Slice<Phi_Source const> const srcs,
                             Source_Info const& source_info)
   {
     auto const instr =
       VUSH_ALLOCATE(Instr_phi, allocator, id, type, allocator, source_info);
-    for(Value* src: srcs) {
-      instr->add_source(src);
+    for(Phi_Source const& src: srcs) {
+      instr->add_source(src.value, src.block);
     }
     return instr;
   }
 
-  ir::Instr_return* make_instr_return(Allocator* allocator, i64 id,
+  void Instr_phi::remove_source(i64 const index)
+  {
+    i64 const last = srcs.size() - 1;
+    Use* previous = nullptr;
+    Use* use = operands;
+    while(use != nullptr) {
+      Use* const next = use->next_operand;
+      if(use->operand == index) {
+        remove_use(use);
+        if(previous != nullptr) {
+          previous->next_operand = next;
+        } else {
+          operands = next;
+        }
+        deallocate(allocator, use);
+      } else {
+        if(use->operand == last) {
+          use->operand = index;
+        }
+        previous = use;
+      }
+      use = next;
+    }
+
+    srcs[index] = srcs[last];
+    srcs.pop_back();
+  }
+
+  ir::Instr_return* make_instr_return(Allocator* allocator, u32 id,
                                       Source_Info const& source_info)
   {
-    auto const instr =
-      VUSH_ALLOCATE(Instr_return, allocator, id, allocator, source_info);
+    auto const instr = VUSH_ALLOCATE(Instr_return, allocator, id, source_info);
     return instr;
   }
 
-  ir::Instr_return* make_instr_return(Allocator* allocator, i64 id,
+  ir::Instr_return* make_instr_return(Allocator* allocator, u32 id,
                                       ir::Value* value,
                                       Source_Info const& source_info)
   {
     auto const instr =
-      VUSH_ALLOCATE(Instr_return, allocator, id, value, allocator, source_info);
-    value->add_referrer(instr);
+      VUSH_ALLOCATE(Instr_return, allocator, id, value, source_info);
+    add_use(allocator, instr, value, 0);
     return instr;
   }
 
-  ir::Instr_die* make_instr_die(Allocator* allocator, i64 id,
+  ir::Instr_die* make_instr_die(Allocator* allocator, u32 id,
                                 Source_Info const& source_info)
   {
-    auto const instr =
-      VUSH_ALLOCATE(Instr_die, allocator, id, allocator, source_info);
+    auto const instr = VUSH_ALLOCATE(Instr_die, allocator, id, source_info);
     return instr;
   }
 } // namespace vush::ir
@@ -21,9 +21,9 @@
 namespace vush::ir {
   struct Basic_Block {
     anton::IList<Instr, Basic_Block> instructions;
-    i64 id;
+    u32 id;
 
-    Basic_Block(i64 id): id(id) {}
+    Basic_Block(u32 id): id(id) {}
 
     void insert(Instr* node);
 
@@ -49,10 +49,38 @@ namespace vush::ir {
 
     Function* entry;
 
-    Module(anton::String&& pass_identifier, Stage_Kind stage, Function* entry)
-      : pass_identifier(ANTON_MOV(pass_identifier)), stage(stage), entry(entry)
+  private:
+    // The ids of the arguments, instructions, blocks and functions are
+    // allocated from a single counter, hence they are dense and unique across
+    // all functions of the module.
+    u32 id_bound;
+
+  public:
+    Module(anton::String&& pass_identifier, Stage_Kind stage, Function* entry,
+           u32 id_bound)
+      : pass_identifier(ANTON_MOV(pass_identifier)), stage(stage), entry(entry),
+        id_bound(id_bound)
     {
     }
+
+    // next_id
+    // Allocate a new id. Every node created after the module has been lowered
+    // must be assigned an id allocated by this function.
+    //
+    [[nodiscard]] u32 next_id()
+    {
+      u32 const value = id_bound;
+      id_bound += 1;
+      return value;
+    }
+  };
+
+  enum struct Inline_Hint : u8 {
+    e_none,
+    // The function is always inlined into its callers.
+    e_inline,
+    // The function is never inlined into its callers.
+    e_noinline,
   };
 
   struct Function {
@@ -60,13 +88,14 @@ namespace vush::ir {
     Type* return_type;
     Basic_Block* entry_block;
     // IR identifier of the function.
-    i64 id;
+    u32 id;
+    Inline_Hint inline_hint = Inline_Hint::e_none;
 
     // Source code string identifier of the function.
     anton::String identifier;
     Source_Info source_info;
 
-    Function(i64 id, Type* return_type, Basic_Block* entry_block,
+    Function(u32 id, Type* return_type, Basic_Block* entry_block,
              anton::String&& identifier, Source_Info const& source_info)
       : return_type(return_type), entry_block(entry_block), id(id),
         identifier(ANTON_MOV(identifier)), source_info(source_info)
@@ -76,6 +105,9 @@ namespace vush::ir {
 
   struct Buffer {
     Type* type;
+    // IR identifier of the buffer. Buffers are numbered separately from the
+    // other values.
+    u32 id;
     u32 descriptor_set = -1;
     u32 binding = -1;
 
@@ -83,9 +115,10 @@ namespace vush::ir {
     anton::String identifier;
     Source_Info source_info;
 
-    Buffer(Type* type, anton::String&& identifier,
+    Buffer(u32 id, Type* type, anton::String&& identifier,
            Source_Info const& source_info)
-      : type(type), identifier(ANTON_MOV(identifier)), source_info(source_info)
+      : type(type), id(id), identifier(ANTON_MOV(identifier)),
+        source_info(source_info)
     {
     }
   };
@@ -96,38 +129,171 @@ namespace vush::ir {
     e_instr,
   };
 
+  // Use
+  // An occurrence of a value as an operand of an instruction. The uses of a
+  // value form an intrusive doubly linked list, hence adding, removing and
+  // retargeting a use does not allocate and takes constant time. A use is
+  // allocated when the operand is added to its user and deallocated when the
+  // operand is removed from the user or the operands of the user are dropped.
+  //
+  struct Use {
+    Value* value;
+    Instr* user;
+    // The index of the operand within the user.
+    i64 operand;
+    // The neighbours in the list of the uses of the value.
+    Use* prev = nullptr;
+    Use* next = nullptr;
+    // The next use in the list of the operands of the user.
+    Use* next_operand = nullptr;
+  };
+
+  struct Use_Iterator {
+    Use* use;
+
+    [[nodiscard]] Use* operator*() const
+    {
+      return use;
+    }
+
+    Use_Iterator& operator++()
+    {
+      use = use->next;
+      return *this;
+    }
+
+    [[nodiscard]] bool operator==(Use_Iterator const& other) const
+    {
+      return use == other.use;
+    }
+  };
+
+  struct Use_Range {
+    Use* first;
+
+    [[nodiscard]] Use_Iterator begin() const
+    {
+      return Use_Iterator{first};
+    }
+
+    [[nodiscard]] Use_Iterator end() const
+    {
+      return Use_Iterator{nullptr};
+    }
+  };
+
   struct Value {
-    anton::Array<Value*> referrers;
+    // The head of the list of the uses of the value.
+    Use* uses = nullptr;
     Type* type;
     Value_Kind value_kind;
 
-    Value(Value_Kind value_kind, Type* type, Allocator* allocator)
-      : referrers(allocator), type(type), value_kind(value_kind)
+    Value(Value_Kind value_kind, Type* type)
+      : type(type), value_kind(value_kind)
+    {
+    }
+
+    // get_uses
+    // The range of the uses of the value. The range must not be iterated while
+    // the uses are being removed or retargeted.
+    //
+    [[nodiscard]] Use_Range get_uses() const
     {
+      return Use_Range{uses};
     }
 
-    void add_referrer(Value* instruction)
+    [[nodiscard]] bool has_uses() const
     {
-      referrers.push_back(instruction);
+      return uses != nullptr;
     }
 
-    void remove_referrer(Value* instruction)
+    [[nodiscard]] bool has_single_use() const
     {
-      auto begin = referrers.begin();
-      auto const end = referrers.end();
-      for(; begin != end; ++begin) {
-        if(*begin == instruction) {
-          referrers.erase_unsorted(begin);
-        }
-      }
+      return uses != nullptr && uses->next == nullptr;
     }
   };
 
   template<typename T>
   [[nodiscard]] bool instanceof(Value const* value);
 
+  // add_use
+  // Record the value as the operand of the user. Does not modify the operand
+  // itself.
+  //
+  // Parameters:
+  // operand - the index of the operand within the user.
+  //
+  // Returns:
+  // The new use allocated with the allocator.
+  //
+  Use* add_use(Allocator* allocator, Instr* user, Value* value, i64 operand);
+
+  // remove_use
+  // Unlink the use from the list of the uses of its value. The use remains in
+  // the list of the operands of its user.
+  //
+  void remove_use(Use* use);
+
+  // set_use
+  // Replace the operand referred to by the use and move the use to the list of
+  // the uses of the replacement.
+  //
+  void set_use(Use* use, Value* replacement);
+
+  // drop_operands
+  // Remove the uses of the instruction from the lists of the uses of its
+  // operands and deallocate them. The operands themselves are left unchanged.
+  // Must be called before the instruction is removed from its block.
+  //
+  void drop_operands(Allocator* allocator, Instr* instruction);
+
+  // erase_instruction
+  // Drop the operands of the instruction, remove it from its block and
+  // deallocate it. The instruction must not have any uses and must have been
+  // allocated from allocator.
+  //
+  void erase_instruction(Allocator* allocator, Instr* instruction);
+
+  // replace_uses_with
+  // Replace all uses of the value with the replacement. The uses are moved to
+  // the replacement. Takes time linear in the number of the uses.
+  //
   void replace_uses_with(Value* value, Value* replacement);
 
+  // remove_phi_sources
+  // Remove the sources flowing in from the predecessor from the phis of the
+  // block.
+  //
+  void remove_phi_sources(Basic_Block* block, Basic_Block const* predecessor);
+
+  // get_successors
+  // Append the targets of the terminator to the array, one for each edge.
+  //
+  void get_successors(Instr const* terminator, Array<Basic_Block*>& successors);
+
+  // retarget_terminator
+  // Replace the block with the replacement in the targets of the terminator.
+  //
+  void retarget_terminator(Instr* terminator, Basic_Block const* block,
+                           Basic_Block* replacement);
+
+  // replace_terminator_with_branch
+  // Replace the terminator of the block with an unconditional branch to the
+  // target, which must be one of the targets of the terminator. The phis of
+  // the other targets lose their sources from the block and the selection
+  // header of the block, if any, is removed.
+  //
+  void replace_terminator_with_branch(Allocator* allocator, Basic_Block* block,
+                                      Basic_Block* target);
+
+  // clone_instruction
+  // Create a copy of the instruction with a new id. The copy refers to the
+  // same operands and blocks as the original and is not inserted into any
+  // block. The caller is expected to remap the operands with set_use.
+  //
+  [[nodiscard]] Instr* clone_instruction(Allocator* allocator,
+                                         Instr const* instruction, u32 id);
+
   enum struct Storage_Class {
     e_automatic,
     e_input,
@@ -148,16 +314,15 @@ namespace vush::ir {
   // pointee_type - when sourced, the pointed to type. Otherwise, nullptr.
   //
   struct Argument: public Value, anton::IList_Node<Argument>, Decorable {
-    i64 id = -1;
+    u32 id = -1;
     Function* function;
     Buffer* buffer = nullptr;
     i64 buffer_index = -1;
     Type* pointee_type = nullptr;
     Storage_Class storage_class = Storage_Class::e_automatic;
 
-    Argument(i64 id, Type* type, Function* function, Allocator* allocator)
-      : Value(Value_Kind::e_argument, type, allocator), id(id),
-        function(function)
+    Argument(u32 id, Type* type, Function* function)
+      : Value(Value_Kind::e_argument, type), id(id), function(function)
     {
     }
   };
@@ -176,9 +341,8 @@ namespace vush::ir {
   struct Constant: public Value {
     Constant_Kind constant_kind;
 
-    Constant(Constant_Kind constant_kind, Type* type, Allocator* allocator)
-      : Value(Value_Kind::e_const, type, allocator),
-        constant_kind(constant_kind)
+    Constant(Constant_Kind constant_kind, Type* type)
+      : Value(Value_Kind::e_const, type), constant_kind(constant_kind)
     {
     }
   };
@@ -186,9 +350,8 @@ namespace vush::ir {
   struct Constant_bool: public Constant {
     bool value;
 
-    Constant_bool(bool value, Allocator* allocator)
-      : Constant(Constant_Kind::e_constant_bool, get_type_bool(), allocator),
-        value(value)
+    Constant_bool(bool value)
+      : Constant(Constant_Kind::e_constant_bool, get_type_bool()), value(value)
     {
     }
   };
@@ -199,9 +362,8 @@ namespace vush::ir {
   struct Constant_i32: public Constant {
     i32 value;
 
-    Constant_i32(i32 value, Allocator* allocator)
-      : Constant(Constant_Kind::e_constant_i32, get_type_int32(), allocator),
-        value(value)
+    Constant_i32(i32 value)
+      : Constant(Constant_Kind::e_constant_i32, get_type_int32()), value(value)
     {
     }
   };
@@ -212,9 +374,8 @@ namespace vush::ir {
   struct Constant_u32: public Constant {
     u32 value;
 
-    Constant_u32(u32 value, Allocator* allocator)
-      : Constant(Constant_Kind::e_constant_u32, get_type_uint32(), allocator),
-        value(value)
+    Constant_u32(u32 value)
+      : Constant(Constant_Kind::e_constant_u32, get_type_uint32()), value(value)
     {
     }
   };
@@ -225,9 +386,8 @@ namespace vush::ir {
   struct Constant_f32: public Constant {
     f32 value;
 
-    Constant_f32(f32 value, Allocator* allocator)
-      : Constant(Constant_Kind::e_constant_f32, get_type_fp32(), allocator),
-        value(value)
+    Constant_f32(f32 value)
+      : Constant(Constant_Kind::e_constant_f32, get_type_fp32()), value(value)
     {
     }
   };
@@ -238,9 +398,8 @@ namespace vush::ir {
   struct Constant_f64: public Constant {
     f64 value;
 
-    Constant_f64(f64 value, Allocator* allocator)
-      : Constant(Constant_Kind::e_constant_f64, get_type_fp64(), allocator),
-        value(value)
+    Constant_f64(f64 value)
+      : Constant(Constant_Kind::e_constant_f64, get_type_fp64()), value(value)
     {
     }
   };
@@ -249,8 +408,8 @@ namespace vush::ir {
                                                 f64 value);
 
   struct Constant_undef: public Constant {
-    Constant_undef(Type* type, Allocator* allocator)
-      : Constant(Constant_Kind::e_undef, type, allocator)
+    Constant_undef(Type* type)
+      : Constant(Constant_Kind::e_undef, type)
     {
     }
   };
@@ -258,6 +417,15 @@ namespace vush::ir {
   [[nodiscard]] Constant_undef* make_constant_undef(Allocator* allocator,
                                                     Type* type);
 
+  // compare_constants_equal
+  // Compare the values of the constants. The floating point constants are
+  // compared bitwise, hence the signed zeros differ and NaNs with the same
+  // payload are equal. undef is not equal to any constant, including itself,
+  // as it may take a different value at each use.
+  //
+  [[nodiscard]] bool compare_constants_equal(Constant const& lhs,
+                                             Constant const& rhs);
+
   enum struct Instr_Kind : u8 {
     e_intrinsic,
     e_alloc,
@@ -278,6 +446,7 @@ namespace vush::ir {
     e_cvt_fp2si,
     e_cvt_ui2fp,
     e_cvt_fp2ui,
+    e_select,
     e_call,
     e_ext_call,
     e_branch,
@@ -290,14 +459,16 @@ namespace vush::ir {
 
   struct Instr: public anton::IList_Node<Basic_Block>, public Value {
     Basic_Block* block = nullptr;
-    i64 id = -1;
+    u32 id = -1;
     Instr_Kind instr_kind;
     Source_Info source_info;
+    // The head of the list of the uses of the operands of the instruction.
+    Use* operands = nullptr;
 
-    Instr(i64 id, Instr_Kind instr_kind, Type* type, Allocator* allocator,
+    Instr(u32 id, Instr_Kind instr_kind, Type* type,
           Source_Info const& source_info)
-      : Value(Value_Kind::e_instr, type, allocator), id(id),
-        instr_kind(instr_kind), source_info(source_info)
+      : Value(Value_Kind::e_instr, type), id(id), instr_kind(instr_kind),
+        source_info(source_info)
     {
     }
   };
@@ -307,15 +478,14 @@ namespace vush::ir {
   enum struct Intrinsic_Kind {
     // Structured Control Flow
     e_scf_branch_head,
-    // e_scf_loop_head,
+    e_scf_loop_head,
   };
 
   struct Instr_intrinsic: public Instr {
     Intrinsic_Kind intrinsic_kind;
 
-    Instr_intrinsic(Intrinsic_Kind kind, Allocator* allocator)
-      : Instr(0, Instr_Kind::e_intrinsic, get_type_void(), allocator,
-              Source_Info{}),
+    Instr_intrinsic(Intrinsic_Kind kind)
+      : Instr(0, Instr_Kind::e_intrinsic, get_type_void(), Source_Info{}),
         intrinsic_kind(kind)
     {
     }
@@ -328,8 +498,8 @@ namespace vush::ir {
   struct Intrinsic_scf_branch_head: public Instr_intrinsic {
     Basic_Block* converge_block;
 
-    Intrinsic_scf_branch_head(Basic_Block* converge_block, Allocator* allocator)
-      : Instr_intrinsic(Intrinsic_Kind::e_scf_branch_head, allocator),
+    Intrinsic_scf_branch_head(Basic_Block* converge_block)
+      : Instr_intrinsic(Intrinsic_Kind::e_scf_branch_head),
         converge_block(converge_block)
     {
     }
@@ -339,36 +509,74 @@ namespace vush::ir {
   make_intrinsic_scf_branch_head(Allocator* allocator,
                                  Basic_Block* converge_block);
 
+  enum struct Unroll_Hint : u8 {
+    e_none,
+    // The loop is unrolled regardless of its size.
+    e_unroll,
+    // The loop is never unrolled.
+    e_nounroll,
+  };
+
+  // Intrinsic_scf_loop_head
+  //
+  // Structured Control Flow loop head. Resides in the header of the loop.
+  //
+  // Members:
+  //   merge_block - the block the loop exits to.
+  // continue_block - the block containing the back edge to the header.
+  //    unroll_hint - the unroll attribute of the source loop.
+  //   unroll_count - the number of iterations to unroll requested by the
+  //                  attribute. 0 if not specified.
+  //
+  struct Intrinsic_scf_loop_head: public Instr_intrinsic {
+    Basic_Block* merge_block;
+    Basic_Block* continue_block;
+    Unroll_Hint unroll_hint;
+    i64 unroll_count;
+
+    Intrinsic_scf_loop_head(Basic_Block* merge_block,
+                            Basic_Block* continue_block,
+                            Unroll_Hint unroll_hint, i64 unroll_count)
+      : Instr_intrinsic(Intrinsic_Kind::e_scf_loop_head),
+        merge_block(merge_block), continue_block(continue_block),
+        unroll_hint(unroll_hint), unroll_count(unroll_count)
+    {
+    }
+  };
+
+  [[nodiscard]] Intrinsic_scf_loop_head*
+  make_intrinsic_scf_loop_head(Allocator* allocator, Basic_Block* merge_block,
+                               Basic_Block* continue_block,
+                               Unroll_Hint unroll_hint, i64 unroll_count);
+
   // Instr_alloc
   // Produces an address to the allocated stack memory.
   //
   struct Instr_alloc: public Instr {
     Type* alloc_type;
 
-    Instr_alloc(i64 id, Type* alloc_type, Allocator* allocator,
-                Source_Info const& source_info)
-      : Instr(id, Instr_Kind::e_alloc, get_type_ptr(), allocator, source_info),
+    Instr_alloc(u32 id, Type* alloc_type, Source_Info const& source_info)
+      : Instr(id, Instr_Kind::e_alloc, get_type_ptr(), source_info),
         alloc_type(alloc_type)
     {
     }
   };
 
-  [[nodiscard]] Instr_alloc* make_instr_alloc(Allocator* allocator, i64 id,
+  [[nodiscard]] Instr_alloc* make_instr_alloc(Allocator* allocator, u32 id,
                                               Type* alloc_type,
                                               Source_Info const& source_info);
 
   struct Instr_load: public Instr {
     Value* address;
 
-    Instr_load(i64 id, Type* type, Value* address, Allocator* allocator,
+    Instr_load(u32 id, Type* type, Value* address,
                Source_Info const& source_info)
-      : Instr(id, Instr_Kind::e_load, type, allocator, source_info),
-        address(address)
+      : Instr(id, Instr_Kind::e_load, type, source_info), address(address)
     {
     }
   };
 
-  [[nodiscard]] Instr_load* make_instr_load(Allocator* allocator, i64 id,
+  [[nodiscard]] Instr_load* make_instr_load(Allocator* allocator, u32 id,
                                             Type* type, Value* address,
                                             Source_Info const& source_info);
 
@@ -381,56 +589,66 @@ namespace vush::ir {
     // Value to be stored.
     Value* src;
 
-    Instr_store(i64 id, Value* dst, Value* src, Allocator* allocator,
-                Source_Info const& source_info)
-      : Instr(id, Instr_Kind::e_store, get_type_void(), allocator, source_info),
+    Instr_store(u32 id, Value* dst, Value* src, Source_Info const& source_info)
+      : Instr(id, Instr_Kind::e_store, get_type_void(), source_info),
         dst(dst), src(src)
     {
     }
   };
 
-  [[nodiscard]] Instr_store* make_instr_store(Allocator* allocator, i64 id,
+  [[nodiscard]] Instr_store* make_instr_store(Allocator* allocator, u32 id,
                                               Value* dst, Value* src,
                                               Source_Info const& source_info);
 
   // getptr
   // The instruction is used to calculate the address of a field of an aggregate
-  // data structure.
+  // data structure. Each index selects an element of the type selected by the
+  // preceding indices, the first one of addressed_type.
   //
   struct Instr_getptr: public Instr {
     Type* addressed_type;
     Value* address;
-    // TODO: Verify that the index is constant integer and fits in i64 when
-    // type is composite. AND is positive.
-    Value* index;
+    // TODO: Verify that the indices are constant integers and fit in i64 when
+    // they index a composite. AND are positive.
+    Array<Value*> indices;
 
-    Instr_getptr(i64 id, Type* addressed_type, Value* address, Value* index,
+    Instr_getptr(u32 id, Type* addressed_type, Value* address,
                  Allocator* allocator, Source_Info const& source_info)
-      : Instr(id, Instr_Kind::e_getptr, get_type_ptr(), allocator, source_info),
-        addressed_type(addressed_type), address(address), index(index)
+      : Instr(id, Instr_Kind::e_getptr, get_type_ptr(), source_info),
+        addressed_type(addressed_type), address(address), indices(allocator)
     {
     }
   };
 
-  [[nodiscard]] Instr_getptr* make_instr_getptr(Allocator* allocator, i64 id,
+  [[nodiscard]] Instr_getptr* make_instr_getptr(Allocator* allocator, u32 id,
                                                 Type* addressed_type,
                                                 Value* address, Value* index,
                                                 Source_Info const& source_info);
 
+  [[nodiscard]] Instr_getptr*
+  make_instr_getptr(Allocator* allocator, u32 id, Type* addressed_type,
+                    Value* address, anton::Slice<Value* const> indices,
+                    Source_Info const& source_info);
+
+  // get_indexed_type
+  // Get the type selected by the indices of a getptr.
+  //
+  [[nodiscard]] Type* get_indexed_type(Instr_getptr const* getptr);
+
   struct Instr_ALU: public Instr {
     Value* src1;
     Value* src2;
     ALU_Opcode op;
 
-    Instr_ALU(i64 id, Type* type, ALU_Opcode op, Value* src1, Value* src2,
-              Allocator* allocator, Source_Info const& source_info)
-      : Instr(id, Instr_Kind::e_alu, type, allocator, source_info), src1(src1),
-        src2(src2), op(op)
+    Instr_ALU(u32 id, Type* type, ALU_Opcode op, Value* src1, Value* src2,
+              Source_Info const& source_info)
+      : Instr(id, Instr_Kind::e_alu, type, source_info), src1(src1), src2(src2),
+        op(op)
     {
     }
   };
 
-  [[nodiscard]] Instr_ALU* make_instr_alu(Allocator* allocator, i64 id,
+  [[nodiscard]] Instr_ALU* make_instr_alu(Allocator* allocator, u32 id,
                                           Type* type, ALU_Opcode op,
                                           Value* src1, Value* src2,
                                           Source_Info const& source_info);
@@ -439,16 +657,16 @@ namespace vush::ir {
     Value* value;
     i64 index;
 
-    Instr_vector_extract(i64 id, Type* type, Value* value, i64 index,
-                         Allocator* allocator, Source_Info const& source_info)
-      : Instr(id, Instr_Kind::e_vector_extract, type, allocator, source_info),
+    Instr_vector_extract(u32 id, Type* type, Value* value, i64 index,
+                         Source_Info const& source_info)
+      : Instr(id, Instr_Kind::e_vector_extract, type, source_info),
         value(value), index(index)
     {
     }
   };
 
   [[nodiscard]] Instr_vector_extract*
-  make_instr_vector_extract(Allocator* allocator, i64 id, Type* type,
+  make_instr_vector_extract(Allocator* allocator, u32 id, Type* type,
                             Value* value, i64 index,
                             Source_Info const& source_info);
 
@@ -457,16 +675,16 @@ namespace vush::ir {
     Value* value;
     i64 index;
 
-    Instr_vector_insert(i64 id, Type* type, Value* dst, Value* value, i64 index,
-                        Allocator* allocator, Source_Info const& source_info)
-      : Instr(id, Instr_Kind::e_vector_insert, type, allocator, source_info),
+    Instr_vector_insert(u32 id, Type* type, Value* dst, Value* value, i64 index,
+                        Source_Info const& source_info)
+      : Instr(id, Instr_Kind::e_vector_insert, type, source_info),
         dst(dst), value(value), index(index)
     {
     }
   };
 
   [[nodiscard]] Instr_vector_insert*
-  make_instr_vector_insert(Allocator* allocator, i64 id, Type* type, Value* dst,
+  make_instr_vector_insert(Allocator* allocator, u32 id, Type* type, Value* dst,
                            Value* value, i64 index,
                            Source_Info const& source_info);
 
@@ -474,268 +692,289 @@ namespace vush::ir {
     Value* value;
     Array<i64> indices;
 
-    Instr_composite_extract(i64 id, Type* type, Value* value, i64 index,
+    Instr_composite_extract(u32 id, Type* type, Value* value, i64 index,
                             Allocator* allocator,
                             Source_Info const& source_info)
-      : Instr(id, Instr_Kind::e_composite_extract, type, allocator,
-              source_info),
-        value(value)
+      : Instr(id, Instr_Kind::e_composite_extract, type, source_info),
+        value(value), indices(allocator)
     {
       indices.push_back(index);
     }
 
-    Instr_composite_extract(i64 id, Type* type, Value* value,
+    Instr_composite_extract(u32 id, Type* type, Value* value,
                             anton::Slice<i64 const> indices,
                             Allocator* allocator,
                             Source_Info const& source_info)
-      : Instr(id, Instr_Kind::e_composite_extract, type, allocator,
-              source_info),
-        value(value)
+      : Instr(id, Instr_Kind::e_composite_extract, type, source_info),
+        value(value), indices(allocator)
     {
       this->indices.assign(indices.begin(), indices.end());
     }
   };
 
   [[nodiscard]] Instr_composite_extract*
-  make_instr_composite_extract(Allocator* allocator, i64 id, Type* type,
+  make_instr_composite_extract(Allocator* allocator, u32 id, Type* type,
                                Value* value, i64 index,
                                Source_Info const& source_info);
 
   [[nodiscard]] Instr_composite_extract*
-  make_instr_composite_extract(Allocator* allocator, i64 id, Type* type,
+  make_instr_composite_extract(Allocator* allocator, u32 id, Type* type,
                                Value* value, anton::Slice<i64 const> indices,
                                Source_Info const& source_info);
 
   struct Instr_composite_construct: public Instr {
+    Allocator* allocator;
     Array<Value*> elements;
 
-    Instr_composite_construct(i64 id, Type* type, Allocator* allocator,
+    Instr_composite_construct(u32 id, Type* type, Allocator* allocator,
                               Source_Info const& source_info)
-      : Instr(id, Instr_Kind::e_composite_construct, type, allocator,
-              source_info),
-        elements(allocator)
+      : Instr(id, Instr_Kind::e_composite_construct, type, source_info),
+        allocator(allocator), elements(allocator)
     {
     }
 
-    void add_element(Value* value)
+    void add_element(Value* const value)
     {
+      add_use(allocator, this, value, elements.size());
       elements.push_back(value);
-      value->add_referrer(this);
     }
   };
 
   [[nodiscard]] Instr_composite_construct*
-  make_instr_composite_construct(Allocator* allocator, i64 id, Type* type,
+  make_instr_composite_construct(Allocator* allocator, u32 id, Type* type,
                                  Source_Info const& source_info);
 
   [[nodiscard]] Instr_composite_construct*
-  make_instr_composite_construct(Allocator* allocator, i64 id, Type* type,
+  make_instr_composite_construct(Allocator* allocator, u32 id, Type* type,
                                  anton::Slice<Value* const> elements,
                                  Source_Info const& source_info);
 
   struct Instr_cvt_sext: public Instr {
     Value* value;
 
-    Instr_cvt_sext(i64 id, Type* target_type, Value* value,
-                   Allocator* allocator, Source_Info const& source_info)
-      : Instr(id, Instr_Kind::e_cvt_sext, target_type, allocator, source_info),
+    Instr_cvt_sext(u32 id, Type* target_type, Value* value,
+                   Source_Info const& source_info)
+      : Instr(id, Instr_Kind::e_cvt_sext, target_type, source_info),
         value(value)
     {
     }
   };
 
   [[nodiscard]] Instr_cvt_sext*
-  make_instr_cvt_sext(Allocator* allocator, i64 id, Type* target_type,
+  make_instr_cvt_sext(Allocator* allocator, u32 id, Type* target_type,
                       Value* value, Source_Info const& source_info);
 
   struct Instr_cvt_zext: public Instr {
     Value* value;
 
-    Instr_cvt_zext(i64 id, Type* target_type, Value* value,
-                   Allocator* allocator, Source_Info const& source_info)
-      : Instr(id, Instr_Kind::e_cvt_zext, target_type, allocator, source_info),
+    Instr_cvt_zext(u32 id, Type* target_type, Value* value,
+                   Source_Info const& source_info)
+      : Instr(id, Instr_Kind::e_cvt_zext, target_type, source_info),
         value(value)
     {
     }
   };
 
   [[nodiscard]] Instr_cvt_zext*
-  make_instr_cvt_zext(Allocator* allocator, i64 id, Type* target_type,
+  make_instr_cvt_zext(Allocator* allocator, u32 id, Type* target_type,
                       Value* value, Source_Info const& source_info);
 
   struct Instr_cvt_trunc: public Instr {
     Value* value;
 
-    Instr_cvt_trunc(i64 id, Type* target_type, Value* value,
-                    Allocator* allocator, Source_Info const& source_info)
-      : Instr(id, Instr_Kind::e_cvt_trunc, target_type, allocator, source_info),
+    Instr_cvt_trunc(u32 id, Type* target_type, Value* value,
+                    Source_Info const& source_info)
+      : Instr(id, Instr_Kind::e_cvt_trunc, target_type, source_info),
         value(value)
     {
     }
   };
 
   [[nodiscard]] Instr_cvt_trunc*
-  make_instr_cvt_trunc(Allocator* allocator, i64 id, Type* target_type,
+  make_instr_cvt_trunc(Allocator* allocator, u32 id, Type* target_type,
                        Value* value, Source_Info const& source_info);
 
   struct Instr_cvt_fpext: public Instr {
     Value* value;
 
-    Instr_cvt_fpext(i64 id, Type* target_type, Value* value,
-                    Allocator* allocator, Source_Info const& source_info)
-      : Instr(id, Instr_Kind::e_cvt_fpext, target_type, allocator, source_info),
+    Instr_cvt_fpext(u32 id, Type* target_type, Value* value,
+                    Source_Info const& source_info)
+      : Instr(id, Instr_Kind::e_cvt_fpext, target_type, source_info),
         value(value)
     {
     }
   };
 
   [[nodiscard]] Instr_cvt_fpext*
-  make_instr_cvt_fpext(Allocator* allocator, i64 id, Type* target_type,
+  make_instr_cvt_fpext(Allocator* allocator, u32 id, Type* target_type,
                        Value* value, Source_Info const& source_info);
 
   struct Instr_cvt_fptrunc: public Instr {
     Value* value;
 
-    Instr_cvt_fptrunc(i64 id, Type* target_type, Value* value,
-                      Allocator* allocator, Source_Info const& source_info)
-      : Instr(id, Instr_Kind::e_cvt_fptrunc, target_type, allocator,
-              source_info),
+    Instr_cvt_fptrunc(u32 id, Type* target_type, Value* value,
+                      Source_Info const& source_info)
+      : Instr(id, Instr_Kind::e_cvt_fptrunc, target_type, source_info),
         value(value)
     {
     }
   };
 
   [[nodiscard]] Instr_cvt_fptrunc*
-  make_instr_cvt_fptrunc(Allocator* allocator, i64 id, Type* target_type,
+  make_instr_cvt_fptrunc(Allocator* allocator, u32 id, Type* target_type,
                          Value* value, Source_Info const& source_info);
 
   struct Instr_cvt_si2fp: public Instr {
     Value* value;
 
-    Instr_cvt_si2fp(i64 id, Type* target_type, Value* value,
-                    Allocator* allocator, Source_Info const& source_info)
-      : Instr(id, Instr_Kind::e_cvt_si2fp, target_type, allocator, source_info),
+    Instr_cvt_si2fp(u32 id, Type* target_type, Value* value,
+                    Source_Info const& source_info)
+      : Instr(id, Instr_Kind::e_cvt_si2fp, target_type, source_info),
         value(value)
     {
     }
   };
 
   [[nodiscard]] Instr_cvt_si2fp*
-  make_instr_cvt_si2fp(Allocator* allocator, i64 id, Type* target_type,
+  make_instr_cvt_si2fp(Allocator* allocator, u32 id, Type* target_type,
                        Value* value, Source_Info const& source_info);
 
   struct Instr_cvt_ui2fp: public Instr {
     Value* value;
 
-    Instr_cvt_ui2fp(i64 id, Type* target_type, Value* value,
-                    Allocator* allocator, Source_Info const& source_info)
-      : Instr(id, Instr_Kind::e_cvt_ui2fp, target_type, allocator, source_info),
+    Instr_cvt_ui2fp(u32 id, Type* target_type, Value* value,
+                    Source_Info const& source_info)
+      : Instr(id, Instr_Kind::e_cvt_ui2fp, target_type, source_info),
         value(value)
     {
     }
   };
 
   [[nodiscard]] Instr_cvt_ui2fp*
-  make_instr_cvt_ui2fp(Allocator* allocator, i64 id, Type* target_type,
+  make_instr_cvt_ui2fp(Allocator* allocator, u32 id, Type* target_type,
                        Value* value, Source_Info const& source_info);
 
   struct Instr_cvt_fp2si: public Instr {
     Value* value;
 
-    Instr_cvt_fp2si(i64 id, Type* target_type, Value* value,
-                    Allocator* allocator, Source_Info const& source_info)
-      : Instr(id, Instr_Kind::e_cvt_fp2si, target_type, allocator, source_info),
+    Instr_cvt_fp2si(u32 id, Type* target_type, Value* value,
+                    Source_Info const& source_info)
+      : Instr(id, Instr_Kind::e_cvt_fp2si, target_type, source_info),
         value(value)
     {
     }
   };
 
   [[nodiscard]] Instr_cvt_fp2si*
-  make_instr_cvt_fp2si(Allocator* allocator, i64 id, Type* target_type,
+  make_instr_cvt_fp2si(Allocator* allocator, u32 id, Type* target_type,
                        Value* value, Source_Info const& source_info);
 
   struct Instr_cvt_fp2ui: public Instr {
     Value* value;
 
-    Instr_cvt_fp2ui(i64 id, Type* target_type, Value* value,
-                    Allocator* allocator, Source_Info const& source_info)
-      : Instr(id, Instr_Kind::e_cvt_fp2ui, target_type, allocator, source_info),
+    Instr_cvt_fp2ui(u32 id, Type* target_type, Value* value,
+                    Source_Info const& source_info)
+      : Instr(id, Instr_Kind::e_cvt_fp2ui, target_type, source_info),
         value(value)
     {
     }
   };
 
   [[nodiscard]] Instr_cvt_fp2ui*
-  make_instr_cvt_fp2ui(Allocator* allocator, i64 id, Type* target_type,
+  make_instr_cvt_fp2ui(Allocator* allocator, u32 id, Type* target_type,
                        Value* value, Source_Info const& source_info);
 
+  // Instr_select
+  // Choose between two values of the same type according to a boolean
+  // condition without branching. The condition is either a scalar bool or a
+  // vector of bools with as many components as the values.
+  //
+  struct Instr_select: public Instr {
+    Value* condition;
+    Value* then_value;
+    Value* else_value;
+
+    Instr_select(u32 id, Type* type, Value* condition, Value* then_value,
+                 Value* else_value, Source_Info const& source_info)
+      : Instr(id, Instr_Kind::e_select, type, source_info),
+        condition(condition), then_value(then_value), else_value(else_value)
+    {
+    }
+  };
+
+  [[nodiscard]] Instr_select* make_instr_select(Allocator* allocator, u32 id,
+                                                Type* type, Value* condition,
+                                                Value* then_value,
+                                                Value* else_value,
+                                                Source_Info const& source_info);
+
   struct Instr_call: public Instr {
+    Allocator* allocator;
     Array<Value*> args;
     Function* function;
 
-    Instr_call(i64 id, Function* function, Type* type, Allocator* allocator,
+    Instr_call(u32 id, Function* function, Type* type, Allocator* allocator,
                Source_Info const& source_info)
-      : Instr(id, Instr_Kind::e_call, type, allocator, source_info),
-        args(allocator), function(function)
+      : Instr(id, Instr_Kind::e_call, type, source_info),
+        allocator(allocator), args(allocator), function(function)
     {
     }
 
     void add_argument(Value* const value)
     {
+      add_use(allocator, this, value, args.size());
       args.push_back(value);
-      value->add_referrer(this);
     }
   };
 
-  [[nodiscard]] Instr_call* make_instr_call(Allocator* allocator, i64 id,
+  [[nodiscard]] Instr_call* make_instr_call(Allocator* allocator, u32 id,
                                             Function* function, Type* type,
                                             Source_Info const& source_info);
 
-  [[nodiscard]] Instr_call* make_instr_call(Allocator* allocator, i64 id,
+  [[nodiscard]] Instr_call* make_instr_call(Allocator* allocator, u32 id,
                                             Function* function, Type* type,
                                             anton::Slice<Value* const> args,
                                             Source_Info const& source_info);
 
   struct Instr_ext_call: public Instr {
+    Allocator* allocator;
     Array<Value*> args;
     Ext_Kind ext;
 
-    Instr_ext_call(i64 id, Ext_Kind ext, Type* type, Allocator* allocator,
+    Instr_ext_call(u32 id, Ext_Kind ext, Type* type, Allocator* allocator,
                    Source_Info const& source_info)
-      : Instr(id, Instr_Kind::e_ext_call, type, allocator, source_info),
-        args(allocator), ext(ext)
+      : Instr(id, Instr_Kind::e_ext_call, type, source_info),
+        allocator(allocator), args(allocator), ext(ext)
     {
     }
 
     void add_argument(Value* const value)
     {
+      add_use(allocator, this, value, args.size());
       args.push_back(value);
-      value->add_referrer(this);
     }
   };
 
   [[nodiscard]] Instr_ext_call*
-  make_instr_ext_call(Allocator* allocator, i64 id, Ext_Kind ext, Type* type,
+  make_instr_ext_call(Allocator* allocator, u32 id, Ext_Kind ext, Type* type,
                       Source_Info const& source_info);
 
   [[nodiscard]] Instr_ext_call*
-  make_instr_ext_call(Allocator* allocator, i64 id, Ext_Kind ext, Type* type,
+  make_instr_ext_call(Allocator* allocator, u32 id, Ext_Kind ext, Type* type,
                       anton::Slice<Value* const> args,
                       Source_Info const& source_info);
 
   struct Instr_branch: public Instr {
     Basic_Block* target;
 
-    Instr_branch(i64 id, Basic_Block* target, Allocator* allocator,
-                 Source_Info const& source_info)
-      : Instr(id, Instr_Kind::e_branch, get_type_void(), allocator,
-              source_info),
+    Instr_branch(u32 id, Basic_Block* target, Source_Info const& source_info)
+      : Instr(id, Instr_Kind::e_branch, get_type_void(), source_info),
         target(target)
     {
     }
   };
 
-  [[nodiscard]] Instr_branch* make_instr_branch(Allocator* allocator, i64 id,
+  [[nodiscard]] Instr_branch* make_instr_branch(Allocator* allocator, u32 id,
                                                 Basic_Block* target,
                                                 Source_Info const& source_info);
 
@@ -744,17 +983,15 @@ namespace vush::ir {
     Basic_Block* then_target;
     Basic_Block* else_target;
 
-    Instr_brcond(i64 id, Value* condition, Basic_Block* then_target,
-                 Basic_Block* else_target, Allocator* allocator,
-                 Source_Info const& source_info)
-      : Instr(id, Instr_Kind::e_brcond, get_type_void(), allocator,
-              source_info),
+    Instr_brcond(u32 id, Value* condition, Basic_Block* then_target,
+                 Basic_Block* else_target, Source_Info const& source_info)
+      : Instr(id, Instr_Kind::e_brcond, get_type_void(), source_info),
         condition(condition), then_target(then_target), else_target(else_target)
     {
     }
   };
 
-  [[nodiscard]] Instr_brcond* make_instr_brcond(Allocator* allocator, i64 id,
+  [[nodiscard]] Instr_brcond* make_instr_brcond(Allocator* allocator, u32 id,
                                                 Value* condition,
                                                 Basic_Block* then_target,
                                                 Basic_Block* else_target,
@@ -770,10 +1007,9 @@ namespace vush::ir {
     Basic_Block* default_label;
     Array<Switch_Label> labels;
 
-    Instr_switch(i64 id, Value* selector, Basic_Block* default_label,
+    Instr_switch(u32 id, Value* selector, Basic_Block* default_label,
                  Allocator* allocator, Source_Info const& source_info)
-      : Instr(id, Instr_Kind::e_switch, get_type_void(), allocator,
-              source_info),
+      : Instr(id, Instr_Kind::e_switch, get_type_void(), source_info),
         selector(selector), default_label(default_label), labels(allocator)
     {
     }
@@ -784,60 +1020,75 @@ namespace vush::ir {
     }
   };
 
-  [[nodiscard]] Instr_switch* make_instr_switch(Allocator* allocator, i64 id,
+  [[nodiscard]] Instr_switch* make_instr_switch(Allocator* allocator, u32 id,
                                                 Value* selector,
                                                 Basic_Block* default_label,
                                                 Source_Info const& source_info);
 
   [[nodiscard]] Instr_switch* make_instr_switch(
-    Allocator* allocator, i64 id, Value* selector, Basic_Block* default_label,
+    Allocator* allocator, u32 id, Value* selector, Basic_Block* default_label,
     anton::Slice<Switch_Label const> labels, Source_Info const& source_info);
 
+  struct Phi_Source {
+    Value* value;
+    // The predecessor block the value flows in from.
+    Basic_Block* block;
+  };
+
+  // Instr_phi
+  // Selects the source corresponding to the predecessor block the control has
+  // arrived from. Phis must be placed at the start of a block.
+  //
   struct Instr_phi: public Instr {
-    Array<Value*> srcs;
+    Allocator* allocator;
+    Array<Phi_Source> srcs;
 
-    Instr_phi(i64 id, Type* type, Allocator* allocator,
+    Instr_phi(u32 id, Type* type, Allocator* allocator,
               Source_Info const& source_info)
-      : Instr(id, Instr_Kind::e_phi, type, allocator, source_info),
-        srcs(allocator)
+      : Instr(id, Instr_Kind::e_phi, type, source_info),
+        allocator(allocator), srcs(allocator)
     {
     }
 
-    void add_source(Value* const value)
+    void add_source(Value* const value, Basic_Block* const block)
     {
-      srcs.push_back(value);
-      value->add_referrer(this);
+      add_use(allocator, this, value, srcs.size());
+      srcs.push_back(Phi_Source{value, block});
     }
+
+    // remove_source
+    // Remove the source at the index and deallocate its use. The last source
+    // takes its place.
+    //
+    void remove_source(i64 index);
   };
 
-  [[nodiscard]] Instr_phi* make_instr_phi(Allocator* allocator, i64 id,
+  [[nodiscard]] Instr_phi* make_instr_phi(Allocator* allocator, u32 id,
                                           Type* type,
                                           Source_Info const& source_info);
 
-  [[nodiscard]] Instr_phi* make_instr_phi(Allocator* allocator, i64 id,
+  [[nodiscard]] Instr_phi* make_instr_phi(Allocator* allocator, u32 id,
                                           Type* type,
-                                          anton::Slice<Value* const> srcs,
+                                          anton::Slice<Phi_Source const> srcs,
                                           Source_Info const& source_info);
 
   struct Instr_return: public Instr {
     Value* value = nullptr;
 
-    Instr_return(i64 id, Allocator* allocator, Source_Info const& source_info)
-      : Instr(id, Instr_Kind::e_return, get_type_void(), allocator, source_info)
+    Instr_return(u32 id, Source_Info const& source_info)
+      : Instr(id, Instr_Kind::e_return, get_type_void(), source_info)
     {
     }
 
-    Instr_return(i64 id, Value* value, Allocator* allocator,
-                 Source_Info const& source_info)
-      : Instr(id, Instr_Kind::e_return, value->type, allocator, source_info),
-        value(value)
+    Instr_return(u32 id, Value* value, Source_Info const& source_info)
+      : Instr(id, Instr_Kind::e_return, value->type, source_info), value(value)
     {
     }
   };
 
-  [[nodiscard]] Instr_return* make_instr_return(Allocator* allocator, i64 id,
+  [[nodiscard]] Instr_return* make_instr_return(Allocator* allocator, u32 id,
                                                 Source_Info const& source_info);
-  [[nodiscard]] Instr_return* make_instr_return(Allocator* allocator, i64 id,
+  [[nodiscard]] Instr_return* make_instr_return(Allocator* allocator, u32 id,
                                                 Value* value,
                                                 Source_Info const& source_info);
 
@@ -845,12 +1096,12 @@ namespace vush::ir {
   // Terminate (die) current invocation.
   //
   struct Instr_die: public Instr {
-    Instr_die(i64 id, Allocator* allocator, Source_Info const& source_info)
-      : Instr(id, Instr_Kind::e_die, get_type_void(), allocator, source_info)
+    Instr_die(u32 id, Source_Info const& source_info)
+      : Instr(id, Instr_Kind::e_die, get_type_void(), source_info)
     {
     }
   };
 
-  [[nodiscard]] Instr_die* make_instr_die(Allocator* allocator, i64 id,
+  [[nodiscard]] Instr_die* make_instr_die(Allocator* allocator, u32 id,
                                           Source_Info const& source_info);
 } // namespace vush::ir
@@ -7,12 +7,15 @@ namespace vush::ir {
     e_or, // Bitwise or
     e_xor, // Bitwise xor
     e_shl,
-    e_shr,
+    e_shr, // Logical shift right
+    e_ashr, // Arithmetic shift right
     e_neg, // Algebraic negation
     e_iadd,
     e_imul,
+    e_imulhi, // The high 32 bits of the signed 64 bit product
     e_uadd,
     e_umul,
+    e_umulhi, // The high 32 bits of the unsigned 64 bit product
     e_idiv,
     e_udiv,
     e_irem,
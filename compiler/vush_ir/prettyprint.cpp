@@ -279,16 +279,22 @@ namespace vush::ir {
       return "shl"_sv;
     case ALU_Opcode::e_shr:
       return "shr"_sv;
+    case ALU_Opcode::e_ashr:
+      return "ashr"_sv;
     case ALU_Opcode::e_neg:
       return "neg"_sv;
     case ALU_Opcode::e_iadd:
       return "iadd"_sv;
     case ALU_Opcode::e_imul:
       return "imul"_sv;
+    case ALU_Opcode::e_imulhi:
+      return "imulhi"_sv;
     case ALU_Opcode::e_uadd:
       return "uadd"_sv;
     case ALU_Opcode::e_umul:
       return "umul"_sv;
+    case ALU_Opcode::e_umulhi:
+      return "umulhi"_sv;
     case ALU_Opcode::e_idiv:
       return "idiv"_sv;
     case ALU_Opcode::e_udiv:
@@ -517,6 +523,31 @@ namespace vush::ir {
       printer.write("@vush.scf_branch_head "_sv);
       print_block_id(allocator, printer, intrinsic->converge_block);
     } break;
+
+    case Intrinsic_Kind::e_scf_loop_head: {
+      auto const intrinsic = static_cast<Intrinsic_scf_loop_head const*>(instr);
+      printer.write("@vush.scf_loop_head "_sv);
+      print_block_id(allocator, printer, intrinsic->merge_block);
+      printer.write(" "_sv);
+      print_block_id(allocator, printer, intrinsic->continue_block);
+      switch(intrinsic->unroll_hint) {
+      case Unroll_Hint::e_none:
+        break;
+
+      case Unroll_Hint::e_unroll:
+        if(intrinsic->unroll_count > 0) {
+          printer.write(anton::format(allocator, " unroll({})"_sv,
+                                      intrinsic->unroll_count));
+        } else {
+          printer.write(" unroll"_sv);
+        }
+        break;
+
+      case Unroll_Hint::e_nounroll:
+        printer.write(" nounroll"_sv);
+        break;
+      }
+    } break;
     }
   }
 
@@ -561,8 +592,10 @@ namespace vush::ir {
       print_value(allocator, printer, options, instr);
       printer.write(" = getptr "_sv);
       print_value(allocator, printer, options, instr->address);
-      printer.write(", "_sv);
-      print_value(allocator, printer, options, instr->index);
+      for(Value const* const index: instr->indices) {
+        printer.write(", "_sv);
+        print_value(allocator, printer, options, index);
+      }
     } break;
 
     case Instr_Kind::e_alu: {
@@ -597,14 +630,17 @@ namespace vush::ir {
     case Instr_Kind::e_phi: {
       auto const instr = static_cast<Instr_phi const*>(generic_instr);
       print_value(allocator, printer, options, instr);
-      printer.write("= phi "_sv);
-      for(bool first = true; Value const* const src: instr->srcs) {
-        if(first) {
-          printer.write(" "_sv);
-        } else {
+      printer.write(" = phi "_sv);
+      for(bool first = true; Phi_Source const& src: instr->srcs) {
+        if(!first) {
           printer.write(", "_sv);
         }
-        print_value(allocator, printer, options, src);
+        first = false;
+        printer.write("["_sv);
+        print_value(allocator, printer, options, src.value);
+        printer.write(", "_sv);
+        print_block_id(allocator, printer, src.block);
+        printer.write("]"_sv);
       }
     } break;
 
@@ -754,6 +790,19 @@ namespace vush::ir {
       print_value(allocator, printer, options, instr->value);
     } break;
 
+    case Instr_Kind::e_select: {
+      auto const instr = static_cast<Instr_select const*>(generic_instr);
+      print_value(allocator, printer, options, instr);
+      printer.write(" = select "_sv);
+      print_type_inline(allocator, printer, options, instr->type);
+      printer.write(", "_sv);
+      print_value(allocator, printer, options, instr->condition);
+      printer.write(", "_sv);
+      print_value(allocator, printer, options, instr->then_value);
+      printer.write(", "_sv);
+      print_value(allocator, printer, options, instr->else_value);
+    } break;
+
     case Instr_Kind::e_call: {
       auto const instr = static_cast<Instr_call const*>(generic_instr);
       print_value(allocator, printer, options, instr);
@@ -1,4 +1,6 @@
+#include <anton/assert.hpp>
 #include <anton/ranges.hpp>
+#include <vush_core/memory.hpp>
 #include <vush_ir/types.hpp>
 
 namespace vush::ir {
@@ -134,6 +136,268 @@ namespace vush::ir {
     return &static_type_sampler;
   }
 
+  // Indexed by the element type and then by the number of rows less 2.
+  static Type_Vec static_type_vec[10][3] = {
+    {{&static_type_bool, 2}, {&static_type_bool, 3}, {&static_type_bool, 4}},
+    {{&static_type_int8, 2}, {&static_type_int8, 3}, {&static_type_int8, 4}},
+    {{&static_type_int16, 2}, {&static_type_int16, 3}, {&static_type_int16, 4}},
+    {{&static_type_int32, 2}, {&static_type_int32, 3}, {&static_type_int32, 4}},
+    {{&static_type_uint8, 2}, {&static_type_uint8, 3}, {&static_type_uint8, 4}},
+    {{&static_type_uint16, 2},
+     {&static_type_uint16, 3},
+     {&static_type_uint16, 4}},
+    {{&static_type_uint32, 2},
+     {&static_type_uint32, 3},
+     {&static_type_uint32, 4}},
+    {{&static_type_fp16, 2}, {&static_type_fp16, 3}, {&static_type_fp16, 4}},
+    {{&static_type_fp32, 2}, {&static_type_fp32, 3}, {&static_type_fp32, 4}},
+    {{&static_type_fp64, 2}, {&static_type_fp64, 3}, {&static_type_fp64, 4}},
+  };
+
+  Type_Vec* get_type_vec(Type* const element_type, i32 const rows)
+  {
+    ANTON_ASSERT(rows >= 2 && rows <= 4, "invalid number of vector rows");
+    i64 index = 0;
+    switch(element_type->kind) {
+    case Type_Kind::e_bool:
+      index = 0;
+      break;
+    case Type_Kind::e_int8:
+      index = 1;
+      break;
+    case Type_Kind::e_int16:
+      index = 2;
+      break;
+    case Type_Kind::e_int32:
+      index = 3;
+      break;
+    case Type_Kind::e_uint8:
+      index = 4;
+      break;
+    case Type_Kind::e_uint16:
+      index = 5;
+      break;
+    case Type_Kind::e_uint32:
+      index = 6;
+      break;
+    case Type_Kind::e_fp16:
+      index = 7;
+      break;
+    case Type_Kind::e_fp32:
+      index = 8;
+      break;
+    case Type_Kind::e_fp64:
+      index = 9;
+      break;
+    default:
+      ANTON_UNREACHABLE("invalid vector element type");
+    }
+    return &static_type_vec[index][rows - 2];
+  }
+
+  [[nodiscard]] static u64 combine_hash(u64 const hash, u64 const value)
+  {
+    return hash ^ (value + 0x9E3779B97F4A7C15 + (hash << 6) + (hash >> 2));
+  }
+
+  [[nodiscard]] static u64 get_type_hash(Type const& type)
+  {
+    if(type.interned) {
+      return type.hash;
+    }
+
+    u64 hash = combine_hash(0, static_cast<u64>(type.kind));
+    switch(type.kind) {
+    case Type_Kind::e_vec: {
+      auto const& t = static_cast<Type_Vec const&>(type);
+      hash = combine_hash(hash, get_type_hash(*t.element_type));
+      hash = combine_hash(hash, static_cast<u64>(t.rows));
+    } break;
+
+    case Type_Kind::e_mat: {
+      auto const& t = static_cast<Type_Mat const&>(type);
+      hash = combine_hash(hash, get_type_hash(*t.column_type));
+      hash = combine_hash(hash, static_cast<u64>(t.columns));
+    } break;
+
+    case Type_Kind::e_image: {
+      auto const& t = static_cast<Type_Image const&>(type);
+      hash = combine_hash(hash, get_type_hash(*t.sampled_type));
+      hash = combine_hash(hash, static_cast<u64>(t.format));
+      hash = combine_hash(hash, static_cast<u64>(t.dimensions));
+      hash = combine_hash(hash, t.multisampled | t.array << 1 | t.shadow << 2 |
+                                  t.sampled << 3);
+    } break;
+
+    case Type_Kind::e_sampled_image: {
+      auto const& t = static_cast<Type_Sampled_Image const&>(type);
+      hash = combine_hash(hash, get_type_hash(*t.sampled_type));
+      hash = combine_hash(hash, static_cast<u64>(t.dimensions));
+      hash =
+        combine_hash(hash, t.multisampled | t.array << 1 | t.shadow << 2);
+    } break;
+
+    case Type_Kind::e_composite: {
+      auto const& t = static_cast<Type_Composite const&>(type);
+      hash = combine_hash(hash, anton::hash(t.identifier));
+      for(Type const* const element: t.elements) {
+        hash = combine_hash(hash, get_type_hash(*element));
+      }
+    } break;
+
+    case Type_Kind::e_array: {
+      auto const& t = static_cast<Type_Array const&>(type);
+      hash = combine_hash(hash, get_type_hash(*t.element_type));
+      hash = combine_hash(hash, static_cast<u64>(t.size));
+    } break;
+
+    default:
+      break;
+    }
+    return hash;
+  }
+
+  // are_types_identical
+  // Compare the types structurally. The constituents of the types must be
+  // canonical and are compared by their addresses.
+  //
+  [[nodiscard]] static bool are_types_identical(Type const& lhs,
+                                                Type const& rhs)
+  {
+    if(lhs.kind != rhs.kind) {
+      return false;
+    }
+
+    switch(lhs.kind) {
+    case Type_Kind::e_vec: {
+      auto const& l = static_cast<Type_Vec const&>(lhs);
+      auto const& r = static_cast<Type_Vec const&>(rhs);
+      return l.element_type == r.element_type && l.rows == r.rows;
+    }
+
+    case Type_Kind::e_mat: {
+      auto const& l = static_cast<Type_Mat const&>(lhs);
+      auto const& r = static_cast<Type_Mat const&>(rhs);
+      return l.column_type == r.column_type && l.columns == r.columns;
+    }
+
+    case Type_Kind::e_image: {
+      auto const& l = static_cast<Type_Image const&>(lhs);
+      auto const& r = static_cast<Type_Image const&>(rhs);
+      return l.sampled_type == r.sampled_type && l.format == r.format &&
+             l.dimensions == r.dimensions &&
+             l.multisampled == r.multisampled && l.array == r.array &&
+             l.shadow == r.shadow && l.sampled == r.sampled;
+    }
+
+    case Type_Kind::e_sampled_image: {
+      auto const& l = static_cast<Type_Sampled_Image const&>(lhs);
+      auto const& r = static_cast<Type_Sampled_Image const&>(rhs);
+      return l.sampled_type == r.sampled_type &&
+             l.dimensions == r.dimensions &&
+             l.multisampled == r.multisampled && l.array == r.array &&
+             l.shadow == r.shadow;
+    }
+
+    case Type_Kind::e_composite: {
+      auto const& l = static_cast<Type_Composite const&>(lhs);
+      auto const& r = static_cast<Type_Composite const&>(rhs);
+      if(l.identifier != r.identifier ||
+         l.elements.size() != r.elements.size()) {
+        return false;
+      }
+
+      for(i64 i = 0; i < l.elements.size(); i += 1) {
+        if(l.elements[i] != r.elements[i]) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    case Type_Kind::e_array: {
+      auto const& l = static_cast<Type_Array const&>(lhs);
+      auto const& r = static_cast<Type_Array const&>(rhs);
+      return l.element_type == r.element_type && l.size == r.size;
+    }
+
+    default:
+      // The remaining types are unique.
+      return &lhs == &rhs;
+    }
+  }
+
+  Type_Interner::Type_Interner(Allocator* allocator)
+    : allocator(allocator), entries(allocator)
+  {
+  }
+
+  Type* Type_Interner::intern(Type* const type)
+  {
+    if(type->interned) {
+      return type;
+    }
+
+    switch(type->kind) {
+    case Type_Kind::e_vec: {
+      auto const t = static_cast<Type_Vec*>(type);
+      return get_type_vec(t->element_type, t->rows);
+    }
+
+    case Type_Kind::e_mat: {
+      auto const t = static_cast<Type_Mat*>(type);
+      t->column_type = get_type_vec(t->column_type->element_type,
+                                    t->column_type->rows);
+    } break;
+
+    case Type_Kind::e_image: {
+      auto const t = static_cast<Type_Image*>(type);
+      t->sampled_type = intern(t->sampled_type);
+    } break;
+
+    case Type_Kind::e_sampled_image: {
+      auto const t = static_cast<Type_Sampled_Image*>(type);
+      t->sampled_type = intern(t->sampled_type);
+    } break;
+
+    case Type_Kind::e_composite: {
+      auto const t = static_cast<Type_Composite*>(type);
+      for(Type*& element: t->elements) {
+        element = intern(element);
+      }
+    } break;
+
+    case Type_Kind::e_array: {
+      auto const t = static_cast<Type_Array*>(type);
+      t->element_type = intern(t->element_type);
+    } break;
+
+    default:
+      // The scalar types are unique.
+      return type;
+    }
+
+    u64 const hash = get_type_hash(*type);
+    auto iterator = entries.find(hash);
+    if(iterator != entries.end()) {
+      for(Entry* entry = iterator->value; entry != nullptr;
+          entry = entry->next) {
+        if(are_types_identical(*entry->type, *type)) {
+          return entry->type;
+        }
+      }
+    }
+
+    type->hash = hash;
+    type->interned = true;
+    if(iterator != entries.end()) {
+      iterator->value = VUSH_ALLOCATE(Entry, allocator, type, iterator->value);
+    } else {
+      entries.emplace(hash, VUSH_ALLOCATE(Entry, allocator, type, nullptr));
+    }
+    return type;
+  }
+
   template<>
   bool instanceof<Type_Image>(Type const& type)
   {
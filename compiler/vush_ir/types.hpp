@@ -1,5 +1,6 @@
 #pragma once
 
+#include <anton/flat_hash_map.hpp>
 #include <anton/string.hpp>
 
 #include <vush_core/types.hpp>
@@ -30,6 +31,10 @@ namespace vush::ir {
 
   struct Type: public Decorable {
     Type_Kind kind;
+    // The structural hash of the type. Valid only when the type is interned.
+    u64 hash = 0;
+    // Whether the type is the canonical instance of its structure.
+    bool interned = false;
 
     Type(Type_Kind kind): kind(kind) {}
   };
@@ -88,6 +93,16 @@ namespace vush::ir {
     }
   };
 
+  // get_type_vec
+  // The vector types of the scalar types are unique like the scalar types
+  // themselves and do not need to be interned.
+  //
+  // Parameters:
+  // element_type - a scalar type other than void, ptr or sampler.
+  // rows - the number of elements, 2, 3 or 4.
+  //
+  [[nodiscard]] Type_Vec* get_type_vec(Type* element_type, i32 rows);
+
   struct Type_Mat: public Type {
     Type_Vec* column_type;
     i32 columns;
@@ -182,4 +197,34 @@ namespace vush::ir {
     {
     }
   };
+
+  // Type_Interner
+  // Maintains the canonical instances of the types of a module. Each
+  // structurally unique type is interned once, hence the interned types may
+  // be compared by their addresses. Types whose hashes collide are chained
+  // and told apart by a structural comparison.
+  //
+  struct Type_Interner {
+  private:
+    struct Entry {
+      Type* type;
+      Entry* next;
+    };
+
+    Allocator* allocator;
+    anton::Flat_Hash_Map<u64, Entry*> entries;
+
+  public:
+    Type_Interner(Allocator* allocator);
+
+    // intern
+    // Intern the type and its constituent types. The constituents of the type
+    // are replaced with their canonical instances. The type becomes canonical
+    // unless a structurally equal type has already been interned.
+    //
+    // Returns:
+    // The canonical instance of the type.
+    //
+    [[nodiscard]] Type* intern(Type* type);
+  };
 } // namespace vush::ir
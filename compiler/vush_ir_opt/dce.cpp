@@ -0,0 +1,148 @@
+#include <vush_ir_opt/opts.hpp>
+
+#include <anton/flat_hash_set.hpp>
+
+#include <vush_core/memory.hpp>
+
+namespace vush {
+  namespace {
+    struct DCE_Context {
+      anton::Flat_Hash_Set<ir::Instr const*> live;
+      Array<ir::Instr*> worklist;
+
+      DCE_Context(Allocator* allocator): live(allocator), worklist(allocator)
+      {
+      }
+    };
+  } // namespace
+
+  // is_root
+  //
+  // Returns:
+  // Whether the instruction has effects other than computing its result.
+  //
+  [[nodiscard]] static bool is_root(ir::Instr const* const instr)
+  {
+    switch(instr->instr_kind) {
+    case ir::Instr_Kind::e_store: {
+      // The stores to the allocations are live only if the allocations are.
+      auto const store = static_cast<ir::Instr_store const*>(instr);
+      ir::Value const* base = store->dst;
+      while(ir::instanceof<ir::Instr_getptr>(base)) {
+        base = static_cast<ir::Instr_getptr const*>(base)->address;
+      }
+      return !ir::instanceof<ir::Instr_alloc>(base);
+    }
+
+    case ir::Instr_Kind::e_intrinsic:
+    case ir::Instr_Kind::e_call:
+    case ir::Instr_Kind::e_branch:
+    case ir::Instr_Kind::e_brcond:
+    case ir::Instr_Kind::e_switch:
+    case ir::Instr_Kind::e_return:
+    case ir::Instr_Kind::e_die:
+      return true;
+
+    default:
+      return false;
+    }
+  }
+
+  // is_used_outside
+  //
+  // Returns:
+  // Whether the instruction is used in a block that is not reachable, hence
+  // not being swept.
+  //
+  [[nodiscard]] static bool is_used_outside(ir::CFG const& cfg,
+                                            ir::Instr const* const instr)
+  {
+    for(ir::Use const* const use: instr->get_uses()) {
+      if(cfg.get_index(use->user->block) == -1) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static void mark_live(DCE_Context& ctx, ir::Instr* const instr)
+  {
+    if(ctx.live.find(instr) != ctx.live.end()) {
+      return;
+    }
+
+    ctx.live.emplace(instr);
+    ctx.worklist.push_back(instr);
+  }
+
+  // mark_address_writes
+  // Mark the stores through the address and the addresses derived from it.
+  //
+  static void mark_address_writes(DCE_Context& ctx, ir::Instr* const address)
+  {
+    for(ir::Use const* const use: address->get_uses()) {
+      ir::Instr* const user = use->user;
+      bool const is_store_dst =
+        user->instr_kind == ir::Instr_Kind::e_store && use->operand == 0;
+      bool const is_getptr_address =
+        user->instr_kind == ir::Instr_Kind::e_getptr && use->operand == 0;
+      if(is_store_dst || is_getptr_address) {
+        mark_live(ctx, user);
+      }
+    }
+  }
+
+  ir::Pass_Result run_opt_ir_dce(Allocator* const allocator,
+                                 ir::Function_Analyses& analyses)
+  {
+    ir::CFG const& cfg = analyses.get_cfg();
+    DCE_Context ctx(allocator);
+    for(ir::Basic_Block* const block: cfg.blocks) {
+      for(ir::Instr& instruction: block->instructions) {
+        if(is_root(&instruction) || is_used_outside(cfg, &instruction)) {
+          mark_live(ctx, &instruction);
+        }
+      }
+    }
+
+    // The worklist grows while being processed.
+    for(i64 i = 0; i < ctx.worklist.size(); i += 1) {
+      ir::Instr* const instr = ctx.worklist[i];
+      for(ir::Use const* use = instr->operands; use != nullptr;
+          use = use->next_operand) {
+        if(ir::instanceof<ir::Instr>(use->value)) {
+          mark_live(ctx, static_cast<ir::Instr*>(use->value));
+        }
+      }
+
+      // A live allocation is read, hence the writes to it are live as well.
+      if(instr->instr_kind == ir::Instr_Kind::e_alloc ||
+         instr->instr_kind == ir::Instr_Kind::e_getptr) {
+        mark_address_writes(ctx, instr);
+      }
+    }
+
+    // The dead instructions may use each other, therefore all operands are
+    // dropped before any of them is erased.
+    Array<ir::Instr*> dead_instructions(allocator);
+    for(ir::Basic_Block* const block: cfg.blocks) {
+      for(ir::Instr& instruction: block->instructions) {
+        if(ctx.live.find(&instruction) == ctx.live.end()) {
+          ir::drop_operands(allocator, &instruction);
+          dead_instructions.push_back(&instruction);
+        }
+      }
+    }
+
+    for(ir::Instr* const instruction: dead_instructions) {
+      ir::erase_instruction(allocator, instruction);
+    }
+
+    // The terminators are always live.
+    return ir::Pass_Result{.changes = dead_instructions.size(),
+                           .preserved = {.cfg = true,
+                                         .dominator_tree = true,
+                                         .post_dominator_tree = true,
+                                         .loop_info = true}};
+  }
+} // namespace vush
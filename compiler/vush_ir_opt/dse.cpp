@@ -0,0 +1,161 @@
+#include <vush_ir_opt/opts.hpp>
+
+#include <vush_core/memory.hpp>
+#include <vush_ir/types.hpp>
+
+namespace vush {
+  namespace {
+    // Overwrite
+    // A store that is executed later in the block and is not preceded by
+    // a read of its allocation.
+    //
+    struct Overwrite {
+      ir::Value const* address;
+      ir::Type const* type;
+      ir::Value const* base;
+    };
+
+    // Block_State
+    // The state of the backward scan of a block.
+    //
+    // Members:
+    // function_exit - whether the function is left at the end of the block
+    //                 without reaching a call, after which the allocations
+    //                 are no longer accessible.
+    //    read_bases - the allocations read later in the block.
+    //
+    struct Block_State {
+      bool function_exit = false;
+      Array<ir::Value const*> read_bases;
+      Array<Overwrite> overwrites;
+
+      Block_State(Allocator* allocator)
+        : read_bases(allocator), overwrites(allocator)
+      {
+      }
+    };
+  } // namespace
+
+  [[nodiscard]] static ir::Value const* get_base(ir::Value const* address)
+  {
+    while(ir::instanceof<ir::Instr_getptr>(address)) {
+      address = static_cast<ir::Instr_getptr const*>(address)->address;
+    }
+    return address;
+  }
+
+  [[nodiscard]] static bool contains(Array<ir::Value const*> const& array,
+                                     ir::Value const* const value)
+  {
+    for(ir::Value const* const element: array) {
+      if(element == value) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  [[nodiscard]] static bool is_overwritten(Block_State const& state,
+                                           ir::Instr_store const* const store)
+  {
+    for(Overwrite const& overwrite: state.overwrites) {
+      if(overwrite.address == store->dst &&
+         ir::compare_types_equal(*overwrite.type, *store->src->type)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // visit_load
+  // Any store to the allocation might be read by the load.
+  //
+  static void visit_load(Block_State& state, ir::Value const* const base)
+  {
+    for(i64 i = 0; i < state.overwrites.size();) {
+      if(state.overwrites[i].base == base) {
+        state.overwrites.erase_unsorted(i);
+      } else {
+        i += 1;
+      }
+    }
+
+    if(!contains(state.read_bases, base)) {
+      state.read_bases.push_back(base);
+    }
+  }
+
+  static void eliminate_block_stores(Block_State& state,
+                                     ir::Basic_Block* const block,
+                                     Array<ir::Instr*>& dead_stores)
+  {
+    state.read_bases.clear();
+    state.overwrites.clear();
+    ir::Instr* const last = block->get_last();
+    state.function_exit = last->instr_kind == ir::Instr_Kind::e_return ||
+                          last->instr_kind == ir::Instr_Kind::e_die;
+    auto iterator = block->instructions.end();
+    while(iterator != block->instructions.begin()) {
+      --iterator;
+      auto const instr = static_cast<ir::Instr*>(iterator.node);
+      switch(instr->instr_kind) {
+      case ir::Instr_Kind::e_store: {
+        auto const store = static_cast<ir::Instr_store*>(instr);
+        ir::Value const* const base = get_base(store->dst);
+        if(!ir::instanceof<ir::Instr_alloc>(base)) {
+          break;
+        }
+
+        bool const dead = (state.function_exit &&
+                           !contains(state.read_bases, base)) ||
+                          is_overwritten(state, store);
+        if(dead) {
+          dead_stores.push_back(store);
+        } else {
+          state.overwrites.push_back(
+            Overwrite{.address = store->dst,
+                      .type = store->src->type,
+                      .base = base});
+        }
+      } break;
+
+      case ir::Instr_Kind::e_load: {
+        auto const load = static_cast<ir::Instr_load*>(instr);
+        visit_load(state, get_base(load->address));
+      } break;
+
+      case ir::Instr_Kind::e_call:
+        // The allocations passed to the callee might be read by it.
+        state.function_exit = false;
+        state.overwrites.clear();
+        break;
+
+      default:
+        break;
+      }
+    }
+  }
+
+  ir::Pass_Result run_opt_ir_dse(Allocator* const allocator,
+                                 ir::Function_Analyses& analyses)
+  {
+    ir::CFG const& cfg = analyses.get_cfg();
+    Block_State state(allocator);
+    Array<ir::Instr*> dead_stores(allocator);
+    for(ir::Basic_Block* const block: cfg.blocks) {
+      if(!block->empty()) {
+        eliminate_block_stores(state, block, dead_stores);
+      }
+    }
+
+    for(ir::Instr* const store: dead_stores) {
+      ir::erase_instruction(allocator, store);
+    }
+
+    return ir::Pass_Result{.changes = dead_stores.size(),
+                           .preserved = {.cfg = true,
+                                         .dominator_tree = true,
+                                         .post_dominator_tree = true,
+                                         .loop_info = true}};
+  }
+} // namespace vush
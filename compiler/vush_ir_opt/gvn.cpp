@@ -0,0 +1,548 @@
+#include <vush_ir_opt/opts.hpp>
+
+#include <bit>
+
+#include <anton/flat_hash_map.hpp>
+
+#include <vush_core/memory.hpp>
+#include <vush_core/running_hash.hpp>
+#include <vush_ir/ext.hpp>
+#include <vush_ir/opcodes.hpp>
+#include <vush_ir/types.hpp>
+
+// The value numbering is scoped by the dominator tree as in
+//   Briggs, Cooper, Simpson, "Value Numbering".
+// The memory is versioned by generations as in LLVM's EarlyCSE.
+
+namespace vush {
+  namespace {
+    // Expression_Entry
+    //
+    // Members:
+    //       next - the index of the previous entry with the same hash or -1.
+    // generation - the memory generation at the time a load was recorded.
+    //
+    struct Expression_Entry {
+      ir::Instr* instr;
+      u64 hash;
+      i64 next;
+      i64 generation;
+    };
+
+    // Clobber
+    // A write to memory.
+    //
+    // Members:
+    // base - the base of the written address. nullptr if any memory may have
+    //        been written.
+    //
+    struct Clobber {
+      i64 generation;
+      ir::Value const* base;
+    };
+
+    struct GVN_Context {
+      Allocator* allocator;
+      ir::CFG const& cfg;
+      ir::Dominator_Tree const& dominator_tree;
+      // The most recent entry for each hash. -1 once all entries with the hash
+      // have gone out of scope.
+      anton::Flat_Hash_Map<u64, i64> heads;
+      Array<Expression_Entry> entries;
+      Array<Clobber> clobbers;
+      Array<ir::Instr*> dead_instructions;
+      // The generation is never rolled back when the walk leaves a subtree,
+      // hence writes in the previously visited siblings invalidate the loads
+      // conservatively.
+      i64 generation = 0;
+
+      GVN_Context(Allocator* allocator, ir::CFG const& cfg,
+                  ir::Dominator_Tree const& dominator_tree)
+        : allocator(allocator), cfg(cfg), dominator_tree(dominator_tree),
+          heads(allocator), entries(allocator), clobbers(allocator),
+          dead_instructions(allocator)
+      {
+      }
+    };
+  } // namespace
+
+  // hash_operand
+  // Constants are hashed by their values as equal constants are distinct
+  // objects.
+  //
+  [[nodiscard]] static u64 hash_operand(ir::Value const* const value)
+  {
+    Running_Hash hash;
+    hash.start();
+    if(!ir::instanceof<ir::Constant>(value) ||
+       ir::instanceof<ir::Constant_undef>(value)) {
+      hash.feed(reinterpret_cast<u64>(value));
+      return hash.finish();
+    }
+
+    auto const constant = static_cast<ir::Constant const*>(value);
+    hash.feed(static_cast<u8>(constant->constant_kind));
+    switch(constant->constant_kind) {
+    case ir::Constant_Kind::e_constant_bool:
+      hash.feed(static_cast<u8>(
+        static_cast<ir::Constant_bool const*>(constant)->value));
+      break;
+    case ir::Constant_Kind::e_constant_i32:
+      hash.feed(static_cast<u32>(
+        static_cast<ir::Constant_i32 const*>(constant)->value));
+      break;
+    case ir::Constant_Kind::e_constant_u32:
+      hash.feed(static_cast<ir::Constant_u32 const*>(constant)->value);
+      break;
+    case ir::Constant_Kind::e_constant_f32:
+      hash.feed(std::bit_cast<u32>(
+        static_cast<ir::Constant_f32 const*>(constant)->value));
+      break;
+    case ir::Constant_Kind::e_constant_f64:
+      hash.feed(std::bit_cast<u64>(
+        static_cast<ir::Constant_f64 const*>(constant)->value));
+      break;
+    case ir::Constant_Kind::e_undef:
+      break;
+    }
+    return hash.finish();
+  }
+
+  [[nodiscard]] static bool compare_operands_equal(ir::Value const* const v1,
+                                                   ir::Value const* const v2)
+  {
+    if(v1 == v2) {
+      return true;
+    }
+
+    return ir::instanceof<ir::Constant>(v1) &&
+           ir::instanceof<ir::Constant>(v2) &&
+           ir::compare_constants_equal(*static_cast<ir::Constant const*>(v1),
+                                       *static_cast<ir::Constant const*>(v2));
+  }
+
+  [[nodiscard]] static bool is_commutative(ir::ALU_Opcode const op)
+  {
+    switch(op) {
+    case ir::ALU_Opcode::e_and:
+    case ir::ALU_Opcode::e_or:
+    case ir::ALU_Opcode::e_xor:
+    case ir::ALU_Opcode::e_iadd:
+    case ir::ALU_Opcode::e_imul:
+    case ir::ALU_Opcode::e_imulhi:
+    case ir::ALU_Opcode::e_uadd:
+    case ir::ALU_Opcode::e_umul:
+    case ir::ALU_Opcode::e_umulhi:
+    case ir::ALU_Opcode::e_fadd:
+    case ir::ALU_Opcode::e_fmul:
+    case ir::ALU_Opcode::e_icmp_eq:
+    case ir::ALU_Opcode::e_icmp_neq:
+    case ir::ALU_Opcode::e_fcmp_eq:
+    case ir::ALU_Opcode::e_fcmp_neq:
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  // is_numberable
+  //
+  // Returns:
+  // Whether the instruction computes a value that depends only on its
+  // operands or, for loads, on its operands and the memory.
+  //
+  [[nodiscard]] static bool is_numberable(ir::Instr const* const instr)
+  {
+    switch(instr->instr_kind) {
+    case ir::Instr_Kind::e_load:
+    case ir::Instr_Kind::e_getptr:
+    case ir::Instr_Kind::e_alu:
+    case ir::Instr_Kind::e_vector_extract:
+    case ir::Instr_Kind::e_vector_insert:
+    case ir::Instr_Kind::e_composite_extract:
+    case ir::Instr_Kind::e_composite_construct:
+    case ir::Instr_Kind::e_cvt_sext:
+    case ir::Instr_Kind::e_cvt_zext:
+    case ir::Instr_Kind::e_cvt_trunc:
+    case ir::Instr_Kind::e_cvt_fpext:
+    case ir::Instr_Kind::e_cvt_fptrunc:
+    case ir::Instr_Kind::e_cvt_si2fp:
+    case ir::Instr_Kind::e_cvt_fp2si:
+    case ir::Instr_Kind::e_cvt_ui2fp:
+    case ir::Instr_Kind::e_cvt_fp2ui:
+    case ir::Instr_Kind::e_select:
+      return true;
+
+    case ir::Instr_Kind::e_ext_call:
+      // Only the math extensions. The texture extensions depend on the
+      // implicit derivatives.
+      return static_cast<ir::Instr_ext_call const*>(instr)->ext <=
+             ir::Ext_Kind::e_mat_inv;
+
+    default:
+      return false;
+    }
+  }
+
+  // get_operands
+  // Collect the operands of the instruction ordered by their indices.
+  //
+  static void get_operands(Array<ir::Value*>& operands,
+                           ir::Instr const* const instr)
+  {
+    operands.clear();
+    for(ir::Use const* use = instr->operands; use != nullptr;
+        use = use->next_operand) {
+      while(operands.size() <= use->operand) {
+        operands.push_back(nullptr);
+      }
+      operands[use->operand] = use->value;
+    }
+  }
+
+  [[nodiscard]] static u64 hash_instruction(ir::Instr const* const instr,
+                                            Array<ir::Value*>& operands)
+  {
+    Running_Hash hash;
+    hash.start();
+    hash.feed(static_cast<u8>(instr->instr_kind));
+    hash.feed(static_cast<u8>(instr->type->kind));
+    switch(instr->instr_kind) {
+    case ir::Instr_Kind::e_alu:
+      hash.feed(static_cast<u8>(static_cast<ir::Instr_ALU const*>(instr)->op));
+      break;
+    case ir::Instr_Kind::e_vector_extract:
+      hash.feed(static_cast<u32>(
+        static_cast<ir::Instr_vector_extract const*>(instr)->index));
+      break;
+    case ir::Instr_Kind::e_vector_insert:
+      hash.feed(static_cast<u32>(
+        static_cast<ir::Instr_vector_insert const*>(instr)->index));
+      break;
+    case ir::Instr_Kind::e_composite_extract:
+      for(i64 const index:
+          static_cast<ir::Instr_composite_extract const*>(instr)->indices) {
+        hash.feed(static_cast<u64>(index));
+      }
+      break;
+    case ir::Instr_Kind::e_ext_call:
+      hash.feed(
+        static_cast<u8>(static_cast<ir::Instr_ext_call const*>(instr)->ext));
+      break;
+    default:
+      break;
+    }
+
+    get_operands(operands, instr);
+    if(instr->instr_kind == ir::Instr_Kind::e_alu &&
+       is_commutative(static_cast<ir::Instr_ALU const*>(instr)->op)) {
+      // The operand hashes are combined independently of their order.
+      u64 const h1 = hash_operand(operands[0]);
+      u64 const h2 = hash_operand(operands[1]);
+      hash.feed(h1 < h2 ? h1 : h2);
+      hash.feed(h1 < h2 ? h2 : h1);
+    } else {
+      for(ir::Value const* const operand: operands) {
+        if(operand != nullptr) {
+          hash.feed(hash_operand(operand));
+        }
+      }
+    }
+    return hash.finish();
+  }
+
+  [[nodiscard]] static bool
+  compare_instructions_equal(ir::Instr const* const i1,
+                             ir::Instr const* const i2)
+  {
+    if(i1->instr_kind != i2->instr_kind ||
+       !ir::compare_types_equal(*i1->type, *i2->type)) {
+      return false;
+    }
+
+    switch(i1->instr_kind) {
+    case ir::Instr_Kind::e_load: {
+      auto const l1 = static_cast<ir::Instr_load const*>(i1);
+      auto const l2 = static_cast<ir::Instr_load const*>(i2);
+      return l1->address == l2->address;
+    }
+
+    case ir::Instr_Kind::e_getptr: {
+      auto const g1 = static_cast<ir::Instr_getptr const*>(i1);
+      auto const g2 = static_cast<ir::Instr_getptr const*>(i2);
+      if(!ir::compare_types_equal(*g1->addressed_type, *g2->addressed_type) ||
+         g1->address != g2->address ||
+         g1->indices.size() != g2->indices.size()) {
+        return false;
+      }
+
+      for(i64 i = 0; i < g1->indices.size(); i += 1) {
+        if(!compare_operands_equal(g1->indices[i], g2->indices[i])) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    case ir::Instr_Kind::e_alu: {
+      auto const a1 = static_cast<ir::Instr_ALU const*>(i1);
+      auto const a2 = static_cast<ir::Instr_ALU const*>(i2);
+      if(a1->op != a2->op) {
+        return false;
+      }
+
+      if(compare_operands_equal(a1->src1, a2->src1) &&
+         compare_operands_equal(a1->src2, a2->src2)) {
+        return true;
+      }
+
+      return is_commutative(a1->op) &&
+             compare_operands_equal(a1->src1, a2->src2) &&
+             compare_operands_equal(a1->src2, a2->src1);
+    }
+
+    case ir::Instr_Kind::e_vector_extract: {
+      auto const e1 = static_cast<ir::Instr_vector_extract const*>(i1);
+      auto const e2 = static_cast<ir::Instr_vector_extract const*>(i2);
+      return e1->index == e2->index && e1->value == e2->value;
+    }
+
+    case ir::Instr_Kind::e_vector_insert: {
+      auto const e1 = static_cast<ir::Instr_vector_insert const*>(i1);
+      auto const e2 = static_cast<ir::Instr_vector_insert const*>(i2);
+      return e1->index == e2->index && e1->dst == e2->dst &&
+             compare_operands_equal(e1->value, e2->value);
+    }
+
+    case ir::Instr_Kind::e_composite_extract: {
+      auto const e1 = static_cast<ir::Instr_composite_extract const*>(i1);
+      auto const e2 = static_cast<ir::Instr_composite_extract const*>(i2);
+      if(e1->value != e2->value || e1->indices.size() != e2->indices.size()) {
+        return false;
+      }
+
+      for(i64 i = 0; i < e1->indices.size(); i += 1) {
+        if(e1->indices[i] != e2->indices[i]) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    case ir::Instr_Kind::e_composite_construct: {
+      auto const c1 = static_cast<ir::Instr_composite_construct const*>(i1);
+      auto const c2 = static_cast<ir::Instr_composite_construct const*>(i2);
+      if(c1->elements.size() != c2->elements.size()) {
+        return false;
+      }
+
+      for(i64 i = 0; i < c1->elements.size(); i += 1) {
+        if(!compare_operands_equal(c1->elements[i], c2->elements[i])) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    case ir::Instr_Kind::e_select: {
+      auto const s1 = static_cast<ir::Instr_select const*>(i1);
+      auto const s2 = static_cast<ir::Instr_select const*>(i2);
+      return compare_operands_equal(s1->condition, s2->condition) &&
+             compare_operands_equal(s1->then_value, s2->then_value) &&
+             compare_operands_equal(s1->else_value, s2->else_value);
+    }
+
+    case ir::Instr_Kind::e_ext_call: {
+      auto const c1 = static_cast<ir::Instr_ext_call const*>(i1);
+      auto const c2 = static_cast<ir::Instr_ext_call const*>(i2);
+      if(c1->ext != c2->ext || c1->args.size() != c2->args.size()) {
+        return false;
+      }
+
+      for(i64 i = 0; i < c1->args.size(); i += 1) {
+        if(!compare_operands_equal(c1->args[i], c2->args[i])) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    default:
+      // The conversions have a single operand and no other fields.
+      return compare_operands_equal(i1->operands->value, i2->operands->value);
+    }
+  }
+
+  // get_base
+  //
+  // Returns:
+  // The address the address has been derived from through getptrs.
+  //
+  [[nodiscard]] static ir::Value const* get_base(ir::Value const* address)
+  {
+    while(ir::instanceof<ir::Instr_getptr>(address)) {
+      address = static_cast<ir::Instr_getptr const*>(address)->address;
+    }
+    return address;
+  }
+
+  // may_alias
+  // Distinct allocations never alias each other or any other memory. The
+  // memory of the arguments, e.g. buffers, might be bound to the same
+  // resource.
+  //
+  [[nodiscard]] static bool may_alias(ir::Value const* const base1,
+                                      ir::Value const* const base2)
+  {
+    if(base1 == base2) {
+      return true;
+    }
+
+    return !ir::instanceof<ir::Instr_alloc>(base1) &&
+           !ir::instanceof<ir::Instr_alloc>(base2);
+  }
+
+  // is_load_available
+  //
+  // Returns:
+  // Whether memory read by the recorded load has not been written since.
+  //
+  [[nodiscard]] static bool is_load_available(GVN_Context const& ctx,
+                                              Expression_Entry const& entry)
+  {
+    ir::Value const* const base =
+      get_base(static_cast<ir::Instr_load const*>(entry.instr)->address);
+    for(i64 i = ctx.clobbers.size() - 1; i >= 0; i -= 1) {
+      Clobber const& clobber = ctx.clobbers[i];
+      if(clobber.generation <= entry.generation) {
+        break;
+      }
+
+      if(clobber.base == nullptr || may_alias(clobber.base, base)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  static void add_clobber(GVN_Context& ctx, ir::Value const* const base)
+  {
+    ctx.generation += 1;
+    ctx.clobbers.push_back(Clobber{ctx.generation, base});
+  }
+
+  // find_equivalent
+  //
+  // Returns:
+  // The available instruction computing the same value or nullptr.
+  //
+  [[nodiscard]] static ir::Instr* find_equivalent(GVN_Context const& ctx,
+                                                  ir::Instr const* const instr,
+                                                  u64 const hash)
+  {
+    auto const iterator = ctx.heads.find(hash);
+    if(iterator == ctx.heads.end()) {
+      return nullptr;
+    }
+
+    for(i64 i = iterator->value; i != -1; i = ctx.entries[i].next) {
+      Expression_Entry const& entry = ctx.entries[i];
+      if(entry.hash != hash ||
+         !compare_instructions_equal(entry.instr, instr)) {
+        continue;
+      }
+
+      if(instr->instr_kind != ir::Instr_Kind::e_load ||
+         is_load_available(ctx, entry)) {
+        return entry.instr;
+      }
+    }
+    return nullptr;
+  }
+
+  static void add_entry(GVN_Context& ctx, ir::Instr* const instr,
+                        u64 const hash)
+  {
+    i64 next = -1;
+    auto iterator = ctx.heads.find(hash);
+    if(iterator != ctx.heads.end()) {
+      next = iterator->value;
+      iterator->value = ctx.entries.size();
+    } else {
+      ctx.heads.emplace(hash, ctx.entries.size());
+    }
+
+    ctx.entries.push_back(Expression_Entry{.instr = instr,
+                                           .hash = hash,
+                                           .next = next,
+                                           .generation = ctx.generation});
+  }
+
+  static void number_block(GVN_Context& ctx, i64 const index,
+                           Array<ir::Value*>& operands)
+  {
+    i64 const scope_size = ctx.entries.size();
+    // The memory might have been written along the paths through the other
+    // predecessors, which have not necessarily been visited yet.
+    if(ctx.cfg.predecessors[index].size() > 1) {
+      add_clobber(ctx, nullptr);
+    }
+
+    ir::Basic_Block* const block = ctx.cfg.blocks[index];
+    for(ir::Instr& instruction: block->instructions) {
+      if(instruction.instr_kind == ir::Instr_Kind::e_store) {
+        auto const store = static_cast<ir::Instr_store*>(&instruction);
+        add_clobber(ctx, get_base(store->dst));
+        continue;
+      }
+
+      if(instruction.instr_kind == ir::Instr_Kind::e_call) {
+        add_clobber(ctx, nullptr);
+        continue;
+      }
+
+      if(!is_numberable(&instruction)) {
+        continue;
+      }
+
+      u64 const hash = hash_instruction(&instruction, operands);
+      ir::Instr* const equivalent = find_equivalent(ctx, &instruction, hash);
+      if(equivalent != nullptr) {
+        ir::replace_uses_with(&instruction, equivalent);
+        ctx.dead_instructions.push_back(&instruction);
+      } else {
+        add_entry(ctx, &instruction, hash);
+      }
+    }
+
+    for(i64 const child: ctx.dominator_tree.children[index]) {
+      number_block(ctx, child, operands);
+    }
+
+    // Leave the scope of the block.
+    while(ctx.entries.size() > scope_size) {
+      Expression_Entry const& entry = ctx.entries.back();
+      ctx.heads.find(entry.hash)->value = entry.next;
+      ctx.entries.pop_back();
+    }
+  }
+
+  ir::Pass_Result run_opt_ir_gvn(Allocator* const allocator,
+                                 ir::Function_Analyses& analyses)
+  {
+    GVN_Context ctx(allocator, analyses.get_cfg(),
+                    analyses.get_dominator_tree());
+    Array<ir::Value*> operands(allocator);
+    number_block(ctx, 0, operands);
+    for(ir::Instr* const instruction: ctx.dead_instructions) {
+      ir::erase_instruction(allocator, instruction);
+    }
+
+    // Only instructions are removed.
+    return ir::Pass_Result{.changes = ctx.dead_instructions.size(),
+                           .preserved = {.cfg = true,
+                                         .dominator_tree = true,
+                                         .post_dominator_tree = true,
+                                         .loop_info = true}};
+  }
+} // namespace vush
@@ -0,0 +1,390 @@
+#include <vush_ir_opt/opts.hpp>
+
+#include <anton/flat_hash_set.hpp>
+
+#include <vush_core/memory.hpp>
+#include <vush_ir/analysis.hpp>
+#include <vush_ir/types.hpp>
+
+namespace vush {
+  // The largest total cost of the arms of a selection and the selects
+  // replacing its phis that is still executed unconditionally.
+  constexpr i64 max_if_conversion_cost = 8;
+
+  namespace {
+    // Arm
+    // A path from the selection header to the converge block.
+    //
+    // Members:
+    //  blocks - the blocks of the path in order. Empty when the header
+    //           branches directly to the converge block.
+    //     end - the predecessor of the converge block on the path.
+    //    cost - the cost of executing the instructions of the path
+    //           unconditionally.
+    //
+    struct Arm {
+      Array<ir::Basic_Block*> blocks;
+      ir::Basic_Block* end = nullptr;
+      i64 cost = 0;
+
+      Arm(Allocator* allocator): blocks(allocator) {}
+    };
+
+    // Convert_Context
+    //
+    // Members:
+    //  merge_targets - the converge blocks of the selection headers and the
+    //                  merge and continue blocks of the loop headers. These
+    //                  blocks are referenced by the headers, therefore they
+    //                  are never folded into an arm.
+    //        touched - the blocks, indexed by their number in the CFG, that
+    //                  have changed during the current sweep.
+    //
+    struct Convert_Context {
+      Allocator* allocator;
+      ir::Module* module;
+      ir::CFG const& cfg;
+      anton::Flat_Hash_Set<ir::Basic_Block const*> merge_targets;
+      Array<bool> touched;
+
+      Convert_Context(Allocator* allocator, ir::Module* module,
+                      ir::CFG const& cfg)
+        : allocator(allocator), module(module), cfg(cfg),
+          merge_targets(allocator), touched(allocator)
+      {
+        for(i64 i = 0; i < cfg.size(); i += 1) {
+          touched.push_back(false);
+        }
+      }
+    };
+  } // namespace
+
+  [[nodiscard]] static ir::Intrinsic_scf_branch_head*
+  find_scf_branch_head(ir::Basic_Block* const block)
+  {
+    for(ir::Instr& instruction: block->instructions) {
+      if(instruction.instr_kind == ir::Instr_Kind::e_intrinsic &&
+         static_cast<ir::Instr_intrinsic&>(instruction).intrinsic_kind ==
+           ir::Intrinsic_Kind::e_scf_branch_head) {
+        return static_cast<ir::Intrinsic_scf_branch_head*>(&instruction);
+      }
+    }
+    return nullptr;
+  }
+
+  static void collect_merge_targets(Convert_Context& ctx)
+  {
+    for(ir::Basic_Block* const block: ctx.cfg.blocks) {
+      for(ir::Instr& instruction: block->instructions) {
+        if(instruction.instr_kind != ir::Instr_Kind::e_intrinsic) {
+          continue;
+        }
+
+        auto& intrinsic = static_cast<ir::Instr_intrinsic&>(instruction);
+        if(intrinsic.intrinsic_kind == ir::Intrinsic_Kind::e_scf_branch_head) {
+          auto& head = static_cast<ir::Intrinsic_scf_branch_head&>(instruction);
+          ctx.merge_targets.emplace(head.converge_block);
+        } else if(intrinsic.intrinsic_kind ==
+                  ir::Intrinsic_Kind::e_scf_loop_head) {
+          auto& head = static_cast<ir::Intrinsic_scf_loop_head&>(instruction);
+          ctx.merge_targets.emplace(head.merge_block);
+          ctx.merge_targets.emplace(head.continue_block);
+        }
+      }
+    }
+  }
+
+  // get_speculation_cost
+  // The transcendental extensions and the divisions are considerably more
+  // expensive than the remaining instructions.
+  //
+  // Returns:
+  // The cost of executing the instruction unconditionally or -1 if the
+  // instruction may fault or has effects other than computing its result.
+  //
+  [[nodiscard]] static i64 get_speculation_cost(ir::Instr const* const instr)
+  {
+    switch(instr->instr_kind) {
+    case ir::Instr_Kind::e_getptr:
+    case ir::Instr_Kind::e_vector_extract:
+    case ir::Instr_Kind::e_vector_insert:
+    case ir::Instr_Kind::e_composite_extract:
+    case ir::Instr_Kind::e_composite_construct:
+    case ir::Instr_Kind::e_cvt_sext:
+    case ir::Instr_Kind::e_cvt_zext:
+    case ir::Instr_Kind::e_cvt_trunc:
+    case ir::Instr_Kind::e_cvt_fpext:
+    case ir::Instr_Kind::e_cvt_fptrunc:
+    case ir::Instr_Kind::e_cvt_si2fp:
+    case ir::Instr_Kind::e_cvt_fp2si:
+    case ir::Instr_Kind::e_cvt_ui2fp:
+    case ir::Instr_Kind::e_cvt_fp2ui:
+    case ir::Instr_Kind::e_select:
+      return 1;
+
+    case ir::Instr_Kind::e_alu: {
+      auto const alu = static_cast<ir::Instr_ALU const*>(instr);
+      if(alu->op == ir::ALU_Opcode::e_fdiv) {
+        return 4;
+      }
+
+      // The integer division is speculated only when the divisor is a
+      // non-zero constant.
+      if(alu->op != ir::ALU_Opcode::e_idiv &&
+         alu->op != ir::ALU_Opcode::e_udiv &&
+         alu->op != ir::ALU_Opcode::e_irem &&
+         alu->op != ir::ALU_Opcode::e_urem) {
+        return 1;
+      }
+
+      bool nonzero = false;
+      if(ir::instanceof<ir::Constant_i32>(alu->src2)) {
+        nonzero = static_cast<ir::Constant_i32 const*>(alu->src2)->value != 0;
+      } else if(ir::instanceof<ir::Constant_u32>(alu->src2)) {
+        nonzero = static_cast<ir::Constant_u32 const*>(alu->src2)->value != 0;
+      }
+      return nonzero ? 4 : -1;
+    }
+
+    case ir::Instr_Kind::e_ext_call:
+      // Only the math extensions. The texture extensions depend on the
+      // implicit derivatives.
+      if(static_cast<ir::Instr_ext_call const*>(instr)->ext <=
+         ir::Ext_Kind::e_mat_inv) {
+        return 4;
+      } else {
+        return -1;
+      }
+
+    default:
+      return -1;
+    }
+  }
+
+  // is_selectable_type
+  // Selecting pointers requires variable pointers and the opaque types cannot
+  // be operands of a select.
+  //
+  [[nodiscard]] static bool is_selectable_type(ir::Type const& type)
+  {
+    return !ir::is_pointer(type) && !ir::is_opaque_type(type);
+  }
+
+  // build_arm
+  // Follow the path from the target of the header to the converge block. The
+  // blocks of the path must be entered only along the path, end with an
+  // unconditional branch and consist of speculatable instructions.
+  //
+  // Returns:
+  // Whether the path may be executed unconditionally.
+  //
+  [[nodiscard]] static bool build_arm(Convert_Context const& ctx, Arm& arm,
+                                      ir::Basic_Block* const header,
+                                      ir::Basic_Block* const target,
+                                      ir::Basic_Block* const converge_block)
+  {
+    ir::Basic_Block* previous = header;
+    ir::Basic_Block* block = target;
+    while(block != converge_block) {
+      i64 const index = ctx.cfg.get_index(block);
+      Array<i64> const& predecessors = ctx.cfg.predecessors[index];
+      if(block == header || ctx.touched[index] ||
+         ctx.merge_targets.find(block) != ctx.merge_targets.end() ||
+         predecessors.size() != 1 ||
+         ctx.cfg.blocks[predecessors[0]] != previous) {
+        return false;
+      }
+
+      ir::Instr* const terminator = block->get_last();
+      if(terminator->instr_kind != ir::Instr_Kind::e_branch) {
+        return false;
+      }
+
+      for(ir::Instr& instruction: block->instructions) {
+        if(&instruction == terminator) {
+          break;
+        }
+
+        i64 const cost = get_speculation_cost(&instruction);
+        if(cost < 0) {
+          return false;
+        }
+
+        arm.cost += cost;
+        if(arm.cost > max_if_conversion_cost) {
+          return false;
+        }
+      }
+
+      arm.blocks.push_back(block);
+      previous = block;
+      block = static_cast<ir::Instr_branch*>(terminator)->target;
+    }
+    arm.end = previous;
+    return true;
+  }
+
+  [[nodiscard]] static ir::Value* get_phi_source(ir::Instr_phi const* phi,
+                                                 ir::Basic_Block const* block)
+  {
+    for(ir::Phi_Source const& src: phi->srcs) {
+      if(src.block == block) {
+        return src.value;
+      }
+    }
+    return nullptr;
+  }
+
+  // move_arm
+  // Move the instructions of the arm to the end of the header and empty the
+  // blocks of the arm, which are no longer reachable.
+  //
+  static void move_arm(Allocator* const allocator, Arm const& arm,
+                       ir::Basic_Block* const header)
+  {
+    for(ir::Basic_Block* const block: arm.blocks) {
+      ir::erase_instruction(allocator, block->get_last());
+      while(!block->empty()) {
+        ir::Instr* const instruction = block->get_first();
+        anton::ilist_erase(instruction);
+        header->insert(instruction);
+      }
+    }
+  }
+
+  // convert_selection
+  // Replace a selection whose arms are cheap enough with the unconditional
+  // execution of both arms followed by selects of the values flowing into
+  // the phis of the converge block.
+  //
+  [[nodiscard]] static bool convert_selection(Convert_Context& ctx,
+                                              i64 const header_index)
+  {
+    ir::Basic_Block* const header = ctx.cfg.blocks[header_index];
+    ir::Instr* const terminator = header->get_last();
+    if(ctx.touched[header_index] ||
+       terminator->instr_kind != ir::Instr_Kind::e_brcond) {
+      return false;
+    }
+
+    ir::Intrinsic_scf_branch_head* const scf_branch_head =
+      find_scf_branch_head(header);
+    auto const brcond = static_cast<ir::Instr_brcond*>(terminator);
+    if(scf_branch_head == nullptr ||
+       brcond->then_target == brcond->else_target) {
+      return false;
+    }
+
+    ir::Basic_Block* const converge_block = scf_branch_head->converge_block;
+    i64 const converge_index = ctx.cfg.get_index(converge_block);
+    if(converge_index == -1 || ctx.touched[converge_index]) {
+      return false;
+    }
+
+    Arm then_arm(ctx.allocator);
+    Arm else_arm(ctx.allocator);
+    if(!build_arm(ctx, then_arm, header, brcond->then_target, converge_block) ||
+       !build_arm(ctx, else_arm, header, brcond->else_target,
+                  converge_block)) {
+      return false;
+    }
+
+    // The converge block must be entered only through the arms, each phi
+    // becoming a single select.
+    Array<i64> const& predecessors = ctx.cfg.predecessors[converge_index];
+    if(predecessors.size() != 2) {
+      return false;
+    }
+
+    i64 cost = then_arm.cost + else_arm.cost;
+    for(ir::Instr& instruction: converge_block->instructions) {
+      if(instruction.instr_kind != ir::Instr_Kind::e_phi) {
+        break;
+      }
+
+      auto const phi = static_cast<ir::Instr_phi*>(&instruction);
+      if(phi->srcs.size() != 2 || !is_selectable_type(*phi->type) ||
+         get_phi_source(phi, then_arm.end) == nullptr ||
+         get_phi_source(phi, else_arm.end) == nullptr) {
+        return false;
+      }
+      cost += 1;
+    }
+
+    if(cost > max_if_conversion_cost) {
+      return false;
+    }
+
+    ir::Value* const condition = brcond->condition;
+    Source_Info const source_info = brcond->source_info;
+    ir::erase_instruction(ctx.allocator, scf_branch_head);
+    ir::erase_instruction(ctx.allocator, brcond);
+    move_arm(ctx.allocator, then_arm, header);
+    move_arm(ctx.allocator, else_arm, header);
+    while(converge_block->get_first()->instr_kind == ir::Instr_Kind::e_phi) {
+      auto const phi = static_cast<ir::Instr_phi*>(converge_block->get_first());
+      auto const select = ir::make_instr_select(
+        ctx.allocator, ctx.module->next_id(), phi->type, condition,
+        get_phi_source(phi, then_arm.end), get_phi_source(phi, else_arm.end),
+        phi->source_info);
+      header->insert(select);
+      ir::replace_uses_with(phi, select);
+      ir::erase_instruction(ctx.allocator, phi);
+    }
+
+    auto const branch =
+      ir::make_instr_branch(ctx.allocator, ctx.module->next_id(),
+                            converge_block, source_info);
+    header->insert(branch);
+
+    ctx.touched[header_index] = true;
+    ctx.touched[converge_index] = true;
+    for(ir::Basic_Block* const block: then_arm.blocks) {
+      ctx.touched[ctx.cfg.get_index(block)] = true;
+    }
+
+    for(ir::Basic_Block* const block: else_arm.blocks) {
+      ctx.touched[ctx.cfg.get_index(block)] = true;
+    }
+    return true;
+  }
+
+  ir::Pass_Result run_opt_ir_if_convert(Allocator* const allocator,
+                                        ir::Function_Analyses& analyses)
+  {
+    ir::Function* const function = analyses.get_function();
+    ir::CFG const* cfg = &analyses.get_cfg();
+    i64 changes = 0;
+    while(true) {
+      Convert_Context ctx(allocator, analyses.get_module(), *cfg);
+      collect_merge_targets(ctx);
+      // The blocks are numbered in reverse postorder, hence the nested
+      // selections are visited before the enclosing ones. An enclosing
+      // selection becomes convertible in the following sweep once its
+      // nested selections have been flattened.
+      i64 sweep_changes = 0;
+      for(i64 i = cfg->size() - 1; i >= 0; i -= 1) {
+        if(convert_selection(ctx, i)) {
+          sweep_changes += 1;
+        }
+      }
+
+      if(sweep_changes == 0) {
+        break;
+      }
+
+      changes += sweep_changes;
+      cfg = ir::build_cfg(allocator, function);
+    }
+
+    if(changes > 0) {
+      return ir::Pass_Result{.changes = changes};
+    }
+
+    return ir::Pass_Result{.changes = 0,
+                           .preserved = {.cfg = true,
+                                         .dominator_tree = true,
+                                         .post_dominator_tree = true,
+                                         .loop_info = true}};
+  }
+} // namespace vush
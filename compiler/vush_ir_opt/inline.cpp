@@ -0,0 +1,423 @@
+#include <vush_ir_opt/opts.hpp>
+
+#include <anton/flat_hash_map.hpp>
+#include <anton/flat_hash_set.hpp>
+
+#include <vush_core/memory.hpp>
+#include <vush_ir/analysis.hpp>
+
+namespace vush {
+  // The cost model. The size of a callee is the number of its instructions.
+  // A callee is inlined when its size less the savings estimated for the call
+  // site does not exceed the threshold.
+  constexpr i64 inline_threshold = 40;
+  // The call, the return and the passing of the return value.
+  constexpr i64 call_savings = 3;
+  constexpr i64 argument_savings = 1;
+  // The uses of an argument that is constant at the call site are likely to
+  // be folded once the callee has been inlined.
+  constexpr i64 constant_use_savings = 2;
+
+  namespace {
+    enum struct Visit_State : u8 {
+      e_active,
+      e_finished,
+    };
+
+    struct Inline_Context {
+      Allocator* allocator;
+      ir::Module* module;
+      bool flatten;
+      // The functions in the postorder of the call graph, i.e. the callees
+      // precede their callers except for the recursive calls.
+      Array<ir::Function*> functions;
+      anton::Flat_Hash_Map<ir::Function const*, Visit_State> visit_states;
+      // The number of the call sites of each function.
+      anton::Flat_Hash_Map<ir::Function const*, i64> call_counts;
+      anton::Flat_Hash_Set<ir::Instr_call const*> recursive_calls;
+      // The sizes of the functions that have been fully processed.
+      anton::Flat_Hash_Map<ir::Function const*, i64> sizes;
+
+      Inline_Context(Allocator* allocator, ir::Module* module, bool flatten)
+        : allocator(allocator), module(module), flatten(flatten),
+          functions(allocator), visit_states(allocator), call_counts(allocator),
+          recursive_calls(allocator), sizes(allocator)
+      {
+      }
+    };
+
+    // Clone_Map
+    // The correspondence between the values and blocks of a callee and their
+    // clones at a call site.
+    //
+    struct Clone_Map {
+      anton::Flat_Hash_Map<ir::Value const*, ir::Value*> values;
+      anton::Flat_Hash_Map<ir::Basic_Block const*, ir::Basic_Block*> blocks;
+
+      Clone_Map(Allocator* allocator): values(allocator), blocks(allocator) {}
+    };
+  } // namespace
+
+  static void collect_calls(Allocator* const allocator,
+                            ir::Function* const function,
+                            Array<ir::Instr_call*>& calls)
+  {
+    ir::CFG const* const cfg = ir::build_cfg(allocator, function);
+    for(ir::Basic_Block* const block: cfg->blocks) {
+      for(ir::Instr& instruction: block->instructions) {
+        if(instruction.instr_kind == ir::Instr_Kind::e_call) {
+          calls.push_back(static_cast<ir::Instr_call*>(&instruction));
+        }
+      }
+    }
+  }
+
+  // visit_function
+  // Walk the call graph depth-first and record the functions in postorder.
+  // A call to a function whose walk has not finished yet is recursive.
+  //
+  static void visit_function(Inline_Context& ctx, ir::Function* const function)
+  {
+    ctx.visit_states.emplace(function, Visit_State::e_active);
+    Array<ir::Instr_call*> calls(ctx.allocator);
+    collect_calls(ctx.allocator, function, calls);
+    for(ir::Instr_call* const call: calls) {
+      ir::Function* const callee = call->function;
+      auto count = ctx.call_counts.find(callee);
+      if(count == ctx.call_counts.end()) {
+        ctx.call_counts.emplace(callee, 1);
+      } else {
+        count->value += 1;
+      }
+
+      auto const state = ctx.visit_states.find(callee);
+      if(state == ctx.visit_states.end()) {
+        visit_function(ctx, callee);
+      } else if(state->value == Visit_State::e_active) {
+        ctx.recursive_calls.emplace(call);
+      }
+    }
+
+    ctx.visit_states.find(function)->value = Visit_State::e_finished;
+    ctx.functions.push_back(function);
+  }
+
+  [[nodiscard]] static i64 get_function_size(Inline_Context& ctx,
+                                             ir::Function* const function)
+  {
+    auto const iterator = ctx.sizes.find(function);
+    if(iterator != ctx.sizes.end()) {
+      return iterator->value;
+    }
+
+    i64 size = 0;
+    ir::CFG const* const cfg = ir::build_cfg(ctx.allocator, function);
+    for(ir::Basic_Block const* const block: cfg->blocks) {
+      for(ir::Instr const& instruction: block->instructions) {
+        if(instruction.instr_kind != ir::Instr_Kind::e_intrinsic) {
+          size += 1;
+        }
+      }
+    }
+    ctx.sizes.emplace(function, size);
+    return size;
+  }
+
+  [[nodiscard]] static bool should_inline(Inline_Context& ctx,
+                                          ir::Instr_call const* const call)
+  {
+    ir::Function* const callee = call->function;
+    if(ctx.recursive_calls.find(call) != ctx.recursive_calls.end() ||
+       callee->inline_hint == ir::Inline_Hint::e_noinline) {
+      return false;
+    }
+
+    if(ctx.flatten || callee->inline_hint == ir::Inline_Hint::e_inline) {
+      return true;
+    }
+
+    // The only call site does not duplicate the callee.
+    if(ctx.call_counts.find(callee)->value == 1) {
+      return true;
+    }
+
+    i64 savings = call_savings + argument_savings * call->args.size();
+    i64 index = 0;
+    for(ir::Argument const& argument: callee->arguments) {
+      if(ir::instanceof<ir::Constant>(call->args[index])) {
+        for(ir::Use const* const use: argument.get_uses()) {
+          ANTON_UNUSED(use);
+          savings += constant_use_savings;
+        }
+      }
+      index += 1;
+    }
+
+    return get_function_size(ctx, callee) - savings <= inline_threshold;
+  }
+
+  [[nodiscard]] static ir::Basic_Block*
+  get_cloned_block(Inline_Context& ctx, Clone_Map& map,
+                   ir::Basic_Block const* const block)
+  {
+    auto iterator = map.blocks.find(block);
+    if(iterator == map.blocks.end()) {
+      // An unreachable converge, merge or continue block that is never
+      // cloned.
+      auto const clone =
+        VUSH_ALLOCATE(ir::Basic_Block, ctx.allocator, ctx.module->next_id());
+      iterator = map.blocks.emplace(block, clone);
+    }
+    return iterator->value;
+  }
+
+  static void remap_blocks(Inline_Context& ctx, Clone_Map& map,
+                           ir::Instr* const instr)
+  {
+    switch(instr->instr_kind) {
+    case ir::Instr_Kind::e_intrinsic: {
+      auto const intrinsic = static_cast<ir::Instr_intrinsic*>(instr);
+      if(intrinsic->intrinsic_kind == ir::Intrinsic_Kind::e_scf_branch_head) {
+        auto const head = static_cast<ir::Intrinsic_scf_branch_head*>(instr);
+        head->converge_block =
+          get_cloned_block(ctx, map, head->converge_block);
+      } else if(intrinsic->intrinsic_kind ==
+                ir::Intrinsic_Kind::e_scf_loop_head) {
+        auto const head = static_cast<ir::Intrinsic_scf_loop_head*>(instr);
+        head->merge_block = get_cloned_block(ctx, map, head->merge_block);
+        head->continue_block =
+          get_cloned_block(ctx, map, head->continue_block);
+      }
+    } break;
+
+    case ir::Instr_Kind::e_branch: {
+      auto const branch = static_cast<ir::Instr_branch*>(instr);
+      branch->target = get_cloned_block(ctx, map, branch->target);
+    } break;
+
+    case ir::Instr_Kind::e_brcond: {
+      auto const brcond = static_cast<ir::Instr_brcond*>(instr);
+      brcond->then_target = get_cloned_block(ctx, map, brcond->then_target);
+      brcond->else_target = get_cloned_block(ctx, map, brcond->else_target);
+    } break;
+
+    case ir::Instr_Kind::e_switch: {
+      auto const instr_switch = static_cast<ir::Instr_switch*>(instr);
+      instr_switch->default_label =
+        get_cloned_block(ctx, map, instr_switch->default_label);
+      for(ir::Switch_Label& label: instr_switch->labels) {
+        label.target = get_cloned_block(ctx, map, label.target);
+      }
+    } break;
+
+    case ir::Instr_Kind::e_phi: {
+      auto const phi = static_cast<ir::Instr_phi*>(instr);
+      for(ir::Phi_Source& src: phi->srcs) {
+        src.block = get_cloned_block(ctx, map, src.block);
+      }
+    } break;
+
+    default:
+      break;
+    }
+  }
+
+  // split_after_call
+  // Move the instructions following the call to a new block. The allocations
+  // stay in the block of the call so that those of the entry block remain
+  // there.
+  //
+  // Returns:
+  // The new block.
+  //
+  [[nodiscard]] static ir::Basic_Block*
+  split_after_call(Inline_Context& ctx, ir::Instr_call* const call)
+  {
+    ir::Basic_Block* const block = call->block;
+    auto const continuation =
+      VUSH_ALLOCATE(ir::Basic_Block, ctx.allocator, ctx.module->next_id());
+    Array<ir::Instr*> tail(ctx.allocator);
+    while(block->get_last() != call) {
+      ir::Instr* const instruction = block->get_last();
+      anton::ilist_erase(instruction);
+      tail.push_back(instruction);
+    }
+
+    for(i64 i = tail.size() - 1; i >= 0; i -= 1) {
+      if(tail[i]->instr_kind == ir::Instr_Kind::e_alloc) {
+        block->insert(tail[i]);
+      } else {
+        continuation->insert(tail[i]);
+      }
+    }
+
+    // The successors now flow in from the new block.
+    Array<ir::Basic_Block*> successors(ctx.allocator);
+    ir::get_successors(continuation->get_last(), successors);
+    for(ir::Basic_Block* const successor: successors) {
+      for(ir::Instr& instruction: successor->instructions) {
+        if(instruction.instr_kind != ir::Instr_Kind::e_phi) {
+          break;
+        }
+
+        auto const phi = static_cast<ir::Instr_phi*>(&instruction);
+        for(ir::Phi_Source& src: phi->srcs) {
+          if(src.block == block) {
+            src.block = continuation;
+          }
+        }
+      }
+    }
+    return continuation;
+  }
+
+  // inline_call
+  // Replace the call with a copy of the body of the callee. The returns of the
+  // copy branch to the instructions following the call and the returned
+  // values are merged with a phi.
+  //
+  static void inline_call(Inline_Context& ctx, ir::Function* const caller,
+                          ir::Instr_call* const call)
+  {
+    ir::Function* const callee = call->function;
+    ir::Basic_Block* const block = call->block;
+    ir::Basic_Block* const continuation = split_after_call(ctx, call);
+
+    Clone_Map map(ctx.allocator);
+    i64 index = 0;
+    for(ir::Argument& argument: callee->arguments) {
+      map.values.emplace(&argument, call->args[index]);
+      index += 1;
+    }
+
+    ir::CFG const* const cfg = ir::build_cfg(ctx.allocator, callee);
+    for(ir::Basic_Block* const callee_block: cfg->blocks) {
+      auto const clone =
+        VUSH_ALLOCATE(ir::Basic_Block, ctx.allocator, ctx.module->next_id());
+      map.blocks.emplace(callee_block, clone);
+    }
+
+    Array<ir::Instr*> clones(ctx.allocator);
+    for(ir::Basic_Block* const callee_block: cfg->blocks) {
+      ir::Basic_Block* const clone_block = map.blocks.find(callee_block)->value;
+      for(ir::Instr& instruction: callee_block->instructions) {
+        ir::Instr* const clone =
+          ir::clone_instruction(ctx.allocator, &instruction,
+                                ctx.module->next_id());
+        map.values.emplace(&instruction, clone);
+        clones.push_back(clone);
+        // The calls left in the callee are duplicated at the call site.
+        if(clone->instr_kind == ir::Instr_Kind::e_call) {
+          auto const callee_call = static_cast<ir::Instr_call*>(&instruction);
+          auto const clone_call = static_cast<ir::Instr_call*>(clone);
+          ctx.call_counts.find(clone_call->function)->value += 1;
+          if(ctx.recursive_calls.find(callee_call) !=
+             ctx.recursive_calls.end()) {
+            ctx.recursive_calls.emplace(clone_call);
+          }
+        }
+        // The allocations are hoisted to the entry of the caller.
+        if(clone->instr_kind == ir::Instr_Kind::e_alloc) {
+          caller->entry_block->instructions.insert_front(*clone);
+          clone->block = caller->entry_block;
+        } else {
+          clone_block->insert(clone);
+        }
+      }
+    }
+
+    Array<ir::Phi_Source> returns(ctx.allocator);
+    for(ir::Instr* const clone: clones) {
+      for(ir::Use* use = clone->operands; use != nullptr;
+          use = use->next_operand) {
+        auto const value = map.values.find(use->value);
+        if(value != map.values.end()) {
+          ir::set_use(use, value->value);
+        }
+      }
+
+      remap_blocks(ctx, map, clone);
+      if(clone->instr_kind == ir::Instr_Kind::e_return) {
+        ir::Basic_Block* const return_block = clone->block;
+        returns.push_back(ir::Phi_Source{
+          .value = static_cast<ir::Instr_return*>(clone)->value,
+          .block = return_block});
+        auto const branch = ir::make_instr_branch(
+          ctx.allocator, clone->id, continuation, clone->source_info);
+        ir::erase_instruction(ctx.allocator, clone);
+        return_block->insert(branch);
+      }
+    }
+
+    if(call->has_uses()) {
+      if(returns.size() == 0) {
+        ir::replace_uses_with(call,
+                              ir::make_constant_undef(ctx.allocator,
+                                                      call->type));
+      } else if(returns.size() == 1) {
+        ir::replace_uses_with(call, returns[0].value);
+      } else {
+        auto const phi =
+          ir::make_instr_phi(ctx.allocator, ctx.module->next_id(), call->type,
+                             call->source_info);
+        for(ir::Phi_Source const& src: returns) {
+          phi->add_source(src.value, src.block);
+        }
+        continuation->instructions.insert_front(*phi);
+        phi->block = continuation;
+        ir::replace_uses_with(call, phi);
+      }
+    }
+
+    // The continuation is unreachable when the callee never returns.
+    if(returns.size() == 0) {
+      Array<ir::Basic_Block*> successors(ctx.allocator);
+      ir::get_successors(continuation->get_last(), successors);
+      for(ir::Basic_Block* const successor: successors) {
+        ir::remove_phi_sources(successor, continuation);
+      }
+    }
+
+    ir::Basic_Block* const entry = map.blocks.find(callee->entry_block)->value;
+    auto const branch =
+      ir::make_instr_branch(ctx.allocator, call->id, entry, call->source_info);
+    ctx.call_counts.find(callee)->value -= 1;
+    ir::erase_instruction(ctx.allocator, call);
+    block->insert(branch);
+  }
+
+  [[nodiscard]] static i64 run_inliner(Inline_Context& ctx)
+  {
+    visit_function(ctx, ctx.module->entry);
+
+    i64 inlined = 0;
+    Array<ir::Instr_call*> calls(ctx.allocator);
+    for(ir::Function* const function: ctx.functions) {
+      calls.clear();
+      collect_calls(ctx.allocator, function, calls);
+      for(ir::Instr_call* const call: calls) {
+        if(should_inline(ctx, call)) {
+          inline_call(ctx, function, call);
+          inlined += 1;
+        }
+      }
+    }
+    return inlined;
+  }
+
+  ir::Pass_Result run_opt_ir_inline(Allocator* const allocator,
+                                    ir::Module_Analyses& analyses)
+  {
+    Inline_Context ctx(allocator, analyses.get_module(), false);
+    i64 const inlined = run_inliner(ctx);
+    return ir::Pass_Result{.changes = inlined};
+  }
+
+  ir::Pass_Result run_opt_ir_flatten(Allocator* const allocator,
+                                     ir::Module_Analyses& analyses)
+  {
+    Inline_Context ctx(allocator, analyses.get_module(), true);
+    i64 const inlined = run_inliner(ctx);
+    return ir::Pass_Result{.changes = inlined};
+  }
+} // namespace vush
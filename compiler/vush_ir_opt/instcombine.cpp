@@ -0,0 +1,723 @@
+#include <vush_ir_opt/opts.hpp>
+
+#include <bit>
+
+#include <anton/flat_hash_map.hpp>
+#include <anton/flat_hash_set.hpp>
+
+#include <vush_core/memory.hpp>
+#include <vush_ir/types.hpp>
+
+namespace vush {
+  namespace {
+    // Identity
+    // The right operand of an operation that yields the left operand.
+    //
+    enum struct Identity {
+      e_none,
+      e_zero,
+      e_one,
+      e_all_ones,
+      e_fp_one,
+      // x + 0.0 is not x when x is -0.0.
+      e_fp_negative_zero,
+    };
+
+    // ALU_Pattern
+    //
+    // Members:
+    //      commutative - whether the operands may be swapped. Constant left
+    //                    operands are moved to the right.
+    //       involution - whether applying the unary operation twice yields
+    //                    the operand.
+    //         identity - the right operand that leaves the left operand
+    //                    unchanged.
+    //
+    struct ALU_Pattern {
+      ir::ALU_Opcode op;
+      bool commutative;
+      bool involution;
+      Identity identity;
+    };
+
+    struct Combine_Context {
+      Allocator* allocator;
+      ir::Module* module;
+      Array<ir::Instr*> worklist;
+      // The position in the worklist at which an instruction has been queued
+      // last.
+      anton::Flat_Hash_Map<ir::Instr const*, i64> queued;
+      anton::Flat_Hash_Set<ir::Instr const*> replaced;
+      Array<ir::Instr*> dead_instructions;
+      // The index of the instruction being combined.
+      i64 current = 0;
+
+      Combine_Context(Allocator* allocator, ir::Module* module)
+        : allocator(allocator), module(module), worklist(allocator),
+          queued(allocator), replaced(allocator), dead_instructions(allocator)
+      {
+      }
+    };
+  } // namespace
+
+  constexpr ALU_Pattern alu_patterns[] = {
+    {ir::ALU_Opcode::e_inv, false, true, Identity::e_none},
+    {ir::ALU_Opcode::e_and, true, false, Identity::e_all_ones},
+    {ir::ALU_Opcode::e_or, true, false, Identity::e_zero},
+    {ir::ALU_Opcode::e_xor, true, false, Identity::e_zero},
+    {ir::ALU_Opcode::e_shl, false, false, Identity::e_zero},
+    {ir::ALU_Opcode::e_shr, false, false, Identity::e_zero},
+    {ir::ALU_Opcode::e_ashr, false, false, Identity::e_zero},
+    {ir::ALU_Opcode::e_neg, false, true, Identity::e_none},
+    {ir::ALU_Opcode::e_iadd, true, false, Identity::e_zero},
+    {ir::ALU_Opcode::e_imul, true, false, Identity::e_one},
+    {ir::ALU_Opcode::e_imulhi, true, false, Identity::e_none},
+    {ir::ALU_Opcode::e_uadd, true, false, Identity::e_zero},
+    {ir::ALU_Opcode::e_umul, true, false, Identity::e_one},
+    {ir::ALU_Opcode::e_umulhi, true, false, Identity::e_none},
+    {ir::ALU_Opcode::e_idiv, false, false, Identity::e_one},
+    {ir::ALU_Opcode::e_udiv, false, false, Identity::e_one},
+    {ir::ALU_Opcode::e_fneg, false, true, Identity::e_none},
+    {ir::ALU_Opcode::e_fadd, true, false, Identity::e_fp_negative_zero},
+    {ir::ALU_Opcode::e_fmul, true, false, Identity::e_fp_one},
+    {ir::ALU_Opcode::e_fdiv, false, false, Identity::e_fp_one},
+    {ir::ALU_Opcode::e_icmp_eq, true, false, Identity::e_none},
+    {ir::ALU_Opcode::e_icmp_neq, true, false, Identity::e_none},
+    {ir::ALU_Opcode::e_fcmp_eq, true, false, Identity::e_none},
+    {ir::ALU_Opcode::e_fcmp_neq, true, false, Identity::e_none},
+  };
+
+  [[nodiscard]] static ALU_Pattern get_alu_pattern(ir::ALU_Opcode const op)
+  {
+    for(ALU_Pattern const& pattern: alu_patterns) {
+      if(pattern.op == op) {
+        return pattern;
+      }
+    }
+    return ALU_Pattern{op, false, false, Identity::e_none};
+  }
+
+  static void enqueue(Combine_Context& ctx, ir::Instr* const instr)
+  {
+    auto const iterator = ctx.queued.find(instr);
+    if(iterator == ctx.queued.end()) {
+      ctx.queued.emplace(instr, ctx.worklist.size());
+    } else if(iterator->value > ctx.current) {
+      // Still pending.
+      return;
+    } else {
+      iterator->value = ctx.worklist.size();
+    }
+    ctx.worklist.push_back(instr);
+  }
+
+  static void enqueue_users(Combine_Context& ctx, ir::Instr const* const instr)
+  {
+    for(ir::Use const* const use: instr->get_uses()) {
+      enqueue(ctx, use->user);
+    }
+  }
+
+  // insert_combined
+  // Insert an instruction created by the combiner after the position and
+  // queue it to be combined.
+  //
+  static void insert_combined(Combine_Context& ctx, ir::Instr* const position,
+                              ir::Instr* const instr)
+  {
+    anton::ilist_insert_after(position, instr);
+    instr->block = position->block;
+    enqueue(ctx, instr);
+  }
+
+  [[nodiscard]] static bool is_constant_operand(ir::Value const* const value)
+  {
+    if(ir::instanceof<ir::Constant>(value)) {
+      return true;
+    }
+
+    if(ir::instanceof<ir::Instr_composite_construct>(value)) {
+      auto const construct =
+        static_cast<ir::Instr_composite_construct const*>(value);
+      for(ir::Value const* const element: construct->elements) {
+        if(!ir::instanceof<ir::Constant>(element)) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    return false;
+  }
+
+  // is_identity
+  //
+  // Returns:
+  // Whether the value is the identity. Vectors are the identity if all their
+  // elements are.
+  //
+  [[nodiscard]] static bool is_identity(ir::Value const* const value,
+                                        Identity const identity)
+  {
+    if(ir::instanceof<ir::Instr_composite_construct>(value)) {
+      auto const construct =
+        static_cast<ir::Instr_composite_construct const*>(value);
+      if(construct->type->kind != ir::Type_Kind::e_vec) {
+        return false;
+      }
+
+      for(ir::Value const* const element: construct->elements) {
+        if(!is_identity(element, identity)) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    switch(identity) {
+    case Identity::e_none:
+      return false;
+
+    case Identity::e_zero:
+      if(ir::instanceof<ir::Constant_bool>(value)) {
+        return !static_cast<ir::Constant_bool const*>(value)->value;
+      } else if(ir::instanceof<ir::Constant_i32>(value)) {
+        return static_cast<ir::Constant_i32 const*>(value)->value == 0;
+      } else if(ir::instanceof<ir::Constant_u32>(value)) {
+        return static_cast<ir::Constant_u32 const*>(value)->value == 0;
+      } else {
+        return false;
+      }
+
+    case Identity::e_one:
+      if(ir::instanceof<ir::Constant_i32>(value)) {
+        return static_cast<ir::Constant_i32 const*>(value)->value == 1;
+      } else if(ir::instanceof<ir::Constant_u32>(value)) {
+        return static_cast<ir::Constant_u32 const*>(value)->value == 1;
+      } else {
+        return false;
+      }
+
+    case Identity::e_all_ones:
+      if(ir::instanceof<ir::Constant_bool>(value)) {
+        return static_cast<ir::Constant_bool const*>(value)->value;
+      } else if(ir::instanceof<ir::Constant_i32>(value)) {
+        return static_cast<ir::Constant_i32 const*>(value)->value == -1;
+      } else if(ir::instanceof<ir::Constant_u32>(value)) {
+        return static_cast<ir::Constant_u32 const*>(value)->value ==
+               0xFFFFFFFF;
+      } else {
+        return false;
+      }
+
+    case Identity::e_fp_one:
+      if(ir::instanceof<ir::Constant_f32>(value)) {
+        return static_cast<ir::Constant_f32 const*>(value)->value == 1.0f;
+      } else if(ir::instanceof<ir::Constant_f64>(value)) {
+        return static_cast<ir::Constant_f64 const*>(value)->value == 1.0;
+      } else {
+        return false;
+      }
+
+    case Identity::e_fp_negative_zero:
+      if(ir::instanceof<ir::Constant_f32>(value)) {
+        f32 const v = static_cast<ir::Constant_f32 const*>(value)->value;
+        return v == 0.0f && std::bit_cast<u32>(v) != 0;
+      } else if(ir::instanceof<ir::Constant_f64>(value)) {
+        f64 const v = static_cast<ir::Constant_f64 const*>(value)->value;
+        return v == 0.0 && std::bit_cast<u64>(v) != 0;
+      } else {
+        return false;
+      }
+    }
+    return false;
+  }
+
+  // combine_alu
+  // Move the constant operands of commutative operations to the right, fold
+  // the identities and the pairs of involutions.
+  //
+  [[nodiscard]] static ir::Value* combine_alu(ir::Instr_ALU* const alu)
+  {
+    ALU_Pattern const pattern = get_alu_pattern(alu->op);
+    bool swapped = false;
+    if(pattern.commutative && is_constant_operand(alu->src1) &&
+       !is_constant_operand(alu->src2)) {
+      ir::Value* const src1 = alu->src1;
+      ir::Value* const src2 = alu->src2;
+      for(ir::Use* use = alu->operands; use != nullptr;
+          use = use->next_operand) {
+        ir::set_use(use, use->operand == 0 ? src2 : src1);
+      }
+      swapped = true;
+    }
+
+    if(alu->src2 != nullptr && is_identity(alu->src2, pattern.identity) &&
+       ir::compare_types_equal(*alu->type, *alu->src1->type)) {
+      return alu->src1;
+    }
+
+    if(pattern.involution && ir::instanceof<ir::Instr_ALU>(alu->src1)) {
+      auto const inner = static_cast<ir::Instr_ALU const*>(alu->src1);
+      if(inner->op == alu->op) {
+        return inner->src1;
+      }
+    }
+
+    return swapped ? alu : nullptr;
+  }
+
+  // combine_vector_extract
+  // Look through the insertions into other elements and forward the inserted
+  // or constructed element.
+  //
+  [[nodiscard]] static ir::Value*
+  combine_vector_extract(Combine_Context& ctx,
+                         ir::Instr_vector_extract* const extract)
+  {
+    ir::Value* value = extract->value;
+    while(ir::instanceof<ir::Instr_vector_insert>(value)) {
+      auto const insert = static_cast<ir::Instr_vector_insert const*>(value);
+      if(insert->index == extract->index) {
+        return insert->value;
+      }
+      value = insert->dst;
+    }
+
+    if(ir::instanceof<ir::Instr_composite_construct>(value) &&
+       value->type->kind == ir::Type_Kind::e_vec) {
+      // The vectors are constructed from scalars and vectors.
+      auto const construct =
+        static_cast<ir::Instr_composite_construct const*>(value);
+      i64 offset = 0;
+      for(ir::Value* const element: construct->elements) {
+        if(element->type->kind != ir::Type_Kind::e_vec) {
+          if(offset == extract->index) {
+            return element;
+          }
+          offset += 1;
+          continue;
+        }
+
+        i64 const rows = static_cast<ir::Type_Vec const*>(element->type)->rows;
+        if(extract->index < offset + rows) {
+          auto const forwarded = ir::make_instr_vector_extract(
+            ctx.allocator, ctx.module->next_id(), extract->type, element,
+            extract->index - offset, extract->source_info);
+          insert_combined(ctx, extract, forwarded);
+          return forwarded;
+        }
+        offset += rows;
+      }
+    }
+
+    if(value != extract->value) {
+      ir::set_use(extract->operands, value);
+      return extract;
+    }
+
+    return nullptr;
+  }
+
+  // get_element_count
+  //
+  // Returns:
+  // The number of elements of the type. 0 if the type is not a composite.
+  //
+  [[nodiscard]] static i64 get_element_count(ir::Type const& type)
+  {
+    switch(type.kind) {
+    case ir::Type_Kind::e_composite:
+      return static_cast<ir::Type_Composite const&>(type).elements.size();
+    case ir::Type_Kind::e_array:
+      return static_cast<ir::Type_Array const&>(type).size;
+    case ir::Type_Kind::e_mat:
+      return static_cast<ir::Type_Mat const&>(type).columns;
+    case ir::Type_Kind::e_vec:
+      return static_cast<ir::Type_Vec const&>(type).rows;
+    default:
+      return 0;
+    }
+  }
+
+  // combine_composite_extract
+  // Merge the chains of extractions into a single extraction and forward the
+  // elements of constructed composites.
+  //
+  [[nodiscard]] static ir::Value*
+  combine_composite_extract(Combine_Context& ctx,
+                            ir::Instr_composite_extract* const extract)
+  {
+    if(ir::instanceof<ir::Instr_composite_extract>(extract->value)) {
+      auto const inner =
+        static_cast<ir::Instr_composite_extract const*>(extract->value);
+      Array<i64> indices(ctx.allocator);
+      indices.assign(inner->indices.begin(), inner->indices.end());
+      for(i64 const index: extract->indices) {
+        indices.push_back(index);
+      }
+      auto const merged = ir::make_instr_composite_extract(
+        ctx.allocator, ctx.module->next_id(), extract->type, inner->value,
+        anton::Slice<i64 const>(indices.data(),
+                                indices.data() + indices.size()),
+        extract->source_info);
+      insert_combined(ctx, extract, merged);
+      return merged;
+    }
+
+    if(ir::instanceof<ir::Instr_composite_construct>(extract->value)) {
+      auto const construct =
+        static_cast<ir::Instr_composite_construct const*>(extract->value);
+      // The vectors might be constructed from other vectors, in which case
+      // the elements do not correspond to the constituents.
+      if(construct->elements.size() != get_element_count(*construct->type)) {
+        return nullptr;
+      }
+
+      ir::Value* const element = construct->elements[extract->indices[0]];
+      if(extract->indices.size() == 1) {
+        return element;
+      }
+
+      auto const forwarded = ir::make_instr_composite_extract(
+        ctx.allocator, ctx.module->next_id(), extract->type, element,
+        anton::Slice<i64 const>(extract->indices.data() + 1,
+                                extract->indices.data() +
+                                  extract->indices.size()),
+        extract->source_info);
+      insert_combined(ctx, extract, forwarded);
+      return forwarded;
+    }
+
+    return nullptr;
+  }
+
+  // get_extracted_element
+  //
+  // Returns:
+  // The composite from which the value is extracted as the element at the
+  // index. nullptr if the value is not such an extraction.
+  //
+  [[nodiscard]] static ir::Value* get_extracted_element(ir::Value* const value,
+                                                        i64 const index)
+  {
+    if(ir::instanceof<ir::Instr_composite_extract>(value)) {
+      auto const extract = static_cast<ir::Instr_composite_extract*>(value);
+      if(extract->indices.size() == 1 && extract->indices[0] == index) {
+        return extract->value;
+      }
+    } else if(ir::instanceof<ir::Instr_vector_extract>(value)) {
+      auto const extract = static_cast<ir::Instr_vector_extract*>(value);
+      if(extract->index == index) {
+        return extract->value;
+      }
+    }
+    return nullptr;
+  }
+
+  // combine_composite_construct
+  // Replace the reconstruction of a composite from all its elements in order
+  // with the composite.
+  //
+  [[nodiscard]] static ir::Value*
+  combine_composite_construct(ir::Instr_composite_construct* const construct)
+  {
+    i64 const count = construct->elements.size();
+    if(count == 0 || count != get_element_count(*construct->type)) {
+      return nullptr;
+    }
+
+    ir::Value* const source = get_extracted_element(construct->elements[0], 0);
+    if(source == nullptr ||
+       !ir::compare_types_equal(*source->type, *construct->type)) {
+      return nullptr;
+    }
+
+    for(i64 i = 1; i < count; i += 1) {
+      if(get_extracted_element(construct->elements[i], i) != source) {
+        return nullptr;
+      }
+    }
+    return source;
+  }
+
+  // combine_select
+  // Replace a select between equal values with the value and a select of
+  // true and false with its condition.
+  //
+  [[nodiscard]] static ir::Value*
+  combine_select(ir::Instr_select* const select)
+  {
+    if(select->then_value == select->else_value) {
+      return select->then_value;
+    }
+
+    if(ir::compare_types_equal(*select->condition->type, *select->type) &&
+       is_identity(select->then_value, Identity::e_all_ones) &&
+       is_identity(select->else_value, Identity::e_zero)) {
+      return select->condition;
+    }
+    return nullptr;
+  }
+
+  [[nodiscard]] static ir::Type_Kind get_scalar_kind(ir::Type const& type)
+  {
+    if(type.kind == ir::Type_Kind::e_vec) {
+      return static_cast<ir::Type_Vec const&>(type).element_type->kind;
+    }
+    return type.kind;
+  }
+
+  // get_value_bits
+  //
+  // Returns:
+  // The number of bits of the magnitude of the values of an integer type.
+  //
+  [[nodiscard]] static i64 get_value_bits(ir::Type_Kind const kind)
+  {
+    switch(kind) {
+    case ir::Type_Kind::e_int8:
+      return 7;
+    case ir::Type_Kind::e_int16:
+      return 15;
+    case ir::Type_Kind::e_int32:
+      return 31;
+    case ir::Type_Kind::e_uint8:
+      return 8;
+    case ir::Type_Kind::e_uint16:
+      return 16;
+    default:
+      return 32;
+    }
+  }
+
+  // get_significand_bits
+  //
+  // Returns:
+  // The number of bits of the significand of a floating point type including
+  // the implicit bit.
+  //
+  [[nodiscard]] static i64 get_significand_bits(ir::Type_Kind const kind)
+  {
+    switch(kind) {
+    case ir::Type_Kind::e_fp16:
+      return 11;
+    case ir::Type_Kind::e_fp32:
+      return 24;
+    default:
+      return 53;
+    }
+  }
+
+  [[nodiscard]] static ir::Value* get_converted_value(ir::Instr const* instr)
+  {
+    // All conversions have the same layout.
+    return static_cast<ir::Instr_cvt_sext const*>(instr)->value;
+  }
+
+  // combine_conversion
+  // Fold the chains of conversions that are equivalent to a single
+  // conversion and the conversions that are undone by the following one.
+  // Two roundings are never folded into one.
+  //
+  [[nodiscard]] static ir::Value* combine_conversion(Combine_Context& ctx,
+                                                     ir::Instr* const cvt)
+  {
+    ir::Value* const value = get_converted_value(cvt);
+    if(!ir::instanceof<ir::Instr>(value)) {
+      return nullptr;
+    }
+
+    auto const inner = static_cast<ir::Instr*>(value);
+    bool widened = false;
+    switch(cvt->instr_kind) {
+    case ir::Instr_Kind::e_cvt_sext:
+      // A zero extended value has a clear sign bit.
+      widened = inner->instr_kind == ir::Instr_Kind::e_cvt_sext ||
+                inner->instr_kind == ir::Instr_Kind::e_cvt_zext;
+      break;
+
+    case ir::Instr_Kind::e_cvt_zext:
+      widened = inner->instr_kind == ir::Instr_Kind::e_cvt_zext;
+      break;
+
+    case ir::Instr_Kind::e_cvt_fpext:
+      if(inner->instr_kind == ir::Instr_Kind::e_cvt_fpext) {
+        widened = true;
+      } else if(inner->instr_kind == ir::Instr_Kind::e_cvt_si2fp ||
+                inner->instr_kind == ir::Instr_Kind::e_cvt_ui2fp) {
+        // The intermediate conversion must be exact.
+        ir::Type_Kind const source_kind =
+          get_scalar_kind(*get_converted_value(inner)->type);
+        ir::Type_Kind const intermediate_kind = get_scalar_kind(*inner->type);
+        widened = get_value_bits(source_kind) <=
+                  get_significand_bits(intermediate_kind);
+      }
+      break;
+
+    case ir::Instr_Kind::e_cvt_trunc:
+      if(inner->instr_kind == ir::Instr_Kind::e_cvt_sext ||
+         inner->instr_kind == ir::Instr_Kind::e_cvt_zext) {
+        ir::Value* const source = get_converted_value(inner);
+        if(ir::compare_types_equal(*source->type, *cvt->type)) {
+          return source;
+        }
+      }
+      return nullptr;
+
+    case ir::Instr_Kind::e_cvt_fptrunc:
+      if(inner->instr_kind == ir::Instr_Kind::e_cvt_fpext) {
+        ir::Value* const source = get_converted_value(inner);
+        if(ir::compare_types_equal(*source->type, *cvt->type)) {
+          return source;
+        }
+      }
+      return nullptr;
+
+    default:
+      return nullptr;
+    }
+
+    if(!widened) {
+      return nullptr;
+    }
+
+    // The inner conversion performed directly to the type of the outer one.
+    ir::Instr* const direct =
+      ir::clone_instruction(ctx.allocator, inner, ctx.module->next_id());
+    direct->type = cvt->type;
+    direct->source_info = cvt->source_info;
+    insert_combined(ctx, cvt, direct);
+    return direct;
+  }
+
+  // combine_getptr
+  // Fold a getptr of an address computed by another getptr into a single
+  // getptr with the indices of both.
+  //
+  [[nodiscard]] static ir::Value* combine_getptr(Combine_Context& ctx,
+                                                 ir::Instr_getptr* const getptr)
+  {
+    if(!ir::instanceof<ir::Instr_getptr>(getptr->address)) {
+      return nullptr;
+    }
+
+    auto const inner = static_cast<ir::Instr_getptr const*>(getptr->address);
+    if(!ir::compare_types_equal(*ir::get_indexed_type(inner),
+                                *getptr->addressed_type)) {
+      return nullptr;
+    }
+
+    Array<ir::Value*> indices(ctx.allocator);
+    indices.assign(inner->indices.begin(), inner->indices.end());
+    for(ir::Value* const index: getptr->indices) {
+      indices.push_back(index);
+    }
+    auto const merged = ir::make_instr_getptr(
+      ctx.allocator, ctx.module->next_id(), inner->addressed_type,
+      inner->address,
+      anton::Slice<ir::Value* const>(indices.data(),
+                                     indices.data() + indices.size()),
+      getptr->source_info);
+    insert_combined(ctx, getptr, merged);
+    return merged;
+  }
+
+  // combine
+  //
+  // Returns:
+  // The value replacing the instruction, the instruction itself if it has
+  // been modified or nullptr if it is unchanged.
+  //
+  [[nodiscard]] static ir::Value* combine(Combine_Context& ctx,
+                                          ir::Instr* const instr)
+  {
+    switch(instr->instr_kind) {
+    case ir::Instr_Kind::e_alu:
+      return combine_alu(static_cast<ir::Instr_ALU*>(instr));
+
+    case ir::Instr_Kind::e_vector_extract:
+      return combine_vector_extract(
+        ctx, static_cast<ir::Instr_vector_extract*>(instr));
+
+    case ir::Instr_Kind::e_composite_extract:
+      return combine_composite_extract(
+        ctx, static_cast<ir::Instr_composite_extract*>(instr));
+
+    case ir::Instr_Kind::e_composite_construct:
+      return combine_composite_construct(
+        static_cast<ir::Instr_composite_construct*>(instr));
+
+    case ir::Instr_Kind::e_select:
+      return combine_select(static_cast<ir::Instr_select*>(instr));
+
+    case ir::Instr_Kind::e_cvt_sext:
+    case ir::Instr_Kind::e_cvt_zext:
+    case ir::Instr_Kind::e_cvt_trunc:
+    case ir::Instr_Kind::e_cvt_fpext:
+    case ir::Instr_Kind::e_cvt_fptrunc:
+      return combine_conversion(ctx, instr);
+
+    case ir::Instr_Kind::e_getptr:
+      return combine_getptr(ctx, static_cast<ir::Instr_getptr*>(instr));
+
+    default:
+      return nullptr;
+    }
+  }
+
+  ir::Pass_Result run_opt_ir_instcombine(Allocator* const allocator,
+                                         ir::Function_Analyses& analyses)
+  {
+    ir::CFG const& cfg = analyses.get_cfg();
+    Combine_Context ctx(allocator, analyses.get_module());
+    for(ir::Basic_Block* const block: cfg.blocks) {
+      for(ir::Instr& instruction: block->instructions) {
+        enqueue(ctx, &instruction);
+      }
+    }
+
+    // The worklist grows while being processed. The users of a combined
+    // instruction are queued again as they might be combined further.
+    i64 changes = 0;
+    for(; ctx.current < ctx.worklist.size(); ctx.current += 1) {
+      ir::Instr* const instr = ctx.worklist[ctx.current];
+      if(ctx.replaced.find(instr) != ctx.replaced.end()) {
+        continue;
+      }
+
+      ir::Value* const replacement = combine(ctx, instr);
+      if(replacement == nullptr) {
+        continue;
+      }
+
+      changes += 1;
+      enqueue_users(ctx, instr);
+      if(replacement == instr) {
+        enqueue(ctx, instr);
+        continue;
+      }
+
+      ir::replace_uses_with(instr, replacement);
+      ctx.replaced.emplace(instr);
+      ctx.dead_instructions.push_back(instr);
+    }
+
+    // The replaced instructions might still use each other.
+    for(ir::Instr* const instruction: ctx.dead_instructions) {
+      ir::drop_operands(allocator, instruction);
+    }
+    for(ir::Instr* const instruction: ctx.dead_instructions) {
+      ir::erase_instruction(allocator, instruction);
+    }
+
+    // Only instructions are inserted and removed, the blocks and the branches
+    // between them are unchanged.
+    return ir::Pass_Result{
+      .changes = changes,
+      .preserved = {.cfg = true,
+                    .dominator_tree = true,
+                    .post_dominator_tree = true,
+                    .loop_info = true}};
+  }
+} // namespace vush
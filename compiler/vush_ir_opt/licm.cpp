@@ -0,0 +1,450 @@
+#include <vush_ir_opt/opts.hpp>
+
+#include <vush_core/memory.hpp>
+#include <vush_ir/analysis.hpp>
+
+namespace vush {
+  namespace {
+    // Loop_Memory
+    // The memory written within a loop.
+    //
+    // Members:
+    // store_bases - the bases of the addresses stored to.
+    //    has_call - whether the loop contains a call, which might write any
+    //               memory.
+    //
+    struct Loop_Memory {
+      Array<ir::Value const*> store_bases;
+      bool has_call = false;
+
+      Loop_Memory(Allocator* allocator): store_bases(allocator) {}
+    };
+  } // namespace
+
+  [[nodiscard]] static bool is_scf_branch_head(ir::Instr const& instruction)
+  {
+    return instruction.instr_kind == ir::Instr_Kind::e_intrinsic &&
+           static_cast<ir::Instr_intrinsic const&>(instruction)
+               .intrinsic_kind == ir::Intrinsic_Kind::e_scf_branch_head;
+  }
+
+  [[nodiscard]] static bool is_scf_loop_head(ir::Instr const& instruction)
+  {
+    return instruction.instr_kind == ir::Instr_Kind::e_intrinsic &&
+           static_cast<ir::Instr_intrinsic const&>(instruction)
+               .intrinsic_kind == ir::Intrinsic_Kind::e_scf_loop_head;
+  }
+
+  // find_preheader
+  //
+  // Returns:
+  // The number of the only block outside of the loop that branches to the
+  // header if the block branches unconditionally. -1 otherwise.
+  //
+  [[nodiscard]] static i64 find_preheader(ir::CFG const& cfg,
+                                          ir::Loop_Info const& loop_info,
+                                          ir::Loop const* const loop)
+  {
+    i64 preheader = -1;
+    for(i64 const predecessor: cfg.predecessors[loop->header]) {
+      if(loop_info.contains(loop, predecessor)) {
+        continue;
+      }
+
+      if(preheader != -1) {
+        return -1;
+      }
+      preheader = predecessor;
+    }
+
+    if(preheader == -1 || cfg.successors[preheader].size() != 1 ||
+       cfg.blocks[preheader]->get_last()->instr_kind !=
+         ir::Instr_Kind::e_branch) {
+      return -1;
+    }
+    return preheader;
+  }
+
+  // insert_preheader
+  // Create a block that branches to the header of the loop and redirect the
+  // edges entering the loop to it. The values the phis of the header receive
+  // from outside of the loop are merged in the new block.
+  //
+  static void insert_preheader(Allocator* const allocator,
+                               ir::Module* const module, ir::CFG const& cfg,
+                               ir::Loop_Info const& loop_info,
+                               ir::Loop const* const loop)
+  {
+    ir::Basic_Block* const header = cfg.blocks[loop->header];
+    auto const preheader =
+      VUSH_ALLOCATE(ir::Basic_Block, allocator, module->next_id());
+
+    Array<ir::Basic_Block*> entering(allocator);
+    for(i64 const predecessor: cfg.predecessors[loop->header]) {
+      if(!loop_info.contains(loop, predecessor)) {
+        entering.push_back(cfg.blocks[predecessor]);
+      }
+    }
+
+    for(ir::Instr& instruction: header->instructions) {
+      if(instruction.instr_kind != ir::Instr_Kind::e_phi) {
+        break;
+      }
+
+      auto const phi = static_cast<ir::Instr_phi*>(&instruction);
+      auto const merged = ir::make_instr_phi(allocator, module->next_id(),
+                                             phi->type, phi->source_info);
+      for(i64 i = phi->srcs.size() - 1; i >= 0; i -= 1) {
+        ir::Phi_Source const src = phi->srcs[i];
+        for(ir::Basic_Block* const block: entering) {
+          if(src.block == block) {
+            merged->add_source(src.value, src.block);
+            phi->remove_source(i);
+            break;
+          }
+        }
+      }
+
+      // A single entering edge does not need to be merged. The merged phi has
+      // never been inserted into a block, hence it is only destroyed.
+      if(merged->srcs.size() == 1) {
+        phi->add_source(merged->srcs[0].value, preheader);
+        ir::drop_operands(allocator, merged);
+        merged->~Instr_phi();
+        deallocate(allocator, merged);
+      } else {
+        preheader->insert(merged);
+        phi->add_source(merged, preheader);
+      }
+    }
+
+    for(ir::Basic_Block* const block: entering) {
+      ir::retarget_terminator(block->get_last(), header, preheader);
+    }
+
+    // A selection converging at the header or a loop merging at the header
+    // now converges at the preheader.
+    for(ir::Basic_Block* const block: cfg.blocks) {
+      for(ir::Instr& instruction: block->instructions) {
+        if(is_scf_branch_head(instruction)) {
+          auto& head = static_cast<ir::Intrinsic_scf_branch_head&>(instruction);
+          if(head.converge_block == header) {
+            head.converge_block = preheader;
+          }
+        }
+
+        if(is_scf_loop_head(instruction)) {
+          auto& head = static_cast<ir::Intrinsic_scf_loop_head&>(instruction);
+          if(head.merge_block == header) {
+            head.merge_block = preheader;
+          }
+        }
+      }
+    }
+
+    auto const branch =
+      ir::make_instr_branch(allocator, module->next_id(), header,
+                            header->get_first()->source_info);
+    preheader->insert(branch);
+  }
+
+  [[nodiscard]] static ir::Value const* get_base(ir::Value const* address)
+  {
+    while(ir::instanceof<ir::Instr_getptr>(address)) {
+      address = static_cast<ir::Instr_getptr const*>(address)->address;
+    }
+    return address;
+  }
+
+  // is_read_only
+  //
+  // Returns:
+  // Whether the memory may not be written by the shader.
+  //
+  [[nodiscard]] static bool is_read_only(ir::Value const* const base)
+  {
+    if(!ir::instanceof<ir::Argument>(base)) {
+      return false;
+    }
+
+    ir::Storage_Class const storage_class =
+      static_cast<ir::Argument const*>(base)->storage_class;
+    return storage_class == ir::Storage_Class::e_input ||
+           storage_class == ir::Storage_Class::e_uniform ||
+           storage_class == ir::Storage_Class::e_push_constant;
+  }
+
+  // may_alias
+  // Distinct allocations never alias each other or any other memory. The
+  // memory of the arguments, e.g. buffers, might be bound to the same
+  // resource.
+  //
+  [[nodiscard]] static bool may_alias(ir::Value const* const base1,
+                                      ir::Value const* const base2)
+  {
+    if(base1 == base2) {
+      return true;
+    }
+
+    return !ir::instanceof<ir::Instr_alloc>(base1) &&
+           !ir::instanceof<ir::Instr_alloc>(base2);
+  }
+
+  // has_constant_indices
+  //
+  // Returns:
+  // Whether the address is derived from its base with constant indices only,
+  // hence is always within the bounds of the base.
+  //
+  [[nodiscard]] static bool has_constant_indices(ir::Value const* address)
+  {
+    while(ir::instanceof<ir::Instr_getptr>(address)) {
+      auto const getptr = static_cast<ir::Instr_getptr const*>(address);
+      for(ir::Value const* const index: getptr->indices) {
+        if(!ir::instanceof<ir::Constant>(index)) {
+          return false;
+        }
+      }
+      address = getptr->address;
+    }
+    return true;
+  }
+
+  // is_speculatable
+  //
+  // Returns:
+  // Whether the instruction computes a value that depends only on its
+  // operands and cannot fault, hence may be executed even if the original
+  // program would not have executed it.
+  //
+  [[nodiscard]] static bool is_speculatable(ir::Instr const* const instr)
+  {
+    switch(instr->instr_kind) {
+    case ir::Instr_Kind::e_getptr:
+    case ir::Instr_Kind::e_vector_extract:
+    case ir::Instr_Kind::e_vector_insert:
+    case ir::Instr_Kind::e_composite_extract:
+    case ir::Instr_Kind::e_composite_construct:
+    case ir::Instr_Kind::e_cvt_sext:
+    case ir::Instr_Kind::e_cvt_zext:
+    case ir::Instr_Kind::e_cvt_trunc:
+    case ir::Instr_Kind::e_cvt_fpext:
+    case ir::Instr_Kind::e_cvt_fptrunc:
+    case ir::Instr_Kind::e_cvt_si2fp:
+    case ir::Instr_Kind::e_cvt_fp2si:
+    case ir::Instr_Kind::e_cvt_ui2fp:
+    case ir::Instr_Kind::e_cvt_fp2ui:
+    case ir::Instr_Kind::e_select:
+      return true;
+
+    case ir::Instr_Kind::e_alu: {
+      // The integer division is hoisted only when the divisor is a non-zero
+      // constant.
+      auto const alu = static_cast<ir::Instr_ALU const*>(instr);
+      if(alu->op != ir::ALU_Opcode::e_idiv &&
+         alu->op != ir::ALU_Opcode::e_udiv &&
+         alu->op != ir::ALU_Opcode::e_irem &&
+         alu->op != ir::ALU_Opcode::e_urem) {
+        return true;
+      }
+
+      if(ir::instanceof<ir::Constant_i32>(alu->src2)) {
+        return static_cast<ir::Constant_i32 const*>(alu->src2)->value != 0;
+      }
+
+      if(ir::instanceof<ir::Constant_u32>(alu->src2)) {
+        return static_cast<ir::Constant_u32 const*>(alu->src2)->value != 0;
+      }
+      return false;
+    }
+
+    case ir::Instr_Kind::e_ext_call:
+      // Only the math extensions. The texture extensions depend on the
+      // implicit derivatives.
+      return static_cast<ir::Instr_ext_call const*>(instr)->ext <=
+             ir::Ext_Kind::e_mat_inv;
+
+    default:
+      return false;
+    }
+  }
+
+  [[nodiscard]] static bool is_invariant(ir::CFG const& cfg,
+                                         ir::Loop_Info const& loop_info,
+                                         ir::Loop const* const loop,
+                                         ir::Instr const* const instr)
+  {
+    for(ir::Use const* use = instr->operands; use != nullptr;
+        use = use->next_operand) {
+      if(!ir::instanceof<ir::Instr>(use->value)) {
+        continue;
+      }
+
+      auto const operand = static_cast<ir::Instr const*>(use->value);
+      if(loop_info.contains(loop, cfg.get_index(operand->block))) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // can_hoist_load
+  // The load must not read memory written within the loop and must be
+  // executed whenever the loop is entered or read an address that is always
+  // valid.
+  //
+  [[nodiscard]] static bool can_hoist_load(Loop_Memory const& memory,
+                                           ir::Loop const* const loop,
+                                           i64 const block,
+                                           ir::Instr_load const* const load)
+  {
+    if(block != loop->header && !has_constant_indices(load->address)) {
+      return false;
+    }
+
+    ir::Value const* const base = get_base(load->address);
+    if(is_read_only(base)) {
+      return true;
+    }
+
+    if(memory.has_call) {
+      return false;
+    }
+
+    for(ir::Value const* const store_base: memory.store_bases) {
+      if(may_alias(store_base, base)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  static void collect_loop_memory(ir::CFG const& cfg,
+                                  ir::Loop const* const loop,
+                                  Loop_Memory& memory)
+  {
+    memory.store_bases.clear();
+    memory.has_call = false;
+    for(i64 const block: loop->blocks) {
+      for(ir::Instr const& instruction: cfg.blocks[block]->instructions) {
+        if(instruction.instr_kind == ir::Instr_Kind::e_store) {
+          auto const& store = static_cast<ir::Instr_store const&>(instruction);
+          memory.store_bases.push_back(get_base(store.dst));
+        } else if(instruction.instr_kind == ir::Instr_Kind::e_call) {
+          memory.has_call = true;
+        }
+      }
+    }
+  }
+
+  // hoist_loop
+  // Move the invariant instructions of the loop to its preheader. The blocks
+  // are visited in reverse postorder, hence the operands of an instruction are
+  // hoisted before the instruction itself.
+  //
+  // Returns:
+  // The number of hoisted instructions.
+  //
+  [[nodiscard]] static i64 hoist_loop(Allocator* const allocator,
+                                      ir::CFG const& cfg,
+                                      ir::Loop_Info const& loop_info,
+                                      ir::Loop const* const loop,
+                                      Loop_Memory& memory)
+  {
+    i64 const preheader_index = find_preheader(cfg, loop_info, loop);
+    if(preheader_index == -1) {
+      return 0;
+    }
+
+    ir::Basic_Block* const preheader = cfg.blocks[preheader_index];
+    collect_loop_memory(cfg, loop, memory);
+
+    i64 hoisted = 0;
+    Array<ir::Instr*> instructions(allocator);
+    for(i64 block = 0; block < cfg.size(); block += 1) {
+      if(!loop_info.contains(loop, block)) {
+        continue;
+      }
+
+      instructions.clear();
+      for(ir::Instr& instruction: cfg.blocks[block]->instructions) {
+        instructions.push_back(&instruction);
+      }
+
+      for(ir::Instr* const instr: instructions) {
+        bool hoistable = false;
+        if(instr->instr_kind == ir::Instr_Kind::e_load) {
+          hoistable = can_hoist_load(memory, loop, block,
+                                     static_cast<ir::Instr_load*>(instr));
+        } else {
+          hoistable = is_speculatable(instr);
+        }
+
+        if(!hoistable || !is_invariant(cfg, loop_info, loop, instr)) {
+          continue;
+        }
+
+        // Insert before the terminator of the preheader.
+        ir::Instr* const terminator = preheader->get_last();
+        anton::ilist_erase(terminator);
+        anton::ilist_erase(instr);
+        preheader->insert(instr);
+        preheader->insert(terminator);
+        hoisted += 1;
+      }
+    }
+    return hoisted;
+  }
+
+  ir::Pass_Result run_opt_ir_licm(Allocator* const allocator,
+                                  ir::Function_Analyses& analyses)
+  {
+    ir::Function* const function = analyses.get_function();
+    ir::CFG const* cfg = &analyses.get_cfg();
+    ir::Loop_Info const* loop_info = &analyses.get_loop_info();
+    if(loop_info->loops.size() == 0) {
+      return ir::Pass_Result{.changes = 0,
+                             .preserved = {.cfg = true,
+                                           .dominator_tree = true,
+                                           .post_dominator_tree = true,
+                                           .loop_info = true}};
+    }
+
+    // The loops whose header is the entry block cannot be given a preheader.
+    i64 inserted = 0;
+    for(ir::Loop const* const loop: loop_info->loops) {
+      if(loop->header != 0 &&
+         find_preheader(*cfg, *loop_info, loop) == -1) {
+        insert_preheader(allocator, analyses.get_module(), *cfg, *loop_info,
+                         loop);
+        inserted += 1;
+      }
+    }
+
+    if(inserted > 0) {
+      cfg = ir::build_cfg(allocator, function);
+      ir::Dominator_Tree const* const dominator_tree =
+        ir::build_dominator_tree(allocator, *cfg);
+      loop_info = ir::build_loop_info(allocator, *cfg, *dominator_tree);
+    }
+
+    // The nested loops precede the enclosing ones, hence the instructions
+    // hoisted out of a nested loop may be hoisted further.
+    i64 hoisted = 0;
+    Loop_Memory memory(allocator);
+    for(ir::Loop const* const loop: loop_info->loops) {
+      hoisted += hoist_loop(allocator, *cfg, *loop_info, loop, memory);
+    }
+
+    if(inserted > 0) {
+      return ir::Pass_Result{.changes = inserted + hoisted};
+    }
+
+    // Only instructions have been moved between existing blocks.
+    return ir::Pass_Result{.changes = hoisted,
+                           .preserved = {.cfg = true,
+                                         .dominator_tree = true,
+                                         .post_dominator_tree = true,
+                                         .loop_info = true}};
+  }
+} // namespace vush
@@ -0,0 +1,336 @@
+#include <vush_ir_opt/opts.hpp>
+
+#include <anton/flat_hash_map.hpp>
+#include <anton/flat_hash_set.hpp>
+
+#include <vush_core/memory.hpp>
+#include <vush_ir/types.hpp>
+
+// The SSA construction follows
+//   Cytron, Ferrante, Rosen, Wegman, Zadeck, "Efficiently Computing Static
+//   Single Assignment Form and the Control Dependence Graph".
+
+namespace vush {
+  namespace {
+    struct Promoted_Variable {
+      ir::Instr_alloc* alloc;
+      // The value of the variable before the first store. Created lazily.
+      ir::Constant_undef* undef = nullptr;
+    };
+
+    // Rename_Entry
+    // The value of a variable prior to its redefinition. Restored once the
+    // renaming leaves the dominator subtree of the redefinition.
+    //
+    struct Rename_Entry {
+      i64 variable;
+      ir::Value* value;
+    };
+
+    struct Mem2reg_Context {
+      Allocator* allocator;
+      ir::Module* module;
+      ir::CFG const& cfg;
+      ir::Dominator_Tree const& dominator_tree;
+
+      Array<Promoted_Variable> variables;
+      anton::Flat_Hash_Map<ir::Value const*, i64> variable_indices;
+      // The phis inserted by the pass mapped to their variables.
+      anton::Flat_Hash_Map<ir::Value const*, i64> phi_variables;
+      Array<ir::Instr_phi*> phis;
+      Array<ir::Value*> current_values;
+      Array<Rename_Entry> rename_log;
+      Array<ir::Instr*> dead_instructions;
+
+      Mem2reg_Context(Allocator* allocator, ir::Module* module,
+                      ir::CFG const& cfg,
+                      ir::Dominator_Tree const& dominator_tree)
+        : allocator(allocator), module(module), cfg(cfg),
+          dominator_tree(dominator_tree), variables(allocator),
+          variable_indices(allocator), phi_variables(allocator),
+          phis(allocator), current_values(allocator), rename_log(allocator),
+          dead_instructions(allocator)
+      {
+      }
+    };
+  } // namespace
+
+  [[nodiscard]] static bool is_promotable(Mem2reg_Context const& ctx,
+                                          ir::Instr_alloc const* const alloc)
+  {
+    ir::Type const& type = *alloc->alloc_type;
+    if(!ir::is_scalar_type(type) && type.kind != ir::Type_Kind::e_vec &&
+       type.kind != ir::Type_Kind::e_mat) {
+      return false;
+    }
+
+    // The address must be used exclusively as the address operand of loads
+    // and stores of the entire variable. Any other use lets it escape.
+    for(ir::Use const* const use: alloc->get_uses()) {
+      ir::Instr const* const instr = use->user;
+      // Instructions in unreachable blocks would not be renamed.
+      if(ctx.cfg.get_index(instr->block) == -1) {
+        return false;
+      }
+
+      if(instr->instr_kind == ir::Instr_Kind::e_load) {
+        auto const load = static_cast<ir::Instr_load const*>(instr);
+        if(!ir::compare_types_equal(*load->type, type)) {
+          return false;
+        }
+      } else if(instr->instr_kind == ir::Instr_Kind::e_store) {
+        auto const store = static_cast<ir::Instr_store const*>(instr);
+        if(store->dst != alloc || store->src == alloc ||
+           !ir::compare_types_equal(*store->src->type, type)) {
+          return false;
+        }
+      } else {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  static void collect_variables(Mem2reg_Context& ctx)
+  {
+    for(ir::Basic_Block* const block: ctx.cfg.blocks) {
+      for(ir::Instr& instruction: block->instructions) {
+        if(instruction.instr_kind != ir::Instr_Kind::e_alloc) {
+          continue;
+        }
+
+        auto const alloc = static_cast<ir::Instr_alloc*>(&instruction);
+        if(is_promotable(ctx, alloc)) {
+          ctx.variable_indices.emplace(alloc, ctx.variables.size());
+          ctx.variables.push_back(Promoted_Variable{.alloc = alloc});
+          ctx.current_values.push_back(nullptr);
+        }
+      }
+    }
+  }
+
+  static void insert_phis(Mem2reg_Context& ctx)
+  {
+    // The variable that has last placed a phi in, or queued, the block.
+    Array<i64> phi_placed(ctx.allocator);
+    Array<i64> queued(ctx.allocator);
+    for(i64 i = 0; i < ctx.cfg.size(); i += 1) {
+      phi_placed.push_back(-1);
+      queued.push_back(-1);
+    }
+
+    Array<i64> worklist(ctx.allocator);
+    for(i64 v = 0; v < ctx.variables.size(); v += 1) {
+      ir::Instr_alloc* const alloc = ctx.variables[v].alloc;
+      worklist.clear();
+      for(ir::Use const* const use: alloc->get_uses()) {
+        ir::Instr const* const instr = use->user;
+        if(instr->instr_kind != ir::Instr_Kind::e_store) {
+          continue;
+        }
+
+        i64 const b = ctx.cfg.get_index(instr->block);
+        if(queued[b] != v) {
+          queued[b] = v;
+          worklist.push_back(b);
+        }
+      }
+
+      // The worklist grows while being processed.
+      for(i64 i = 0; i < worklist.size(); i += 1) {
+        for(i64 const f: ctx.dominator_tree.frontiers[worklist[i]]) {
+          // The entry block has no predecessor to source the initial value
+          // from. Structured control flow never branches back to it.
+          if(f == 0 || phi_placed[f] == v) {
+            continue;
+          }
+
+          phi_placed[f] = v;
+          ir::Basic_Block* const block = ctx.cfg.blocks[f];
+          auto const phi =
+            ir::make_instr_phi(ctx.allocator, ctx.module->next_id(),
+                               alloc->alloc_type, alloc->source_info);
+          block->instructions.insert_front(*phi);
+          phi->block = block;
+          ctx.phi_variables.emplace(phi, v);
+          ctx.phis.push_back(phi);
+          if(queued[f] != v) {
+            queued[f] = v;
+            worklist.push_back(f);
+          }
+        }
+      }
+    }
+  }
+
+  [[nodiscard]] static ir::Value* get_current_value(Mem2reg_Context& ctx,
+                                                    i64 const variable)
+  {
+    if(ctx.current_values[variable] != nullptr) {
+      return ctx.current_values[variable];
+    }
+
+    // The variable is read before it has been written.
+    Promoted_Variable& promoted = ctx.variables[variable];
+    if(promoted.undef == nullptr) {
+      promoted.undef =
+        ir::make_constant_undef(ctx.allocator, promoted.alloc->alloc_type);
+    }
+    return promoted.undef;
+  }
+
+  static void set_current_value(Mem2reg_Context& ctx, i64 const variable,
+                                ir::Value* const value)
+  {
+    ctx.rename_log.push_back(
+      Rename_Entry{variable, ctx.current_values[variable]});
+    ctx.current_values[variable] = value;
+  }
+
+  static void rename_block(Mem2reg_Context& ctx, i64 const index)
+  {
+    i64 const log_size = ctx.rename_log.size();
+    ir::Basic_Block* const block = ctx.cfg.blocks[index];
+    for(ir::Instr& instruction: block->instructions) {
+      switch(instruction.instr_kind) {
+      case ir::Instr_Kind::e_phi: {
+        auto const iterator = ctx.phi_variables.find(&instruction);
+        if(iterator != ctx.phi_variables.end()) {
+          set_current_value(ctx, iterator->value, &instruction);
+        }
+      } break;
+
+      case ir::Instr_Kind::e_load: {
+        auto const load = static_cast<ir::Instr_load*>(&instruction);
+        auto const iterator = ctx.variable_indices.find(load->address);
+        if(iterator != ctx.variable_indices.end()) {
+          ir::replace_uses_with(load, get_current_value(ctx, iterator->value));
+          ctx.dead_instructions.push_back(load);
+        }
+      } break;
+
+      case ir::Instr_Kind::e_store: {
+        auto const store = static_cast<ir::Instr_store*>(&instruction);
+        auto const iterator = ctx.variable_indices.find(store->dst);
+        if(iterator != ctx.variable_indices.end()) {
+          set_current_value(ctx, iterator->value, store->src);
+          ctx.dead_instructions.push_back(store);
+        }
+      } break;
+
+      default:
+        break;
+      }
+    }
+
+    for(i64 const successor: ctx.cfg.successors[index]) {
+      // Phis are always placed at the start of the block.
+      for(ir::Instr& instruction: ctx.cfg.blocks[successor]->instructions) {
+        if(instruction.instr_kind != ir::Instr_Kind::e_phi) {
+          break;
+        }
+
+        auto const iterator = ctx.phi_variables.find(&instruction);
+        if(iterator != ctx.phi_variables.end()) {
+          auto const phi = static_cast<ir::Instr_phi*>(&instruction);
+          phi->add_source(get_current_value(ctx, iterator->value), block);
+        }
+      }
+    }
+
+    for(i64 const child: ctx.dominator_tree.children[index]) {
+      rename_block(ctx, child);
+    }
+
+    while(ctx.rename_log.size() > log_size) {
+      Rename_Entry const& entry = ctx.rename_log.back();
+      ctx.current_values[entry.variable] = entry.value;
+      ctx.rename_log.pop_back();
+    }
+  }
+
+  // remove_dead_phis
+  // Remove the inserted phis that are not live. The phis are not pruned
+  // during the insertion, hence variables that are dead at a join point
+  // leave behind phis used only by other inserted phis, e.g. the cycles
+  // formed by the phis of loops. A phi is live when it is used by an
+  // instruction other than an inserted phi or by a live phi.
+  //
+  static void remove_dead_phis(Mem2reg_Context& ctx)
+  {
+    anton::Flat_Hash_Set<ir::Value const*> live(ctx.allocator);
+    Array<ir::Instr_phi*> worklist(ctx.allocator);
+    for(ir::Instr_phi* const phi: ctx.phis) {
+      for(ir::Use const* const use: phi->get_uses()) {
+        if(ctx.phi_variables.find(use->user) == ctx.phi_variables.end()) {
+          live.emplace(phi);
+          worklist.push_back(phi);
+          break;
+        }
+      }
+    }
+
+    // The worklist grows while being processed. A phi is added only when it
+    // is marked live, therefore each phi is added at most once.
+    for(i64 i = 0; i < worklist.size(); i += 1) {
+      ir::Instr_phi* const phi = worklist[i];
+      for(ir::Use* use = phi->operands; use != nullptr;
+          use = use->next_operand) {
+        ir::Value* const src = use->value;
+        if(ctx.phi_variables.find(src) != ctx.phi_variables.end() &&
+           live.find(src) == live.end()) {
+          live.emplace(src);
+          worklist.push_back(static_cast<ir::Instr_phi*>(src));
+        }
+      }
+    }
+
+    // The dead phis may use each other, hence the operands of all of them are
+    // dropped before any is erased.
+    Array<ir::Instr_phi*> dead(ctx.allocator);
+    for(ir::Instr_phi* const phi: ctx.phis) {
+      if(live.find(phi) == live.end()) {
+        ir::drop_operands(ctx.allocator, phi);
+        dead.push_back(phi);
+      }
+    }
+
+    for(ir::Instr_phi* const phi: dead) {
+      ir::erase_instruction(ctx.allocator, phi);
+    }
+  }
+
+  ir::Pass_Result run_opt_ir_mem2reg(Allocator* const allocator,
+                                     ir::Function_Analyses& analyses)
+  {
+    Mem2reg_Context ctx(allocator, analyses.get_module(), analyses.get_cfg(),
+                        analyses.get_dominator_tree());
+    collect_variables(ctx);
+    if(ctx.variables.size() == 0) {
+      return ir::Pass_Result{};
+    }
+
+    insert_phis(ctx);
+    rename_block(ctx, 0);
+
+    // The uses of the loads have been replaced. The allocs are used only by
+    // the loads and stores and are removed last.
+    for(ir::Instr* const instruction: ctx.dead_instructions) {
+      ir::erase_instruction(allocator, instruction);
+    }
+
+    for(Promoted_Variable const& variable: ctx.variables) {
+      ir::erase_instruction(allocator, variable.alloc);
+    }
+
+    remove_dead_phis(ctx);
+    // Only instructions are inserted and removed, the blocks and the branches
+    // between them are unchanged.
+    return ir::Pass_Result{
+      .changes = ctx.variables.size(),
+      .preserved = {.cfg = true,
+                    .dominator_tree = true,
+                    .post_dominator_tree = true,
+                    .loop_info = true}};
+  }
+} // namespace vush
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <vush_ir/ir.hpp>
+#include <vush_ir_opt/pass_manager.hpp>
+
+namespace vush {
+  // run_opt_ir_inline
+  // Inline the calls whose callees are small enough according to the cost
+  // model, are marked @inline or are called only once. The callees marked
+  // @noinline and the recursive calls are never inlined. The callees are
+  // processed before their callers, hence the bodies being inlined have
+  // already had their own calls inlined.
+  //
+  // Returns:
+  // The number of inlined calls. No analyses are preserved.
+  //
+  ir::Pass_Result run_opt_ir_inline(Allocator* allocator,
+                                    ir::Module_Analyses& analyses);
+
+  // run_opt_ir_flatten
+  // Inline all calls into the stage entry except for those to the callees
+  // marked @noinline and the recursive calls.
+  //
+  // Returns:
+  // The number of inlined calls. No analyses are preserved.
+  //
+  ir::Pass_Result run_opt_ir_flatten(Allocator* allocator,
+                                     ir::Module_Analyses& analyses);
+
+  // run_opt_ir_sroa
+  // Scalar replacement of aggregates. Splits the stack allocations of struct
+  // and sized array type whose address does not escape into an allocation
+  // per element. The address may only be indexed with constants and the
+  // aggregate loaded and stored as a whole. Nested aggregates are split
+  // recursively. The resulting allocations are then promoted by mem2reg.
+  //
+  // Returns:
+  // The number of split allocations. The control flow analyses are
+  // preserved.
+  //
+  ir::Pass_Result run_opt_ir_sroa(Allocator* allocator,
+                                  ir::Function_Analyses& analyses);
+
+  // run_opt_ir_mem2reg
+  // Promote the stack allocations of scalar, vector and matrix type whose
+  // address does not escape to SSA values. Loads are replaced with the
+  // reaching stored values and phis are inserted at the iterated dominance
+  // frontiers of the stores.
+  //
+  // Returns:
+  // The number of promoted allocations. The control flow analyses are
+  // preserved.
+  //
+  ir::Pass_Result run_opt_ir_mem2reg(Allocator* allocator,
+                                     ir::Function_Analyses& analyses);
+
+  // run_opt_ir_sccp
+  // Sparse conditional constant propagation. Replaces the values that are
+  // constant along all executable paths with constants, folds the branches
+  // on constant conditions and empties the blocks that become unreachable.
+  // Scalar arithmetic, conversions, extractions from constant composites and
+  // the pure math extensions are evaluated.
+  //
+  // Returns:
+  // The number of replaced values, folded branches and removed blocks. The
+  // control flow analyses are preserved only if no branch has been folded.
+  //
+  ir::Pass_Result run_opt_ir_sccp(Allocator* allocator,
+                                  ir::Function_Analyses& analyses);
+
+  // run_opt_ir_instcombine
+  // Combine instructions into simpler equivalents. Constant operands of
+  // commutative operations are moved to the right, identities such as
+  // x * 1.0 and x + 0 and pairs of negations are folded. Extractions look
+  // through the insertions and constructions they read from, chains of
+  // extractions, getptrs and widening conversions are merged, and composites
+  // reconstructed from all their elements are replaced with the originals.
+  //
+  // Returns:
+  // The number of combined instructions. The control flow analyses are
+  // preserved.
+  //
+  ir::Pass_Result run_opt_ir_instcombine(Allocator* allocator,
+                                         ir::Function_Analyses& analyses);
+
+  // run_opt_ir_simplify_cfg
+  // Simplify the control flow graph. Conditional branches and switches on
+  // constants or with a single distinct target are replaced with
+  // unconditional branches, blocks consisting of only an unconditional branch
+  // are bypassed and blocks are merged into their only predecessor when it
+  // branches to them unconditionally. The converge blocks of the selection
+  // headers and the merge and continue blocks of the loop headers are kept so
+  // that the structured control flow remains valid. The heads of the loops
+  // that no longer have a back edge are removed.
+  //
+  // Returns:
+  // The number of simplifications. The control flow analyses are preserved
+  // only if nothing has been simplified.
+  //
+  ir::Pass_Result run_opt_ir_simplify_cfg(Allocator* allocator,
+                                          ir::Function_Analyses& analyses);
+
+  // run_opt_ir_gvn
+  // Global value numbering. Replaces the instructions that compute the same
+  // value as a dominating instruction with that instruction. Loads are
+  // replaced only if the memory has not been written in between.
+  //
+  // Returns:
+  // The number of replaced instructions. The control flow analyses are
+  // preserved.
+  //
+  ir::Pass_Result run_opt_ir_gvn(Allocator* allocator,
+                                 ir::Function_Analyses& analyses);
+
+  // run_opt_ir_slp_vectorise
+  // Superword level parallelism vectorisation. Replaces the trees of
+  // isomorphic scalar ALU instructions whose results are combined into a
+  // vector by a composite construct with vector ALU instructions. The
+  // extracts of the elements of a vector in order are replaced with the
+  // vector itself and the remaining operands are gathered into vectors. A
+  // tree is vectorised only if fewer instructions remain.
+  //
+  // Returns:
+  // The number of vectorised trees. The control flow analyses are preserved.
+  //
+  ir::Pass_Result run_opt_ir_slp_vectorise(Allocator* allocator,
+                                           ir::Function_Analyses& analyses);
+
+  // run_opt_ir_if_convert
+  // If-conversion. Replaces the selections whose arms are short and consist
+  // of instructions without side effects that cannot fault with the
+  // unconditional execution of both arms followed by selects of the values
+  // flowing into the phis of the converge block. Both the if statements and
+  // the phis of the short-circuiting && and || are converted.
+  //
+  // Returns:
+  // The number of converted selections. The control flow analyses are
+  // preserved only if nothing has been converted.
+  //
+  ir::Pass_Result run_opt_ir_if_convert(Allocator* allocator,
+                                        ir::Function_Analyses& analyses);
+
+  // run_opt_ir_licm
+  // Loop invariant code motion. Hoists the instructions whose operands are
+  // defined outside of a loop into the preheader of the loop, which is
+  // created when missing. Only the instructions that cannot fault are
+  // hoisted. Loads are hoisted only if no store or call within the loop may
+  // write the memory they read.
+  //
+  // Returns:
+  // The number of hoisted instructions and inserted preheaders. The control
+  // flow analyses are preserved only if no preheader has been inserted.
+  //
+  ir::Pass_Result run_opt_ir_licm(Allocator* allocator,
+                                  ir::Function_Analyses& analyses);
+
+  // run_opt_ir_strength_reduce
+  // Replace the 32 bit integer multiplications, divisions and remainders by
+  // constants with cheaper sequences of shifts, additions and high-half
+  // multiplications. The multiplications of loop induction variables by
+  // constants are replaced with induction variables of their own.
+  //
+  // Returns:
+  // The number of reduced instructions. The control flow analyses are
+  // preserved.
+  //
+  ir::Pass_Result run_opt_ir_strength_reduce(Allocator* allocator,
+                                             ir::Function_Analyses& analyses);
+
+  // run_opt_ir_unroll
+  // Unroll the loops whose trip count is a compile-time constant. A loop is
+  // fully unrolled when its unrolled size is small enough according to the
+  // cost model or the loop is marked @unroll. Otherwise it is partially
+  // unrolled by a factor that divides the trip count. @unroll(N) unrolls by
+  // at most N iterations. When N does not divide the trip count, the
+  // remaining iterations are peeled in front of the loop. The loops marked
+  // @nounroll are never unrolled.
+  // Only the loops that are left through the exit test of their header and
+  // have a single latch are considered.
+  //
+  // Returns:
+  // The number of unrolled loops. No analyses are preserved.
+  //
+  ir::Pass_Result run_opt_ir_unroll(Allocator* allocator,
+                                    ir::Function_Analyses& analyses);
+
+  // run_opt_ir_dse
+  // Remove the stores to allocations that are overwritten before being read
+  // and those that are not read before the function is left. Only the stores
+  // within a block are considered.
+  //
+  // Returns:
+  // The number of removed stores. The control flow analyses are preserved.
+  //
+  ir::Pass_Result run_opt_ir_dse(Allocator* allocator,
+                                 ir::Function_Analyses& analyses);
+
+  // run_opt_ir_dce
+  // Remove the instructions that do not contribute to the effects of the
+  // function. The instructions with effects are the stores to memory other
+  // than allocations, calls, control flow and intrinsics. All other
+  // instructions, including the stores to allocations, are live only if an
+  // instruction with effects depends on them.
+  //
+  // Returns:
+  // The number of removed instructions. The control flow analyses are
+  // preserved.
+  //
+  ir::Pass_Result run_opt_ir_dce(Allocator* allocator,
+                                 ir::Function_Analyses& analyses);
+} // namespace vush
@@ -0,0 +1,281 @@
+#include <vush_ir_opt/pass_manager.hpp>
+
+#include <chrono>
+
+#include <vush_core/memory.hpp>
+#include <vush_ir/ir.hpp>
+#include <vush_ir_opt/opts.hpp>
+
+namespace vush::ir {
+  using namespace anton::literals;
+
+  Function_Analyses::Function_Analyses(Allocator* allocator, Module* module,
+                                       Function* function)
+    : allocator(allocator), module(module), function(function)
+  {
+  }
+
+  Module* Function_Analyses::get_module()
+  {
+    return module;
+  }
+
+  Function* Function_Analyses::get_function()
+  {
+    return function;
+  }
+
+  CFG const& Function_Analyses::get_cfg()
+  {
+    if(cfg == nullptr) {
+      cfg = build_cfg(allocator, function);
+    }
+    return *cfg;
+  }
+
+  Dominator_Tree const& Function_Analyses::get_dominator_tree()
+  {
+    if(dominator_tree == nullptr) {
+      dominator_tree = build_dominator_tree(allocator, get_cfg());
+    }
+    return *dominator_tree;
+  }
+
+  Post_Dominator_Tree const& Function_Analyses::get_post_dominator_tree()
+  {
+    if(post_dominator_tree == nullptr) {
+      post_dominator_tree = build_post_dominator_tree(allocator, get_cfg());
+    }
+    return *post_dominator_tree;
+  }
+
+  Loop_Info const& Function_Analyses::get_loop_info()
+  {
+    if(loop_info == nullptr) {
+      loop_info = build_loop_info(allocator, get_cfg(), get_dominator_tree());
+    }
+    return *loop_info;
+  }
+
+  void Function_Analyses::invalidate(Preserved_Analyses const& preserved)
+  {
+    if(!preserved.cfg && cfg != nullptr) {
+      deallocate_cfg(allocator, cfg);
+      cfg = nullptr;
+    }
+
+    if(!preserved.dominator_tree && dominator_tree != nullptr) {
+      deallocate_dominator_tree(allocator, dominator_tree);
+      dominator_tree = nullptr;
+    }
+
+    if(!preserved.post_dominator_tree && post_dominator_tree != nullptr) {
+      deallocate_post_dominator_tree(allocator, post_dominator_tree);
+      post_dominator_tree = nullptr;
+    }
+
+    if(!preserved.loop_info && loop_info != nullptr) {
+      deallocate_loop_info(allocator, loop_info);
+      loop_info = nullptr;
+    }
+  }
+
+  Module_Analyses::Module_Analyses(Allocator* allocator, Module* module)
+    : allocator(allocator), module(module), functions(allocator),
+      listed_generations(allocator), function_analyses(allocator),
+      all_function_analyses(allocator)
+  {
+  }
+
+  Module* Module_Analyses::get_module()
+  {
+    return module;
+  }
+
+  Array<Function*> const& Module_Analyses::get_functions()
+  {
+    if(functions.size() > 0) {
+      return functions;
+    }
+
+    generation += 1;
+    functions.push_back(module->entry);
+    listed_generations.emplace(module->entry, generation);
+    // The list grows while being walked.
+    for(i64 i = 0; i < functions.size(); i += 1) {
+      CFG const& cfg = get_function_analyses(functions[i]).get_cfg();
+      for(Basic_Block* const block: cfg.blocks) {
+        for(Instr& instruction: block->instructions) {
+          if(instruction.instr_kind != Instr_Kind::e_call) {
+            continue;
+          }
+
+          Function* const callee =
+            static_cast<Instr_call*>(&instruction)->function;
+          auto const listed = listed_generations.find(callee);
+          if(listed == listed_generations.end()) {
+            listed_generations.emplace(callee, generation);
+            functions.push_back(callee);
+          } else if(listed->value != generation) {
+            listed->value = generation;
+            functions.push_back(callee);
+          }
+        }
+      }
+    }
+    return functions;
+  }
+
+  Function_Analyses&
+  Module_Analyses::get_function_analyses(Function* const function)
+  {
+    auto iterator = function_analyses.find(function);
+    if(iterator == function_analyses.end()) {
+      auto const analyses =
+        VUSH_ALLOCATE(Function_Analyses, allocator, allocator, module,
+                      function);
+      iterator = function_analyses.emplace(function, analyses);
+      all_function_analyses.push_back(analyses);
+    }
+    return *iterator->value;
+  }
+
+  void Module_Analyses::invalidate(Preserved_Analyses const& preserved)
+  {
+    for(Function_Analyses* const analyses: all_function_analyses) {
+      analyses->invalidate(preserved);
+    }
+    functions.clear();
+  }
+
+  [[nodiscard]] static i64 get_time_ns()
+  {
+    auto const now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+  }
+
+  Pass_Manager::Pass_Manager(Allocator* allocator)
+    : passes(allocator), statistics(allocator)
+  {
+  }
+
+  void Pass_Manager::add_function_pass(anton::String_View const name,
+                                       function_pass_fn const pass)
+  {
+    passes.push_back(Pass{.name = name, .function_pass = pass});
+    statistics.push_back(Pass_Statistics{.pass_name = name});
+  }
+
+  void Pass_Manager::add_module_pass(anton::String_View const name,
+                                     module_pass_fn const pass)
+  {
+    passes.push_back(Pass{.name = name, .module_pass = pass});
+    statistics.push_back(Pass_Statistics{.pass_name = name});
+  }
+
+  void Pass_Manager::run(Recycling_Allocator* const module_allocator,
+                         Module* const module)
+  {
+    Module_Analyses analyses(module_allocator, module);
+    for(i64 i = 0; i < passes.size(); i += 1) {
+      Pass const& pass = passes[i];
+      Pass_Statistics& stats = statistics[i];
+      i64 const start = get_time_ns();
+      if(pass.function_pass != nullptr) {
+        for(Function* const function: analyses.get_functions()) {
+          Function_Analyses& function_analyses =
+            analyses.get_function_analyses(function);
+          Pass_Result const result =
+            pass.function_pass(module_allocator, function_analyses);
+          stats.changes += result.changes;
+          if(result.changes > 0) {
+            function_analyses.invalidate(result.preserved);
+          }
+          module_allocator->recycle();
+        }
+      } else {
+        Pass_Result const result =
+          pass.module_pass(module_allocator, analyses);
+        stats.changes += result.changes;
+        if(result.changes > 0) {
+          analyses.invalidate(result.preserved);
+        }
+        module_allocator->recycle();
+      }
+      stats.time_ns += get_time_ns() - start;
+    }
+  }
+
+  void Pass_Manager::append_statistics(Array<Pass_Statistics>& output) const
+  {
+    for(Pass_Statistics const& stats: statistics) {
+      output.push_back(stats);
+    }
+  }
+
+  void build_pipeline(Pass_Manager& pass_manager,
+                      Optimisation_Level const level, bool const flatten)
+  {
+    // The IR is lowered unchanged at o0.
+    if(level == Optimisation_Level::o0) {
+      return;
+    }
+
+    if(flatten) {
+      pass_manager.add_module_pass("flatten"_sv, run_opt_ir_flatten);
+    }
+
+    switch(level) {
+    case Optimisation_Level::o0:
+      break;
+
+    case Optimisation_Level::o1:
+    case Optimisation_Level::o2:
+      pass_manager.add_function_pass("sroa"_sv, run_opt_ir_sroa);
+      pass_manager.add_function_pass("mem2reg"_sv, run_opt_ir_mem2reg);
+      pass_manager.add_function_pass("sccp"_sv, run_opt_ir_sccp);
+      pass_manager.add_function_pass("simplifycfg"_sv,
+                                     run_opt_ir_simplify_cfg);
+      if(level == Optimisation_Level::o2 && !flatten) {
+        // The callees have been simplified by the preceding passes, hence
+        // their sizes are representative. The constants passed to the
+        // inlined callees are then propagated through their bodies.
+        // The aggregates passed by value to the inlined callees are copied
+        // into allocations that are split and promoted anew.
+        pass_manager.add_module_pass("inline"_sv, run_opt_ir_inline);
+        pass_manager.add_function_pass("sroa"_sv, run_opt_ir_sroa);
+        pass_manager.add_function_pass("mem2reg"_sv, run_opt_ir_mem2reg);
+        pass_manager.add_function_pass("sccp"_sv, run_opt_ir_sccp);
+      }
+      if(level == Optimisation_Level::o2) {
+        // The induction variables of the unrolled iterations are constants
+        // which are then propagated through the copies of the body.
+        pass_manager.add_function_pass("unroll"_sv, run_opt_ir_unroll);
+        pass_manager.add_function_pass("sccp"_sv, run_opt_ir_sccp);
+      }
+      pass_manager.add_function_pass("instcombine"_sv,
+                                     run_opt_ir_instcombine);
+      pass_manager.add_function_pass("gvn"_sv, run_opt_ir_gvn);
+      if(level == Optimisation_Level::o2) {
+        // The equal lanes have been merged by gvn and are splatted.
+        pass_manager.add_function_pass("slp"_sv, run_opt_ir_slp_vectorise);
+      }
+      // The arms have been simplified by the preceding passes, hence their
+      // costs are representative.
+      pass_manager.add_function_pass("ifconvert"_sv, run_opt_ir_if_convert);
+      if(level == Optimisation_Level::o2) {
+        pass_manager.add_function_pass("licm"_sv, run_opt_ir_licm);
+      }
+      // The arithmetic is reduced once the combiner and gvn have exposed the
+      // constant operands. The induction variables left dead by the reduction
+      // of their multiplications are removed by dce.
+      pass_manager.add_function_pass("strengthreduce"_sv,
+                                     run_opt_ir_strength_reduce);
+      pass_manager.add_function_pass("dse"_sv, run_opt_ir_dse);
+      pass_manager.add_function_pass("dce"_sv, run_opt_ir_dce);
+      pass_manager.add_function_pass("simplifycfg"_sv,
+                                     run_opt_ir_simplify_cfg);
+      break;
+    }
+  }
+} // namespace vush::ir
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <anton/flat_hash_map.hpp>
+#include <anton/string_view.hpp>
+
+#include <vush.hpp>
+#include <vush_core/recycling_allocator.hpp>
+#include <vush_ir/analysis.hpp>
+#include <vush_ir/fwd.hpp>
+
+namespace vush::ir {
+  // Preserved_Analyses
+  // The analyses that remain valid after a pass has changed the IR. The use
+  // lists are maintained by the IR itself and are always valid.
+  //
+  struct Preserved_Analyses {
+    bool cfg = false;
+    bool dominator_tree = false;
+    bool post_dominator_tree = false;
+    bool loop_info = false;
+  };
+
+  // Function_Analyses
+  // The cache of the analyses of a function. An analysis is computed on the
+  // first request and remains cached until it is invalidated.
+  //
+  struct Function_Analyses {
+  private:
+    Allocator* allocator;
+    Module* module;
+    Function* function;
+    CFG* cfg = nullptr;
+    Dominator_Tree* dominator_tree = nullptr;
+    Post_Dominator_Tree* post_dominator_tree = nullptr;
+    Loop_Info* loop_info = nullptr;
+
+  public:
+    Function_Analyses(Allocator* allocator, Module* module, Function* function);
+
+    // get_module
+    //
+    // Returns:
+    // The module containing the function. New ids must be allocated from it.
+    //
+    [[nodiscard]] Module* get_module();
+    [[nodiscard]] Function* get_function();
+    [[nodiscard]] CFG const& get_cfg();
+    [[nodiscard]] Dominator_Tree const& get_dominator_tree();
+    [[nodiscard]] Post_Dominator_Tree const& get_post_dominator_tree();
+    [[nodiscard]] Loop_Info const& get_loop_info();
+
+    // invalidate
+    // Deallocate the cached analyses that have not been preserved.
+    //
+    void invalidate(Preserved_Analyses const& preserved);
+  };
+
+  // Module_Analyses
+  // The cache of the analyses of the functions of a module.
+  //
+  struct Module_Analyses {
+  private:
+    Allocator* allocator;
+    Module* module;
+    // The functions reachable from the entry of the module through calls in
+    // the order of discovery. The entry is always the first one. Empty when
+    // not computed.
+    Array<Function*> functions;
+    // The generation of the list of the functions in which each function has
+    // last been listed. A function is in the list when its generation is the
+    // current one, hence the list is rebuilt without clearing the table.
+    anton::Flat_Hash_Map<Function const*, i64> listed_generations;
+    i64 generation = 0;
+    anton::Flat_Hash_Map<Function const*, Function_Analyses*>
+      function_analyses;
+    // All entries of function_analyses.
+    Array<Function_Analyses*> all_function_analyses;
+
+  public:
+    Module_Analyses(Allocator* allocator, Module* module);
+
+    [[nodiscard]] Module* get_module();
+    [[nodiscard]] Array<Function*> const& get_functions();
+    [[nodiscard]] Function_Analyses& get_function_analyses(Function* function);
+
+    // invalidate
+    // Drop the cached analyses of all functions that have not been preserved.
+    // The list of the functions is always recomputed as a module pass might
+    // have added or removed calls.
+    //
+    void invalidate(Preserved_Analyses const& preserved);
+  };
+
+  // Pass_Result
+  //
+  // Members:
+  //   changes - The number of changes made by the pass. Zero implies that
+  //             the IR has not been modified and all analyses are preserved.
+  // preserved - The analyses that remain valid after the changes.
+  //
+  struct Pass_Result {
+    i64 changes = 0;
+    Preserved_Analyses preserved;
+  };
+
+  using function_pass_fn = Pass_Result (*)(Allocator* allocator,
+                                           Function_Analyses& analyses);
+  using module_pass_fn = Pass_Result (*)(Allocator* allocator,
+                                         Module_Analyses& analyses);
+
+  // Pass_Manager
+  // Runs a pipeline of function and module passes over IR modules. The
+  // function passes are run on every function of a module before the next
+  // pass is started. The statistics of each pass are accumulated over all
+  // modules the pipeline has been run on.
+  //
+  struct Pass_Manager {
+  private:
+    struct Pass {
+      anton::String_View name;
+      function_pass_fn function_pass = nullptr;
+      module_pass_fn module_pass = nullptr;
+    };
+
+    Array<Pass> passes;
+    Array<Pass_Statistics> statistics;
+
+  public:
+    Pass_Manager(Allocator* allocator);
+
+    // The names of the passes must be static strings.
+    void add_function_pass(anton::String_View name, function_pass_fn pass);
+    void add_module_pass(anton::String_View name, module_pass_fn pass);
+
+    // run
+    // Run the pipeline on the module. The analyses and the nodes created by the
+    // passes are allocated from module_allocator, which is expected to own the
+    // module. The memory deallocated by a pass, e.g. the erased instructions,
+    // is recycled once the pass has finished.
+    //
+    void run(Recycling_Allocator* module_allocator, Module* module);
+
+    // append_statistics
+    // Append the statistics of the passes in the order of the pipeline.
+    //
+    void append_statistics(Array<Pass_Statistics>& statistics) const;
+  };
+
+  // build_pipeline
+  // Add the passes of the optimisation level to the pass manager. No passes
+  // run at o0. When flattening at the other levels, all calls are inlined
+  // before any other pass runs.
+  //
+  void build_pipeline(Pass_Manager& pass_manager, Optimisation_Level level,
+                      bool flatten);
+} // namespace vush::ir
@@ -0,0 +1,1233 @@
+#include <vush_ir_opt/opts.hpp>
+
+#include <cmath>
+
+#include <anton/flat_hash_map.hpp>
+
+#include <vush_core/memory.hpp>
+#include <vush_ir/ext.hpp>
+#include <vush_ir/opcodes.hpp>
+#include <vush_ir/types.hpp>
+
+// The propagation follows
+//   Wegman, Zadeck, "Constant Propagation with Conditional Branches".
+
+namespace vush {
+  namespace {
+    enum struct Lattice_Kind : u8 {
+      e_unknown,
+      e_constant,
+      e_overdefined,
+    };
+
+    // Lattice_Value
+    //
+    // Members:
+    // constant - the scalar constant or, for composites whose elements are all
+    //            constant, the composite_construct instruction building them.
+    //
+    struct Lattice_Value {
+      Lattice_Kind kind = Lattice_Kind::e_unknown;
+      ir::Value* constant = nullptr;
+    };
+
+    struct SCCP_Context {
+      Allocator* allocator;
+      ir::CFG const& cfg;
+      Array<bool> executable_blocks;
+      // The executable flags of the edges parallel to the successors of the
+      // CFG.
+      Array<Array<bool>> executable_edges;
+      anton::Flat_Hash_Map<ir::Value const*, Lattice_Value> lattice;
+      Array<i64> block_worklist;
+      Array<ir::Instr*> instr_worklist;
+
+      SCCP_Context(Allocator* allocator, ir::CFG const& cfg)
+        : allocator(allocator), cfg(cfg), executable_blocks(allocator),
+          executable_edges(allocator), lattice(allocator),
+          block_worklist(allocator), instr_worklist(allocator)
+      {
+        for(i64 i = 0; i < cfg.size(); i += 1) {
+          executable_blocks.push_back(false);
+          executable_edges.push_back(Array<bool>(allocator));
+          for(i64 j = 0; j < cfg.successors[i].size(); j += 1) {
+            executable_edges[i].push_back(false);
+          }
+        }
+      }
+    };
+  } // namespace
+
+  [[nodiscard]] static Lattice_Value make_overdefined()
+  {
+    return Lattice_Value{.kind = Lattice_Kind::e_overdefined};
+  }
+
+  [[nodiscard]] static Lattice_Value
+  make_lattice_constant(ir::Value* const value)
+  {
+    return Lattice_Value{.kind = Lattice_Kind::e_constant, .constant = value};
+  }
+
+  [[nodiscard]] static Lattice_Value get_lattice(SCCP_Context const& ctx,
+                                                 ir::Value* const value)
+  {
+    switch(value->value_kind) {
+    case ir::Value_Kind::e_const:
+      // undef may take a different value at each use, therefore it is not
+      // a constant.
+      if(ir::instanceof<ir::Constant_undef>(value)) {
+        return make_overdefined();
+      } else {
+        return make_lattice_constant(value);
+      }
+
+    case ir::Value_Kind::e_argument:
+      return make_overdefined();
+
+    case ir::Value_Kind::e_instr: {
+      auto const iterator = ctx.lattice.find(value);
+      if(iterator != ctx.lattice.end()) {
+        return iterator->value;
+      } else {
+        return Lattice_Value{};
+      }
+    }
+    }
+  }
+
+  [[nodiscard]] static bool compare_lattice_constants(ir::Value const* const v1,
+                                                      ir::Value const* const v2)
+  {
+    // Composites are equal only if they are built by the same instruction.
+    if(v1 == v2) {
+      return true;
+    }
+
+    if(!ir::instanceof<ir::Constant>(v1) || !ir::instanceof<ir::Constant>(v2)) {
+      return false;
+    }
+
+    return ir::compare_constants_equal(*static_cast<ir::Constant const*>(v1),
+                                       *static_cast<ir::Constant const*>(v2));
+  }
+
+  [[nodiscard]] static Lattice_Value meet(Lattice_Value const& v1,
+                                          Lattice_Value const& v2)
+  {
+    if(v1.kind == Lattice_Kind::e_unknown) {
+      return v2;
+    }
+
+    if(v2.kind == Lattice_Kind::e_unknown) {
+      return v1;
+    }
+
+    if(v1.kind == Lattice_Kind::e_constant &&
+       v2.kind == Lattice_Kind::e_constant &&
+       compare_lattice_constants(v1.constant, v2.constant)) {
+      return v1;
+    }
+
+    return make_overdefined();
+  }
+
+  static void update_lattice(SCCP_Context& ctx, ir::Instr* const instr,
+                             Lattice_Value const& value)
+  {
+    Lattice_Value const previous = get_lattice(ctx, instr);
+    Lattice_Value const next = meet(previous, value);
+    if(next.kind == previous.kind &&
+       (next.kind != Lattice_Kind::e_constant ||
+        compare_lattice_constants(next.constant, previous.constant))) {
+      return;
+    }
+
+    auto const iterator = ctx.lattice.find(instr);
+    if(iterator != ctx.lattice.end()) {
+      iterator->value = next;
+    } else {
+      ctx.lattice.emplace(instr, next);
+    }
+
+    for(ir::Use const* const use: instr->get_uses()) {
+      ctx.instr_worklist.push_back(use->user);
+    }
+  }
+
+  // get_scalar_constant
+  //
+  // Returns:
+  // The scalar constant of the lattice value or nullptr if the value is not
+  // a scalar constant.
+  //
+  [[nodiscard]] static ir::Constant*
+  get_scalar_constant(Lattice_Value const& value)
+  {
+    if(value.kind != Lattice_Kind::e_constant ||
+       !ir::instanceof<ir::Constant>(value.constant)) {
+      return nullptr;
+    }
+
+    return static_cast<ir::Constant*>(value.constant);
+  }
+
+  [[nodiscard]] static bool is_int_constant(ir::Constant const* const constant)
+  {
+    return constant->constant_kind == ir::Constant_Kind::e_constant_i32 ||
+           constant->constant_kind == ir::Constant_Kind::e_constant_u32;
+  }
+
+  [[nodiscard]] static u32 get_int_bits(ir::Constant const* const constant)
+  {
+    if(constant->constant_kind == ir::Constant_Kind::e_constant_i32) {
+      return static_cast<u32>(
+        static_cast<ir::Constant_i32 const*>(constant)->value);
+    } else {
+      return static_cast<ir::Constant_u32 const*>(constant)->value;
+    }
+  }
+
+  // make_int_constant
+  //
+  // Returns:
+  // The constant of the type with the given bits or nullptr if the type has
+  // no constants.
+  //
+  [[nodiscard]] static ir::Constant*
+  make_int_constant(Allocator* const allocator, ir::Type const& type,
+                    u32 const bits)
+  {
+    switch(type.kind) {
+    case ir::Type_Kind::e_int32:
+      return ir::make_constant_i32(allocator, static_cast<i32>(bits));
+    case ir::Type_Kind::e_uint32:
+      return ir::make_constant_u32(allocator, bits);
+    default:
+      return nullptr;
+    }
+  }
+
+  [[nodiscard]] static ir::Constant*
+  make_fp_constant(Allocator* const allocator, f32 const value)
+  {
+    return ir::make_constant_f32(allocator, value);
+  }
+
+  [[nodiscard]] static ir::Constant*
+  make_fp_constant(Allocator* const allocator, f64 const value)
+  {
+    return ir::make_constant_f64(allocator, value);
+  }
+
+  template<typename T>
+  [[nodiscard]] static T get_fp_value(ir::Constant const* const constant)
+  {
+    if(constant->constant_kind == ir::Constant_Kind::e_constant_f32) {
+      return static_cast<ir::Constant_f32 const*>(constant)->value;
+    } else {
+      return static_cast<ir::Constant_f64 const*>(constant)->value;
+    }
+  }
+
+  [[nodiscard]] static ir::Constant* fold_alu_bool(Allocator* const allocator,
+                                                   ir::ALU_Opcode const op,
+                                                   bool const a, bool const b)
+  {
+    switch(op) {
+    case ir::ALU_Opcode::e_inv:
+      return ir::make_constant_bool(allocator, !a);
+    case ir::ALU_Opcode::e_and:
+      return ir::make_constant_bool(allocator, a && b);
+    case ir::ALU_Opcode::e_or:
+      return ir::make_constant_bool(allocator, a || b);
+    case ir::ALU_Opcode::e_xor:
+    case ir::ALU_Opcode::e_icmp_neq:
+      return ir::make_constant_bool(allocator, a != b);
+    case ir::ALU_Opcode::e_icmp_eq:
+      return ir::make_constant_bool(allocator, a == b);
+    default:
+      return nullptr;
+    }
+  }
+
+  [[nodiscard]] static ir::Constant*
+  fold_alu_int(Allocator* const allocator, ir::Instr_ALU const* const instr,
+               u32 const a, u32 const b)
+  {
+    i32 const sa = static_cast<i32>(a);
+    i32 const sb = static_cast<i32>(b);
+    // The signed division overflows on the minimum value divided by -1.
+    bool const division_defined =
+      b != 0 && (a != 0x80000000u || b != 0xFFFFFFFFu);
+    ir::Type const& type = *instr->type;
+    switch(instr->op) {
+    case ir::ALU_Opcode::e_inv:
+      return make_int_constant(allocator, type, ~a);
+    case ir::ALU_Opcode::e_and:
+      return make_int_constant(allocator, type, a & b);
+    case ir::ALU_Opcode::e_or:
+      return make_int_constant(allocator, type, a | b);
+    case ir::ALU_Opcode::e_xor:
+      return make_int_constant(allocator, type, a ^ b);
+    case ir::ALU_Opcode::e_shl:
+      if(b >= 32) {
+        return nullptr;
+      }
+      return make_int_constant(allocator, type, a << b);
+    case ir::ALU_Opcode::e_shr:
+      // The shift of signed integers is arithmetic in the source language,
+      // but is lowered as a logical one. Leave them for the backend.
+      if(b >= 32 || ir::is_signed_int_type(type)) {
+        return nullptr;
+      }
+      return make_int_constant(allocator, type, a >> b);
+    case ir::ALU_Opcode::e_ashr:
+      if(b >= 32) {
+        return nullptr;
+      }
+      return make_int_constant(allocator, type, static_cast<u32>(sa >> b));
+    case ir::ALU_Opcode::e_neg:
+      return make_int_constant(allocator, type, 0u - a);
+    case ir::ALU_Opcode::e_iadd:
+    case ir::ALU_Opcode::e_uadd:
+      return make_int_constant(allocator, type, a + b);
+    case ir::ALU_Opcode::e_imul:
+    case ir::ALU_Opcode::e_umul:
+      return make_int_constant(allocator, type, a * b);
+    case ir::ALU_Opcode::e_imulhi:
+      return make_int_constant(
+        allocator, type,
+        static_cast<u32>(static_cast<u64>(static_cast<i64>(sa) * sb) >> 32));
+    case ir::ALU_Opcode::e_umulhi:
+      return make_int_constant(allocator, type,
+                               static_cast<u32>(static_cast<u64>(a) * b >> 32));
+    case ir::ALU_Opcode::e_idiv:
+      if(!division_defined) {
+        return nullptr;
+      }
+      return make_int_constant(allocator, type, static_cast<u32>(sa / sb));
+    case ir::ALU_Opcode::e_irem:
+      if(!division_defined) {
+        return nullptr;
+      }
+      return make_int_constant(allocator, type, static_cast<u32>(sa % sb));
+    case ir::ALU_Opcode::e_udiv:
+      if(b == 0) {
+        return nullptr;
+      }
+      return make_int_constant(allocator, type, a / b);
+    case ir::ALU_Opcode::e_urem:
+      if(b == 0) {
+        return nullptr;
+      }
+      return make_int_constant(allocator, type, a % b);
+    case ir::ALU_Opcode::e_icmp_eq:
+      return ir::make_constant_bool(allocator, a == b);
+    case ir::ALU_Opcode::e_icmp_neq:
+      return ir::make_constant_bool(allocator, a != b);
+    case ir::ALU_Opcode::e_icmp_ugt:
+      return ir::make_constant_bool(allocator, a > b);
+    case ir::ALU_Opcode::e_icmp_ult:
+      return ir::make_constant_bool(allocator, a < b);
+    case ir::ALU_Opcode::e_icmp_uge:
+      return ir::make_constant_bool(allocator, a >= b);
+    case ir::ALU_Opcode::e_icmp_ule:
+      return ir::make_constant_bool(allocator, a <= b);
+    case ir::ALU_Opcode::e_icmp_sgt:
+      return ir::make_constant_bool(allocator, sa > sb);
+    case ir::ALU_Opcode::e_icmp_slt:
+      return ir::make_constant_bool(allocator, sa < sb);
+    case ir::ALU_Opcode::e_icmp_sge:
+      return ir::make_constant_bool(allocator, sa >= sb);
+    case ir::ALU_Opcode::e_icmp_sle:
+      return ir::make_constant_bool(allocator, sa <= sb);
+    default:
+      return nullptr;
+    }
+  }
+
+  // fold_alu_fp
+  // The arithmetic of the host is IEEE 754 binary32 and binary64 with
+  // round-to-nearest-even, which is what SPIR-V requires of the basic
+  // operations. The comparisons are ordered, i.e. false for NaNs.
+  //
+  template<typename T>
+  [[nodiscard]] static ir::Constant* fold_alu_fp(Allocator* const allocator,
+                                                 ir::ALU_Opcode const op,
+                                                 T const a, T const b)
+  {
+    switch(op) {
+    case ir::ALU_Opcode::e_fneg:
+      return make_fp_constant(allocator, static_cast<T>(-a));
+    case ir::ALU_Opcode::e_fadd:
+      return make_fp_constant(allocator, static_cast<T>(a + b));
+    case ir::ALU_Opcode::e_fmul:
+      return make_fp_constant(allocator, static_cast<T>(a * b));
+    case ir::ALU_Opcode::e_fdiv:
+      return make_fp_constant(allocator, static_cast<T>(a / b));
+    case ir::ALU_Opcode::e_fcmp_eq:
+      return ir::make_constant_bool(allocator, a == b);
+    case ir::ALU_Opcode::e_fcmp_neq:
+      return ir::make_constant_bool(allocator, a < b || a > b);
+    case ir::ALU_Opcode::e_fcmp_gt:
+      return ir::make_constant_bool(allocator, a > b);
+    case ir::ALU_Opcode::e_fcmp_lt:
+      return ir::make_constant_bool(allocator, a < b);
+    case ir::ALU_Opcode::e_fcmp_ge:
+      return ir::make_constant_bool(allocator, a >= b);
+    case ir::ALU_Opcode::e_fcmp_le:
+      return ir::make_constant_bool(allocator, a <= b);
+    default:
+      return nullptr;
+    }
+  }
+
+  [[nodiscard]] static bool is_unary(ir::ALU_Opcode const op)
+  {
+    return op == ir::ALU_Opcode::e_inv || op == ir::ALU_Opcode::e_neg ||
+           op == ir::ALU_Opcode::e_fneg;
+  }
+
+  [[nodiscard]] static Lattice_Value evaluate_alu(SCCP_Context const& ctx,
+                                                  ir::Instr_ALU* const instr)
+  {
+    bool const unary = is_unary(instr->op);
+    Lattice_Value const v1 = get_lattice(ctx, instr->src1);
+    Lattice_Value const v2 = unary ? v1 : get_lattice(ctx, instr->src2);
+    if(v1.kind == Lattice_Kind::e_overdefined ||
+       v2.kind == Lattice_Kind::e_overdefined) {
+      return make_overdefined();
+    }
+
+    if(v1.kind == Lattice_Kind::e_unknown ||
+       v2.kind == Lattice_Kind::e_unknown) {
+      return Lattice_Value{};
+    }
+
+    // Vector operations are not folded.
+    ir::Constant const* const a = get_scalar_constant(v1);
+    ir::Constant const* const b = get_scalar_constant(v2);
+    if(a == nullptr || b == nullptr ||
+       a->constant_kind != b->constant_kind) {
+      return make_overdefined();
+    }
+
+    ir::Constant* result = nullptr;
+    switch(a->constant_kind) {
+    case ir::Constant_Kind::e_constant_bool:
+      result = fold_alu_bool(ctx.allocator, instr->op,
+                             static_cast<ir::Constant_bool const*>(a)->value,
+                             static_cast<ir::Constant_bool const*>(b)->value);
+      break;
+    case ir::Constant_Kind::e_constant_i32:
+    case ir::Constant_Kind::e_constant_u32:
+      result =
+        fold_alu_int(ctx.allocator, instr, get_int_bits(a), get_int_bits(b));
+      break;
+    case ir::Constant_Kind::e_constant_f32:
+      result = fold_alu_fp(ctx.allocator, instr->op, get_fp_value<f32>(a),
+                           get_fp_value<f32>(b));
+      break;
+    case ir::Constant_Kind::e_constant_f64:
+      result = fold_alu_fp(ctx.allocator, instr->op, get_fp_value<f64>(a),
+                           get_fp_value<f64>(b));
+      break;
+    case ir::Constant_Kind::e_undef:
+      break;
+    }
+
+    if(result != nullptr) {
+      return make_lattice_constant(result);
+    } else {
+      return make_overdefined();
+    }
+  }
+
+  [[nodiscard]] static ir::Constant*
+  fold_fp_to_int(Allocator* const allocator, ir::Type const& type,
+                 f64 const value)
+  {
+    // The conversions of NaNs and out of range values are undefined.
+    if(type.kind == ir::Type_Kind::e_int32) {
+      if(!(value > -2147483649.0 && value < 2147483648.0)) {
+        return nullptr;
+      }
+      return ir::make_constant_i32(allocator, static_cast<i32>(value));
+    } else if(type.kind == ir::Type_Kind::e_uint32) {
+      if(!(value > -1.0 && value < 4294967296.0)) {
+        return nullptr;
+      }
+      return ir::make_constant_u32(allocator, static_cast<u32>(value));
+    } else {
+      return nullptr;
+    }
+  }
+
+  [[nodiscard]] static ir::Constant* fold_int_to_fp(Allocator* const allocator,
+                                                    ir::Type const& type,
+                                                    i64 const value)
+  {
+    // The conversions round to nearest even.
+    if(type.kind == ir::Type_Kind::e_fp32) {
+      return ir::make_constant_f32(allocator, static_cast<f32>(value));
+    } else if(type.kind == ir::Type_Kind::e_fp64) {
+      return ir::make_constant_f64(allocator, static_cast<f64>(value));
+    } else {
+      return nullptr;
+    }
+  }
+
+  [[nodiscard]] static ir::Constant* fold_cvt(Allocator* const allocator,
+                                              ir::Instr const* const instr,
+                                              ir::Constant const* const value)
+  {
+    ir::Type const& type = *instr->type;
+    bool const is_int = is_int_constant(value);
+    bool const is_fp =
+      value->constant_kind == ir::Constant_Kind::e_constant_f32 ||
+      value->constant_kind == ir::Constant_Kind::e_constant_f64;
+    switch(instr->instr_kind) {
+    case ir::Instr_Kind::e_cvt_sext:
+    case ir::Instr_Kind::e_cvt_zext:
+    case ir::Instr_Kind::e_cvt_trunc:
+      // Only 32 bit integers have constants, hence the bits do not change.
+      if(!is_int) {
+        return nullptr;
+      }
+      return make_int_constant(allocator, type, get_int_bits(value));
+    case ir::Instr_Kind::e_cvt_fpext:
+      if(value->constant_kind != ir::Constant_Kind::e_constant_f32 ||
+         type.kind != ir::Type_Kind::e_fp64) {
+        return nullptr;
+      }
+      return ir::make_constant_f64(allocator, get_fp_value<f64>(value));
+    case ir::Instr_Kind::e_cvt_fptrunc:
+      if(value->constant_kind != ir::Constant_Kind::e_constant_f64 ||
+         type.kind != ir::Type_Kind::e_fp32) {
+        return nullptr;
+      }
+      return ir::make_constant_f32(
+        allocator, static_cast<f32>(get_fp_value<f64>(value)));
+    case ir::Instr_Kind::e_cvt_si2fp:
+      if(!is_int) {
+        return nullptr;
+      }
+      return fold_int_to_fp(allocator, type,
+                            static_cast<i32>(get_int_bits(value)));
+    case ir::Instr_Kind::e_cvt_ui2fp:
+      if(!is_int) {
+        return nullptr;
+      }
+      return fold_int_to_fp(allocator, type, get_int_bits(value));
+    case ir::Instr_Kind::e_cvt_fp2si:
+    case ir::Instr_Kind::e_cvt_fp2ui:
+      if(!is_fp) {
+        return nullptr;
+      }
+      return fold_fp_to_int(allocator, type, get_fp_value<f64>(value));
+    default:
+      return nullptr;
+    }
+  }
+
+  // evaluate_ext_fp
+  // Only the operations that are exact or correctly rounded are evaluated,
+  // hence the folded results do not depend on the host library and are
+  // within the precision required by GLSL.std.450. The transcendental
+  // functions and the operations defined by formulas, e.g. mix or
+  // smoothstep, are left to the device. This is the policy of the
+  // evaluation of the builtin functions in sema as well. Operations whose
+  // result is undefined for the arguments are not evaluated.
+  //
+  // Returns:
+  // Whether the extension has been evaluated.
+  //
+  template<typename T>
+  [[nodiscard]] static bool evaluate_ext_fp(ir::Ext_Kind const ext,
+                                            T const* const args, T& result)
+  {
+    switch(ext) {
+    case ir::Ext_Kind::e_round_even:
+      result = std::nearbyint(args[0]);
+      return true;
+    case ir::Ext_Kind::e_trunc:
+      result = std::trunc(args[0]);
+      return true;
+    case ir::Ext_Kind::e_fabs:
+      result = std::fabs(args[0]);
+      return true;
+    case ir::Ext_Kind::e_fsign:
+      result = static_cast<T>((args[0] > 0) - (args[0] < 0));
+      return true;
+    case ir::Ext_Kind::e_floor:
+      result = std::floor(args[0]);
+      return true;
+    case ir::Ext_Kind::e_ceil:
+      result = std::ceil(args[0]);
+      return true;
+    case ir::Ext_Kind::e_fmin:
+      result = std::fmin(args[0], args[1]);
+      return true;
+    case ir::Ext_Kind::e_fmax:
+      result = std::fmax(args[0], args[1]);
+      return true;
+    case ir::Ext_Kind::e_fclamp:
+      if(args[1] > args[2]) {
+        return false;
+      }
+      result = std::fmin(std::fmax(args[0], args[1]), args[2]);
+      return true;
+    case ir::Ext_Kind::e_step:
+      result = args[1] < args[0] ? static_cast<T>(0) : static_cast<T>(1);
+      return true;
+    case ir::Ext_Kind::e_fma:
+      result = std::fma(args[0], args[1], args[2]);
+      return true;
+    case ir::Ext_Kind::e_sqrt:
+      if(args[0] < 0) {
+        return false;
+      }
+      result = std::sqrt(args[0]);
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  [[nodiscard]] static bool evaluate_ext_int(ir::Ext_Kind const ext,
+                                             u32 const* const args,
+                                             u32& result)
+  {
+    auto const s = [args](i64 const index) {
+      return static_cast<i32>(args[index]);
+    };
+    switch(ext) {
+    case ir::Ext_Kind::e_iabs:
+      // The absolute value of the minimum value wraps around to itself.
+      result = s(0) < 0 ? 0u - args[0] : args[0];
+      return true;
+    case ir::Ext_Kind::e_isign:
+      result = static_cast<u32>((s(0) > 0) - (s(0) < 0));
+      return true;
+    case ir::Ext_Kind::e_imin:
+      result = s(0) < s(1) ? args[0] : args[1];
+      return true;
+    case ir::Ext_Kind::e_umin:
+      result = args[0] < args[1] ? args[0] : args[1];
+      return true;
+    case ir::Ext_Kind::e_imax:
+      result = s(0) > s(1) ? args[0] : args[1];
+      return true;
+    case ir::Ext_Kind::e_umax:
+      result = args[0] > args[1] ? args[0] : args[1];
+      return true;
+    case ir::Ext_Kind::e_iclamp:
+      if(s(1) > s(2)) {
+        return false;
+      }
+      result = s(0) < s(1) ? args[1] : (s(0) > s(2) ? args[2] : args[0]);
+      return true;
+    case ir::Ext_Kind::e_uclamp:
+      if(args[1] > args[2]) {
+        return false;
+      }
+      result = args[0] < args[1] ? args[1]
+                                 : (args[0] > args[2] ? args[2] : args[0]);
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  // The largest number of arguments of a foldable extension.
+  constexpr i64 max_ext_args = 3;
+
+  template<typename T>
+  [[nodiscard]] static ir::Constant*
+  fold_ext_fp(Allocator* const allocator, ir::Instr_ext_call const* const instr,
+              ir::Constant const* const* const constants)
+  {
+    T args[max_ext_args] = {};
+    for(i64 i = 0; i < instr->args.size(); i += 1) {
+      if(constants[i]->constant_kind != constants[0]->constant_kind) {
+        return nullptr;
+      }
+
+      args[i] = get_fp_value<T>(constants[i]);
+      // Infinities and NaNs make most of the operations undefined.
+      if(!std::isfinite(args[i])) {
+        return nullptr;
+      }
+    }
+
+    T result = 0;
+    if(!evaluate_ext_fp(instr->ext, args, result) || !std::isfinite(result)) {
+      return nullptr;
+    }
+    return make_fp_constant(allocator, result);
+  }
+
+  [[nodiscard]] static ir::Constant*
+  fold_ext(Allocator* const allocator, ir::Instr_ext_call const* const instr,
+           ir::Constant const* const* const constants)
+  {
+    ir::Type const& type = *instr->type;
+    if(type.kind == ir::Type_Kind::e_fp32) {
+      if(constants[0]->constant_kind != ir::Constant_Kind::e_constant_f32) {
+        return nullptr;
+      }
+      return fold_ext_fp<f32>(allocator, instr, constants);
+    } else if(type.kind == ir::Type_Kind::e_fp64) {
+      if(constants[0]->constant_kind != ir::Constant_Kind::e_constant_f64) {
+        return nullptr;
+      }
+      return fold_ext_fp<f64>(allocator, instr, constants);
+    } else {
+      u32 args[max_ext_args] = {};
+      for(i64 i = 0; i < instr->args.size(); i += 1) {
+        if(!is_int_constant(constants[i])) {
+          return nullptr;
+        }
+        args[i] = get_int_bits(constants[i]);
+      }
+
+      u32 result = 0;
+      if(!evaluate_ext_int(instr->ext, args, result)) {
+        return nullptr;
+      }
+      return make_int_constant(allocator, type, result);
+    }
+  }
+
+  [[nodiscard]] static Lattice_Value
+  evaluate_ext_call(SCCP_Context const& ctx,
+                    ir::Instr_ext_call* const instr)
+  {
+    if(instr->args.size() == 0 || instr->args.size() > max_ext_args) {
+      return make_overdefined();
+    }
+
+    ir::Constant const* constants[max_ext_args] = {};
+    bool unknown = false;
+    for(i64 i = 0; i < instr->args.size(); i += 1) {
+      Lattice_Value const value = get_lattice(ctx, instr->args[i]);
+      if(value.kind == Lattice_Kind::e_overdefined) {
+        return make_overdefined();
+      }
+
+      if(value.kind == Lattice_Kind::e_unknown) {
+        unknown = true;
+        continue;
+      }
+
+      // Vector arguments are not folded.
+      constants[i] = get_scalar_constant(value);
+      if(constants[i] == nullptr) {
+        return make_overdefined();
+      }
+    }
+
+    if(unknown) {
+      return Lattice_Value{};
+    }
+
+    ir::Constant* const result = fold_ext(ctx.allocator, instr, constants);
+    if(result != nullptr) {
+      return make_lattice_constant(result);
+    } else {
+      return make_overdefined();
+    }
+  }
+
+  // evaluate_extract
+  // Follow the indices through the constant composites.
+  //
+  [[nodiscard]] static Lattice_Value
+  evaluate_extract(SCCP_Context const& ctx, ir::Value* const composite,
+                   anton::Slice<i64 const> const indices)
+  {
+    Lattice_Value value = get_lattice(ctx, composite);
+    for(i64 const index: indices) {
+      if(value.kind != Lattice_Kind::e_constant) {
+        return value;
+      }
+
+      if(!ir::instanceof<ir::Instr_composite_construct>(value.constant)) {
+        return make_overdefined();
+      }
+
+      auto const construct =
+        static_cast<ir::Instr_composite_construct*>(value.constant);
+      value = get_lattice(ctx, construct->elements[index]);
+    }
+    return value;
+  }
+
+  [[nodiscard]] static Lattice_Value
+  evaluate_composite_construct(SCCP_Context const& ctx,
+                               ir::Instr_composite_construct* const instr)
+  {
+    Lattice_Value result = make_lattice_constant(instr);
+    for(ir::Value* const element: instr->elements) {
+      Lattice_Value const value = get_lattice(ctx, element);
+      if(value.kind == Lattice_Kind::e_overdefined) {
+        return make_overdefined();
+      }
+
+      if(value.kind == Lattice_Kind::e_unknown) {
+        result = Lattice_Value{};
+      }
+    }
+    return result;
+  }
+
+  [[nodiscard]] static bool is_edge_executable(SCCP_Context const& ctx,
+                                               i64 const from, i64 const to)
+  {
+    Array<i64> const& successors = ctx.cfg.successors[from];
+    for(i64 i = 0; i < successors.size(); i += 1) {
+      if(successors[i] == to) {
+        return ctx.executable_edges[from][i];
+      }
+    }
+    return false;
+  }
+
+  [[nodiscard]] static Lattice_Value evaluate_phi(SCCP_Context const& ctx,
+                                                  ir::Instr_phi* const phi)
+  {
+    i64 const block = ctx.cfg.get_index(phi->block);
+    Lattice_Value result;
+    for(ir::Phi_Source const& src: phi->srcs) {
+      i64 const predecessor = ctx.cfg.get_index(src.block);
+      if(predecessor != -1 && is_edge_executable(ctx, predecessor, block)) {
+        result = meet(result, get_lattice(ctx, src.value));
+      }
+    }
+    return result;
+  }
+
+  // evaluate_select
+  // A select on a known condition is the chosen value. Otherwise it is
+  // constant only if both values are the same constant.
+  //
+  [[nodiscard]] static Lattice_Value
+  evaluate_select(SCCP_Context const& ctx, ir::Instr_select* const select)
+  {
+    Lattice_Value const condition = get_lattice(ctx, select->condition);
+    if(condition.kind == Lattice_Kind::e_unknown) {
+      return Lattice_Value{};
+    }
+
+    ir::Constant const* const constant = get_scalar_constant(condition);
+    if(constant != nullptr &&
+       constant->constant_kind == ir::Constant_Kind::e_constant_bool) {
+      if(static_cast<ir::Constant_bool const*>(constant)->value) {
+        return get_lattice(ctx, select->then_value);
+      } else {
+        return get_lattice(ctx, select->else_value);
+      }
+    }
+
+    return meet(get_lattice(ctx, select->then_value),
+                get_lattice(ctx, select->else_value));
+  }
+
+  static void mark_edge_executable(SCCP_Context& ctx, i64 const from,
+                                   ir::Basic_Block const* const target)
+  {
+    i64 const to = ctx.cfg.get_index(target);
+    Array<i64> const& successors = ctx.cfg.successors[from];
+    for(i64 i = 0; i < successors.size(); i += 1) {
+      if(successors[i] != to || ctx.executable_edges[from][i]) {
+        continue;
+      }
+
+      ctx.executable_edges[from][i] = true;
+      if(!ctx.executable_blocks[to]) {
+        ctx.executable_blocks[to] = true;
+        ctx.block_worklist.push_back(to);
+      } else {
+        // The phis of an already visited block gain a new source.
+        for(ir::Instr& instruction: ctx.cfg.blocks[to]->instructions) {
+          if(instruction.instr_kind != ir::Instr_Kind::e_phi) {
+            break;
+          }
+          ctx.instr_worklist.push_back(&instruction);
+        }
+      }
+    }
+  }
+
+  // get_switch_target
+  //
+  // Returns:
+  // The target of the switch taken for the selector.
+  //
+  [[nodiscard]] static ir::Basic_Block*
+  get_switch_target(ir::Instr_switch const* const instr,
+                    ir::Constant const* const selector)
+  {
+    i64 value = get_int_bits(selector);
+    if(selector->constant_kind == ir::Constant_Kind::e_constant_i32) {
+      value = static_cast<i32>(get_int_bits(selector));
+    }
+
+    for(ir::Switch_Label const& label: instr->labels) {
+      if(label.value == value) {
+        return label.target;
+      }
+    }
+    return instr->default_label;
+  }
+
+  // get_taken_target
+  //
+  // Returns:
+  // The only target of the conditional branch or switch that may be taken or
+  // nullptr if the condition is not a constant.
+  //
+  [[nodiscard]] static ir::Basic_Block*
+  get_taken_target(SCCP_Context const& ctx, ir::Instr* const instr)
+  {
+    if(instr->instr_kind == ir::Instr_Kind::e_brcond) {
+      auto const brcond = static_cast<ir::Instr_brcond*>(instr);
+      ir::Constant const* const condition =
+        get_scalar_constant(get_lattice(ctx, brcond->condition));
+      if(condition == nullptr ||
+         condition->constant_kind != ir::Constant_Kind::e_constant_bool) {
+        return nullptr;
+      }
+
+      if(static_cast<ir::Constant_bool const*>(condition)->value) {
+        return brcond->then_target;
+      } else {
+        return brcond->else_target;
+      }
+    } else {
+      auto const instr_switch = static_cast<ir::Instr_switch*>(instr);
+      ir::Constant const* const selector =
+        get_scalar_constant(get_lattice(ctx, instr_switch->selector));
+      if(selector == nullptr || !is_int_constant(selector)) {
+        return nullptr;
+      }
+
+      return get_switch_target(instr_switch, selector);
+    }
+  }
+
+  static void mark_all_edges_executable(SCCP_Context& ctx, i64 const block)
+  {
+    for(i64 const successor: ctx.cfg.successors[block]) {
+      mark_edge_executable(ctx, block, ctx.cfg.blocks[successor]);
+    }
+  }
+
+  static void visit_conditional_branch(SCCP_Context& ctx,
+                                       ir::Instr* const instr,
+                                       ir::Value* const condition)
+  {
+    i64 const block = ctx.cfg.get_index(instr->block);
+    Lattice_Value const value = get_lattice(ctx, condition);
+    if(value.kind == Lattice_Kind::e_unknown) {
+      return;
+    }
+
+    ir::Basic_Block* const target = get_taken_target(ctx, instr);
+    if(target != nullptr) {
+      mark_edge_executable(ctx, block, target);
+    } else {
+      mark_all_edges_executable(ctx, block);
+    }
+  }
+
+  static void visit_instruction(SCCP_Context& ctx, ir::Instr* const instr)
+  {
+    switch(instr->instr_kind) {
+    case ir::Instr_Kind::e_phi:
+      update_lattice(ctx, instr,
+                     evaluate_phi(ctx, static_cast<ir::Instr_phi*>(instr)));
+      break;
+
+    case ir::Instr_Kind::e_alu:
+      update_lattice(ctx, instr,
+                     evaluate_alu(ctx, static_cast<ir::Instr_ALU*>(instr)));
+      break;
+
+    case ir::Instr_Kind::e_select:
+      update_lattice(
+        ctx, instr,
+        evaluate_select(ctx, static_cast<ir::Instr_select*>(instr)));
+      break;
+
+    case ir::Instr_Kind::e_ext_call:
+      update_lattice(
+        ctx, instr,
+        evaluate_ext_call(ctx, static_cast<ir::Instr_ext_call*>(instr)));
+      break;
+
+    case ir::Instr_Kind::e_composite_construct: {
+      auto const construct = static_cast<ir::Instr_composite_construct*>(instr);
+      update_lattice(ctx, instr, evaluate_composite_construct(ctx, construct));
+    } break;
+
+    case ir::Instr_Kind::e_composite_extract: {
+      auto const extract = static_cast<ir::Instr_composite_extract*>(instr);
+      Array<i64> const& indices = extract->indices;
+      anton::Slice<i64 const> const slice(indices.data(),
+                                          indices.data() + indices.size());
+      update_lattice(ctx, instr, evaluate_extract(ctx, extract->value, slice));
+    } break;
+
+    case ir::Instr_Kind::e_vector_extract: {
+      auto const extract = static_cast<ir::Instr_vector_extract*>(instr);
+      anton::Slice<i64 const> const slice(&extract->index,
+                                          &extract->index + 1);
+      update_lattice(ctx, instr, evaluate_extract(ctx, extract->value, slice));
+    } break;
+
+    case ir::Instr_Kind::e_cvt_sext:
+    case ir::Instr_Kind::e_cvt_zext:
+    case ir::Instr_Kind::e_cvt_trunc:
+    case ir::Instr_Kind::e_cvt_fpext:
+    case ir::Instr_Kind::e_cvt_fptrunc:
+    case ir::Instr_Kind::e_cvt_si2fp:
+    case ir::Instr_Kind::e_cvt_fp2si:
+    case ir::Instr_Kind::e_cvt_ui2fp:
+    case ir::Instr_Kind::e_cvt_fp2ui: {
+      // All conversions have their single operand as the first use.
+      Lattice_Value const value = get_lattice(ctx, instr->operands->value);
+      ir::Constant const* const constant = get_scalar_constant(value);
+      if(value.kind == Lattice_Kind::e_unknown) {
+        break;
+      } else if(constant == nullptr) {
+        update_lattice(ctx, instr, make_overdefined());
+      } else {
+        ir::Constant* const result = fold_cvt(ctx.allocator, instr, constant);
+        update_lattice(ctx, instr,
+                       result != nullptr ? make_lattice_constant(result)
+                                         : make_overdefined());
+      }
+    } break;
+
+    case ir::Instr_Kind::e_branch: {
+      auto const branch = static_cast<ir::Instr_branch*>(instr);
+      mark_edge_executable(ctx, ctx.cfg.get_index(instr->block),
+                           branch->target);
+    } break;
+
+    case ir::Instr_Kind::e_brcond:
+      visit_conditional_branch(
+        ctx, instr, static_cast<ir::Instr_brcond*>(instr)->condition);
+      break;
+
+    case ir::Instr_Kind::e_switch:
+      visit_conditional_branch(
+        ctx, instr, static_cast<ir::Instr_switch*>(instr)->selector);
+      break;
+
+    default:
+      // Memory, calls and the remaining instructions are never constant.
+      if(instr->type->kind != ir::Type_Kind::e_void) {
+        update_lattice(ctx, instr, make_overdefined());
+      }
+      break;
+    }
+  }
+
+  // resolve_undecided_branches
+  // Mark all edges of the conditional branches whose conditions are still
+  // unknown as executable. The conditions are computed only from undef or
+  // from values that never reach the branch, hence any target is valid, but
+  // the blocks must remain reachable since the branches are not folded.
+  //
+  static void resolve_undecided_branches(SCCP_Context& ctx)
+  {
+    for(i64 i = 0; i < ctx.cfg.size(); i += 1) {
+      ir::Basic_Block* const block = ctx.cfg.blocks[i];
+      if(!ctx.executable_blocks[i] || block->empty()) {
+        continue;
+      }
+
+      ir::Instr* const last = block->get_last();
+      ir::Value* condition = nullptr;
+      if(last->instr_kind == ir::Instr_Kind::e_brcond) {
+        condition = static_cast<ir::Instr_brcond*>(last)->condition;
+      } else if(last->instr_kind == ir::Instr_Kind::e_switch) {
+        condition = static_cast<ir::Instr_switch*>(last)->selector;
+      }
+
+      if(condition != nullptr &&
+         get_lattice(ctx, condition).kind == Lattice_Kind::e_unknown) {
+        mark_all_edges_executable(ctx, i);
+      }
+    }
+  }
+
+  static void solve(SCCP_Context& ctx)
+  {
+    ctx.executable_blocks[0] = true;
+    ctx.block_worklist.push_back(0);
+    while(ctx.block_worklist.size() > 0 || ctx.instr_worklist.size() > 0) {
+      while(ctx.instr_worklist.size() > 0) {
+        ir::Instr* const instr = ctx.instr_worklist.back();
+        ctx.instr_worklist.pop_back();
+        i64 const block = ctx.cfg.get_index(instr->block);
+        if(block != -1 && ctx.executable_blocks[block]) {
+          visit_instruction(ctx, instr);
+        }
+      }
+
+      if(ctx.block_worklist.size() > 0) {
+        i64 const block = ctx.block_worklist.back();
+        ctx.block_worklist.pop_back();
+        for(ir::Instr& instruction: ctx.cfg.blocks[block]->instructions) {
+          visit_instruction(ctx, &instruction);
+        }
+      }
+
+      if(ctx.block_worklist.size() == 0 && ctx.instr_worklist.size() == 0) {
+        resolve_undecided_branches(ctx);
+      }
+    }
+  }
+
+  // replace_constants
+  //
+  // Returns:
+  // The number of instructions replaced with constants.
+  //
+  [[nodiscard]] static i64 replace_constants(SCCP_Context& ctx)
+  {
+    Array<ir::Instr*> dead_instructions(ctx.allocator);
+    for(i64 i = 0; i < ctx.cfg.size(); i += 1) {
+      if(!ctx.executable_blocks[i]) {
+        continue;
+      }
+
+      for(ir::Instr& instruction: ctx.cfg.blocks[i]->instructions) {
+        // Only the instructions without side effects may become constant.
+        ir::Constant* const constant =
+          get_scalar_constant(get_lattice(ctx, &instruction));
+        if(constant != nullptr) {
+          ir::replace_uses_with(&instruction, constant);
+          dead_instructions.push_back(&instruction);
+        }
+      }
+    }
+
+    for(ir::Instr* const instruction: dead_instructions) {
+      ir::erase_instruction(ctx.allocator, instruction);
+    }
+    return dead_instructions.size();
+  }
+
+  // fold_branches
+  // Replace the conditional branches and switches with constant conditions
+  // with unconditional branches. The selection headers of the folded branches
+  // are removed along with them.
+  //
+  // Returns:
+  // The number of folded branches.
+  //
+  [[nodiscard]] static i64 fold_branches(SCCP_Context& ctx)
+  {
+    i64 folded = 0;
+    for(i64 i = 0; i < ctx.cfg.size(); i += 1) {
+      ir::Basic_Block* const block = ctx.cfg.blocks[i];
+      if(!ctx.executable_blocks[i] || block->empty()) {
+        continue;
+      }
+
+      ir::Instr* const last = block->get_last();
+      if(last->instr_kind != ir::Instr_Kind::e_brcond &&
+         last->instr_kind != ir::Instr_Kind::e_switch) {
+        continue;
+      }
+
+      ir::Basic_Block* const target = get_taken_target(ctx, last);
+      if(target == nullptr) {
+        continue;
+      }
+
+      ir::replace_terminator_with_branch(ctx.allocator, block, target);
+      folded += 1;
+    }
+    return folded;
+  }
+
+  // remove_unreachable_blocks
+  // Empty the blocks that have been found unreachable. The blocks remain
+  // allocated as they may still be referenced by the selection headers.
+  //
+  // Returns:
+  // The number of removed blocks.
+  //
+  [[nodiscard]] static i64 remove_unreachable_blocks(SCCP_Context& ctx)
+  {
+    i64 removed = 0;
+    for(i64 i = 0; i < ctx.cfg.size(); i += 1) {
+      if(ctx.executable_blocks[i]) {
+        continue;
+      }
+
+      ir::Basic_Block* const block = ctx.cfg.blocks[i];
+      for(i64 const successor: ctx.cfg.successors[i]) {
+        if(ctx.executable_blocks[successor]) {
+          ir::remove_phi_sources(ctx.cfg.blocks[successor], block);
+        }
+      }
+      removed += 1;
+    }
+
+    if(removed == 0) {
+      return 0;
+    }
+
+    // The instructions of unreachable blocks may use each other across the
+    // blocks, therefore all operands are dropped before any is erased.
+    for(i64 i = 0; i < ctx.cfg.size(); i += 1) {
+      if(!ctx.executable_blocks[i]) {
+        for(ir::Instr& instruction: ctx.cfg.blocks[i]->instructions) {
+          ir::drop_operands(ctx.allocator, &instruction);
+        }
+      }
+    }
+
+    for(i64 i = 0; i < ctx.cfg.size(); i += 1) {
+      ir::Basic_Block* const block = ctx.cfg.blocks[i];
+      if(ctx.executable_blocks[i]) {
+        continue;
+      }
+
+      // The instructions of reachable blocks cannot use the instructions of
+      // the unreachable ones as the definitions would not dominate the uses.
+      while(!block->empty()) {
+        ir::erase_instruction(ctx.allocator, block->get_first());
+      }
+    }
+    return removed;
+  }
+
+  ir::Pass_Result run_opt_ir_sccp(Allocator* const allocator,
+                                  ir::Function_Analyses& analyses)
+  {
+    SCCP_Context ctx(allocator, analyses.get_cfg());
+    solve(ctx);
+    i64 const replaced = replace_constants(ctx);
+    i64 const folded = fold_branches(ctx);
+    i64 const removed = remove_unreachable_blocks(ctx);
+    if(folded + removed > 0) {
+      return ir::Pass_Result{.changes = replaced + folded + removed};
+    }
+
+    // Only instructions have been replaced, the blocks and the branches
+    // between them are unchanged.
+    return ir::Pass_Result{.changes = replaced,
+                           .preserved = {.cfg = true,
+                                         .dominator_tree = true,
+                                         .post_dominator_tree = true,
+                                         .loop_info = true}};
+  }
+} // namespace vush
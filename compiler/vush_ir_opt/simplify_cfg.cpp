@@ -0,0 +1,435 @@
+#include <vush_ir_opt/opts.hpp>
+
+#include <anton/flat_hash_set.hpp>
+
+#include <vush_core/memory.hpp>
+#include <vush_ir/analysis.hpp>
+
+namespace vush {
+  namespace {
+    // Simplify_Context
+    //
+    // Members:
+    //  merge_targets - the converge blocks of the selection headers and the
+    //                  merge and continue blocks of the loop headers. These
+    //                  blocks are referenced by the headers, therefore they are
+    //                  never threaded or merged into their predecessors.
+    //        touched - the blocks, indexed by their number in the CFG, whose
+    //                  instructions or edges have changed during the current
+    //                  sweep. The CFG no longer describes them accurately,
+    //                  hence they are left alone until the next sweep.
+    //
+    struct Simplify_Context {
+      Allocator* allocator;
+      ir::CFG const& cfg;
+      anton::Flat_Hash_Set<ir::Basic_Block const*> merge_targets;
+      Array<bool> touched;
+
+      Simplify_Context(Allocator* allocator, ir::CFG const& cfg)
+        : allocator(allocator), cfg(cfg), merge_targets(allocator),
+          touched(allocator)
+      {
+        for(i64 i = 0; i < cfg.size(); i += 1) {
+          touched.push_back(false);
+        }
+      }
+    };
+  } // namespace
+
+  [[nodiscard]] static ir::Intrinsic_scf_branch_head*
+  find_scf_branch_head(ir::Basic_Block* const block)
+  {
+    for(ir::Instr& instruction: block->instructions) {
+      if(instruction.instr_kind == ir::Instr_Kind::e_intrinsic &&
+         static_cast<ir::Instr_intrinsic&>(instruction).intrinsic_kind ==
+           ir::Intrinsic_Kind::e_scf_branch_head) {
+        return static_cast<ir::Intrinsic_scf_branch_head*>(&instruction);
+      }
+    }
+    return nullptr;
+  }
+
+  [[nodiscard]] static ir::Intrinsic_scf_loop_head*
+  find_scf_loop_head(ir::Basic_Block* const block)
+  {
+    for(ir::Instr& instruction: block->instructions) {
+      if(instruction.instr_kind == ir::Instr_Kind::e_intrinsic &&
+         static_cast<ir::Instr_intrinsic&>(instruction).intrinsic_kind ==
+           ir::Intrinsic_Kind::e_scf_loop_head) {
+        return static_cast<ir::Intrinsic_scf_loop_head*>(&instruction);
+      }
+    }
+    return nullptr;
+  }
+
+  [[nodiscard]] static bool is_merge_target(Simplify_Context const& ctx,
+                                            ir::Basic_Block const* const block)
+  {
+    return ctx.merge_targets.find(block) != ctx.merge_targets.end();
+  }
+
+  [[nodiscard]] static bool has_phis(ir::Basic_Block const* const block)
+  {
+    return !block->empty() &&
+           block->get_first()->instr_kind == ir::Instr_Kind::e_phi;
+  }
+
+  // get_folded_target
+  //
+  // Returns:
+  // The only target the terminator may transfer control to or nullptr if
+  // the terminator is not a conditional branch or switch that may be folded.
+  //
+  [[nodiscard]] static ir::Basic_Block*
+  get_folded_target(ir::Instr* const terminator)
+  {
+    if(terminator->instr_kind == ir::Instr_Kind::e_brcond) {
+      auto const brcond = static_cast<ir::Instr_brcond*>(terminator);
+      if(brcond->then_target == brcond->else_target) {
+        return brcond->then_target;
+      }
+
+      if(ir::instanceof<ir::Constant_bool>(brcond->condition)) {
+        if(static_cast<ir::Constant_bool*>(brcond->condition)->value) {
+          return brcond->then_target;
+        } else {
+          return brcond->else_target;
+        }
+      }
+      return nullptr;
+    }
+
+    if(terminator->instr_kind == ir::Instr_Kind::e_switch) {
+      auto const instr_switch = static_cast<ir::Instr_switch*>(terminator);
+      ir::Value* const selector = instr_switch->selector;
+      bool has_value = true;
+      i64 value = 0;
+      if(ir::instanceof<ir::Constant_i32>(selector)) {
+        value = static_cast<ir::Constant_i32*>(selector)->value;
+      } else if(ir::instanceof<ir::Constant_u32>(selector)) {
+        value = static_cast<ir::Constant_u32*>(selector)->value;
+      } else {
+        has_value = false;
+      }
+
+      bool uniform = true;
+      for(ir::Switch_Label const& label: instr_switch->labels) {
+        if(has_value && label.value == value) {
+          return label.target;
+        }
+
+        uniform = uniform && label.target == instr_switch->default_label;
+      }
+
+      if(has_value || uniform) {
+        return instr_switch->default_label;
+      }
+    }
+
+    return nullptr;
+  }
+
+  // fold_terminator
+  // Replace a conditional branch or switch that always transfers control to
+  // the same block with an unconditional branch.
+  //
+  [[nodiscard]] static bool fold_terminator(Simplify_Context& ctx,
+                                            ir::Basic_Block* const block)
+  {
+    ir::Instr* const terminator = block->get_last();
+    ir::Basic_Block* const target = get_folded_target(terminator);
+    if(target == nullptr) {
+      return false;
+    }
+
+    i64 const index = ctx.cfg.get_index(block);
+    for(i64 const successor: ctx.cfg.successors[index]) {
+      ctx.touched[successor] = true;
+    }
+    ctx.touched[index] = true;
+    ir::replace_terminator_with_branch(ctx.allocator, block, target);
+    return true;
+  }
+
+  // can_thread_block
+  // A forwarding block may be bypassed if no predecessor is a selection
+  // header that would thereby leave its construct other than through its
+  // converge block, and, when the target has phis, no predecessor already
+  // branches to the target directly as the phis could not tell the edges
+  // apart.
+  //
+  [[nodiscard]] static bool can_thread_block(Simplify_Context const& ctx,
+                                             i64 const block,
+                                             i64 const target)
+  {
+    bool const target_has_phis = has_phis(ctx.cfg.blocks[target]);
+    for(i64 const predecessor: ctx.cfg.predecessors[block]) {
+      if(ctx.touched[predecessor]) {
+        return false;
+      }
+
+      ir::Intrinsic_scf_branch_head const* const scf_branch_head =
+        find_scf_branch_head(ctx.cfg.blocks[predecessor]);
+      if(scf_branch_head != nullptr &&
+         scf_branch_head->converge_block != ctx.cfg.blocks[target]) {
+        return false;
+      }
+
+      if(target_has_phis) {
+        for(i64 const successor: ctx.cfg.successors[predecessor]) {
+          if(successor == target) {
+            return false;
+          }
+        }
+      }
+    }
+    return true;
+  }
+
+  // thread_block
+  // Bypass a block consisting of only an unconditional branch by retargeting
+  // its predecessors to the target of the branch.
+  //
+  [[nodiscard]] static bool thread_block(Simplify_Context& ctx,
+                                         ir::Basic_Block* const block)
+  {
+    i64 const index = ctx.cfg.get_index(block);
+    ir::Instr* const terminator = block->get_last();
+    if(index == 0 || terminator != block->get_first() ||
+       terminator->instr_kind != ir::Instr_Kind::e_branch ||
+       is_merge_target(ctx, block)) {
+      return false;
+    }
+
+    ir::Basic_Block* const target =
+      static_cast<ir::Instr_branch*>(terminator)->target;
+    i64 const target_index = ctx.cfg.get_index(target);
+    if(target == block || ctx.touched[target_index] ||
+       !can_thread_block(ctx, index, target_index)) {
+      return false;
+    }
+
+    for(i64 const predecessor: ctx.cfg.predecessors[index]) {
+      ir::Basic_Block* const predecessor_block = ctx.cfg.blocks[predecessor];
+      ir::retarget_terminator(predecessor_block->get_last(), block, target);
+      ctx.touched[predecessor] = true;
+    }
+
+    // The value flowing in from the block flows in from each of its
+    // predecessors instead.
+    for(ir::Instr& instruction: target->instructions) {
+      if(instruction.instr_kind != ir::Instr_Kind::e_phi) {
+        break;
+      }
+
+      auto const phi = static_cast<ir::Instr_phi*>(&instruction);
+      for(i64 i = 0; i < phi->srcs.size(); i += 1) {
+        if(phi->srcs[i].block != block) {
+          continue;
+        }
+
+        ir::Value* const value = phi->srcs[i].value;
+        phi->remove_source(i);
+        for(i64 const predecessor: ctx.cfg.predecessors[index]) {
+          phi->add_source(value, ctx.cfg.blocks[predecessor]);
+        }
+        break;
+      }
+    }
+
+    ir::erase_instruction(ctx.allocator, terminator);
+    ctx.touched[index] = true;
+    ctx.touched[target_index] = true;
+    return true;
+  }
+
+  // merge_successor
+  // Merge the successor of a block ending in an unconditional branch into the
+  // block when the block is the only predecessor of the successor. A loop
+  // header is not merged with a selection header as a block may be the header
+  // of only one construct.
+  //
+  [[nodiscard]] static bool merge_successor(Simplify_Context& ctx,
+                                            ir::Basic_Block* const block)
+  {
+    ir::Instr* const terminator = block->get_last();
+    if(terminator->instr_kind != ir::Instr_Kind::e_branch) {
+      return false;
+    }
+
+    ir::Basic_Block* const successor =
+      static_cast<ir::Instr_branch*>(terminator)->target;
+    i64 const successor_index = ctx.cfg.get_index(successor);
+    if(successor == block || successor_index == 0 ||
+       ctx.touched[successor_index] ||
+       ctx.cfg.predecessors[successor_index].size() != 1 ||
+       is_merge_target(ctx, successor)) {
+      return false;
+    }
+
+    if(find_scf_loop_head(block) != nullptr &&
+       (find_scf_branch_head(successor) != nullptr ||
+        find_scf_loop_head(successor) != nullptr)) {
+      return false;
+    }
+
+    // The phis of the successor have a single source.
+    while(has_phis(successor)) {
+      auto const phi = static_cast<ir::Instr_phi*>(successor->get_first());
+      ANTON_ASSERT(phi->srcs.size() == 1, "phi source count mismatch");
+      ir::replace_uses_with(phi, phi->srcs[0].value);
+      ir::erase_instruction(ctx.allocator, phi);
+    }
+
+    ir::erase_instruction(ctx.allocator, terminator);
+    while(!successor->empty()) {
+      ir::Instr* const instruction = successor->get_first();
+      anton::ilist_erase(instruction);
+      block->insert(instruction);
+    }
+
+    for(i64 const next: ctx.cfg.successors[successor_index]) {
+      ir::Basic_Block* const next_block = ctx.cfg.blocks[next];
+      for(ir::Instr& instruction: next_block->instructions) {
+        if(instruction.instr_kind != ir::Instr_Kind::e_phi) {
+          break;
+        }
+
+        auto const phi = static_cast<ir::Instr_phi*>(&instruction);
+        for(ir::Phi_Source& src: phi->srcs) {
+          if(src.block == successor) {
+            src.block = block;
+          }
+        }
+      }
+      ctx.touched[next] = true;
+    }
+
+    ctx.touched[ctx.cfg.get_index(block)] = true;
+    ctx.touched[successor_index] = true;
+    return true;
+  }
+
+  // has_back_edge
+  // Whether the header is still the target of an edge from a block of its
+  // loop. The blocks are numbered in reverse postorder, hence a back edge
+  // originates in a block numbered no lower than the header.
+  //
+  [[nodiscard]] static bool has_back_edge(Simplify_Context const& ctx,
+                                          i64 const header)
+  {
+    for(i64 const predecessor: ctx.cfg.predecessors[header]) {
+      if(predecessor >= header) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  [[nodiscard]] static i64 simplify_blocks(Simplify_Context& ctx)
+  {
+    i64 changes = 0;
+    for(i64 i = 0; i < ctx.cfg.size(); i += 1) {
+      ir::Basic_Block* const block = ctx.cfg.blocks[i];
+      ir::Intrinsic_scf_branch_head const* const scf_branch_head =
+        find_scf_branch_head(block);
+      if(scf_branch_head != nullptr) {
+        ctx.merge_targets.emplace(scf_branch_head->converge_block);
+      }
+
+      // A loop whose back edge has been removed no longer loops and its head
+      // is dropped.
+      ir::Intrinsic_scf_loop_head* const scf_loop_head =
+        find_scf_loop_head(block);
+      if(scf_loop_head != nullptr) {
+        if(has_back_edge(ctx, i)) {
+          ctx.merge_targets.emplace(scf_loop_head->merge_block);
+          ctx.merge_targets.emplace(scf_loop_head->continue_block);
+        } else {
+          ir::erase_instruction(ctx.allocator, scf_loop_head);
+          changes += 1;
+        }
+      }
+    }
+
+    for(i64 i = 0; i < ctx.cfg.size(); i += 1) {
+      ir::Basic_Block* const block = ctx.cfg.blocks[i];
+      if(ctx.touched[i] || block->empty()) {
+        continue;
+      }
+
+      if(fold_terminator(ctx, block) || thread_block(ctx, block) ||
+         merge_successor(ctx, block)) {
+        changes += 1;
+      }
+    }
+    return changes;
+  }
+
+  // remove_unreachable_blocks
+  // Empty the blocks that were reachable before the sweep, but no longer are.
+  // The blocks remain allocated as they may still be referenced by the
+  // selection and loop headers.
+  //
+  static void remove_unreachable_blocks(Allocator* const allocator,
+                                        ir::CFG const& old_cfg,
+                                        ir::CFG const& cfg)
+  {
+    Array<ir::Basic_Block*> successors(allocator);
+    Array<ir::Instr*> dead_instructions(allocator);
+    for(ir::Basic_Block* const block: old_cfg.blocks) {
+      if(cfg.get_index(block) != -1 || block->empty()) {
+        continue;
+      }
+
+      // The terminator might have been rewritten during the sweep, therefore
+      // the successors are taken from the terminator rather than the CFG.
+      successors.clear();
+      ir::get_successors(block->get_last(), successors);
+      for(ir::Basic_Block* const successor: successors) {
+        if(cfg.get_index(successor) != -1) {
+          ir::remove_phi_sources(successor, block);
+        }
+      }
+
+      for(ir::Instr& instruction: block->instructions) {
+        ir::drop_operands(allocator, &instruction);
+        dead_instructions.push_back(&instruction);
+      }
+    }
+
+    for(ir::Instr* const instruction: dead_instructions) {
+      ir::erase_instruction(allocator, instruction);
+    }
+  }
+
+  ir::Pass_Result run_opt_ir_simplify_cfg(Allocator* const allocator,
+                                          ir::Function_Analyses& analyses)
+  {
+    ir::Function* const function = analyses.get_function();
+    ir::CFG const* cfg = &analyses.get_cfg();
+    i64 changes = 0;
+    while(true) {
+      Simplify_Context ctx(allocator, *cfg);
+      i64 const sweep_changes = simplify_blocks(ctx);
+      if(sweep_changes == 0) {
+        break;
+      }
+
+      changes += sweep_changes;
+      ir::CFG const* const new_cfg = ir::build_cfg(allocator, function);
+      remove_unreachable_blocks(allocator, *cfg, *new_cfg);
+      cfg = new_cfg;
+    }
+
+    if(changes > 0) {
+      return ir::Pass_Result{.changes = changes};
+    }
+
+    return ir::Pass_Result{.changes = 0,
+                           .preserved = {.cfg = true,
+                                         .dominator_tree = true,
+                                         .post_dominator_tree = true,
+                                         .loop_info = true}};
+  }
+} // namespace vush
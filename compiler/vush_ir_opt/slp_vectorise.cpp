@@ -0,0 +1,358 @@
+#include <vush_ir_opt/opts.hpp>
+
+#include <vush_core/memory.hpp>
+#include <vush_ir/types.hpp>
+
+namespace vush {
+  // The deepest tree of scalar operations that is vectorised. The operands
+  // below are gathered into vectors.
+  constexpr i64 max_slp_depth = 8;
+
+  namespace {
+    enum struct Node_Kind : u8 {
+      // The lanes are isomorphic ALU instructions.
+      e_alu,
+      // The lanes are the elements of a vector extracted in order.
+      e_vector,
+      // All lanes are the same value.
+      e_splat,
+      // The lanes are unrelated values combined into a vector.
+      e_gather,
+    };
+
+    // SLP_Node
+    // A vector of values, one in each lane.
+    //
+    // Members:
+    //    lanes - the scalar values of the lanes.
+    //     type - the vector type of the node.
+    //   vector - the vector the lanes are extracted from for e_vector nodes.
+    // operands - the nodes of the operands of the lanes for e_alu nodes. -1
+    //            when the operand is absent.
+    //
+    struct SLP_Node {
+      Node_Kind kind;
+      Array<ir::Value*> lanes;
+      ir::Type_Vec* type;
+      ir::Value* vector = nullptr;
+      i64 operands[2] = {-1, -1};
+
+      SLP_Node(Allocator* allocator, Node_Kind kind, ir::Type_Vec* type)
+        : kind(kind), lanes(allocator), type(type)
+      {
+      }
+    };
+
+    // SLP_Context
+    //
+    // Members:
+    //  vectorisable - whether the lanes of all nodes of the tree have the
+    //                 same scalar type.
+    //
+    struct SLP_Context {
+      Allocator* allocator;
+      ir::Module* module;
+      Array<SLP_Node> nodes;
+      bool vectorisable = true;
+
+      SLP_Context(Allocator* allocator, ir::Module* module)
+        : allocator(allocator), module(module), nodes(allocator)
+      {
+      }
+    };
+  } // namespace
+
+  // get_extracted_vector
+  //
+  // Returns:
+  // The vector the value is extracted from at the index or nullptr if the
+  // value is not such an extract.
+  //
+  [[nodiscard]] static ir::Value* get_extracted_vector(ir::Value* const value,
+                                                       i64 const index)
+  {
+    if(ir::instanceof<ir::Instr_vector_extract>(value)) {
+      auto const extract = static_cast<ir::Instr_vector_extract*>(value);
+      if(extract->index == index) {
+        return extract->value;
+      }
+    } else if(ir::instanceof<ir::Instr_composite_extract>(value)) {
+      auto const extract = static_cast<ir::Instr_composite_extract*>(value);
+      if(extract->indices.size() == 1 && extract->indices[0] == index) {
+        return extract->value;
+      }
+    }
+    return nullptr;
+  }
+
+  // is_isomorphic
+  // The lanes are distinct ALU instructions with the same opcode and type,
+  // each used only by the corresponding lane of the parent node.
+  //
+  [[nodiscard]] static bool is_isomorphic(Array<ir::Value*> const& lanes)
+  {
+    if(!ir::instanceof<ir::Instr_ALU>(lanes[0])) {
+      return false;
+    }
+
+    auto const first = static_cast<ir::Instr_ALU const*>(lanes[0]);
+    for(i64 i = 0; i < lanes.size(); i += 1) {
+      if(!ir::instanceof<ir::Instr_ALU>(lanes[i]) ||
+         !lanes[i]->has_single_use()) {
+        return false;
+      }
+
+      auto const alu = static_cast<ir::Instr_ALU const*>(lanes[i]);
+      if(alu->op != first->op ||
+         !ir::compare_types_equal(*alu->type, *first->type)) {
+        return false;
+      }
+
+      for(i64 j = 0; j < i; j += 1) {
+        if(lanes[j] == lanes[i]) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  // build_node
+  // Build the tree of the nodes of the lanes.
+  //
+  // Returns:
+  // The index of the node.
+  //
+  [[nodiscard]] static i64 build_node(SLP_Context& ctx,
+                                      Array<ir::Value*> const& lanes,
+                                      i64 const depth)
+  {
+    i64 const count = lanes.size();
+    for(ir::Value const* const lane: lanes) {
+      if(!ir::is_scalar_type(*lane->type) ||
+         !ir::compare_types_equal(*lane->type, *lanes[0]->type)) {
+        ctx.vectorisable = false;
+      }
+    }
+
+    // A tree with lanes that are not scalars is never emitted, hence its nodes
+    // do not need types.
+    ir::Type_Vec* const type =
+      ctx.vectorisable
+        ? ir::get_type_vec(lanes[0]->type, static_cast<i32>(count))
+        : nullptr;
+    i64 const index = ctx.nodes.size();
+    ir::Value* const vector = get_extracted_vector(lanes[0], 0);
+    bool in_order = vector != nullptr && type != nullptr &&
+                    ir::compare_types_equal(*vector->type, *type);
+    bool uniform = true;
+    for(i64 i = 1; i < count; i += 1) {
+      in_order = in_order && get_extracted_vector(lanes[i], i) == vector;
+      uniform = uniform && lanes[i] == lanes[0];
+    }
+
+    if(in_order) {
+      ctx.nodes.push_back(SLP_Node(ctx.allocator, Node_Kind::e_vector, type));
+      ctx.nodes[index].vector = vector;
+    } else if(uniform) {
+      ctx.nodes.push_back(SLP_Node(ctx.allocator, Node_Kind::e_splat, type));
+    } else if(depth < max_slp_depth && is_isomorphic(lanes)) {
+      ctx.nodes.push_back(SLP_Node(ctx.allocator, Node_Kind::e_alu, type));
+    } else {
+      ctx.nodes.push_back(SLP_Node(ctx.allocator, Node_Kind::e_gather, type));
+    }
+    ctx.nodes[index].lanes.assign(lanes.begin(), lanes.end());
+    if(ctx.nodes[index].kind != Node_Kind::e_alu) {
+      return index;
+    }
+
+    // The nodes array may grow while the operands are being built, hence the
+    // node is not referenced across the recursion.
+    Array<ir::Value*> operand_lanes(ctx.allocator);
+    for(i64 operand = 0; operand < 2; operand += 1) {
+      operand_lanes.clear();
+      for(ir::Value* const lane: lanes) {
+        auto const alu = static_cast<ir::Instr_ALU*>(lane);
+        operand_lanes.push_back(operand == 0 ? alu->src1 : alu->src2);
+      }
+
+      if(operand_lanes[0] != nullptr) {
+        i64 const child = build_node(ctx, operand_lanes, depth + 1);
+        ctx.nodes[index].operands[operand] = child;
+      }
+    }
+    return index;
+  }
+
+  // is_profitable
+  // Each vector ALU instruction replaces as many scalar instructions as there
+  // are lanes and the root composite construct is removed along with the
+  // extracts that become unused. Each splat and gather adds a composite
+  // construct.
+  //
+  [[nodiscard]] static bool is_profitable(SLP_Context const& ctx,
+                                          i64 const root)
+  {
+    if(!ctx.vectorisable || ctx.nodes[root].kind != Node_Kind::e_alu) {
+      return false;
+    }
+
+    i64 removed = 1;
+    i64 added = 0;
+    for(SLP_Node const& node: ctx.nodes) {
+      switch(node.kind) {
+      case Node_Kind::e_alu:
+        removed += node.lanes.size();
+        added += 1;
+        break;
+
+      case Node_Kind::e_vector:
+        for(ir::Value const* const lane: node.lanes) {
+          removed += lane->has_single_use();
+        }
+        break;
+
+      case Node_Kind::e_splat:
+      case Node_Kind::e_gather:
+        added += 1;
+        break;
+      }
+    }
+    return added < removed;
+  }
+
+  static void insert_after(ir::Instr*& position, ir::Instr* const instr)
+  {
+    anton::ilist_insert_after(position, instr);
+    instr->block = position->block;
+    position = instr;
+  }
+
+  // emit_node
+  // Emit the vector instructions of the node after the position.
+  //
+  // Returns:
+  // The vector value of the node.
+  //
+  [[nodiscard]] static ir::Value* emit_node(SLP_Context& ctx, i64 const index,
+                                            ir::Instr*& position)
+  {
+    SLP_Node const& node = ctx.nodes[index];
+    switch(node.kind) {
+    case Node_Kind::e_vector:
+      return node.vector;
+
+    case Node_Kind::e_splat:
+    case Node_Kind::e_gather: {
+      auto const construct = ir::make_instr_composite_construct(
+        ctx.allocator, ctx.module->next_id(), node.type, position->source_info);
+      for(ir::Value* const lane: node.lanes) {
+        construct->add_element(lane);
+      }
+      insert_after(position, construct);
+      return construct;
+    }
+
+    case Node_Kind::e_alu: {
+      ir::Value* const src1 = emit_node(ctx, node.operands[0], position);
+      ir::Value* src2 = nullptr;
+      if(node.operands[1] != -1) {
+        src2 = emit_node(ctx, node.operands[1], position);
+      }
+
+      auto const lane = static_cast<ir::Instr_ALU const*>(node.lanes[0]);
+      auto const alu =
+        ir::make_instr_alu(ctx.allocator, ctx.module->next_id(), node.type,
+                           lane->op, src1, src2, lane->source_info);
+      insert_after(position, alu);
+      return alu;
+    }
+    }
+  }
+
+  // vectorise
+  // Replace the composite construct with the vector instructions of the tree
+  // and remove the scalar instructions of the lanes. The nodes are ordered
+  // such that the users of a lane precede it. The extracts are removed last
+  // as they may be shared between the lanes.
+  //
+  static void vectorise(SLP_Context& ctx, i64 const root,
+                        ir::Instr_composite_construct* const construct)
+  {
+    ir::Instr* position = construct;
+    ir::Value* const vector = emit_node(ctx, root, position);
+    ir::replace_uses_with(construct, vector);
+    ir::erase_instruction(ctx.allocator, construct);
+    Array<ir::Instr*> extracts(ctx.allocator);
+    for(SLP_Node const& node: ctx.nodes) {
+      if(node.kind == Node_Kind::e_alu) {
+        for(ir::Value* const lane: node.lanes) {
+          ir::erase_instruction(ctx.allocator, static_cast<ir::Instr*>(lane));
+        }
+      } else if(node.kind == Node_Kind::e_vector) {
+        for(ir::Value* const lane: node.lanes) {
+          auto const extract = static_cast<ir::Instr*>(lane);
+          bool known = false;
+          for(ir::Instr const* const other: extracts) {
+            known |= other == extract;
+          }
+
+          if(!known) {
+            extracts.push_back(extract);
+          }
+        }
+      }
+    }
+
+    for(ir::Instr* const extract: extracts) {
+      if(!extract->has_uses()) {
+        ir::erase_instruction(ctx.allocator, extract);
+      }
+    }
+  }
+
+  ir::Pass_Result run_opt_ir_slp_vectorise(Allocator* const allocator,
+                                           ir::Function_Analyses& analyses)
+  {
+    ir::CFG const& cfg = analyses.get_cfg();
+    SLP_Context ctx(allocator, analyses.get_module());
+    Array<ir::Instr_composite_construct*> constructs(allocator);
+    for(ir::Basic_Block* const block: cfg.blocks) {
+      for(ir::Instr& instruction: block->instructions) {
+        if(instruction.instr_kind != ir::Instr_Kind::e_composite_construct ||
+           instruction.type->kind != ir::Type_Kind::e_vec) {
+          continue;
+        }
+
+        auto const construct =
+          static_cast<ir::Instr_composite_construct*>(&instruction);
+        auto const type = static_cast<ir::Type_Vec const*>(construct->type);
+        if(construct->elements.size() == type->rows) {
+          constructs.push_back(construct);
+        }
+      }
+    }
+
+    // The lanes of a vectorised tree are scalars, hence they are never the
+    // roots of other trees.
+    i64 changes = 0;
+    for(ir::Instr_composite_construct* const construct: constructs) {
+      ctx.nodes.clear();
+      ctx.vectorisable = true;
+      i64 const root = build_node(ctx, construct->elements, 0);
+      if(is_profitable(ctx, root)) {
+        vectorise(ctx, root, construct);
+        changes += 1;
+      }
+    }
+
+    // Only instructions are inserted and removed, the blocks and the branches
+    // between them are unchanged.
+    return ir::Pass_Result{
+      .changes = changes,
+      .preserved = {.cfg = true,
+                    .dominator_tree = true,
+                    .post_dominator_tree = true,
+                    .loop_info = true}};
+  }
+} // namespace vush
@@ -0,0 +1,299 @@
+#include <vush_ir_opt/opts.hpp>
+
+#include <vush_core/memory.hpp>
+#include <vush_ir/types.hpp>
+
+namespace vush {
+  // Each element of a split aggregate becomes an allocation of its own.
+  // Larger aggregates are left intact.
+  constexpr i64 max_sroa_elements = 16;
+
+  namespace {
+    struct SROA_Context {
+      Allocator* allocator;
+      ir::Module* module;
+      ir::CFG const& cfg;
+
+      SROA_Context(Allocator* allocator, ir::Module* module, ir::CFG const& cfg)
+        : allocator(allocator), module(module), cfg(cfg)
+      {
+      }
+    };
+  } // namespace
+
+  // get_element_count
+  //
+  // Returns:
+  // The number of elements of a struct or a sized array. 0 for any other type.
+  //
+  [[nodiscard]] static i64 get_element_count(ir::Type const& type)
+  {
+    if(type.kind == ir::Type_Kind::e_composite) {
+      return static_cast<ir::Type_Composite const&>(type).elements.size();
+    } else if(type.kind == ir::Type_Kind::e_array) {
+      return static_cast<ir::Type_Array const&>(type).size;
+    } else {
+      return 0;
+    }
+  }
+
+  [[nodiscard]] static ir::Type* get_element_type(ir::Type* const type,
+                                                  i64 const index)
+  {
+    if(type->kind == ir::Type_Kind::e_composite) {
+      return static_cast<ir::Type_Composite*>(type)->elements[index];
+    } else {
+      return static_cast<ir::Type_Array*>(type)->element_type;
+    }
+  }
+
+  [[nodiscard]] static bool get_constant_index(ir::Value const* const value,
+                                               i64& index)
+  {
+    if(ir::instanceof<ir::Constant_i32>(value)) {
+      index = static_cast<ir::Constant_i32 const*>(value)->value;
+      return true;
+    }
+
+    if(ir::instanceof<ir::Constant_u32>(value)) {
+      index = static_cast<ir::Constant_u32 const*>(value)->value;
+      return true;
+    }
+
+    return false;
+  }
+
+  // is_splittable
+  // The address of the aggregate must be used exclusively as the address
+  // operand of getptrs with constant in-bounds first indices and of loads and
+  // stores of the entire aggregate. Any other use, e.g. a dynamic index or
+  // passing the address to a call, lets it escape.
+  //
+  [[nodiscard]] static bool is_splittable(SROA_Context const& ctx,
+                                          ir::Instr_alloc const* const alloc)
+  {
+    ir::Type const& type = *alloc->alloc_type;
+    i64 const count = get_element_count(type);
+    if(count <= 0 || count > max_sroa_elements) {
+      return false;
+    }
+
+    for(ir::Use const* const use: alloc->get_uses()) {
+      ir::Instr const* const instr = use->user;
+      if(ctx.cfg.get_index(instr->block) == -1) {
+        return false;
+      }
+
+      if(instr->instr_kind == ir::Instr_Kind::e_getptr) {
+        auto const getptr = static_cast<ir::Instr_getptr const*>(instr);
+        i64 index = 0;
+        if(getptr->address != alloc ||
+           !ir::compare_types_equal(*getptr->addressed_type, type) ||
+           !get_constant_index(getptr->indices[0], index) || index < 0 ||
+           index >= count) {
+          return false;
+        }
+      } else if(instr->instr_kind == ir::Instr_Kind::e_load) {
+        auto const load = static_cast<ir::Instr_load const*>(instr);
+        if(!ir::compare_types_equal(*load->type, type)) {
+          return false;
+        }
+      } else if(instr->instr_kind == ir::Instr_Kind::e_store) {
+        auto const store = static_cast<ir::Instr_store const*>(instr);
+        if(store->dst != alloc || store->src == alloc ||
+           !ir::compare_types_equal(*store->src->type, type)) {
+          return false;
+        }
+      } else {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  static void insert_after(ir::Instr* const position, ir::Instr* const instr)
+  {
+    anton::ilist_insert_after(position, instr);
+    instr->block = position->block;
+  }
+
+  // rewrite_getptr
+  // Replace a getptr into the aggregate with the allocation of the element
+  // selected by its first index. The remaining indices address the element.
+  //
+  static void rewrite_getptr(SROA_Context& ctx, ir::Instr_getptr* const getptr,
+                             ir::Instr_alloc* const element)
+  {
+    if(getptr->indices.size() == 1) {
+      ir::replace_uses_with(getptr, element);
+      ir::erase_instruction(ctx.allocator, getptr);
+      return;
+    }
+
+    anton::Slice<ir::Value* const> const indices(
+      getptr->indices.data() + 1,
+      getptr->indices.data() + getptr->indices.size());
+    auto const element_getptr =
+      ir::make_instr_getptr(ctx.allocator, ctx.module->next_id(),
+                            element->alloc_type, element, indices,
+                            getptr->source_info);
+    insert_after(getptr, element_getptr);
+    ir::replace_uses_with(getptr, element_getptr);
+    ir::erase_instruction(ctx.allocator, getptr);
+  }
+
+  // rewrite_load
+  // Replace a load of the entire aggregate with loads of its elements
+  // combined into a composite.
+  //
+  static void rewrite_load(SROA_Context& ctx, ir::Instr_load* const load,
+                           Array<ir::Instr_alloc*> const& elements)
+  {
+    auto const construct = ir::make_instr_composite_construct(
+      ctx.allocator, ctx.module->next_id(), load->type, load->source_info);
+    ir::Instr* position = load;
+    for(ir::Instr_alloc* const element: elements) {
+      auto const element_load =
+        ir::make_instr_load(ctx.allocator, ctx.module->next_id(),
+                            element->alloc_type, element, load->source_info);
+      insert_after(position, element_load);
+      position = element_load;
+      construct->add_element(element_load);
+    }
+    insert_after(position, construct);
+    ir::replace_uses_with(load, construct);
+    ir::erase_instruction(ctx.allocator, load);
+  }
+
+  // rewrite_store
+  // Replace a store of the entire aggregate with stores of its elements. The
+  // elements of a stored composite construct are stored directly, otherwise
+  // they are extracted from the stored value.
+  //
+  static void rewrite_store(SROA_Context& ctx, ir::Instr_store* const store,
+                            ir::Type* const type,
+                            Array<ir::Instr_alloc*> const& elements)
+  {
+    ir::Instr_composite_construct const* construct = nullptr;
+    if(ir::instanceof<ir::Instr_composite_construct>(store->src)) {
+      construct =
+        static_cast<ir::Instr_composite_construct const*>(store->src);
+      if(construct->elements.size() != elements.size()) {
+        construct = nullptr;
+      }
+    }
+
+    ir::Instr* position = store;
+    for(i64 i = 0; i < elements.size(); i += 1) {
+      ir::Value* value = nullptr;
+      if(construct != nullptr) {
+        value = construct->elements[i];
+      } else {
+        auto const extract = ir::make_instr_composite_extract(
+          ctx.allocator, ctx.module->next_id(), get_element_type(type, i),
+          store->src, i, store->source_info);
+        insert_after(position, extract);
+        position = extract;
+        value = extract;
+      }
+
+      auto const element_store =
+        ir::make_instr_store(ctx.allocator, ctx.module->next_id(), elements[i],
+                             value, store->source_info);
+      insert_after(position, element_store);
+      position = element_store;
+    }
+    ir::erase_instruction(ctx.allocator, store);
+  }
+
+  static void split_alloc(SROA_Context& ctx, ir::Instr_alloc* const alloc)
+  {
+    ir::Type* const type = alloc->alloc_type;
+    i64 const count = get_element_count(*type);
+    Array<ir::Instr_alloc*> elements(ctx.allocator);
+    ir::Instr* position = alloc;
+    for(i64 i = 0; i < count; i += 1) {
+      auto const element =
+        ir::make_instr_alloc(ctx.allocator, ctx.module->next_id(),
+                             get_element_type(type, i), alloc->source_info);
+      insert_after(position, element);
+      position = element;
+      elements.push_back(element);
+    }
+
+    // The uses are removed while the users are rewritten.
+    Array<ir::Instr*> users(ctx.allocator);
+    for(ir::Use const* const use: alloc->get_uses()) {
+      users.push_back(use->user);
+    }
+
+    for(ir::Instr* const user: users) {
+      switch(user->instr_kind) {
+      case ir::Instr_Kind::e_getptr: {
+        auto const getptr = static_cast<ir::Instr_getptr*>(user);
+        i64 index = 0;
+        if(!get_constant_index(getptr->indices[0], index)) {
+          ANTON_UNREACHABLE("index of split aggregate is not constant");
+        }
+        rewrite_getptr(ctx, getptr, elements[index]);
+      } break;
+
+      case ir::Instr_Kind::e_load:
+        rewrite_load(ctx, static_cast<ir::Instr_load*>(user), elements);
+        break;
+
+      case ir::Instr_Kind::e_store:
+        rewrite_store(ctx, static_cast<ir::Instr_store*>(user), type,
+                      elements);
+        break;
+
+      default:
+        ANTON_UNREACHABLE("invalid use of split aggregate");
+      }
+    }
+    ir::erase_instruction(ctx.allocator, alloc);
+  }
+
+  ir::Pass_Result run_opt_ir_sroa(Allocator* const allocator,
+                                  ir::Function_Analyses& analyses)
+  {
+    SROA_Context ctx(allocator, analyses.get_module(), analyses.get_cfg());
+    // The elements of a split aggregate that are aggregates themselves are
+    // considered in the following round.
+    Array<ir::Instr_alloc*> allocs(allocator);
+    i64 changes = 0;
+    while(true) {
+      allocs.clear();
+      for(ir::Basic_Block* const block: ctx.cfg.blocks) {
+        for(ir::Instr& instruction: block->instructions) {
+          if(instruction.instr_kind != ir::Instr_Kind::e_alloc) {
+            continue;
+          }
+
+          auto const alloc = static_cast<ir::Instr_alloc*>(&instruction);
+          if(is_splittable(ctx, alloc)) {
+            allocs.push_back(alloc);
+          }
+        }
+      }
+
+      if(allocs.size() == 0) {
+        break;
+      }
+
+      for(ir::Instr_alloc* const alloc: allocs) {
+        split_alloc(ctx, alloc);
+      }
+      changes += allocs.size();
+    }
+
+    // Only instructions are inserted and removed, the blocks and the branches
+    // between them are unchanged.
+    return ir::Pass_Result{
+      .changes = changes,
+      .preserved = {.cfg = true,
+                    .dominator_tree = true,
+                    .post_dominator_tree = true,
+                    .loop_info = true}};
+  }
+} // namespace vush
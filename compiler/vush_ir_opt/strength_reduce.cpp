@@ -0,0 +1,534 @@
+#include <vush_ir_opt/opts.hpp>
+
+#include <vush_core/memory.hpp>
+#include <vush_ir/analysis.hpp>
+#include <vush_ir/types.hpp>
+
+// The division by constants follows
+//   Granlund, Montgomery, "Division by Invariant Integers using
+//   Multiplication", for the unsigned division and
+//   Warren, "Hacker's Delight", chapter 10, for the signed division.
+
+namespace vush {
+  namespace {
+    struct Reduction_Context {
+      Allocator* allocator;
+      ir::Module* module;
+
+      Reduction_Context(Allocator* allocator, ir::Module* module)
+        : allocator(allocator), module(module)
+      {
+      }
+    };
+
+    // Signed_Magic
+    // The multiplier and the shift replacing the signed division by a
+    // constant.
+    //
+    struct Signed_Magic {
+      u32 multiplier;
+      i64 shift;
+    };
+  } // namespace
+
+  // is_int32_type
+  // Only the scalar 32 bit integers are reduced. The arithmetic of the
+  // smaller integers is not modular in 32 bits.
+  //
+  [[nodiscard]] static bool is_int32_type(ir::Type const& type)
+  {
+    return type.kind == ir::Type_Kind::e_int32 ||
+           type.kind == ir::Type_Kind::e_uint32;
+  }
+
+  [[nodiscard]] static bool get_constant_bits(ir::Value const* const value,
+                                              u32& bits)
+  {
+    if(ir::instanceof<ir::Constant_i32>(value)) {
+      bits = static_cast<u32>(
+        static_cast<ir::Constant_i32 const*>(value)->value);
+      return true;
+    }
+
+    if(ir::instanceof<ir::Constant_u32>(value)) {
+      bits = static_cast<ir::Constant_u32 const*>(value)->value;
+      return true;
+    }
+
+    return false;
+  }
+
+  [[nodiscard]] static ir::Constant* make_int_constant(Allocator* allocator,
+                                                       ir::Type const& type,
+                                                       u32 const bits)
+  {
+    if(type.kind == ir::Type_Kind::e_int32) {
+      return ir::make_constant_i32(allocator, static_cast<i32>(bits));
+    } else {
+      return ir::make_constant_u32(allocator, bits);
+    }
+  }
+
+  [[nodiscard]] static bool is_power_of_two(u32 const value)
+  {
+    return value != 0 && (value & (value - 1)) == 0;
+  }
+
+  [[nodiscard]] static i64 floor_log2(u32 value)
+  {
+    i64 result = -1;
+    while(value != 0) {
+      value >>= 1;
+      result += 1;
+    }
+    return result;
+  }
+
+  // emit_alu
+  // Create an ALU instruction of the type and insert it after the position,
+  // which is then advanced to the new instruction.
+  //
+  [[nodiscard]] static ir::Instr_ALU*
+  emit_alu(Reduction_Context& ctx, ir::Instr*& position, ir::Type* const type,
+           ir::ALU_Opcode const op, ir::Value* const src1,
+           ir::Value* const src2)
+  {
+    auto const instr =
+      ir::make_instr_alu(ctx.allocator, ctx.module->next_id(), type, op, src1,
+                         src2, position->source_info);
+    anton::ilist_insert_after(position, instr);
+    instr->block = position->block;
+    position = instr;
+    return instr;
+  }
+
+  // emit_udiv_magic
+  // Emit the unsigned division by a constant that is not a power of two as
+  // q = (t + ((n - t) >> 1)) >> (l - 1) where t = umulhi(n, m).
+  //
+  [[nodiscard]] static ir::Value* emit_udiv_magic(Reduction_Context& ctx,
+                                                  ir::Instr*& position,
+                                                  ir::Type* const type,
+                                                  ir::Value* const n,
+                                                  u32 const d)
+  {
+    // l = ceil(log2(d)). The multiplier fits in 32 bits since 2^(l-1) < d.
+    i64 const l = floor_log2(d) + 1;
+    u64 const m = ((u64(1) << 32) * ((u64(1) << l) - d)) / d + 1;
+    Allocator* const allocator = ctx.allocator;
+    ir::Value* const t =
+      emit_alu(ctx, position, type, ir::ALU_Opcode::e_umulhi, n,
+               make_int_constant(allocator, *type, static_cast<u32>(m)));
+    ir::Value* const negated_t =
+      emit_alu(ctx, position, type, ir::ALU_Opcode::e_neg, t, nullptr);
+    ir::Value* const difference =
+      emit_alu(ctx, position, type, ir::ALU_Opcode::e_uadd, n, negated_t);
+    ir::Value* const halved =
+      emit_alu(ctx, position, type, ir::ALU_Opcode::e_shr, difference,
+               make_int_constant(allocator, *type, 1));
+    ir::Value* const sum =
+      emit_alu(ctx, position, type, ir::ALU_Opcode::e_uadd, t, halved);
+    return emit_alu(ctx, position, type, ir::ALU_Opcode::e_shr, sum,
+                    make_int_constant(allocator, *type, l - 1));
+  }
+
+  // compute_signed_magic
+  // The divisor must be positive and not a power of two.
+  //
+  [[nodiscard]] static Signed_Magic compute_signed_magic(u32 const d)
+  {
+    u32 const two31 = 0x80000000u;
+    u32 const anc = two31 - 1 - two31 % d;
+    i64 p = 31;
+    u32 q1 = two31 / anc;
+    u32 r1 = two31 - q1 * anc;
+    u32 q2 = two31 / d;
+    u32 r2 = two31 - q2 * d;
+    while(true) {
+      p += 1;
+      q1 = 2 * q1;
+      r1 = 2 * r1;
+      if(r1 >= anc) {
+        q1 += 1;
+        r1 -= anc;
+      }
+
+      q2 = 2 * q2;
+      r2 = 2 * r2;
+      if(r2 >= d) {
+        q2 += 1;
+        r2 -= d;
+      }
+
+      u32 const delta = d - r2;
+      if(q1 > delta || (q1 == delta && r1 != 0)) {
+        break;
+      }
+    }
+    return Signed_Magic{.multiplier = q2 + 1, .shift = p - 32};
+  }
+
+  // emit_sdiv_magic
+  // Emit the signed division by a positive constant that is not a power of
+  // two. The quotient rounded towards negative infinity is corrected by
+  // adding its sign bit.
+  //
+  [[nodiscard]] static ir::Value* emit_sdiv_magic(Reduction_Context& ctx,
+                                                  ir::Instr*& position,
+                                                  ir::Type* const type,
+                                                  ir::Value* const n,
+                                                  u32 const d)
+  {
+    Signed_Magic const magic = compute_signed_magic(d);
+    Allocator* const allocator = ctx.allocator;
+    ir::Value* q =
+      emit_alu(ctx, position, type, ir::ALU_Opcode::e_imulhi, n,
+               make_int_constant(allocator, *type, magic.multiplier));
+    // The multiplier does not fit in a positive i32.
+    if(magic.multiplier >= 0x80000000u) {
+      q = emit_alu(ctx, position, type, ir::ALU_Opcode::e_iadd, q, n);
+    }
+
+    if(magic.shift > 0) {
+      q = emit_alu(ctx, position, type, ir::ALU_Opcode::e_ashr, q,
+                   make_int_constant(allocator, *type, magic.shift));
+    }
+
+    ir::Value* const sign =
+      emit_alu(ctx, position, type, ir::ALU_Opcode::e_shr, q,
+               make_int_constant(allocator, *type, 31));
+    return emit_alu(ctx, position, type, ir::ALU_Opcode::e_iadd, q, sign);
+  }
+
+  // emit_sdiv_power_of_two
+  // Emit the signed division by 2^k. The negative dividends are biased by
+  // 2^k - 1 so that the arithmetic shift rounds towards zero.
+  //
+  [[nodiscard]] static ir::Value* emit_sdiv_power_of_two(Reduction_Context& ctx,
+                                                         ir::Instr*& position,
+                                                         ir::Type* const type,
+                                                         ir::Value* const n,
+                                                         i64 const k)
+  {
+    Allocator* const allocator = ctx.allocator;
+    ir::Value* const sign =
+      emit_alu(ctx, position, type, ir::ALU_Opcode::e_ashr, n,
+               make_int_constant(allocator, *type, 31));
+    ir::Value* const bias =
+      emit_alu(ctx, position, type, ir::ALU_Opcode::e_shr, sign,
+               make_int_constant(allocator, *type, 32 - k));
+    ir::Value* const biased =
+      emit_alu(ctx, position, type, ir::ALU_Opcode::e_iadd, n, bias);
+    return emit_alu(ctx, position, type, ir::ALU_Opcode::e_ashr, biased,
+                    make_int_constant(allocator, *type, k));
+  }
+
+  // reduce_alu
+  //
+  // Returns:
+  // The value replacing the instruction or nullptr if it cannot be reduced.
+  //
+  [[nodiscard]] static ir::Value* reduce_alu(Reduction_Context& ctx,
+                                             ir::Instr_ALU* const alu)
+  {
+    u32 d = 0;
+    if(!is_int32_type(*alu->type) || alu->src2 == nullptr ||
+       !get_constant_bits(alu->src2, d)) {
+      return nullptr;
+    }
+
+    Allocator* const allocator = ctx.allocator;
+    ir::Type* const type = alu->type;
+    ir::Value* const n = alu->src1;
+    ir::Instr* position = alu;
+    switch(alu->op) {
+    case ir::ALU_Opcode::e_imul:
+    case ir::ALU_Opcode::e_umul:
+      if(d <= 1 || !is_power_of_two(d)) {
+        return nullptr;
+      }
+      return emit_alu(ctx, position, type, ir::ALU_Opcode::e_shl, n,
+                      make_int_constant(allocator, *type, floor_log2(d)));
+
+    case ir::ALU_Opcode::e_udiv:
+      if(d <= 1) {
+        return nullptr;
+      } else if(is_power_of_two(d)) {
+        return emit_alu(ctx, position, type, ir::ALU_Opcode::e_shr, n,
+                        make_int_constant(allocator, *type, floor_log2(d)));
+      } else {
+        return emit_udiv_magic(ctx, position, type, n, d);
+      }
+
+    case ir::ALU_Opcode::e_urem: {
+      if(d <= 1) {
+        return nullptr;
+      } else if(is_power_of_two(d)) {
+        return emit_alu(ctx, position, type, ir::ALU_Opcode::e_and, n,
+                        make_int_constant(allocator, *type, d - 1));
+      }
+
+      // r = n - q * d
+      ir::Value* const q = emit_udiv_magic(ctx, position, type, n, d);
+      ir::Value* const product =
+        emit_alu(ctx, position, type, ir::ALU_Opcode::e_umul, q,
+                 make_int_constant(allocator, *type, 0u - d));
+      return emit_alu(ctx, position, type, ir::ALU_Opcode::e_uadd, n,
+                      product);
+    }
+
+    case ir::ALU_Opcode::e_idiv:
+    case ir::ALU_Opcode::e_irem: {
+      // The division by 0 and -1 is left intact as it might be undefined.
+      // The magnitude of the minimum value does not fit in i32.
+      i32 const sd = static_cast<i32>(d);
+      if(sd == 0 || sd == 1 || sd == -1 || d == 0x80000000u) {
+        return nullptr;
+      }
+
+      u32 const ad = sd < 0 ? 0u - d : d;
+      bool const power_of_two = is_power_of_two(ad);
+      ir::Value* q = nullptr;
+      if(power_of_two) {
+        q = emit_sdiv_power_of_two(ctx, position, type, n, floor_log2(ad));
+      } else {
+        q = emit_sdiv_magic(ctx, position, type, n, ad);
+      }
+
+      if(alu->op == ir::ALU_Opcode::e_idiv) {
+        if(sd < 0) {
+          q = emit_alu(ctx, position, type, ir::ALU_Opcode::e_neg, q, nullptr);
+        }
+        return q;
+      }
+
+      // The remainder has the sign of the dividend, hence equals
+      // n - (n / |d|) * |d|.
+      ir::Value* product = nullptr;
+      if(power_of_two) {
+        ir::Value* const shifted =
+          emit_alu(ctx, position, type, ir::ALU_Opcode::e_shl, q,
+                   make_int_constant(allocator, *type, floor_log2(ad)));
+        product = emit_alu(ctx, position, type, ir::ALU_Opcode::e_neg,
+                           shifted, nullptr);
+      } else {
+        product = emit_alu(ctx, position, type, ir::ALU_Opcode::e_imul, q,
+                           make_int_constant(allocator, *type, 0u - ad));
+      }
+      return emit_alu(ctx, position, type, ir::ALU_Opcode::e_iadd, n,
+                      product);
+    }
+
+    default:
+      return nullptr;
+    }
+  }
+
+  // insert_before_terminator
+  //
+  static void insert_before_terminator(ir::Basic_Block* const block,
+                                       ir::Instr* const instr)
+  {
+    ir::Instr* const terminator = block->get_last();
+    anton::ilist_erase(terminator);
+    block->insert(instr);
+    block->insert(terminator);
+  }
+
+  [[nodiscard]] static ir::Value* get_phi_source(ir::Instr_phi const* phi,
+                                                 ir::Basic_Block const* block)
+  {
+    for(ir::Phi_Source const& src: phi->srcs) {
+      if(src.block == block) {
+        return src.value;
+      }
+    }
+    return nullptr;
+  }
+
+  // get_other_operand
+  //
+  // Returns:
+  // The operand of the binary instruction that is not the value or nullptr
+  // if the value is not an operand.
+  //
+  [[nodiscard]] static ir::Value* get_other_operand(ir::Instr_ALU const* alu,
+                                                    ir::Value const* value)
+  {
+    if(alu->src1 == value) {
+      return alu->src2;
+    } else if(alu->src2 == value) {
+      return alu->src1;
+    } else {
+      return nullptr;
+    }
+  }
+
+  // reduce_induction_variables
+  // Replace the multiplications of the induction variables of the loop by
+  // constants with induction variables of their own advanced by additions.
+  // Only the induction variables of the form i = phi(init, i + step) are
+  // considered, where step is a constant.
+  //
+  // Returns:
+  // The number of replaced multiplications.
+  //
+  [[nodiscard]] static i64 reduce_induction_variables(
+    Reduction_Context& ctx, ir::CFG const& cfg, ir::Loop_Info const& loop_info,
+    ir::Loop const* const loop)
+  {
+    if(loop->latches.size() != 1) {
+      return 0;
+    }
+
+    ir::Basic_Block* entering = nullptr;
+    for(i64 const predecessor: cfg.predecessors[loop->header]) {
+      if(loop_info.contains(loop, predecessor)) {
+        continue;
+      }
+
+      if(entering != nullptr) {
+        return 0;
+      }
+      entering = cfg.blocks[predecessor];
+    }
+
+    if(entering == nullptr) {
+      return 0;
+    }
+
+    ir::Basic_Block* const header = cfg.blocks[loop->header];
+    ir::Basic_Block* const latch = cfg.blocks[loop->latches[0]];
+    // The phis inserted by the reduction are not considered.
+    Array<ir::Instr_phi*> phis(ctx.allocator);
+    for(ir::Instr& instruction: header->instructions) {
+      if(instruction.instr_kind != ir::Instr_Kind::e_phi) {
+        break;
+      }
+      phis.push_back(static_cast<ir::Instr_phi*>(&instruction));
+    }
+
+    i64 reduced = 0;
+    Array<ir::Instr_ALU*> multiplications(ctx.allocator);
+    for(ir::Instr_phi* const phi: phis) {
+      ir::Value* const init = get_phi_source(phi, entering);
+      ir::Value* const next = get_phi_source(phi, latch);
+      if(phi->srcs.size() != 2 || !is_int32_type(*phi->type) ||
+         init == nullptr || !ir::instanceof<ir::Instr_ALU>(next)) {
+        continue;
+      }
+
+      auto const increment = static_cast<ir::Instr_ALU const*>(next);
+      u32 step = 0;
+      if((increment->op != ir::ALU_Opcode::e_iadd &&
+          increment->op != ir::ALU_Opcode::e_uadd) ||
+         !get_constant_bits(get_other_operand(increment, phi), step)) {
+        continue;
+      }
+
+      multiplications.clear();
+      for(ir::Use const* const use: phi->get_uses()) {
+        if(!ir::instanceof<ir::Instr_ALU>(use->user)) {
+          continue;
+        }
+
+        auto const alu = static_cast<ir::Instr_ALU*>(use->user);
+        u32 factor = 0;
+        i64 const block = cfg.get_index(alu->block);
+        if((alu->op == ir::ALU_Opcode::e_imul ||
+            alu->op == ir::ALU_Opcode::e_umul) &&
+           block != -1 && loop_info.contains(loop, block) &&
+           get_constant_bits(get_other_operand(alu, phi), factor) &&
+           factor > 1) {
+          multiplications.push_back(alu);
+        }
+      }
+
+      ir::Type* const type = phi->type;
+      ir::ALU_Opcode const add_op = type->kind == ir::Type_Kind::e_int32
+                                      ? ir::ALU_Opcode::e_iadd
+                                      : ir::ALU_Opcode::e_uadd;
+      for(ir::Instr_ALU* const multiplication: multiplications) {
+        u32 factor = 0;
+        if(!get_constant_bits(get_other_operand(multiplication, phi),
+                              factor)) {
+          continue;
+        }
+
+        // The products wrap around exactly as the multiplication does.
+        ir::Value* start = nullptr;
+        u32 init_bits = 0;
+        if(get_constant_bits(init, init_bits)) {
+          start = make_int_constant(ctx.allocator, *type, init_bits * factor);
+        } else {
+          auto const product = ir::make_instr_alu(
+            ctx.allocator, ctx.module->next_id(), type, multiplication->op,
+            init, make_int_constant(ctx.allocator, *type, factor),
+            multiplication->source_info);
+          insert_before_terminator(entering, product);
+          start = product;
+        }
+
+        auto const reduced_phi =
+          ir::make_instr_phi(ctx.allocator, ctx.module->next_id(), type,
+                             phi->source_info);
+        header->instructions.insert_front(*reduced_phi);
+        reduced_phi->block = header;
+        auto const advanced = ir::make_instr_alu(
+          ctx.allocator, ctx.module->next_id(), type, add_op, reduced_phi,
+          make_int_constant(ctx.allocator, *type, step * factor),
+          multiplication->source_info);
+        insert_before_terminator(latch, advanced);
+        reduced_phi->add_source(start, entering);
+        reduced_phi->add_source(advanced, latch);
+
+        ir::replace_uses_with(multiplication, reduced_phi);
+        ir::erase_instruction(ctx.allocator, multiplication);
+        reduced += 1;
+      }
+    }
+    return reduced;
+  }
+
+  ir::Pass_Result run_opt_ir_strength_reduce(Allocator* const allocator,
+                                             ir::Function_Analyses& analyses)
+  {
+    ir::CFG const& cfg = analyses.get_cfg();
+    ir::Loop_Info const& loop_info = analyses.get_loop_info();
+    Reduction_Context ctx(allocator, analyses.get_module());
+
+    // The multiplications of the induction variables are replaced before
+    // the remaining ones are turned into shifts.
+    i64 changes = 0;
+    for(ir::Loop const* const loop: loop_info.loops) {
+      changes += reduce_induction_variables(ctx, cfg, loop_info, loop);
+    }
+
+    Array<ir::Instr_ALU*> candidates(allocator);
+    for(ir::Basic_Block* const block: cfg.blocks) {
+      for(ir::Instr& instruction: block->instructions) {
+        if(instruction.instr_kind == ir::Instr_Kind::e_alu) {
+          candidates.push_back(static_cast<ir::Instr_ALU*>(&instruction));
+        }
+      }
+    }
+
+    for(ir::Instr_ALU* const alu: candidates) {
+      ir::Value* const replacement = reduce_alu(ctx, alu);
+      if(replacement != nullptr) {
+        ir::replace_uses_with(alu, replacement);
+        ir::erase_instruction(allocator, alu);
+        changes += 1;
+      }
+    }
+
+    // Only instructions are inserted and removed, the blocks and the branches
+    // between them are unchanged.
+    return ir::Pass_Result{
+      .changes = changes,
+      .preserved = {.cfg = true,
+                    .dominator_tree = true,
+                    .post_dominator_tree = true,
+                    .loop_info = true}};
+  }
+} // namespace vush
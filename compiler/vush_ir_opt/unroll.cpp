@@ -0,0 +1,787 @@
+#include <vush_ir_opt/opts.hpp>
+
+#include <anton/flat_hash_map.hpp>
+#include <anton/flat_hash_set.hpp>
+
+#include <vush_core/memory.hpp>
+#include <vush_ir/analysis.hpp>
+
+namespace vush {
+  // The cost model. The size of a loop is the number of its instructions.
+  // A loop is fully unrolled when its size multiplied by the trip count does
+  // not exceed the threshold. The loops marked @unroll are given a larger
+  // budget.
+  constexpr i64 unroll_threshold = 200;
+  constexpr i64 forced_unroll_threshold = 2048;
+  // The loops that are not fully unrolled are partially unrolled by the
+  // largest factor that divides the trip count and keeps the size of the
+  // unrolled body within the threshold. A factor requested by @unroll(N) that
+  // does not divide the trip count is honoured by peeling the remaining
+  // iterations in front of the loop.
+  constexpr i64 partial_unroll_threshold = 64;
+  constexpr i64 max_unroll_factor = 8;
+  // The trip count is computed by evaluating the exit test of the loop at
+  // most this many times.
+  constexpr i64 max_trip_count = 4096;
+
+  namespace {
+    // Unroll_Candidate
+    // A loop entered through a single unconditional branch that has a single
+    // latch and is left only through the exit test of its header.
+    //
+    // Members:
+    //     entering - the block outside of the loop branching to the header.
+    //        latch - the continue block of the loop containing the only back
+    //                edge.
+    //       inside - the successor of the header within the loop.
+    //       blocks - the blocks of the loop other than the header.
+    //   trip_count - the number of iterations the loop executes.
+    //         size - the number of instructions of the loop.
+    //
+    struct Unroll_Candidate {
+      ir::Basic_Block* header = nullptr;
+      ir::Basic_Block* entering = nullptr;
+      ir::Basic_Block* latch = nullptr;
+      ir::Basic_Block* inside = nullptr;
+      ir::Intrinsic_scf_loop_head* scf_loop_head = nullptr;
+      Array<ir::Basic_Block*> blocks;
+      Array<ir::Instr_phi*> phis;
+      i64 trip_count = 0;
+      i64 size = 0;
+
+      Unroll_Candidate(Allocator* allocator): blocks(allocator), phis(allocator)
+      {
+      }
+    };
+
+    // Clone_Map
+    // The correspondence between the values and blocks of the loop and their
+    // clones in one of the unrolled iterations. The phis of the header map to
+    // their values in the iteration.
+    //
+    struct Clone_Map {
+      anton::Flat_Hash_Map<ir::Value const*, ir::Value*> values;
+      anton::Flat_Hash_Map<ir::Basic_Block const*, ir::Basic_Block*> blocks;
+
+      Clone_Map(Allocator* allocator): values(allocator), blocks(allocator) {}
+    };
+
+    struct Unroll_Context {
+      Allocator* allocator;
+      ir::Module* module;
+
+      Unroll_Context(Allocator* allocator, ir::Module* module)
+        : allocator(allocator), module(module)
+      {
+      }
+    };
+  } // namespace
+
+  [[nodiscard]] static ir::Intrinsic_scf_loop_head*
+  find_scf_loop_head(ir::Basic_Block* const block)
+  {
+    for(ir::Instr& instruction: block->instructions) {
+      if(instruction.instr_kind == ir::Instr_Kind::e_intrinsic &&
+         static_cast<ir::Instr_intrinsic&>(instruction).intrinsic_kind ==
+           ir::Intrinsic_Kind::e_scf_loop_head) {
+        return static_cast<ir::Intrinsic_scf_loop_head*>(&instruction);
+      }
+    }
+    return nullptr;
+  }
+
+  [[nodiscard]] static bool get_constant_bits(ir::Value const* const value,
+                                              u32& bits)
+  {
+    if(ir::instanceof<ir::Constant_i32>(value)) {
+      auto const constant = static_cast<ir::Constant_i32 const*>(value);
+      bits = static_cast<u32>(constant->value);
+      return true;
+    }
+
+    if(ir::instanceof<ir::Constant_u32>(value)) {
+      bits = static_cast<ir::Constant_u32 const*>(value)->value;
+      return true;
+    }
+
+    return false;
+  }
+
+  [[nodiscard]] static bool is_integer_compare(ir::ALU_Opcode const op)
+  {
+    switch(op) {
+    case ir::ALU_Opcode::e_icmp_eq:
+    case ir::ALU_Opcode::e_icmp_neq:
+    case ir::ALU_Opcode::e_icmp_ugt:
+    case ir::ALU_Opcode::e_icmp_ult:
+    case ir::ALU_Opcode::e_icmp_uge:
+    case ir::ALU_Opcode::e_icmp_ule:
+    case ir::ALU_Opcode::e_icmp_sgt:
+    case ir::ALU_Opcode::e_icmp_slt:
+    case ir::ALU_Opcode::e_icmp_sge:
+    case ir::ALU_Opcode::e_icmp_sle:
+      return true;
+
+    default:
+      return false;
+    }
+  }
+
+  [[nodiscard]] static bool evaluate_compare(ir::ALU_Opcode const op,
+                                             u32 const lhs, u32 const rhs)
+  {
+    i32 const slhs = static_cast<i32>(lhs);
+    i32 const srhs = static_cast<i32>(rhs);
+    switch(op) {
+    case ir::ALU_Opcode::e_icmp_eq:
+      return lhs == rhs;
+    case ir::ALU_Opcode::e_icmp_neq:
+      return lhs != rhs;
+    case ir::ALU_Opcode::e_icmp_ugt:
+      return lhs > rhs;
+    case ir::ALU_Opcode::e_icmp_ult:
+      return lhs < rhs;
+    case ir::ALU_Opcode::e_icmp_uge:
+      return lhs >= rhs;
+    case ir::ALU_Opcode::e_icmp_ule:
+      return lhs <= rhs;
+    case ir::ALU_Opcode::e_icmp_sgt:
+      return slhs > srhs;
+    case ir::ALU_Opcode::e_icmp_slt:
+      return slhs < srhs;
+    case ir::ALU_Opcode::e_icmp_sge:
+      return slhs >= srhs;
+    case ir::ALU_Opcode::e_icmp_sle:
+      return slhs <= srhs;
+    default:
+      ANTON_UNREACHABLE("not an integer comparison");
+    }
+  }
+
+  [[nodiscard]] static ir::Value* get_phi_source(ir::Instr_phi* const phi,
+                                                 ir::Basic_Block* const block)
+  {
+    for(ir::Phi_Source const& src: phi->srcs) {
+      if(src.block == block) {
+        return src.value;
+      }
+    }
+    ANTON_UNREACHABLE("phi has no source from the block");
+  }
+
+  // get_step
+  // Match an induction variable stepped by a constant on every iteration,
+  // i.e. a phi of the header whose value on the back edge is the sum of the
+  // phi and a constant.
+  //
+  [[nodiscard]] static bool get_step(Unroll_Candidate const& candidate,
+                                     ir::Instr_phi* const phi, u32& step)
+  {
+    ir::Value* const next = get_phi_source(phi, candidate.latch);
+    if(!ir::instanceof<ir::Instr_ALU>(next)) {
+      return false;
+    }
+
+    auto const add = static_cast<ir::Instr_ALU const*>(next);
+    if(add->op != ir::ALU_Opcode::e_iadd && add->op != ir::ALU_Opcode::e_uadd) {
+      return false;
+    }
+
+    if(add->src1 == phi) {
+      return get_constant_bits(add->src2, step);
+    }
+
+    if(add->src2 == phi) {
+      return get_constant_bits(add->src1, step);
+    }
+
+    return false;
+  }
+
+  // compute_trip_count
+  // Evaluate the exit test of the header on the successive values of the
+  // induction variable it compares against a constant. The arithmetic wraps
+  // around as it does in the IR.
+  //
+  // Returns:
+  // The number of iterations or -1 if the loop is not counted or the count
+  // exceeds the limit.
+  //
+  [[nodiscard]] static i64
+  compute_trip_count(Unroll_Candidate const& candidate,
+                     ir::Instr_brcond const* const brcond)
+  {
+    if(!ir::instanceof<ir::Instr_ALU>(brcond->condition)) {
+      return -1;
+    }
+
+    auto const compare = static_cast<ir::Instr_ALU const*>(brcond->condition);
+    if(!is_integer_compare(compare->op)) {
+      return -1;
+    }
+
+    bool const swapped = ir::instanceof<ir::Instr_phi>(compare->src2);
+    ir::Value* const variable = swapped ? compare->src2 : compare->src1;
+    u32 bound = 0;
+    if(!get_constant_bits(swapped ? compare->src1 : compare->src2, bound)) {
+      return -1;
+    }
+
+    ir::Instr_phi* phi = nullptr;
+    for(ir::Instr_phi* const header_phi: candidate.phis) {
+      if(header_phi == variable) {
+        phi = header_phi;
+      }
+    }
+
+    u32 value = 0;
+    u32 step = 0;
+    if(phi == nullptr ||
+       !get_constant_bits(get_phi_source(phi, candidate.entering), value) ||
+       !get_step(candidate, phi, step)) {
+      return -1;
+    }
+
+    bool const continue_on_true = brcond->then_target == candidate.inside;
+    for(i64 iteration = 0; iteration <= max_trip_count; iteration += 1) {
+      bool const result = swapped ? evaluate_compare(compare->op, bound, value)
+                                  : evaluate_compare(compare->op, value, bound);
+      if(result != continue_on_true) {
+        return iteration;
+      }
+      value += step;
+    }
+    return -1;
+  }
+
+  // analyse_loop
+  // Check whether the loop is a candidate for unrolling and compute its trip
+  // count.
+  //
+  [[nodiscard]] static bool analyse_loop(ir::CFG const& cfg,
+                                         ir::Loop_Info const& loop_info,
+                                         ir::Loop const* const loop,
+                                         Unroll_Candidate& candidate)
+  {
+    ir::Basic_Block* const header = cfg.blocks[loop->header];
+    ir::Intrinsic_scf_loop_head* const scf_loop_head =
+      find_scf_loop_head(header);
+    if(scf_loop_head == nullptr ||
+       scf_loop_head->unroll_hint == ir::Unroll_Hint::e_nounroll ||
+       loop->latches.size() != 1) {
+      return false;
+    }
+
+    ir::Basic_Block* const latch = cfg.blocks[loop->latches[0]];
+    if(latch != scf_loop_head->continue_block ||
+       latch->get_last()->instr_kind != ir::Instr_Kind::e_branch) {
+      return false;
+    }
+
+    for(i64 const predecessor: cfg.predecessors[loop->header]) {
+      if(loop_info.contains(loop, predecessor)) {
+        continue;
+      }
+
+      if(candidate.entering != nullptr) {
+        return false;
+      }
+      candidate.entering = cfg.blocks[predecessor];
+    }
+
+    if(candidate.entering == nullptr ||
+       candidate.entering->get_last()->instr_kind != ir::Instr_Kind::e_branch) {
+      return false;
+    }
+
+    ir::Instr* const terminator = header->get_last();
+    if(terminator->instr_kind != ir::Instr_Kind::e_brcond) {
+      return false;
+    }
+
+    auto const brcond = static_cast<ir::Instr_brcond*>(terminator);
+    if(brcond->else_target == scf_loop_head->merge_block) {
+      candidate.inside = brcond->then_target;
+    } else if(brcond->then_target == scf_loop_head->merge_block) {
+      candidate.inside = brcond->else_target;
+    } else {
+      return false;
+    }
+
+    i64 const inside = cfg.get_index(candidate.inside);
+    if(candidate.inside == header || !loop_info.contains(loop, inside)) {
+      return false;
+    }
+
+    // The loop must be left only through the exit test of the header.
+    for(i64 const block: loop->blocks) {
+      if(block == loop->header) {
+        continue;
+      }
+
+      for(i64 const successor: cfg.successors[block]) {
+        if(!loop_info.contains(loop, successor)) {
+          return false;
+        }
+      }
+      candidate.blocks.push_back(cfg.blocks[block]);
+    }
+
+    for(i64 const block: loop->blocks) {
+      for(ir::Instr const& instruction: cfg.blocks[block]->instructions) {
+        if(instruction.instr_kind != ir::Instr_Kind::e_intrinsic) {
+          candidate.size += 1;
+        }
+      }
+    }
+
+    for(ir::Instr& instruction: header->instructions) {
+      if(instruction.instr_kind != ir::Instr_Kind::e_phi) {
+        break;
+      }
+      candidate.phis.push_back(static_cast<ir::Instr_phi*>(&instruction));
+    }
+
+    candidate.header = header;
+    candidate.latch = latch;
+    candidate.scf_loop_head = scf_loop_head;
+    candidate.trip_count = compute_trip_count(candidate, brcond);
+    return candidate.trip_count >= 0;
+  }
+
+  [[nodiscard]] static ir::Value* resolve_value(Clone_Map const& map,
+                                                ir::Value* const value)
+  {
+    auto const iterator = map.values.find(value);
+    if(iterator != map.values.end()) {
+      return iterator->value;
+    }
+    return value;
+  }
+
+  [[nodiscard]] static ir::Basic_Block*
+  get_cloned_block(Unroll_Context& ctx, Clone_Map& map,
+                   ir::Basic_Block* const block)
+  {
+    auto iterator = map.blocks.find(block);
+    if(iterator == map.blocks.end()) {
+      // An unreachable converge, merge or continue block that is never
+      // cloned.
+      auto const clone =
+        VUSH_ALLOCATE(ir::Basic_Block, ctx.allocator, ctx.module->next_id());
+      iterator = map.blocks.emplace(block, clone);
+    }
+    return iterator->value;
+  }
+
+  static void remap_blocks(Unroll_Context& ctx, Clone_Map& map,
+                           ir::Instr* const instr)
+  {
+    switch(instr->instr_kind) {
+    case ir::Instr_Kind::e_intrinsic: {
+      auto const intrinsic = static_cast<ir::Instr_intrinsic*>(instr);
+      if(intrinsic->intrinsic_kind == ir::Intrinsic_Kind::e_scf_branch_head) {
+        auto const head = static_cast<ir::Intrinsic_scf_branch_head*>(instr);
+        head->converge_block =
+          get_cloned_block(ctx, map, head->converge_block);
+      } else if(intrinsic->intrinsic_kind ==
+                ir::Intrinsic_Kind::e_scf_loop_head) {
+        auto const head = static_cast<ir::Intrinsic_scf_loop_head*>(instr);
+        head->merge_block = get_cloned_block(ctx, map, head->merge_block);
+        head->continue_block =
+          get_cloned_block(ctx, map, head->continue_block);
+      }
+    } break;
+
+    case ir::Instr_Kind::e_branch: {
+      auto const branch = static_cast<ir::Instr_branch*>(instr);
+      branch->target = get_cloned_block(ctx, map, branch->target);
+    } break;
+
+    case ir::Instr_Kind::e_brcond: {
+      auto const brcond = static_cast<ir::Instr_brcond*>(instr);
+      brcond->then_target = get_cloned_block(ctx, map, brcond->then_target);
+      brcond->else_target = get_cloned_block(ctx, map, brcond->else_target);
+    } break;
+
+    case ir::Instr_Kind::e_switch: {
+      auto const instr_switch = static_cast<ir::Instr_switch*>(instr);
+      instr_switch->default_label =
+        get_cloned_block(ctx, map, instr_switch->default_label);
+      for(ir::Switch_Label& label: instr_switch->labels) {
+        label.target = get_cloned_block(ctx, map, label.target);
+      }
+    } break;
+
+    default:
+      break;
+    }
+  }
+
+  // clone_iteration
+  // Clone the blocks of one iteration of the loop. The clone of the header
+  // consists of the instructions of the header other than the phis, the loop
+  // head and the exit test and branches to the clone of the successor within
+  // the loop. The back edge of the clone branches to the next header. The map
+  // must contain the values of the phis of the header in the iteration.
+  //
+  static void clone_iteration(Unroll_Context& ctx,
+                              Unroll_Candidate const& candidate,
+                              Clone_Map& map,
+                              ir::Basic_Block* const header_clone,
+                              ir::Basic_Block* const next_header)
+  {
+    map.blocks.emplace(candidate.header, next_header);
+    for(ir::Basic_Block* const block: candidate.blocks) {
+      auto const clone =
+        VUSH_ALLOCATE(ir::Basic_Block, ctx.allocator, ctx.module->next_id());
+      map.blocks.emplace(block, clone);
+    }
+
+    Array<ir::Instr*> clones(ctx.allocator);
+    for(ir::Instr& instruction: candidate.header->instructions) {
+      if(instruction.instr_kind == ir::Instr_Kind::e_phi ||
+         instruction.instr_kind == ir::Instr_Kind::e_intrinsic ||
+         ir::is_control_flow_instruction(&instruction)) {
+        continue;
+      }
+
+      ir::Instr* const clone = ir::clone_instruction(
+        ctx.allocator, &instruction, ctx.module->next_id());
+      map.values.emplace(&instruction, clone);
+      clones.push_back(clone);
+      header_clone->insert(clone);
+    }
+
+    ir::Instr* const exit_test = candidate.header->get_last();
+    auto const branch = ir::make_instr_branch(
+      ctx.allocator, ctx.module->next_id(),
+      map.blocks.find(candidate.inside)->value, exit_test->source_info);
+    header_clone->insert(branch);
+
+    for(ir::Basic_Block* const block: candidate.blocks) {
+      ir::Basic_Block* const clone_block = map.blocks.find(block)->value;
+      for(ir::Instr& instruction: block->instructions) {
+        ir::Instr* const clone = ir::clone_instruction(
+          ctx.allocator, &instruction, ctx.module->next_id());
+        map.values.emplace(&instruction, clone);
+        clones.push_back(clone);
+        clone_block->insert(clone);
+      }
+    }
+
+    for(ir::Instr* const clone: clones) {
+      for(ir::Use* use = clone->operands; use != nullptr;
+          use = use->next_operand) {
+        auto const value = map.values.find(use->value);
+        if(value != map.values.end()) {
+          ir::set_use(use, value->value);
+        }
+      }
+
+      // The edges from the header flow in from its clone instead.
+      if(clone->instr_kind == ir::Instr_Kind::e_phi) {
+        for(ir::Phi_Source& src: static_cast<ir::Instr_phi*>(clone)->srcs) {
+          src.block = src.block == candidate.header
+                        ? header_clone
+                        : get_cloned_block(ctx, map, src.block);
+        }
+      } else {
+        remap_blocks(ctx, map, clone);
+      }
+    }
+  }
+
+  // unroll_fully
+  // Replace the loop with a straight sequence of its iterations. The header
+  // remains as the final evaluation of the exit test, which now branches to
+  // the merge block unconditionally.
+  //
+  static void unroll_fully(Unroll_Context& ctx,
+                           Unroll_Candidate const& candidate)
+  {
+    i64 const trip_count = candidate.trip_count;
+    Array<ir::Basic_Block*> headers(ctx.allocator);
+    for(i64 i = 0; i < trip_count; i += 1) {
+      headers.push_back(
+        VUSH_ALLOCATE(ir::Basic_Block, ctx.allocator, ctx.module->next_id()));
+    }
+
+    Array<ir::Value*> values(ctx.allocator);
+    for(ir::Instr_phi* const phi: candidate.phis) {
+      values.push_back(get_phi_source(phi, candidate.entering));
+    }
+
+    for(i64 i = 0; i < trip_count; i += 1) {
+      Clone_Map map(ctx.allocator);
+      for(i64 j = 0; j < candidate.phis.size(); j += 1) {
+        map.values.emplace(candidate.phis[j], values[j]);
+      }
+
+      ir::Basic_Block* const next_header =
+        i + 1 < trip_count ? headers[i + 1] : candidate.header;
+      clone_iteration(ctx, candidate, map, headers[i], next_header);
+      for(i64 j = 0; j < candidate.phis.size(); j += 1) {
+        values[j] = resolve_value(
+          map, get_phi_source(candidate.phis[j], candidate.latch));
+      }
+    }
+
+    if(trip_count > 0) {
+      ir::retarget_terminator(candidate.entering->get_last(), candidate.header,
+                              headers[0]);
+    }
+
+    ir::Basic_Block* const merge_block = candidate.scf_loop_head->merge_block;
+    ir::replace_terminator_with_branch(ctx.allocator, candidate.header,
+                                       merge_block);
+    ir::erase_instruction(ctx.allocator, candidate.scf_loop_head);
+
+    // The original iterations are no longer reachable.
+    for(ir::Basic_Block* const block: candidate.blocks) {
+      for(ir::Instr& instruction: block->instructions) {
+        ir::drop_operands(ctx.allocator, &instruction);
+      }
+    }
+
+    for(i64 j = 0; j < candidate.phis.size(); j += 1) {
+      ir::replace_uses_with(candidate.phis[j], values[j]);
+      ir::erase_instruction(ctx.allocator, candidate.phis[j]);
+    }
+
+    for(ir::Basic_Block* const block: candidate.blocks) {
+      while(!block->empty()) {
+        ir::erase_instruction(ctx.allocator, block->get_first());
+      }
+    }
+  }
+
+  // peel_iterations
+  // Clone the first count iterations of the loop in front of it. The loop is
+  // entered from the latch of the last copy with the values of the phis after
+  // the peeled iterations, hence it executes count fewer iterations.
+  //
+  static void peel_iterations(Unroll_Context& ctx,
+                              Unroll_Candidate const& candidate,
+                              i64 const count)
+  {
+    Array<ir::Basic_Block*> headers(ctx.allocator);
+    for(i64 i = 0; i < count; i += 1) {
+      headers.push_back(
+        VUSH_ALLOCATE(ir::Basic_Block, ctx.allocator, ctx.module->next_id()));
+    }
+
+    Array<ir::Value*> values(ctx.allocator);
+    for(ir::Instr_phi* const phi: candidate.phis) {
+      values.push_back(get_phi_source(phi, candidate.entering));
+    }
+
+    ir::Basic_Block* latch = candidate.entering;
+    for(i64 i = 0; i < count; i += 1) {
+      Clone_Map map(ctx.allocator);
+      for(i64 j = 0; j < candidate.phis.size(); j += 1) {
+        map.values.emplace(candidate.phis[j], values[j]);
+      }
+
+      ir::Basic_Block* const next_header =
+        i + 1 < count ? headers[i + 1] : candidate.header;
+      clone_iteration(ctx, candidate, map, headers[i], next_header);
+      for(i64 j = 0; j < candidate.phis.size(); j += 1) {
+        values[j] = resolve_value(
+          map, get_phi_source(candidate.phis[j], candidate.latch));
+      }
+      latch = map.blocks.find(candidate.latch)->value;
+    }
+
+    ir::retarget_terminator(candidate.entering->get_last(), candidate.header,
+                            headers[0]);
+    for(i64 j = 0; j < candidate.phis.size(); j += 1) {
+      ir::Instr_phi* const phi = candidate.phis[j];
+      for(i64 i = 0; i < phi->srcs.size(); i += 1) {
+        if(phi->srcs[i].block == candidate.entering) {
+          phi->remove_source(i);
+          break;
+        }
+      }
+      phi->add_source(values[j], latch);
+    }
+  }
+
+  // unroll_partially
+  // Chain factor - 1 copies of the iteration after the original one. The
+  // exit tests of the copies are removed as the trip count is a multiple of
+  // the factor. The latch of the last copy becomes the continue block of the
+  // loop.
+  //
+  static void unroll_partially(Unroll_Context& ctx,
+                               Unroll_Candidate const& candidate,
+                               i64 const factor)
+  {
+    Array<ir::Basic_Block*> headers(ctx.allocator);
+    for(i64 i = 1; i < factor; i += 1) {
+      headers.push_back(
+        VUSH_ALLOCATE(ir::Basic_Block, ctx.allocator, ctx.module->next_id()));
+    }
+
+    Array<ir::Value*> values(ctx.allocator);
+    for(ir::Instr_phi* const phi: candidate.phis) {
+      values.push_back(get_phi_source(phi, candidate.latch));
+    }
+
+    ir::Basic_Block* latch = candidate.latch;
+    for(i64 i = 0; i < headers.size(); i += 1) {
+      Clone_Map map(ctx.allocator);
+      for(i64 j = 0; j < candidate.phis.size(); j += 1) {
+        map.values.emplace(candidate.phis[j], values[j]);
+      }
+
+      ir::Basic_Block* const next_header =
+        i + 1 < headers.size() ? headers[i + 1] : candidate.header;
+      clone_iteration(ctx, candidate, map, headers[i], next_header);
+      for(i64 j = 0; j < candidate.phis.size(); j += 1) {
+        values[j] = resolve_value(
+          map, get_phi_source(candidate.phis[j], candidate.latch));
+      }
+      latch = map.blocks.find(candidate.latch)->value;
+    }
+
+    // The original latch is retargeted only after it has been cloned so that
+    // the back edges of the copies are unaffected.
+    ir::retarget_terminator(candidate.latch->get_last(), candidate.header,
+                            headers[0]);
+    for(i64 j = 0; j < candidate.phis.size(); j += 1) {
+      ir::Instr_phi* const phi = candidate.phis[j];
+      for(i64 i = 0; i < phi->srcs.size(); i += 1) {
+        if(phi->srcs[i].block == candidate.latch) {
+          phi->remove_source(i);
+          break;
+        }
+      }
+      phi->add_source(values[j], latch);
+    }
+    candidate.scf_loop_head->continue_block = latch;
+  }
+
+  // select_unroll_factor
+  //
+  // Returns:
+  // The trip count if the loop is to be fully unrolled, a smaller factor if
+  // the loop is to be partially unrolled or 1 if the loop is not to be
+  // unrolled. Only a factor requested by @unroll(N) may leave a remainder of
+  // the trip count. Loops executing at most once are always fully unrolled as
+  // that does not duplicate any code.
+  //
+  [[nodiscard]] static i64
+  select_unroll_factor(Unroll_Candidate const& candidate)
+  {
+    i64 const trip_count = candidate.trip_count;
+    i64 const size = candidate.size;
+    ir::Intrinsic_scf_loop_head const* const head = candidate.scf_loop_head;
+    if(head->unroll_hint == ir::Unroll_Hint::e_unroll) {
+      // A count not less than the trip count requests a full unroll.
+      i64 factor = trip_count;
+      if(head->unroll_count > 0 && head->unroll_count < trip_count) {
+        factor = head->unroll_count;
+      }
+
+      // The remainder is peeled, hence it adds to the size.
+      i64 const remainder = factor < trip_count ? trip_count % factor : 0;
+      if((factor + remainder) * size > forced_unroll_threshold) {
+        return 1;
+      }
+      return factor;
+    }
+
+    if(trip_count * size <= unroll_threshold) {
+      return trip_count;
+    }
+
+    for(i64 factor = max_unroll_factor; factor > 1; factor -= 1) {
+      if(trip_count % factor == 0 &&
+         factor * size <= partial_unroll_threshold) {
+        return factor;
+      }
+    }
+    return 1;
+  }
+
+  [[nodiscard]] static bool unroll_loop(Unroll_Context& ctx,
+                                        Unroll_Candidate const& candidate)
+  {
+    i64 const factor = select_unroll_factor(candidate);
+    if(factor == candidate.trip_count) {
+      unroll_fully(ctx, candidate);
+      return true;
+    }
+
+    if(factor > 1) {
+      i64 const remainder = candidate.trip_count % factor;
+      if(remainder > 0) {
+        peel_iterations(ctx, candidate, remainder);
+      }
+      unroll_partially(ctx, candidate, factor);
+      return true;
+    }
+
+    return false;
+  }
+
+  ir::Pass_Result run_opt_ir_unroll(Allocator* const allocator,
+                                    ir::Function_Analyses& analyses)
+  {
+    ir::Function* const function = analyses.get_function();
+    ir::CFG const* cfg = &analyses.get_cfg();
+    ir::Loop_Info const* loop_info = &analyses.get_loop_info();
+    if(loop_info->loops.size() == 0) {
+      return ir::Pass_Result{.changes = 0,
+                             .preserved = {.cfg = true,
+                                           .dominator_tree = true,
+                                           .post_dominator_tree = true,
+                                           .loop_info = true}};
+    }
+
+    Unroll_Context ctx(allocator, analyses.get_module());
+    // Each loop is considered once. The analyses are rebuilt after every
+    // unrolled loop and the loops nested in it are considered anew as their
+    // copies have new headers.
+    anton::Flat_Hash_Set<ir::Basic_Block const*> attempted(allocator);
+    i64 changes = 0;
+    while(true) {
+      bool unrolled = false;
+      for(ir::Loop const* const loop: loop_info->loops) {
+        ir::Basic_Block const* const header = cfg->blocks[loop->header];
+        if(attempted.find(header) != attempted.end()) {
+          continue;
+        }
+
+        attempted.emplace(header);
+        Unroll_Candidate candidate(allocator);
+        if(analyse_loop(*cfg, *loop_info, loop, candidate) &&
+           unroll_loop(ctx, candidate)) {
+          unrolled = true;
+          break;
+        }
+      }
+
+      if(!unrolled) {
+        break;
+      }
+
+      changes += 1;
+      cfg = ir::build_cfg(allocator, function);
+      ir::Dominator_Tree const* const dominator_tree =
+        ir::build_dominator_tree(allocator, *cfg);
+      loop_info = ir::build_loop_info(allocator, *cfg, *dominator_tree);
+    }
+
+    if(changes > 0) {
+      return ir::Pass_Result{.changes = changes};
+    }
+
+    return ir::Pass_Result{.changes = 0,
+                           .preserved = {.cfg = true,
+                                         .dominator_tree = true,
+                                         .post_dominator_tree = true,
+                                         .loop_info = true}};
+  }
+} // namespace vush
@@ -0,0 +1,386 @@
+#include <vush_module/module.hpp>
+
+#include <stdio.h>
+
+#include <anton/filesystem.hpp>
+#include <anton/ilist.hpp>
+
+#include <vush_core/context.hpp>
+#include <vush_core/memory.hpp>
+#include <vush_core/running_hash.hpp>
+
+// The modules are mapped into memory and written with the POSIX file API on
+// the platforms that provide it. Elsewhere the modules are read into memory
+// and written with the anton file streams.
+#if defined(__unix__) || defined(__APPLE__)
+  #include <fcntl.h>
+  #include <stdlib.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+  #define VUSH_MODULE_MMAP 1
+#else
+  #define VUSH_MODULE_MMAP 0
+#endif
+
+namespace vush {
+  using namespace anton::literals;
+
+  // The layout of a module file is the header followed by the nodes of the
+  // syntax tree in preorder. The file is only ever read by the compiler that
+  // wrote it, therefore the data is stored in the native byte order. The
+  // header and the nodes are aligned within the file, hence they are read in
+  // place from the contents of the file.
+
+  // Bump whenever the layout of the file or the syntax tree produced by the
+  // parser changes.
+  static constexpr u32 module_version = 1;
+  static constexpr u64 module_magic = 0x31444F4D48535556; // "VUSHMOD1"
+  static constexpr u32 snot_kind_count =
+    static_cast<u32>(SNOT_Kind::for_expression) + 1;
+
+  struct Module_Header {
+    u64 magic;
+    u32 version;
+    u32 snot_kind_count;
+    u64 path_hash;
+    u64 source_hash;
+    i64 source_size;
+    // The number of the top-level nodes.
+    i64 root_count;
+    // The number of all nodes in the file.
+    i64 node_count;
+  };
+
+  struct Module_Node {
+    u32 kind;
+    // The number of the direct children of the node.
+    i32 child_count;
+    i32 line;
+    i32 column;
+    i32 offset;
+    i32 end_offset;
+  };
+
+  static_assert(sizeof(Module_Header) % alignof(Module_Node) == 0,
+                "the nodes following the header must be aligned");
+
+  [[nodiscard]] static u64 hash_string(anton::String_View const string)
+  {
+    Running_Hash hash;
+    hash.start();
+    hash.feed(string);
+    return hash.finish();
+  }
+
+  // get_module_path
+  // The modules are named after the hash of the path of their source, so that
+  // sources with equal names in different directories do not collide.
+  //
+  [[nodiscard]] static anton::String
+  get_module_path(Allocator* const allocator,
+                  anton::String_View const directory, u64 const path_hash)
+  {
+    char8 const* const digits = "0123456789abcdef";
+    char8 name[22] = "0000000000000000.vushm";
+    for(i32 i = 0; i < 16; i += 1) {
+      name[i] = digits[(path_hash >> (60 - 4 * i)) & 0xF];
+    }
+    return anton::fs::concat_paths(allocator, directory,
+                                   anton::String_View{name, name + 22});
+  }
+
+  // Module_File
+  // Read-only view of the contents of a module file. The contents are aligned
+  // to at least the alignment of Module_Header.
+  //
+  struct Module_File {
+  private:
+#if VUSH_MODULE_MMAP
+    void* mapping = nullptr;
+#else
+    // u64 elements align the contents for the header.
+    Array<u64> contents;
+#endif
+
+  public:
+    u8 const* data = nullptr;
+    i64 size = 0;
+
+    Module_File(Allocator* const allocator, anton::String const& path)
+#if !VUSH_MODULE_MMAP
+      : contents(allocator)
+#endif
+    {
+#if VUSH_MODULE_MMAP
+      ANTON_UNUSED(allocator);
+      int const fd = open(path.data(), O_RDONLY);
+      if(fd == -1) {
+        return;
+      }
+
+      struct stat status;
+      if(fstat(fd, &status) == 0 && status.st_size > 0) {
+        void* const result =
+          mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(result != MAP_FAILED) {
+          mapping = result;
+          data = static_cast<u8 const*>(result);
+          size = status.st_size;
+        }
+      }
+      // The mapping remains valid after the descriptor has been closed.
+      close(fd);
+#else
+      anton::fs::Input_File_Stream file;
+      if(!file.open(path)) {
+        return;
+      }
+
+      file.seek(anton::Seek_Dir::end, 0);
+      i64 const file_size = file.tell();
+      file.seek(anton::Seek_Dir::beg, 0);
+      i64 const element_count = (file_size + sizeof(u64) - 1) / sizeof(u64);
+      contents = Array<u64>(allocator, anton::reserve, element_count);
+      contents.force_size(element_count);
+      file.read(contents.data(), file_size);
+      data = reinterpret_cast<u8 const*>(contents.data());
+      size = file_size;
+#endif
+    }
+
+    Module_File(Module_File const&) = delete;
+    Module_File& operator=(Module_File const&) = delete;
+
+    ~Module_File()
+    {
+#if VUSH_MODULE_MMAP
+      if(mapping != nullptr) {
+        munmap(mapping, size);
+      }
+#endif
+    }
+  };
+
+  struct Deserialise_Context {
+    Allocator* allocator;
+    Source_Data const* source;
+    Module_Node const* nodes;
+    i64 node_count;
+    i64 next_node;
+  };
+
+  // deserialise_list
+  // Read count consecutive sibling nodes along with their children.
+  //
+  // Returns:
+  // The first node of the list or nullptr if the list is empty. Sets failed
+  // to true when the data is malformed.
+  //
+  [[nodiscard]] static SNOT* deserialise_list(Deserialise_Context& ctx,
+                                              i64 const count, bool& failed)
+  {
+    SNOT* first = nullptr;
+    SNOT* previous = nullptr;
+    for(i64 i = 0; i < count; i += 1) {
+      if(ctx.next_node >= ctx.node_count) {
+        failed = true;
+        return nullptr;
+      }
+
+      Module_Node const& node = ctx.nodes[ctx.next_node];
+      ctx.next_node += 1;
+      i64 const source_size = ctx.source->data.size_bytes();
+      if(node.kind >= snot_kind_count || node.child_count < 0 ||
+         node.offset < 0 || node.offset > node.end_offset ||
+         node.end_offset > source_size) {
+        failed = true;
+        return nullptr;
+      }
+
+      Source_Info const source_info{.source = ctx.source,
+                                    .line = node.line,
+                                    .column = node.column,
+                                    .offset = node.offset,
+                                    .end_offset = node.end_offset};
+      SNOT* const snot =
+        VUSH_ALLOCATE(SNOT, ctx.allocator, static_cast<SNOT_Kind>(node.kind),
+                      source_info);
+      snot->children = deserialise_list(ctx, node.child_count, failed);
+      if(failed) {
+        return nullptr;
+      }
+
+      if(previous != nullptr) {
+        anton::ilist_insert_after(previous, snot);
+      } else {
+        first = snot;
+      }
+      previous = snot;
+    }
+    return first;
+  }
+
+  SNOT* load_module(Context const& ctx, Source_Data const* const source)
+  {
+    if(ctx.module_cache_directory.size_bytes() == 0) {
+      return nullptr;
+    }
+
+    u64 const path_hash = hash_string(source->path);
+    anton::String const path = get_module_path(
+      ctx.syntax_allocator, ctx.module_cache_directory, path_hash);
+    Module_File const file(ctx.syntax_allocator, path);
+    if(file.size < static_cast<i64>(sizeof(Module_Header))) {
+      return nullptr;
+    }
+
+    Module_Header const& header =
+      *reinterpret_cast<Module_Header const*>(file.data);
+    if(header.magic != module_magic || header.version != module_version ||
+       header.snot_kind_count != snot_kind_count ||
+       header.path_hash != path_hash ||
+       header.source_size != source->data.size_bytes() ||
+       header.node_count < 0 || header.root_count < 0) {
+      return nullptr;
+    }
+
+    // A truncated or partially written file is treated as out of date.
+    i64 const nodes_size = file.size - sizeof(Module_Header);
+    i64 const node_size = sizeof(Module_Node);
+    if(nodes_size % node_size != 0 ||
+       nodes_size / node_size != header.node_count) {
+      return nullptr;
+    }
+
+    // Hashing is the most expensive part of the validation, therefore we do it
+    // only after all the cheap checks have passed.
+    if(header.source_hash != hash_string(source->data)) {
+      return nullptr;
+    }
+
+    auto const nodes = reinterpret_cast<Module_Node const*>(
+      file.data + sizeof(Module_Header));
+    Deserialise_Context deserialise_ctx{.allocator = ctx.syntax_allocator,
+                                        .source = source,
+                                        .nodes = nodes,
+                                        .node_count = header.node_count,
+                                        .next_node = 0};
+    bool failed = false;
+    SNOT* const snots =
+      deserialise_list(deserialise_ctx, header.root_count, failed);
+    if(failed || deserialise_ctx.next_node != header.node_count) {
+      return nullptr;
+    }
+
+    return snots;
+  }
+
+  [[nodiscard]] static i64 serialise_list(Array<Module_Node>& nodes,
+                                          SNOT const* snots)
+  {
+    i64 count = 0;
+    for(SNOT const* snot = snots; snot != nullptr;
+        snot = anton::ilist_next(snot)) {
+      count += 1;
+      i64 const index = nodes.size();
+      nodes.push_back(Module_Node{.kind = static_cast<u32>(snot->kind),
+                                  .child_count = 0,
+                                  .line = snot->source_info.line,
+                                  .column = snot->source_info.column,
+                                  .offset = snot->source_info.offset,
+                                  .end_offset = snot->source_info.end_offset});
+      i64 const child_count = serialise_list(nodes, snot->children);
+      nodes[index].child_count = static_cast<i32>(child_count);
+    }
+    return count;
+  }
+
+#if VUSH_MODULE_MMAP
+  [[nodiscard]] static bool write_all(int const fd, void const* const data,
+                                      i64 const size)
+  {
+    u8 const* bytes = static_cast<u8 const*>(data);
+    i64 remaining = size;
+    while(remaining > 0) {
+      ssize_t const written = write(fd, bytes, remaining);
+      if(written <= 0) {
+        return false;
+      }
+      bytes += written;
+      remaining -= written;
+    }
+    return true;
+  }
+#endif
+
+  // write_module_file
+  // Write the module to a temporary file in the directory of the module and
+  // rename it into place. A concurrent compilation never observes a partially
+  // written module and a failed write leaves the previous module intact.
+  //
+  static void write_module_file(Allocator* const allocator,
+                                anton::String const& path,
+                                Module_Header const& header,
+                                Array<Module_Node> const& nodes)
+  {
+    i64 const nodes_size = nodes.size() * sizeof(Module_Node);
+#if VUSH_MODULE_MMAP
+    anton::String temporary_path =
+      anton::concat(allocator, path, ".XXXXXX"_sv);
+    int const fd = mkstemp(temporary_path.data());
+    if(fd == -1) {
+      return;
+    }
+
+    bool const written = write_all(fd, &header, sizeof(Module_Header)) &&
+                         write_all(fd, nodes.data(), nodes_size);
+    bool const closed = close(fd) == 0;
+    if(!written || !closed ||
+       rename(temporary_path.data(), path.data()) != 0) {
+      unlink(temporary_path.data());
+    }
+#else
+    anton::String const temporary_path =
+      anton::concat(allocator, path, ".tmp"_sv);
+    {
+      anton::fs::Output_File_Stream file;
+      if(!file.open(temporary_path)) {
+        return;
+      }
+
+      file.write(&header, sizeof(Module_Header));
+      file.write(nodes.data(), nodes_size);
+    }
+    // rename does not replace an existing file on all platforms.
+    remove(path.data());
+    if(rename(temporary_path.data(), path.data()) != 0) {
+      remove(temporary_path.data());
+    }
+#endif
+  }
+
+  void store_module(Context const& ctx, Source_Data const* const source,
+                    SNOT const* const snots)
+  {
+    if(ctx.module_cache_directory.size_bytes() == 0) {
+      return;
+    }
+
+    Array<Module_Node> nodes{ctx.syntax_allocator};
+    i64 const root_count = serialise_list(nodes, snots);
+    u64 const path_hash = hash_string(source->path);
+    Module_Header const header{.magic = module_magic,
+                               .version = module_version,
+                               .snot_kind_count = snot_kind_count,
+                               .path_hash = path_hash,
+                               .source_hash = hash_string(source->data),
+                               .source_size = source->data.size_bytes(),
+                               .root_count = root_count,
+                               .node_count = nodes.size()};
+
+    anton::String const path = get_module_path(
+      ctx.syntax_allocator, ctx.module_cache_directory, path_hash);
+    write_module_file(ctx.syntax_allocator, path, header, nodes);
+  }
+} // namespace vush
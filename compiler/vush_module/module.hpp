@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vush_core/source_info.hpp>
+#include <vush_syntax/syntax.hpp>
+
+namespace vush {
+  struct Context;
+
+  // Precompiled modules
+  //
+  // A precompiled module stores the syntax tree of an imported source so that
+  // subsequent compilations may skip lexing and parsing it. The module is
+  // identified by the path of the source and records the hash of the contents
+  // of the source it has been built from. A module whose hash does not match
+  // the current contents of the source is ignored and rebuilt.
+  //
+  // Imports within the source are not expanded in the module. Each imported
+  // source has its own module, hence a change to a source invalidates only
+  // the module of that source.
+  //
+  // Modules are stored in Context::module_cache_directory. The cache is
+  // disabled when the directory is empty.
+  //
+
+  // load_module
+  // Load the syntax tree of a source from its precompiled module. The nodes
+  // are allocated with the syntax allocator.
+  //
+  // Returns:
+  // The syntax tree or nullptr if the module does not exist, is invalid or is
+  // out of date.
+  //
+  [[nodiscard]] SNOT* load_module(Context const& ctx,
+                                  Source_Data const* source);
+
+  // store_module
+  // Write the precompiled module of a source. Failures are ignored as the
+  // module is only a cache.
+  //
+  void store_module(Context const& ctx, Source_Data const* source,
+                    SNOT const* snots);
+} // namespace vush
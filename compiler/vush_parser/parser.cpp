@@ -633,6 +633,11 @@ namespace vush {
       auto attribute_list = try_attribute_list();
 
       _lexer.ignore_whitespace_and_comments();
+      lookahead = _lexer.peek_token();
+      if(!lookahead) {
+        set_error(u8"expected declaration");
+        return nullptr;
+      }
 
       // Match declarations that do allow attribute lists.
       switch(lookahead->kind) {
@@ -1101,14 +1106,11 @@ namespace vush {
       case Token_Kind::kw_switch:
         return try_stmt_switch();
 
+      case Token_Kind::tk_at:
       case Token_Kind::kw_for:
-        return try_stmt_for();
-
       case Token_Kind::kw_while:
-        return try_stmt_while();
-
       case Token_Kind::kw_do:
-        return try_stmt_do_while();
+        return try_stmt_loop();
 
       case Token_Kind::kw_return:
         return try_stmt_return();
@@ -1219,10 +1221,11 @@ namespace vush {
               auto label = ALLOCATE_SNOT(SNOT_Kind::switch_arm_label,
                                          source_info, expr_default);
               snots.insert_back(label);
-            } else if(auto literal = try_expr_lt_integer()) {
-              Source_Info const source_info = literal->source_info;
+            } else if(auto expression = try_expression_without_init()) {
+              // Labels are constant expressions that are folded by sema.
+              Source_Info const source_info = expression->source_info;
               auto label = ALLOCATE_SNOT(SNOT_Kind::switch_arm_label,
-                                         source_info, literal);
+                                         source_info, expression);
               snots.insert_back(label);
             } else {
               _lexer.restore_state(begin_state);
@@ -1270,7 +1273,39 @@ namespace vush {
       return ALLOCATE_SNOT(SNOT_Kind::stmt_switch, source, snots.unlink());
     }
 
-    SNOT* try_stmt_for()
+    // try_stmt_loop
+    // Match a loop statement preceded by an optional attribute list. Loops are
+    // the only statements that permit attribute lists.
+    //
+    SNOT* try_stmt_loop()
+    {
+      ANNOTATE_FUNCTION()
+      // The attribute list is moved into the matched loop.
+      auto attribute_list = try_attribute_list();
+
+      _lexer.ignore_whitespace_and_comments();
+      Optional<Token> lookahead = _lexer.peek_token();
+      if(lookahead) {
+        switch(lookahead->kind) {
+        case Token_Kind::kw_for:
+          return try_stmt_for(attribute_list);
+
+        case Token_Kind::kw_while:
+          return try_stmt_while(attribute_list);
+
+        case Token_Kind::kw_do:
+          return try_stmt_do_while(attribute_list);
+
+        default:
+          break;
+        }
+      }
+
+      set_error(u8"expected a loop statement");
+      return nullptr;
+    }
+
+    SNOT* try_stmt_for(SNOT* attribute_list)
     {
       ANNOTATE_FUNCTION()
       auto match_for_stmt_variable = [this]() -> SNOT* {
@@ -1317,12 +1352,13 @@ namespace vush {
 
       EXPECT_NODE(try_stmt_block, snots);
 
+      snots.insert_front(attribute_list);
       Lexer_State const end_state = _lexer.get_current_state_noskip();
       Source_Info const source = src_info(begin_state, end_state);
       return ALLOCATE_SNOT(SNOT_Kind::stmt_for, source, snots.unlink());
     }
 
-    SNOT* try_stmt_while()
+    SNOT* try_stmt_while(SNOT* attribute_list)
     {
       ANNOTATE_FUNCTION()
       Lexer_State const begin_state = _lexer.get_current_state();
@@ -1330,12 +1366,13 @@ namespace vush {
       EXPECT_TOKEN(Token_Kind::kw_while, "expected 'while'"_sv, snots);
       EXPECT_NODE(try_expression_without_init, snots);
       EXPECT_NODE(try_stmt_block, snots);
+      snots.insert_front(attribute_list);
       Lexer_State const end_state = _lexer.get_current_state_noskip();
       Source_Info const source = src_info(begin_state, end_state);
       return ALLOCATE_SNOT(SNOT_Kind::stmt_while, source, snots.unlink());
     }
 
-    SNOT* try_stmt_do_while()
+    SNOT* try_stmt_do_while(SNOT* attribute_list)
     {
       ANNOTATE_FUNCTION()
       Lexer_State const begin_state = _lexer.get_current_state();
@@ -1345,6 +1382,7 @@ namespace vush {
       EXPECT_TOKEN_SKIP(Token_Kind::kw_while, "expected 'while'"_sv, snots);
       EXPECT_NODE(try_expression, snots);
       EXPECT_TOKEN_SKIP(Token_Kind::tk_semicolon, "expected ';'"_sv, snots);
+      snots.insert_front(attribute_list);
       Lexer_State const end_state = _lexer.get_current_state_noskip();
       Source_Info const source = src_info(begin_state, end_state);
       return ALLOCATE_SNOT(SNOT_Kind::stmt_do_while, source, snots.unlink());
@@ -2192,7 +2230,8 @@ namespace vush {
 
         EXPECT_TOKEN_SKIP(Token_Kind::tk_semicolon, "expected ';'"_sv, snots);
 
-        if(auto size = try_expr_lt_integer()) {
+        // The size is a constant expression evaluated by sema.
+        if(auto size = try_expression()) {
           Source_Info const source_info = size->source_info;
           snots.insert_back(
             ALLOCATE_SNOT(SNOT_Kind::type_array_size, source_info, size));
@@ -2298,7 +2337,7 @@ namespace vush {
                                              anton::Slice<Token const> tokens,
                                              Parse_Syntax_Options const options)
   {
-    Parser parser(ctx.bump_allocator, source,
+    Parser parser(ctx.syntax_allocator, source,
                   Lexer(tokens.cbegin(), tokens.cend()));
     anton::Expected<SNOT*, Error> ast = parser.build_syntax_tree();
     // if(ast && options.include_whitespace_and_comments) {
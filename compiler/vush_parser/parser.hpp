@@ -20,7 +20,8 @@ namespace vush {
 
   // parse_tokens
   //
-  // Builds the syntax tree from a tokenised source code.
+  // Builds the syntax tree from a tokenised source code. The nodes are
+  // allocated with the syntax allocator.
   //
   // Parameters:
   //  source - Pointer to the source information of the source being parsed.
@@ -0,0 +1,555 @@
+#include <vush_sema/const_eval.hpp>
+
+#include <anton/iterators/zip.hpp>
+#include <anton/optional.hpp>
+
+#include <vush_ast/ast.hpp>
+#include <vush_autogen/builtin_symbols.hpp>
+#include <vush_core/context.hpp>
+#include <vush_core/memory.hpp>
+#include <vush_sema/diagnostics.hpp>
+
+namespace vush {
+  using namespace anton::literals;
+
+#define RETURN_ON_FAIL_VAR(variable, fn, ...)                    \
+  auto variable = fn(__VA_ARGS__);                               \
+  if(!variable) {                                                \
+    return {anton::expected_error, ANTON_MOV(variable.error())}; \
+  }
+
+  // Arithmetic is carried out on widened values, i.e. integers are widened to
+  // i64 and floating point values to f64, and then narrowed back to the kind
+  // of the operands. Both i32 and u32 are exactly representable in i64, hence
+  // sums and differences do not overflow, and narrowing wraps, which matches
+  // the semantics of the 32 bit operations. Products are computed in u64. The
+  // f32 operations evaluated in f64 and rounded back to f32 yield the same
+  // results as if they were evaluated in f32.
+
+  [[nodiscard]] static bool is_integer_kind(Constant_Kind const kind)
+  {
+    return kind == Constant_Kind::e_i32 || kind == Constant_Kind::e_u32;
+  }
+
+  [[nodiscard]] static Constant_Value make_bool(bool const value)
+  {
+    Constant_Value result;
+    result.bool_value = value;
+    result.kind = Constant_Kind::e_bool;
+    return result;
+  }
+
+  [[nodiscard]] static i64 widen_integer(Constant_Value const value)
+  {
+    switch(value.kind) {
+    case Constant_Kind::e_bool:
+      return value.bool_value;
+    case Constant_Kind::e_i32:
+      return value.i32_value;
+    case Constant_Kind::e_u32:
+      return value.u32_value;
+    case Constant_Kind::e_f32:
+      return static_cast<i64>(value.f32_value);
+    case Constant_Kind::e_f64:
+      return static_cast<i64>(value.f64_value);
+    }
+  }
+
+  [[nodiscard]] static f64 widen_fp(Constant_Value const value)
+  {
+    switch(value.kind) {
+    case Constant_Kind::e_bool:
+      return value.bool_value;
+    case Constant_Kind::e_i32:
+      return value.i32_value;
+    case Constant_Kind::e_u32:
+      return value.u32_value;
+    case Constant_Kind::e_f32:
+      return value.f32_value;
+    case Constant_Kind::e_f64:
+      return value.f64_value;
+    }
+  }
+
+  [[nodiscard]] static Constant_Value narrow_integer(Constant_Kind const kind,
+                                                     i64 const value)
+  {
+    Constant_Value result;
+    result.kind = kind;
+    switch(kind) {
+    case Constant_Kind::e_i32:
+      result.i32_value = static_cast<i32>(static_cast<u32>(value));
+      return result;
+    case Constant_Kind::e_u32:
+      result.u32_value = static_cast<u32>(value);
+      return result;
+    default:
+      ANTON_UNREACHABLE("kind is not integer");
+    }
+  }
+
+  [[nodiscard]] static Constant_Value narrow_fp(Constant_Kind const kind,
+                                                f64 const value)
+  {
+    Constant_Value result;
+    result.kind = kind;
+    switch(kind) {
+    case Constant_Kind::e_f32:
+      result.f32_value = static_cast<f32>(value);
+      return result;
+    case Constant_Kind::e_f64:
+      result.f64_value = value;
+      return result;
+    default:
+      ANTON_UNREACHABLE("kind is not floating point");
+    }
+  }
+
+  [[nodiscard]] static anton::Optional<Constant_Kind>
+  get_constant_kind(ast::Type const& generic_type)
+  {
+    if(generic_type.type_kind != ast::Type_Kind::type_builtin) {
+      return anton::null_optional;
+    }
+
+    auto const& type = static_cast<ast::Type_Builtin const&>(generic_type);
+    switch(type.value) {
+    case ast::Type_Builtin_Kind::e_bool:
+      return Constant_Kind::e_bool;
+    case ast::Type_Builtin_Kind::e_int:
+      return Constant_Kind::e_i32;
+    case ast::Type_Builtin_Kind::e_uint:
+      return Constant_Kind::e_u32;
+    case ast::Type_Builtin_Kind::e_float:
+      return Constant_Kind::e_f32;
+    case ast::Type_Builtin_Kind::e_double:
+      return Constant_Kind::e_f64;
+    default:
+      return anton::null_optional;
+    }
+  }
+
+  [[nodiscard]] static Constant_Value convert(Constant_Value const value,
+                                              Constant_Kind const kind)
+  {
+    if(value.kind == kind) {
+      return value;
+    }
+
+    switch(kind) {
+    case Constant_Kind::e_bool:
+      ANTON_UNREACHABLE("constants are not convertible to bool");
+
+    case Constant_Kind::e_i32:
+    case Constant_Kind::e_u32:
+      return narrow_integer(kind, widen_integer(value));
+
+    case Constant_Kind::e_f32:
+    case Constant_Kind::e_f64:
+      return narrow_fp(kind, widen_fp(value));
+    }
+  }
+
+  bool is_constant_type(ast::Type const& type)
+  {
+    return get_constant_kind(type).holds_value();
+  }
+
+  Constant_Value convert_constant(Constant_Value const value,
+                                  ast::Type const& type)
+  {
+    anton::Optional<Constant_Kind> const kind = get_constant_kind(type);
+    ANTON_ASSERT(kind.holds_value(), "type is not a constant type");
+    return convert(value, kind.value());
+  }
+
+  ast::Expr* materialise_constant(Allocator* const allocator,
+                                  Constant_Value const value,
+                                  Source_Info const& source_info)
+  {
+    ast::Expr* result = nullptr;
+    ast::Type_Builtin_Kind type = ast::Type_Builtin_Kind::e_bool;
+    switch(value.kind) {
+    case Constant_Kind::e_bool: {
+      result =
+        VUSH_ALLOCATE(ast::Lt_Bool, allocator, value.bool_value, source_info);
+      type = ast::Type_Builtin_Kind::e_bool;
+    } break;
+
+    case Constant_Kind::e_i32: {
+      result = VUSH_ALLOCATE(ast::Lt_Integer, allocator, ast::lt_integer_i32,
+                             value.i32_value, source_info);
+      type = ast::Type_Builtin_Kind::e_int;
+    } break;
+
+    case Constant_Kind::e_u32: {
+      result = VUSH_ALLOCATE(ast::Lt_Integer, allocator, ast::lt_integer_u32,
+                             value.u32_value, source_info);
+      type = ast::Type_Builtin_Kind::e_uint;
+    } break;
+
+    case Constant_Kind::e_f32: {
+      result = VUSH_ALLOCATE(ast::Lt_Float, allocator, ast::lt_float_f32,
+                             value.f32_value, source_info);
+      type = ast::Type_Builtin_Kind::e_float;
+    } break;
+
+    case Constant_Kind::e_f64: {
+      result = VUSH_ALLOCATE(ast::Lt_Float, allocator, ast::lt_float_f64,
+                             value.f64_value, source_info);
+      type = ast::Type_Builtin_Kind::e_double;
+    } break;
+    }
+
+    result->evaluated_type = get_builtin_type(type);
+    return result;
+  }
+
+  [[nodiscard]] static anton::Expected<Constant_Value, Error>
+  evaluate_unary_operator(Context const& ctx, ast::Expr_Call const* const expr,
+                          anton::String_View const op,
+                          Constant_Value const operand)
+  {
+    if(operand.kind == Constant_Kind::e_bool) {
+      if(op == "!"_sv) {
+        return {anton::expected_value, make_bool(!operand.bool_value)};
+      }
+    } else if(is_integer_kind(operand.kind)) {
+      i64 const value = widen_integer(operand);
+      if(op == "-"_sv) {
+        return {anton::expected_value, narrow_integer(operand.kind, -value)};
+      } else if(op == "~"_sv) {
+        return {anton::expected_value, narrow_integer(operand.kind, ~value)};
+      }
+    } else {
+      if(op == "-"_sv) {
+        f64 const value = widen_fp(operand);
+        return {anton::expected_value, narrow_fp(operand.kind, -value)};
+      }
+    }
+
+    return {anton::expected_error, err_expression_is_not_constant(ctx, expr)};
+  }
+
+  [[nodiscard]] static anton::Expected<Constant_Value, Error>
+  evaluate_binary_operator(Context const& ctx,
+                           ast::Expr_Call const* const expr,
+                           anton::String_View const op,
+                           Constant_Value const lhs, Constant_Value const rhs)
+  {
+    // The shift operators are the only ones whose operands may be of
+    // different kinds.
+    if(op == "<<"_sv || op == ">>"_sv) {
+      i64 const value = widen_integer(lhs);
+      i64 const shift = widen_integer(rhs);
+      if(shift < 0 || shift >= 32) {
+        return {anton::expected_error,
+                err_constant_shift_out_of_range(ctx, expr)};
+      }
+
+      if(op == "<<"_sv) {
+        u64 const result = static_cast<u64>(value) << shift;
+        return {anton::expected_value,
+                narrow_integer(lhs.kind, static_cast<i64>(result))};
+      } else {
+        // i32 values are sign extended, hence the shift is arithmetic. u32
+        // values are never negative, hence the shift is logical.
+        return {anton::expected_value,
+                narrow_integer(lhs.kind, value >> shift)};
+      }
+    }
+
+    ANTON_ASSERT(lhs.kind == rhs.kind, "operands are of different kinds");
+    if(lhs.kind == Constant_Kind::e_bool) {
+      bool const l = lhs.bool_value;
+      bool const r = rhs.bool_value;
+      if(op == "&&"_sv) {
+        return {anton::expected_value, make_bool(l && r)};
+      } else if(op == "||"_sv) {
+        return {anton::expected_value, make_bool(l || r)};
+      } else if(op == "^^"_sv || op == "!="_sv) {
+        return {anton::expected_value, make_bool(l != r)};
+      } else if(op == "=="_sv) {
+        return {anton::expected_value, make_bool(l == r)};
+      }
+    } else if(is_integer_kind(lhs.kind)) {
+      Constant_Kind const kind = lhs.kind;
+      i64 const l = widen_integer(lhs);
+      i64 const r = widen_integer(rhs);
+      if(op == "+"_sv) {
+        return {anton::expected_value, narrow_integer(kind, l + r)};
+      } else if(op == "-"_sv) {
+        return {anton::expected_value, narrow_integer(kind, l - r)};
+      } else if(op == "*"_sv) {
+        // The product of two u32 values overflows i64, hence we multiply in
+        // u64 where the overflow wraps.
+        u64 const result = static_cast<u64>(l) * static_cast<u64>(r);
+        return {anton::expected_value,
+                narrow_integer(kind, static_cast<i64>(result))};
+      } else if(op == "/"_sv || op == "%"_sv) {
+        if(r == 0) {
+          return {anton::expected_error,
+                  err_constant_division_by_zero(ctx, expr)};
+        }
+
+        i64 const result = op == "/"_sv ? l / r : l % r;
+        return {anton::expected_value, narrow_integer(kind, result)};
+      } else if(op == "&"_sv) {
+        return {anton::expected_value, narrow_integer(kind, l & r)};
+      } else if(op == "|"_sv) {
+        return {anton::expected_value, narrow_integer(kind, l | r)};
+      } else if(op == "^"_sv) {
+        return {anton::expected_value, narrow_integer(kind, l ^ r)};
+      } else if(op == "=="_sv) {
+        return {anton::expected_value, make_bool(l == r)};
+      } else if(op == "!="_sv) {
+        return {anton::expected_value, make_bool(l != r)};
+      } else if(op == "<"_sv) {
+        return {anton::expected_value, make_bool(l < r)};
+      } else if(op == ">"_sv) {
+        return {anton::expected_value, make_bool(l > r)};
+      } else if(op == "<="_sv) {
+        return {anton::expected_value, make_bool(l <= r)};
+      } else if(op == ">="_sv) {
+        return {anton::expected_value, make_bool(l >= r)};
+      }
+    } else {
+      Constant_Kind const kind = lhs.kind;
+      f64 const l = widen_fp(lhs);
+      f64 const r = widen_fp(rhs);
+      if(op == "+"_sv) {
+        return {anton::expected_value, narrow_fp(kind, l + r)};
+      } else if(op == "-"_sv) {
+        return {anton::expected_value, narrow_fp(kind, l - r)};
+      } else if(op == "*"_sv) {
+        return {anton::expected_value, narrow_fp(kind, l * r)};
+      } else if(op == "/"_sv) {
+        return {anton::expected_value, narrow_fp(kind, l / r)};
+      } else if(op == "=="_sv) {
+        return {anton::expected_value, make_bool(l == r)};
+      } else if(op == "!="_sv) {
+        return {anton::expected_value, make_bool(l != r)};
+      } else if(op == "<"_sv) {
+        return {anton::expected_value, make_bool(l < r)};
+      } else if(op == ">"_sv) {
+        return {anton::expected_value, make_bool(l > r)};
+      } else if(op == "<="_sv) {
+        return {anton::expected_value, make_bool(l <= r)};
+      } else if(op == ">="_sv) {
+        return {anton::expected_value, make_bool(l >= r)};
+      }
+    }
+
+    return {anton::expected_error, err_expression_is_not_constant(ctx, expr)};
+  }
+
+  [[nodiscard]] static Constant_Value
+  evaluate_min_max(Constant_Value const lhs, Constant_Value const rhs,
+                   bool const is_min)
+  {
+    if(is_integer_kind(lhs.kind)) {
+      i64 const l = widen_integer(lhs);
+      i64 const r = widen_integer(rhs);
+      bool const select_lhs = is_min ? l < r : l > r;
+      return select_lhs ? lhs : rhs;
+    } else {
+      f64 const l = widen_fp(lhs);
+      f64 const r = widen_fp(rhs);
+      // GLSL defines min and max as y < x ? y : x and x < y ? y : x.
+      bool const select_rhs = is_min ? r < l : l < r;
+      return select_rhs ? rhs : lhs;
+    }
+  }
+
+  [[nodiscard]] static anton::Expected<Constant_Value, Error>
+  evaluate_builtin_function(Context const& ctx,
+                            ast::Expr_Call const* const expr,
+                            anton::String_View const identifier,
+                            Constant_Value const* const arguments,
+                            i64 const count)
+  {
+    // Only the scalar overloads reach this point, hence all arguments are of
+    // the same kind.
+    if(count > 0 && arguments[0].kind != Constant_Kind::e_bool) {
+      Constant_Value const x = arguments[0];
+      if(identifier == "abs"_sv && count == 1) {
+        if(is_integer_kind(x.kind)) {
+          i64 const value = widen_integer(x);
+          return {anton::expected_value,
+                  narrow_integer(x.kind, value < 0 ? -value : value)};
+        } else {
+          f64 const value = widen_fp(x);
+          return {anton::expected_value,
+                  narrow_fp(x.kind, value < 0.0 ? -value : value)};
+        }
+      } else if(identifier == "sign"_sv && count == 1) {
+        if(is_integer_kind(x.kind)) {
+          i64 const value = widen_integer(x);
+          return {anton::expected_value,
+                  narrow_integer(x.kind, (value > 0) - (value < 0))};
+        } else {
+          f64 const value = widen_fp(x);
+          return {anton::expected_value,
+                  narrow_fp(x.kind, (value > 0.0) - (value < 0.0))};
+        }
+      } else if(identifier == "min"_sv && count == 2) {
+        return {anton::expected_value,
+                evaluate_min_max(x, arguments[1], true)};
+      } else if(identifier == "max"_sv && count == 2) {
+        return {anton::expected_value,
+                evaluate_min_max(x, arguments[1], false)};
+      } else if(identifier == "clamp"_sv && count == 3) {
+        // clamp(x, min_val, max_val) = min(max(x, min_val), max_val)
+        Constant_Value const lower = evaluate_min_max(x, arguments[1], false);
+        return {anton::expected_value,
+                evaluate_min_max(lower, arguments[2], true)};
+      }
+    }
+
+    return {anton::expected_error, err_expression_is_not_constant(ctx, expr)};
+  }
+
+  [[nodiscard]] static anton::Expected<Constant_Value, Error>
+  evaluate_expr_call(Context const& ctx, ast::Expr_Call const* const expr)
+  {
+    ast::Decl_Function const* const fn = expr->function;
+    // User functions are never evaluated at compile time.
+    if(fn == nullptr || !fn->builtin || expr->arguments.size() > 3) {
+      return {anton::expected_error,
+              err_expression_is_not_constant(ctx, expr)};
+    }
+
+    // Evaluate the arguments and convert them to the types of the parameters.
+    // Overloads with non-scalar parameters are not evaluated.
+    Constant_Value arguments[3];
+    i64 count = 0;
+    for(auto const [argument, parameter]:
+        anton::zip(expr->arguments, fn->parameters)) {
+      anton::Optional<Constant_Kind> const kind =
+        get_constant_kind(*parameter.type);
+      if(!kind) {
+        return {anton::expected_error,
+                err_expression_is_not_constant(ctx, expr)};
+      }
+
+      RETURN_ON_FAIL_VAR(value, evaluate_constant_expression, ctx, &argument);
+      arguments[count] = convert(value.value(), kind.value());
+      count += 1;
+    }
+
+    anton::Optional<Constant_Kind> const result_kind =
+      get_constant_kind(*fn->return_type);
+    if(!result_kind) {
+      return {anton::expected_error,
+              err_expression_is_not_constant(ctx, expr)};
+    }
+
+    anton::String_View const identifier = fn->identifier.value;
+    if(anton::begins_with(identifier, "operator"_sv)) {
+      anton::String_View const op =
+        anton::shrink_front_bytes(identifier, "operator"_sv.size_bytes());
+      if(count == 1) {
+        return evaluate_unary_operator(ctx, expr, op, arguments[0]);
+      } else if(count == 2) {
+        return evaluate_binary_operator(ctx, expr, op, arguments[0],
+                                        arguments[1]);
+      }
+
+      return {anton::expected_error,
+              err_expression_is_not_constant(ctx, expr)};
+    }
+
+    return evaluate_builtin_function(ctx, expr, identifier, arguments, count);
+  }
+
+  anton::Expected<Constant_Value, Error>
+  evaluate_constant_expression(Context const& ctx,
+                               ast::Expr const* const generic_expr)
+  {
+    switch(generic_expr->node_kind) {
+    case ast::Node_Kind::lt_bool: {
+      auto const expr = static_cast<ast::Lt_Bool const*>(generic_expr);
+      return {anton::expected_value, make_bool(expr->value)};
+    }
+
+    case ast::Node_Kind::lt_integer: {
+      auto const expr = static_cast<ast::Lt_Integer const*>(generic_expr);
+      switch(expr->kind) {
+      case ast::Lt_Integer_Kind::i32:
+        return {anton::expected_value,
+                narrow_integer(Constant_Kind::e_i32, expr->i32_value)};
+      case ast::Lt_Integer_Kind::u32:
+        return {anton::expected_value,
+                narrow_integer(Constant_Kind::e_u32, expr->u32_value)};
+      }
+    }
+
+    case ast::Node_Kind::lt_float: {
+      auto const expr = static_cast<ast::Lt_Float const*>(generic_expr);
+      switch(expr->kind) {
+      case ast::Lt_Float_Kind::f32:
+        return {anton::expected_value,
+                narrow_fp(Constant_Kind::e_f32, expr->f32_value)};
+      case ast::Lt_Float_Kind::f64:
+        return {anton::expected_value,
+                narrow_fp(Constant_Kind::e_f64, expr->f64_value)};
+      }
+    }
+
+    case ast::Node_Kind::expr_identifier: {
+      auto const expr = static_cast<ast::Expr_Identifier const*>(generic_expr);
+      // Only immutable variables with initializers may be constant.
+      // Parameters are never constant.
+      if(expr->definition == nullptr ||
+         expr->definition->node_kind != ast::Node_Kind::variable) {
+        return {anton::expected_error,
+                err_expression_is_not_constant(ctx, expr)};
+      }
+
+      auto const variable =
+        static_cast<ast::Variable const*>(expr->definition);
+      anton::Optional<Constant_Kind> const kind =
+        get_constant_kind(*variable->type);
+      if(variable->type->qualifiers.mut || variable->initializer == nullptr ||
+         !kind) {
+        return {anton::expected_error,
+                err_expression_is_not_constant(ctx, expr)};
+      }
+
+      RETURN_ON_FAIL_VAR(value, evaluate_constant_expression, ctx,
+                         variable->initializer);
+      return {anton::expected_value, convert(value.value(), kind.value())};
+    }
+
+    case ast::Node_Kind::expr_if: {
+      auto const expr = static_cast<ast::Expr_If const*>(generic_expr);
+      RETURN_ON_FAIL_VAR(condition, evaluate_constant_expression, ctx,
+                         expr->condition);
+      if(condition.value().kind != Constant_Kind::e_bool) {
+        return {anton::expected_error,
+                err_expression_is_not_constant(ctx, expr->condition)};
+      }
+
+      // Both branches must be constant regardless of the condition.
+      RETURN_ON_FAIL_VAR(then_value, evaluate_constant_expression, ctx,
+                         expr->then_branch);
+      RETURN_ON_FAIL_VAR(else_value, evaluate_constant_expression, ctx,
+                         expr->else_branch);
+      if(condition.value().bool_value) {
+        return {anton::expected_value, then_value.value()};
+      } else {
+        return {anton::expected_value, else_value.value()};
+      }
+    }
+
+    case ast::Node_Kind::expr_call: {
+      auto const expr = static_cast<ast::Expr_Call const*>(generic_expr);
+      return evaluate_expr_call(ctx, expr);
+    }
+
+    default:
+      return {anton::expected_error,
+              err_expression_is_not_constant(ctx, generic_expr)};
+    }
+  }
+} // namespace vush
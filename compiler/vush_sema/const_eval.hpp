@@ -0,0 +1,70 @@
+#pragma once
+
+#include <anton/expected.hpp>
+
+#include <vush_ast/fwd.hpp>
+#include <vush_core/source_info.hpp>
+#include <vush_core/types.hpp>
+#include <vush_diagnostics/error.hpp>
+
+namespace vush {
+  struct Context;
+
+  enum struct Constant_Kind : u8 {
+    e_bool,
+    e_i32,
+    e_u32,
+    e_f32,
+    e_f64,
+  };
+
+  // Constant_Value
+  // The result of a compile-time evaluation of an expression. Only scalars of
+  // builtin types are representable.
+  //
+  struct Constant_Value {
+    union {
+      bool bool_value;
+      i32 i32_value;
+      u32 u32_value;
+      f32 f32_value;
+      f64 f64_value;
+    };
+    Constant_Kind kind;
+  };
+
+  // is_constant_type
+  // Whether values of the type are representable by Constant_Value.
+  //
+  [[nodiscard]] bool is_constant_type(ast::Type const& type);
+
+  // evaluate_constant_expression
+  // Evaluate an expression at compile time. The expression must have been
+  // analysed. Constant expressions consist of literals, immutable variables
+  // with constant initializers, if expressions, builtin operators on scalars
+  // and a subset of the pure builtin functions (abs, sign, min, max, clamp).
+  // Only the exact builtin functions are evaluated, hence the results do not
+  // depend on the host library. sccp folds the extensions by the same policy.
+  //
+  // Returns:
+  // The value of the expression or an error if the expression is not constant
+  // or its evaluation is undefined.
+  //
+  [[nodiscard]] anton::Expected<Constant_Value, Error>
+  evaluate_constant_expression(Context const& ctx, ast::Expr const* expr);
+
+  // convert_constant
+  // Convert a constant to a type. The type must be a constant type and the
+  // conversion must be valid, i.e. checked by sema.
+  //
+  [[nodiscard]] Constant_Value convert_constant(Constant_Value value,
+                                                ast::Type const& type);
+
+  // materialise_constant
+  // Create a literal node with the value of the constant. The literal has its
+  // evaluated type set.
+  //
+  [[nodiscard]] ast::Expr* materialise_constant(Allocator* allocator,
+                                                Constant_Value value,
+                                                Source_Info const& source_info);
+} // namespace vush
@@ -440,4 +440,73 @@ namespace vush {
                          field_source_info);
     return error;
   }
+
+  Error err_expression_is_not_constant(Context const& ctx,
+                                       ast::Expr const* expr)
+  {
+    Source_Info const source_info = expr->source_info;
+    Error error = error_from_source(ctx.bump_allocator, source_info);
+    anton::String_View const source =
+      ctx.source_registry->find_source(source_info.source->path)->data;
+    error.diagnostic = "error: expression is not a constant expression"_sv;
+    print_source_snippet(ctx, error.extended_diagnostic, source, source_info);
+    error.extended_diagnostic +=
+      " constant expressions may consist only of literals, immutable variables "
+      "with constant initializers, builtin operators and the builtin functions "
+      "abs, sign, min, max and clamp"_sv;
+    return error;
+  }
+
+  Error err_constant_division_by_zero(Context const& ctx,
+                                      ast::Expr const* expr)
+  {
+    Source_Info const source_info = expr->source_info;
+    Error error = error_from_source(ctx.bump_allocator, source_info);
+    anton::String_View const source =
+      ctx.source_registry->find_source(source_info.source->path)->data;
+    error.diagnostic = "error: division by zero in a constant expression"_sv;
+    print_source_snippet(ctx, error.extended_diagnostic, source, source_info);
+    return error;
+  }
+
+  Error err_constant_shift_out_of_range(Context const& ctx,
+                                        ast::Expr const* expr)
+  {
+    Source_Info const source_info = expr->source_info;
+    Error error = error_from_source(ctx.bump_allocator, source_info);
+    anton::String_View const source =
+      ctx.source_registry->find_source(source_info.source->path)->data;
+    error.diagnostic =
+      "error: shift amount out of range in a constant expression"_sv;
+    print_source_snippet(ctx, error.extended_diagnostic, source, source_info);
+    error.extended_diagnostic +=
+      " the shift amount must be at least 0 and less than 32"_sv;
+    return error;
+  }
+
+  Error err_global_variable_not_constant(Context const& ctx,
+                                         ast::Variable const* variable)
+  {
+    Source_Info const source_info = variable->source_info;
+    Error error = error_from_source(ctx.bump_allocator, source_info);
+    anton::String_View const source =
+      ctx.source_registry->find_source(source_info.source->path)->data;
+    error.diagnostic = "error: global variable is not a constant"_sv;
+    print_source_snippet(ctx, error.extended_diagnostic, source, source_info);
+    error.extended_diagnostic += " global variables must be immutable and of "
+                                 "type bool, int, uint, float or double"_sv;
+    return error;
+  }
+
+  Error err_array_size_not_positive_integer(Context const& ctx,
+                                            ast::Expr const* expr)
+  {
+    Source_Info const source_info = expr->source_info;
+    Error error = error_from_source(ctx.bump_allocator, source_info);
+    anton::String_View const source =
+      ctx.source_registry->find_source(source_info.source->path)->data;
+    error.diagnostic = "error: array size is not a positive integer"_sv;
+    print_source_snippet(ctx, error.extended_diagnostic, source, source_info);
+    return error;
+  }
 } // namespace vush
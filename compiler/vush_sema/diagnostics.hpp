@@ -137,6 +137,22 @@ namespace vush {
   err_type_has_no_field_named(Context const& ctx, ast::Type const* type,
                               ast::Identifier const& field_identifier);
 
+  [[nodiscard]] Error err_expression_is_not_constant(Context const& ctx,
+                                                    ast::Expr const* expr);
+
+  [[nodiscard]] Error err_constant_division_by_zero(Context const& ctx,
+                                                   ast::Expr const* expr);
+
+  [[nodiscard]] Error err_constant_shift_out_of_range(Context const& ctx,
+                                                     ast::Expr const* expr);
+
+  [[nodiscard]] Error
+  err_global_variable_not_constant(Context const& ctx,
+                                   ast::Variable const* variable);
+
+  [[nodiscard]] Error err_array_size_not_positive_integer(Context const& ctx,
+                                                         ast::Expr const* expr);
+
   [[nodiscard]] inline Error
   err_image_parameter_not_image(Context const& ctx,
                                 ast::Fn_Parameter const& parameter)
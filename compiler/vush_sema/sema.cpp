@@ -1,6 +1,10 @@
 #include <vush_sema/sema.hpp>
 
+#include <atomic>
+#include <thread>
+
 #include <anton/algorithm.hpp>
+#include <anton/math/math.hpp>
 #include <anton/ranges.hpp>
 
 #include <vush_ast/ast.hpp>
@@ -9,6 +13,7 @@
 #include <vush_core/memory.hpp>
 #include <vush_core/scoped_map.hpp>
 #include <vush_diagnostics/diagnostics.hpp>
+#include <vush_sema/const_eval.hpp>
 #include <vush_sema/diagnostics.hpp>
 #include <vush_sema/typeconv.hpp>
 
@@ -120,8 +125,11 @@ namespace vush {
         type->size != nullptr
           ? VUSH_ALLOCATE(ast::Lt_Integer, allocator, *type->size)
           : nullptr;
-      return VUSH_ALLOCATE(ast::Type_Array, allocator, type->source_info,
-                           type->qualifiers, base, size);
+      auto const result =
+        VUSH_ALLOCATE(ast::Type_Array, allocator, type->source_info,
+                      type->qualifiers, base, size);
+      result->size_expression = type->size_expression;
+      return result;
     }
     }
   }
@@ -258,6 +266,40 @@ namespace vush {
     return {anton::expected_value, candidates[0]};
   }
 
+  [[nodiscard]] static anton::Expected<void, Error>
+  analyse_expression(Context& ctx, Symbol_Table& symtable,
+                     ast::Expr* const expression);
+
+  // evaluate_array_size
+  // Evaluate the size expression of an array type and store the result as the
+  // size of the array.
+  //
+  [[nodiscard]] static anton::Expected<void, Error>
+  evaluate_array_size(Context& ctx, Symbol_Table& symtable,
+                      ast::Type_Array* const array)
+  {
+    ast::Expr* const expression = array->size_expression;
+    RETURN_ON_FAIL(analyse_expression, ctx, symtable, expression);
+    if(!ast::is_integer(*expression->evaluated_type)) {
+      return {anton::expected_error,
+              err_array_size_not_positive_integer(ctx, expression)};
+    }
+
+    RETURN_ON_FAIL_VAR(result, evaluate_constant_expression, ctx, expression);
+    Constant_Value const value = result.value();
+    bool const positive =
+      (value.kind == Constant_Kind::e_i32 && value.i32_value > 0) ||
+      (value.kind == Constant_Kind::e_u32 && value.u32_value > 0);
+    if(!positive) {
+      return {anton::expected_error,
+              err_array_size_not_positive_integer(ctx, expression)};
+    }
+
+    array->size = static_cast<ast::Lt_Integer*>(materialise_constant(
+      ctx.bump_allocator, value, expression->source_info));
+    return anton::expected_value;
+  }
+
   [[nodiscard]] static anton::Expected<void, Error>
   namebind_type(Context& ctx, Symbol_Table& symtable, ast::Type* const type)
   {
@@ -292,6 +334,9 @@ namespace vush {
 
     case ast::Type_Kind::type_array: {
       auto const array = static_cast<ast::Type_Array*>(type);
+      if(array->size == nullptr && array->size_expression != nullptr) {
+        RETURN_ON_FAIL(evaluate_array_size, ctx, symtable, array);
+      }
       return namebind_type(ctx, symtable, array->base);
     }
     }
@@ -921,6 +966,35 @@ namespace vush {
     return anton::expected_value;
   }
 
+  // analyse_global_variable
+  // Global variables must be immutable and of a constant type. Their
+  // initializers are evaluated at compile time and replaced with literals.
+  //
+  [[nodiscard]] static anton::Expected<void, Error>
+  analyse_global_variable(Context& ctx, Symbol_Table& symtable,
+                          ast::Variable* const node)
+  {
+    if(node->type->qualifiers.mut) {
+      return {anton::expected_error,
+              err_global_variable_not_constant(ctx, node)};
+    }
+
+    RETURN_ON_FAIL(analyse_variable, ctx, symtable, node);
+
+    if(!is_constant_type(*node->type)) {
+      return {anton::expected_error,
+              err_global_variable_not_constant(ctx, node)};
+    }
+
+    RETURN_ON_FAIL_VAR(result, evaluate_constant_expression, ctx,
+                       node->initializer);
+    Constant_Value const value = convert_constant(result.value(), *node->type);
+    node->initializer = materialise_constant(ctx.bump_allocator, value,
+                                             node->initializer->source_info);
+    node->constant = true;
+    return anton::expected_value;
+  }
+
   [[nodiscard]] static anton::Expected<void, Error>
   analyse_lvalue_vector_field(Context& ctx, ast::Expr_Field const* const expr)
   {
@@ -1063,10 +1137,56 @@ namespace vush {
     return anton::expected_value;
   }
 
+  // validate_loop_attributes
+  // Loops might have either the unroll or the nounroll attribute. unroll takes
+  // an optional positional parameter, the number of iterations to unroll,
+  // which must be a positive integer literal.
+  //
+  [[nodiscard]] static anton::Expected<void, Error>
+  validate_loop_attributes(Context const& ctx,
+                           ast::Attr_List const& attributes)
+  {
+    ast::Attribute const* unroll_hint = nullptr;
+    for(ast::Attribute const& attribute: attributes) {
+      bool const unroll = attribute.identifier.value == "unroll"_sv;
+      if(!unroll && attribute.identifier.value != "nounroll"_sv) {
+        return {anton::expected_error,
+                err_illegal_attribute(ctx, attribute.identifier.source_info)};
+      }
+
+      if(unroll_hint) {
+        return {anton::expected_error,
+                err_duplicate_attribute(ctx,
+                                        unroll_hint->identifier.source_info,
+                                        attribute.identifier.source_info)};
+      }
+      unroll_hint = &attribute;
+
+      i64 index = 0;
+      for(ast::Attribute_Parameter const& parameter: attribute.parameters) {
+        ast::Expr const* const value = parameter.value;
+        if(!unroll || index > 0 || parameter.key.value.size_bytes() > 0) {
+          return {anton::expected_error, err_unexpected_attribute_parameter(
+                                           ctx, value->source_info)};
+        }
+
+        if(value->node_kind != ast::Node_Kind::lt_integer ||
+           ast::get_lt_integer_value_as_u32(
+             *static_cast<ast::Lt_Integer const*>(value)) == 0) {
+          return {anton::expected_error,
+                  err_invalid_unroll_count(ctx, value->source_info)};
+        }
+        index += 1;
+      }
+    }
+    return anton::expected_value;
+  }
+
   [[nodiscard]] static anton::Expected<void, Error>
   analyse_stmt_for(Context& ctx, Symbol_Table& symtable,
                    ast::Stmt_For* const node, Sema_Context semactx)
   {
+    RETURN_ON_FAIL(validate_loop_attributes, ctx, node->attributes);
     for(ast::Node& declaration: node->declarations) {
       auto const variable = static_cast<ast::Variable*>(&declaration);
       RETURN_ON_FAIL(analyse_variable, ctx, symtable, variable);
@@ -1095,6 +1215,7 @@ namespace vush {
   analyse_stmt_while(Context& ctx, Symbol_Table& symtable,
                      ast::Stmt_While* const node, Sema_Context semactx)
   {
+    RETURN_ON_FAIL(validate_loop_attributes, ctx, node->attributes);
     RETURN_ON_FAIL(analyse_expression, ctx, symtable, node->condition);
     auto const condition_type = node->condition->evaluated_type;
     auto const bool_type = get_builtin_type(ast::Type_Builtin_Kind::e_bool);
@@ -1113,6 +1234,7 @@ namespace vush {
   analyse_stmt_do_while(Context& ctx, Symbol_Table& symtable,
                         ast::Stmt_Do_While* const node, Sema_Context semactx)
   {
+    RETURN_ON_FAIL(validate_loop_attributes, ctx, node->attributes);
     semactx.stmt = Stmt_Ctx::e_loop;
     RETURN_ON_FAIL(analyse_statements, ctx, symtable, node->statements,
                    semactx);
@@ -1144,9 +1266,30 @@ namespace vush {
     semactx.stmt = Stmt_Ctx::e_switch;
     ast::Expr const* default_label = nullptr;
     anton::Flat_Hash_Map<u32, ast::Lt_Integer*> labels{ctx.raii_allocator};
+    // Labels that are constant expressions and the literals they have been
+    // folded into. The labels are replaced after the arm has been traversed.
+    Array<ast::Expr*> folded_labels{ctx.raii_allocator};
+    Array<ast::Lt_Integer*> folded_values{ctx.raii_allocator};
     for(ast::Switch_Arm& arm: node->arms) {
       for(ast::Expr& label: arm.labels) {
         RETURN_ON_FAIL(analyse_expression, ctx, symtable, &label);
+        ast::Lt_Integer* lt = nullptr;
+        if(label.node_kind == ast::Node_Kind::lt_integer) {
+          lt = static_cast<ast::Lt_Integer*>(&label);
+        } else if(label.node_kind != ast::Node_Kind::expr_default) {
+          if(!ast::is_integer(*label.evaluated_type)) {
+            Source_Info const& src = label.source_info;
+            return {anton::expected_error,
+                    err_invalid_switch_arm_expression(ctx, src)};
+          }
+
+          RETURN_ON_FAIL_VAR(result, evaluate_constant_expression, ctx, &label);
+          lt = static_cast<ast::Lt_Integer*>(materialise_constant(
+            ctx.bump_allocator, result.value(), label.source_info));
+          folded_labels.push_back(&label);
+          folded_values.push_back(lt);
+        }
+
         if(label.node_kind == ast::Node_Kind::expr_default) {
           arm.has_default = true;
           // Ensure the default label is unique.
@@ -1157,8 +1300,7 @@ namespace vush {
                     err_duplicate_default_label(ctx, default_label->source_info,
                                                 label.source_info)};
           }
-        } else if(label.node_kind == ast::Node_Kind::lt_integer) {
-          auto const lt = static_cast<ast::Lt_Integer*>(&label);
+        } else {
           u32 const value = ast::get_lt_integer_value_as_u32(*lt);
           auto const it = labels.find(value);
           if(it == labels.end()) {
@@ -1169,13 +1311,16 @@ namespace vush {
             return {anton::expected_error,
                     err_duplicate_label(ctx, src1, src2)};
           }
-        } else {
-          Source_Info const& src = label.source_info;
-          return {anton::expected_error,
-                  err_invalid_switch_arm_expression(ctx, src)};
         }
       }
 
+      for(auto const [label, lt]: anton::zip(folded_labels, folded_values)) {
+        anton::ilist_insert_after(label, lt);
+        anton::ilist_erase(label);
+      }
+      folded_labels.clear();
+      folded_values.clear();
+
       RETURN_ON_FAIL(analyse_statements, ctx, symtable, arm.statements,
                      semactx);
     }
@@ -1397,10 +1542,24 @@ namespace vush {
   analyse_function(Context& ctx, Symbol_Table& symtable,
                    ast::Decl_Function* const fn)
   {
-    // Validate attributes. Currently there are no attributes that are not allowed on ordinary functions.
+    // Validate attributes:
+    // - inline or noinline (at most 1 of them).
+    ast::Attribute const* inline_hint = nullptr;
     for(ast::Attribute& attribute: fn->attributes) {
-      return {anton::expected_error,
-              err_illegal_attribute(ctx, attribute.identifier.source_info)};
+      if(attribute.identifier.value == "inline"_sv ||
+         attribute.identifier.value == "noinline"_sv) {
+        if(!inline_hint) {
+          inline_hint = &attribute;
+        } else {
+          return {anton::expected_error,
+                  err_duplicate_attribute(ctx,
+                                          inline_hint->identifier.source_info,
+                                          attribute.identifier.source_info)};
+        }
+      } else {
+        return {anton::expected_error,
+                err_illegal_attribute(ctx, attribute.identifier.source_info)};
+      }
     }
 
     // We do not defcheck the identifier of the function because it has already
@@ -1410,8 +1569,9 @@ namespace vush {
     symtable.push_scope();
     // Validate parameters:
     // - only ordinary parameters are allowed.
+    // The types of the parameters and the return type have already been bound
+    // by namebind_signature.
     for(ast::Fn_Parameter& parameter: fn->parameters) {
-      RETURN_ON_FAIL(namebind_type, ctx, symtable, parameter.type);
       RETURN_ON_FAIL(add_symbol, ctx, symtable,
                      Symbol(parameter.identifier.value, &parameter));
       if(ast::is_sourced_parameter(parameter)) {
@@ -1422,7 +1582,6 @@ namespace vush {
 
     // Validate the return type:
     // - if the type is an array, it must be sized.
-    RETURN_ON_FAIL(namebind_type, ctx, symtable, fn->return_type);
     RETURN_ON_FAIL(check_array_is_sized, ctx, fn->return_type);
 
     Sema_Context semactx{Stmt_Ctx::e_none};
@@ -1553,7 +1712,6 @@ namespace vush {
     // - fragment: input, output and sourced parameters.
     // - compute: only sourced parameters are allowed.
     for(ast::Fn_Parameter& parameter: fn->parameters) {
-      RETURN_ON_FAIL(namebind_type, ctx, symtable, parameter.type);
       RETURN_ON_FAIL(add_symbol, ctx, symtable,
                      Symbol(parameter.identifier.value, &parameter));
       switch(fn->stage.value) {
@@ -1628,15 +1786,52 @@ namespace vush {
     return anton::expected_value;
   }
 
+  // namebind_signature
+  // Bind the types of the parameters and the return type of a function and
+  // evaluate the sizes of their arrays. The signatures are bound before any
+  // function body is analysed, hence the bodies only read the signatures of
+  // the functions they call.
+  //
+  [[nodiscard]] static anton::Expected<void, Error>
+  namebind_signature(Context& ctx, Symbol_Table& symtable,
+                     ast::Node* const node)
+  {
+    switch(node->node_kind) {
+    case ast::Node_Kind::decl_function: {
+      auto const fn = static_cast<ast::Decl_Function*>(node);
+      for(ast::Fn_Parameter& parameter: fn->parameters) {
+        RETURN_ON_FAIL(namebind_type, ctx, symtable, parameter.type);
+      }
+      return namebind_type(ctx, symtable, fn->return_type);
+    }
+
+    case ast::Node_Kind::decl_stage_function: {
+      auto const fn = static_cast<ast::Decl_Stage_Function*>(node);
+      for(ast::Fn_Parameter& parameter: fn->parameters) {
+        RETURN_ON_FAIL(namebind_type, ctx, symtable, parameter.type);
+      }
+      return anton::expected_value;
+    }
+
+    default:
+      return anton::expected_value;
+    }
+  }
+
   // analyse_new_overload
-  // Verify that a function, if added to an overload group, will not cause
-  // errors, that is it complies with the overload rules.
+  // Verify that a function complies with the overload rules with respect to
+  // the overloads preceding it in its overload group. The signatures must have
+  // been bound, so that the sizes of arrays are compared.
   //
   [[nodiscard]] static anton::Expected<void, Error>
   analyse_new_overload(Context& ctx, ast::Overload_Group const* const group,
                        ast::Decl_Function const* const fn)
   {
     for(ast::Decl_Function const* const overload: group->overloads) {
+      if(overload == fn) {
+        break;
+      }
+
       if(overload->parameters.size() != fn->parameters.size()) {
         continue;
       }
@@ -1668,6 +1863,156 @@ namespace vush {
     return anton::expected_value;
   }
 
+  [[nodiscard]] static anton::Expected<void, Error>
+  analyse_declaration(Context& ctx, Symbol_Table& symtable,
+                      ast::Node* const node)
+  {
+    switch(node->node_kind) {
+    case ast::Node_Kind::variable:
+      // Global variables have already been analysed by run_sema.
+      return anton::expected_value;
+
+    case ast::Node_Kind::decl_struct: {
+      auto const decl = static_cast<ast::Decl_Struct*>(node);
+      return analyse_struct(ctx, symtable, decl);
+    }
+
+    case ast::Node_Kind::decl_buffer: {
+      auto const decl = static_cast<ast::Decl_Buffer*>(node);
+      return analyse_buffer(ctx, symtable, decl);
+    }
+
+    case ast::Node_Kind::decl_function: {
+      auto const decl = static_cast<ast::Decl_Function*>(node);
+      return analyse_function(ctx, symtable, decl);
+    }
+
+    case ast::Node_Kind::decl_stage_function: {
+      auto const decl = static_cast<ast::Decl_Stage_Function*>(node);
+      return analyse_stage_function(ctx, symtable, decl);
+    }
+
+    default:
+      // Nothing.
+      return anton::expected_value;
+    }
+  }
+
+  struct Sema_Task {
+    ast::Node* node;
+    Error error;
+    bool failed = false;
+  };
+
+  struct Sema_Workers {
+    Context const* ctx;
+    Symbol_Table const* symtable;
+    anton::Slice<Sema_Task> tasks;
+    std::atomic<i64> next_task = 0;
+    // Index of the earliest failed task. Tasks past it are not analysed
+    // because their diagnostics would never be reported.
+    std::atomic<i64> first_failure;
+  };
+
+  static void run_sema_worker(Sema_Workers* const workers,
+                              Allocator* const bump_allocator)
+  {
+    // Each worker uses its own bump allocator. The remaining state of the
+    // context is only read.
+    Context ctx = *workers->ctx;
+    ctx.bump_allocator = bump_allocator;
+    ctx.thread_allocators = {};
+    while(true) {
+      i64 const index =
+        workers->next_task.fetch_add(1, std::memory_order_relaxed);
+      // Tasks are handed out in increasing order, hence once we are past the
+      // first failure, all remaining tasks are too.
+      if(index >= workers->tasks.size() ||
+         index > workers->first_failure.load(std::memory_order_relaxed)) {
+        return;
+      }
+
+      Sema_Task& task = workers->tasks[index];
+      // The function scopes are pushed onto a table private to the task that
+      // falls back to the frozen global table.
+      Symbol_Table symtable(ctx.raii_allocator, workers->symtable);
+      anton::Expected<void, Error> result =
+        analyse_declaration(ctx, symtable, task.node);
+      if(!result) {
+        task.error = ANTON_MOV(result.error());
+        task.failed = true;
+        i64 failure = workers->first_failure.load(std::memory_order_relaxed);
+        while(index < failure &&
+              !workers->first_failure.compare_exchange_weak(
+                failure, index, std::memory_order_relaxed)) {
+        }
+      }
+    }
+  }
+
+  // analyse_declarations_parallel
+  // Analyse the top-level declarations with the function bodies distributed
+  // across ctx.thread_allocators.size() threads. Once the global symbol table
+  // is populated and the function signatures are bound, the bodies only read
+  // the shared state and write into their own subtrees.
+  //
+  // Declarations other than functions are analysed serially beforehand since
+  // the bodies depend on them, e.g. the types of struct fields must be bound
+  // before the fields are accessed.
+  //
+  // Returns:
+  // The first error in the source order.
+  //
+  [[nodiscard]] static anton::Expected<void, Error>
+  analyse_declarations_parallel(Context& ctx, Symbol_Table& symtable,
+                                ast::Node_List& ast)
+  {
+    Array<Sema_Task> tasks(ctx.raii_allocator);
+    anton::Expected<void, Error> declaration_result = anton::expected_value;
+    for(ast::Node& node: ast) {
+      if(node.node_kind == ast::Node_Kind::decl_function ||
+         node.node_kind == ast::Node_Kind::decl_stage_function) {
+        tasks.push_back(Sema_Task{.node = &node});
+        continue;
+      }
+
+      declaration_result = analyse_declaration(ctx, symtable, &node);
+      // Only the functions preceding the failed declaration can produce
+      // an earlier diagnostic.
+      if(!declaration_result) {
+        break;
+      }
+    }
+
+    Sema_Workers workers{.ctx = &ctx,
+                         .symtable = &symtable,
+                         .tasks = anton::Slice<Sema_Task>(
+                           tasks.data(), tasks.data() + tasks.size()),
+                         .first_failure = tasks.size()};
+    i64 const thread_count =
+      anton::math::min(ctx.thread_allocators.size(), tasks.size());
+    // The calling thread is the first worker.
+    Array<std::thread> threads(ctx.raii_allocator);
+    for(i64 i = 1; i < thread_count; i += 1) {
+      threads.emplace_back(run_sema_worker, &workers,
+                           ctx.thread_allocators[i]);
+    }
+    run_sema_worker(&workers, ctx.thread_allocators[0]);
+    for(std::thread& thread: threads) {
+      thread.join();
+    }
+
+    for(Sema_Task const& task: tasks) {
+      if(task.failed) {
+        // The diagnostic has been allocated from the worker's allocator which
+        // does not outlive the compilation, hence we copy it.
+        return {anton::expected_error, task.error.copy(ctx.bump_allocator)};
+      }
+    }
+
+    return declaration_result;
+  }
+
   anton::Expected<void, Error> run_sema(Context& ctx, ast::Node_List& ast)
   {
     // There is yet no support for struct member initializers, however, for
@@ -1693,15 +2038,11 @@ namespace vush {
       symtable.add_entry(key, Symbol(key, group));
     }
 
-    // Populate the symbol table with global symbols.
+    // Populate the symbol table with global symbols. Global variables are
+    // added as they are analysed, so that their initializers may only refer to
+    // the variables declared before them.
     for(ast::Node& decl: ast) {
       switch(decl.node_kind) {
-      case ast::Node_Kind::variable: {
-        ast::Variable* const node = static_cast<ast::Variable*>(&decl);
-        RETURN_ON_FAIL(add_symbol, ctx, symtable,
-                       Symbol(node->identifier.value, node));
-      } break;
-
       case ast::Node_Kind::decl_struct: {
         ast::Decl_Struct* const node = static_cast<ast::Decl_Struct*>(&decl);
         RETURN_ON_FAIL(add_symbol, ctx, symtable,
@@ -1732,8 +2073,8 @@ namespace vush {
         auto const node = static_cast<ast::Decl_Function*>(&decl);
         auto const i = groups.find(node->identifier.value);
         if(i != groups.end()) {
-          // Group exists, add our function to it.
-          RETURN_ON_FAIL(analyse_new_overload, ctx, i->value, node);
+          // Group exists, add our function to it. The overload rules are
+          // checked once the signatures have been bound.
           i->value->overloads.push_back(node);
         } else {
           // A group does not exist, hence we have to create it and check its
@@ -1767,38 +2108,36 @@ namespace vush {
       }
     }
 
-    // Run the analysis.
-    for(ast::Node& node: ast) {
-      switch(node.node_kind) {
-      case ast::Node_Kind::variable:
-        return {anton::expected_error,
-                err_unimplemented(ctx, node.source_info, __FILE__, __LINE__)};
-        break;
-
-      case ast::Node_Kind::decl_struct: {
-        auto const decl = static_cast<ast::Decl_Struct*>(&node);
-        RETURN_ON_FAIL(analyse_struct, ctx, symtable, decl);
-      } break;
+    // Evaluate the global variables before any other declarations as they may
+    // be used in constant expressions, e.g. array sizes.
+    for(ast::Node& decl: ast) {
+      if(decl.node_kind == ast::Node_Kind::variable) {
+        auto const node = static_cast<ast::Variable*>(&decl);
+        RETURN_ON_FAIL(analyse_global_variable, ctx, symtable, node);
+      }
+    }
 
-      case ast::Node_Kind::decl_buffer: {
-        auto const decl = static_cast<ast::Decl_Buffer*>(&node);
-        RETURN_ON_FAIL(analyse_buffer, ctx, symtable, decl);
-      } break;
+    // Bind the function signatures serially as the function bodies, which may
+    // be analysed in parallel, read the signatures of their callees.
+    for(ast::Node& node: ast) {
+      RETURN_ON_FAIL(namebind_signature, ctx, symtable, &node);
+    }
 
-      case ast::Node_Kind::decl_function: {
-        auto const decl = static_cast<ast::Decl_Function*>(&node);
-        RETURN_ON_FAIL(analyse_function, ctx, symtable, decl);
-      } break;
+    for(ast::Node& node: ast) {
+      if(node.node_kind == ast::Node_Kind::decl_function) {
+        auto const fn = static_cast<ast::Decl_Function*>(&node);
+        auto const group = groups.find(fn->identifier.value);
+        RETURN_ON_FAIL(analyse_new_overload, ctx, group->value, fn);
+      }
+    }
 
-      case ast::Node_Kind::decl_stage_function: {
-        auto const decl = static_cast<ast::Decl_Stage_Function*>(&node);
-        RETURN_ON_FAIL(analyse_stage_function, ctx, symtable, decl);
-      } break;
+    // Run the analysis.
+    if(ctx.thread_allocators.size() > 1) {
+      return analyse_declarations_parallel(ctx, symtable, ast);
+    }
 
-      default:
-        // Nothing.
-        break;
-      }
+    for(ast::Node& node: ast) {
+      RETURN_ON_FAIL(analyse_declaration, ctx, symtable, &node);
     }
 
     return anton::expected_value;
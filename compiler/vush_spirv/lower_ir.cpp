@@ -20,15 +20,108 @@ namespace vush {
   lower_constant(Lowering_Context& ctx, ir::Constant const* const constant);
 
   namespace {
+    // Pending_Phi
+    // A phi whose operands have not been lowered yet.
+    //
+    struct Pending_Phi {
+      ir::Instr_phi const* ir_phi;
+      spirv::Instr_phi* phi;
+    };
+
+    enum struct Derived_Kind : u8 {
+      e_pointer,
+      e_function,
+      e_mul_extended,
+      e_buffer,
+      e_constant,
+      e_undef,
+    };
+
+    // Derived_Key
+    // Identifies a type derived from the IR types or a constant. The IR types
+    // are interned, hence they are compared by their addresses.
+    //
+    struct Derived_Key {
+      Derived_Kind kind;
+      // The pointee type, the return type, the type of the halves, the buffer
+      // type or the type of the constant.
+      ir::Type const* type;
+      // The storage class of a pointer or the bits of a constant.
+      u64 value = 0;
+      // The parameters of a function type. nullptr when there are none.
+      ir::Function const* function = nullptr;
+    };
+
+    // Derived_Entry
+    // The entries whose keys hash equally are chained.
+    //
+    struct Derived_Entry {
+      Derived_Key key;
+      spirv::Instr* instr;
+      Derived_Entry* next;
+    };
+
+    // Id_Map
+    // A map from the ids of IR entities to their lowered instructions. The ids
+    // are allocated densely by the module, hence the map is an array indexed by
+    // id.
+    //
+    template<typename T>
+    struct Id_Map {
+    private:
+      Array<T*> entries;
+
+    public:
+      Id_Map(Allocator* allocator): entries(allocator) {}
+
+      // find
+      //
+      // Returns:
+      // The instruction mapped to id or nullptr if there is none.
+      //
+      [[nodiscard]] T* find(u32 const id) const
+      {
+        if(id >= entries.size()) {
+          return nullptr;
+        }
+        return entries[id];
+      }
+
+      void emplace(u32 const id, T* const value)
+      {
+        while(entries.size() <= id) {
+          entries.push_back(nullptr);
+        }
+        ANTON_ASSERT(entries[id] == nullptr, "id has already been mapped");
+        entries[id] = value;
+      }
+    };
+
     struct Lowering_Context {
     public:
       Allocator* allocator;
-      anton::Flat_Hash_Map<ir::Value const*, spirv::Instr*> instr_map;
-      anton::Flat_Hash_Map<ir::Basic_Block const*, spirv::Instr_label*> bb_map;
-      anton::Flat_Hash_Map<u64, spirv::Instr*> type_map;
-      anton::Flat_Hash_Map<ir::Buffer const*, spirv::Instr_variable*>
-        buffer_map;
+      // Arguments and instructions share the id space of their function.
+      Id_Map<spirv::Instr> instr_map;
+      Id_Map<spirv::Instr_label> bb_map;
+      // The labels of the merge and continue blocks of loops that have been
+      // referenced before the blocks were lowered.
+      Id_Map<spirv::Instr_label> reserved_labels;
+      Array<ir::Basic_Block const*> reserved_blocks;
+      // The IR types are interned, hence they are mapped by their addresses.
+      anton::Flat_Hash_Map<ir::Type const*, spirv::Instr*> type_map;
+      // Shared by the image and the sampled image types.
+      anton::Flat_Hash_Map<u64, spirv::Instr_type_image*> image_map;
+      // The types derived from the IR types, e.g. pointers and functions, and
+      // the constants. The entries are chained by the hashes of their keys.
+      anton::Flat_Hash_Map<u64, Derived_Entry*> derived_map;
+      Id_Map<spirv::Instr_variable> buffer_map;
+      // The functions called by the lowered functions. A function is declared
+      // when it is first called and lowered after the entry function.
+      anton::Flat_Hash_Map<ir::Function const*, spirv::Instr_function*>
+        function_map;
+      Array<ir::Function const*> pending_functions;
       Array<spirv::Instr_label*> pending_blocks;
+      Array<Pending_Phi> pending_phis;
 
       anton::IList<spirv::Instr> capabilities;
       anton::IList<spirv::Instr> extensions;
@@ -46,7 +139,11 @@ namespace vush {
     public:
       Lowering_Context(Allocator* allocator)
         : allocator(allocator), instr_map(allocator), bb_map(allocator),
-          type_map(allocator), buffer_map(allocator), pending_blocks(allocator)
+          reserved_labels(allocator), reserved_blocks(allocator),
+          type_map(allocator), image_map(allocator), derived_map(allocator),
+          buffer_map(allocator), function_map(allocator),
+          pending_functions(allocator), pending_blocks(allocator),
+          pending_phis(allocator)
       {
       }
 
@@ -57,13 +154,23 @@ namespace vush {
 
       spirv::Instr* get_instr(ir::Value const* const instr)
       {
-        if(instanceof<ir::Constant>(instr)) {
+        switch(instr->value_kind) {
+        case ir::Value_Kind::e_const:
           return lower_constant(*this, static_cast<ir::Constant const*>(instr));
-        } else {
-          auto const iterator = instr_map.find(instr);
-          ANTON_ASSERT(iterator != instr_map.end(),
-                       "no spirv::Instr for ir::Instr");
-          return iterator->value;
+
+        case ir::Value_Kind::e_argument: {
+          auto const argument = static_cast<ir::Argument const*>(instr);
+          spirv::Instr* const result = instr_map.find(argument->id);
+          ANTON_ASSERT(result != nullptr, "no spirv::Instr for ir::Argument");
+          return result;
+        }
+
+        case ir::Value_Kind::e_instr: {
+          spirv::Instr* const result =
+            instr_map.find(static_cast<ir::Instr const*>(instr)->id);
+          ANTON_ASSERT(result != nullptr, "no spirv::Instr for ir::Instr");
+          return result;
+        }
         }
       }
     };
@@ -94,118 +201,130 @@ namespace vush {
     };
   } // namespace
 
-  void hash_type(Running_Hash& hash, ir::Type const* const type)
+  [[nodiscard]] static u64 hash_derived_key(Derived_Key const& key)
   {
-    switch(type->kind) {
-    case ir::Type_Kind::e_void:
-      hash.feed("void");
-      break;
-
-    case ir::Type_Kind::e_bool:
-      hash.feed("bool");
-      break;
-
-    case ir::Type_Kind::e_int8:
-      hash.feed("int8");
-      break;
-
-    case ir::Type_Kind::e_int16:
-      hash.feed("int16");
-      break;
-
-    case ir::Type_Kind::e_int32:
-      hash.feed("int32");
-      break;
-
-    case ir::Type_Kind::e_uint8:
-      hash.feed("uint8");
-      break;
-
-    case ir::Type_Kind::e_uint16:
-      hash.feed("uint16");
-      break;
-
-    case ir::Type_Kind::e_uint32:
-      hash.feed("uint32");
-      break;
-
-    case ir::Type_Kind::e_fp16:
-      hash.feed("fp16");
-      break;
-
-    case ir::Type_Kind::e_fp32:
-      hash.feed("fp32");
-      break;
+    Running_Hash hash;
+    hash.start();
+    hash.feed(static_cast<u8>(key.kind));
+    hash.feed(reinterpret_cast<u64>(key.type));
+    hash.feed(key.value);
+    if(key.function != nullptr) {
+      for(ir::Argument const& argument: key.function->arguments) {
+        hash.feed(reinterpret_cast<u64>(argument.type));
+      }
+    }
+    return hash.finish();
+  }
 
-    case ir::Type_Kind::e_fp64:
-      hash.feed("fp64");
-      break;
+  // compare_signatures
+  // Compare the parameter types of the functions. A nullptr function has no
+  // parameters.
+  //
+  [[nodiscard]] static bool compare_signatures(ir::Function const* const lhs,
+                                               ir::Function const* const rhs)
+  {
+    if(lhs == rhs) {
+      return true;
+    }
 
-    case ir::Type_Kind::e_ptr:
-      hash.feed("ptr");
-      break;
+    if(lhs == nullptr || rhs == nullptr) {
+      ir::Function const* const function = lhs != nullptr ? lhs : rhs;
+      return function->arguments.begin() == function->arguments.end();
+    }
 
-    case ir::Type_Kind::e_sampler: {
-      hash.feed("sampler");
-    } break;
+    auto l = lhs->arguments.begin();
+    auto const l_end = lhs->arguments.end();
+    auto r = rhs->arguments.begin();
+    auto const r_end = rhs->arguments.end();
+    while(l != l_end && r != r_end) {
+      if((*l).type != (*r).type) {
+        return false;
+      }
+      ++l;
+      ++r;
+    }
+    return l == l_end && r == r_end;
+  }
 
-    case ir::Type_Kind::e_image: {
-      auto const t = static_cast<ir::Type_Image const*>(type);
-      hash.feed("image");
-      hash_type(hash, t->sampled_type);
-      hash.feed(static_cast<u8>(t->format));
-      hash.feed(static_cast<u8>(t->dimensions));
-      hash.feed(static_cast<u8>(t->multisampled));
-      hash.feed(static_cast<u8>(t->array));
-      hash.feed(static_cast<u8>(t->shadow));
-      hash.feed(static_cast<u8>(t->sampled));
-    } break;
+  [[nodiscard]] static bool compare_derived_keys(Derived_Key const& lhs,
+                                                 Derived_Key const& rhs)
+  {
+    return lhs.kind == rhs.kind && lhs.type == rhs.type &&
+           lhs.value == rhs.value &&
+           compare_signatures(lhs.function, rhs.function);
+  }
 
-    case ir::Type_Kind::e_sampled_image: {
-      auto const t = static_cast<ir::Type_Sampled_Image const*>(type);
-      hash.feed("sampled_image");
-      hash_type(hash, t->sampled_type);
-      hash.feed(static_cast<u8>(t->dimensions));
-      hash.feed(static_cast<u8>(t->multisampled));
-      hash.feed(static_cast<u8>(t->array));
-      hash.feed(static_cast<u8>(t->shadow));
-    } break;
+  // find_derived
+  //
+  // Returns:
+  // The instruction of the key or nullptr if the key has not been lowered.
+  //
+  [[nodiscard]] static spirv::Instr* find_derived(Lowering_Context& ctx,
+                                                  Derived_Key const& key)
+  {
+    auto const iterator = ctx.derived_map.find(hash_derived_key(key));
+    if(iterator == ctx.derived_map.end()) {
+      return nullptr;
+    }
 
-    case ir::Type_Kind::e_composite: {
-      auto const t = static_cast<ir::Type_Composite const*>(type);
-      hash.feed("composite");
-      hash.feed(t->identifier);
-      for(ir::Type const* const element: t->elements) {
-        hash_type(hash, element);
+    for(Derived_Entry* entry = iterator->value; entry != nullptr;
+        entry = entry->next) {
+      if(compare_derived_keys(entry->key, key)) {
+        return entry->instr;
       }
-    } break;
-
-    case ir::Type_Kind::e_array: {
-      auto const t = static_cast<ir::Type_Array const*>(type);
-      hash.feed("array");
-      hash_type(hash, t->element_type);
-      hash.feed(static_cast<u64>(t->size));
-    } break;
-
-    case ir::Type_Kind::e_vec: {
-      auto const t = static_cast<ir::Type_Vec const*>(type);
-      hash.feed("vec");
-      hash_type(hash, t->element_type);
-      hash.feed(static_cast<u64>(t->rows));
-    } break;
+    }
+    return nullptr;
+  }
 
-    case ir::Type_Kind::e_mat: {
-      auto const t = static_cast<ir::Type_Mat const*>(type);
-      hash.feed("mat");
-      hash_type(hash, t->column_type);
-      hash.feed(static_cast<u64>(t->columns));
-    } break;
+  static void add_derived(Lowering_Context& ctx, Derived_Key const& key,
+                          spirv::Instr* const instr)
+  {
+    u64 const hash = hash_derived_key(key);
+    auto const iterator = ctx.derived_map.find(hash);
+    if(iterator != ctx.derived_map.end()) {
+      iterator->value = VUSH_ALLOCATE(Derived_Entry, ctx.allocator, key, instr,
+                                      iterator->value);
+    } else {
+      ctx.derived_map.emplace(
+        hash, VUSH_ALLOCATE(Derived_Entry, ctx.allocator, key, instr, nullptr));
     }
   }
 
   [[nodiscard]] static spirv::Instr* lower_type(Lowering_Context& ctx,
                                                 ir::Type const* const type);
 
+  // lower_image_type
+  // The image types are shared by the image and the sampled image types. An
+  // image type is identified by its lowered sampled type and its operands.
+  //
+  [[nodiscard]] static spirv::Instr_type_image*
+  lower_image_type(Lowering_Context& ctx, ir::Type const* const sampled_type,
+                   ir::Image_Dim const dimensions, bool const multisampled,
+                   bool const array, bool const shadow, bool const sampled,
+                   ir::Image_Format const format)
+  {
+    spirv::Instr* const sampled_instr = lower_type(ctx, sampled_type);
+    u64 const key = static_cast<u64>(sampled_instr->id) << 32 |
+                    static_cast<u64>(format) << 16 |
+                    static_cast<u64>(dimensions) << 8 | multisampled |
+                    array << 1 | shadow << 2 | sampled << 3;
+    auto const iterator = ctx.image_map.find(key);
+    if(iterator != ctx.image_map.end()) {
+      return iterator->value;
+    }
+
+    // Depth, array and multisampled map straightforwardly. Sampled == 1 for
+    // sampled and sampled == 2 for non-sampled.
+    u8 const sampled_operand = sampled ? 1 : 2;
+    auto const image = spirv::make_instr_type_image(
+      ctx.allocator, ctx.next_id(), sampled_instr,
+      static_cast<spirv::Dimensionality>(dimensions), shadow, array,
+      multisampled, sampled_operand, static_cast<spirv::Image_Format>(format));
+    ctx.globals.insert_back(image);
+    ctx.image_map.emplace(key, image);
+    return image;
+  }
+
   [[nodiscard]] static spirv::Instr*
   make_new_type_instance(Lowering_Context& ctx, ir::Type const* const type)
   {
@@ -271,47 +390,16 @@ namespace vush {
 
     case ir::Type_Kind::e_image: {
       auto const t = static_cast<ir::Type_Image const*>(type);
-      auto const sampled_type = lower_type(ctx, t->sampled_type);
-      // Depth, array and multisampled map straightforwardly. Sampled == 1 for
-      // sampled and sampled == 2 for non-sampled.
-      u8 const sampled = t->sampled ? 1 : 2;
-      return spirv::make_instr_type_image(
-        ctx.allocator, ctx.next_id(), sampled_type,
-        static_cast<spirv::Dimensionality>(t->dimensions), t->shadow, t->array,
-        t->multisampled, sampled, static_cast<spirv::Image_Format>(t->format));
+      return lower_image_type(ctx, t->sampled_type, t->dimensions,
+                              t->multisampled, t->array, t->shadow, t->sampled,
+                              t->format);
     }
 
     case ir::Type_Kind::e_sampled_image: {
       auto const t = static_cast<ir::Type_Sampled_Image const*>(type);
-      // We manually hash the type as if it were an image type.
-      Running_Hash hash;
-      hash.start();
-      hash.feed("image");
-      hash_type(hash, t->sampled_type);
-      hash.feed(static_cast<u8>(ir::Image_Format::e_unknown));
-      hash.feed(static_cast<u8>(t->dimensions));
-      hash.feed(static_cast<u8>(t->multisampled));
-      hash.feed(static_cast<u8>(t->array));
-      hash.feed(static_cast<u8>(t->shadow));
-      hash.feed(static_cast<u8>(true));
-      u64 const result = hash.finish();
-      spirv::Instr_type_image* image = nullptr;
-      {
-        auto const iterator = ctx.type_map.find(result);
-        if(iterator != ctx.type_map.end()) {
-          image = safe_cast<spirv::Instr_type_image*>(iterator->value);
-        } else {
-          auto const sampled_type = lower_type(ctx, t->sampled_type);
-          // Sampled == 1 for sampled.
-          u8 const sampled = 1;
-          image = spirv::make_instr_type_image(
-            ctx.allocator, ctx.next_id(), sampled_type,
-            static_cast<spirv::Dimensionality>(t->dimensions), t->shadow,
-            t->array, t->multisampled, sampled, spirv::Image_Format::e_unknown);
-          ctx.type_map.emplace(result, image);
-          ctx.globals.insert_back(image);
-        }
-      }
+      auto const image = lower_image_type(ctx, t->sampled_type, t->dimensions,
+                                          t->multisampled, t->array, t->shadow,
+                                          true, ir::Image_Format::e_unknown);
       return spirv::make_instr_type_sampled_image(ctx.allocator, ctx.next_id(),
                                                   image);
     }
@@ -346,15 +434,14 @@ namespace vush {
 
   spirv::Instr* lower_type(Lowering_Context& ctx, ir::Type const* const type)
   {
-    Running_Hash hash;
-    hash.start();
-    hash_type(hash, type);
-    u64 const value = hash.finish();
-    auto iter = ctx.type_map.find(value);
+    auto iter = ctx.type_map.find(type);
     if(iter == ctx.type_map.end()) {
       auto const instr = make_new_type_instance(ctx, type);
-      ctx.globals.insert_back(*instr);
-      iter = ctx.type_map.emplace(value, instr);
+      // The image types have been inserted by lower_image_type.
+      if(type->kind != ir::Type_Kind::e_image) {
+        ctx.globals.insert_back(*instr);
+      }
+      iter = ctx.type_map.emplace(type, instr);
     }
     return iter->value;
   }
@@ -362,83 +449,121 @@ namespace vush {
   [[nodiscard]] static spirv::Instr_type_function*
   lower_type(Lowering_Context& ctx, ir::Function const* const function)
   {
-    Running_Hash hash;
-    hash.start();
-    hash.feed("function");
+    Derived_Key const key{.kind = Derived_Kind::e_function,
+                          .type = function->return_type,
+                          .function = function};
+    if(auto const instr = find_derived(ctx, key)) {
+      return safe_cast<spirv::Instr_type_function*>(instr);
+    }
+
+    auto const return_type = lower_type(ctx, function->return_type);
+    auto const instr =
+      make_instr_type_function(ctx.allocator, ctx.next_id(), return_type);
     for(ir::Argument const& argument: function->arguments) {
-      hash_type(hash, argument.type);
+      instr->parameter_types.push_back(lower_type(ctx, argument.type));
     }
-    hash_type(hash, function->return_type);
-    u64 const value = hash.finish();
-    auto iter = ctx.type_map.find(value);
-    if(iter == ctx.type_map.end()) {
-      auto const return_type = lower_type(ctx, function->return_type);
-      auto const instr =
-        make_instr_type_function(ctx.allocator, ctx.next_id(), return_type);
-      ctx.globals.insert_back(*instr);
-      iter = ctx.type_map.emplace(value, instr);
+    ctx.globals.insert_back(*instr);
+    add_derived(ctx, key, instr);
+    return instr;
+  }
+
+  // declare_function
+  // Get the OpFunction of a called function. The function is created and
+  // queued for lowering when it is called for the first time.
+  //
+  [[nodiscard]] static spirv::Instr_function*
+  declare_function(Lowering_Context& ctx, ir::Function const* const function)
+  {
+    auto iter = ctx.function_map.find(function);
+    if(iter == ctx.function_map.end()) {
+      auto const function_type = lower_type(ctx, function);
+      auto const instr = spirv::make_instr_function(
+        ctx.allocator, ctx.next_id(), function_type);
+      ctx.pending_functions.push_back(function);
+      iter = ctx.function_map.emplace(function, instr);
     }
-    return safe_cast<spirv::Instr_type_function*>(iter->value);
+    return iter->value;
+  }
+
+  // lower_type_mul_extended
+  // Get the type of the result of the extended multiplications, a struct of
+  // the low and the high half of the product.
+  //
+  [[nodiscard]] static spirv::Instr*
+  lower_type_mul_extended(Lowering_Context& ctx, ir::Type const* const type)
+  {
+    Derived_Key const key{.kind = Derived_Kind::e_mul_extended, .type = type};
+    if(auto const instr = find_derived(ctx, key)) {
+      return instr;
+    }
+
+    auto const half_type = lower_type(ctx, type);
+    auto const instr =
+      spirv::make_instr_type_struct(ctx.allocator, ctx.next_id());
+    instr->field_types.push_back(half_type);
+    instr->field_types.push_back(half_type);
+    ctx.globals.insert_back(*instr);
+    add_derived(ctx, key, instr);
+    return instr;
   }
 
   [[nodiscard]] static spirv::Instr_type_pointer*
   lower_type_as_pointer(Lowering_Context& ctx, ir::Type const* const type,
                         spirv::Storage_Class const storage_class)
   {
-    Running_Hash hash;
-    hash.start();
-    hash.feed("ptr");
-    hash.feed(static_cast<u32>(storage_class));
-    hash_type(hash, type);
-    u64 const value = hash.finish();
-    auto iter = ctx.type_map.find(value);
-    if(iter == ctx.type_map.end()) {
-      auto const pointee_type = lower_type(ctx, type);
-      auto const instr = make_instr_type_pointer(ctx.allocator, ctx.next_id(),
-                                                 pointee_type, storage_class);
-      ctx.globals.insert_back(*instr);
-      iter = ctx.type_map.emplace(value, instr);
+    Derived_Key const key{.kind = Derived_Kind::e_pointer,
+                          .type = type,
+                          .value = static_cast<u64>(storage_class)};
+    if(auto const instr = find_derived(ctx, key)) {
+      return safe_cast<spirv::Instr_type_pointer*>(instr);
     }
-    return safe_cast<spirv::Instr_type_pointer*>(iter->value);
+
+    auto const pointee_type = lower_type(ctx, type);
+    auto const instr = make_instr_type_pointer(ctx.allocator, ctx.next_id(),
+                                               pointee_type, storage_class);
+    ctx.globals.insert_back(*instr);
+    add_derived(ctx, key, instr);
+    return instr;
   }
 
-  void hash_constant(Running_Hash& hash, ir::Constant const* const gconstant)
+  // make_constant_key
+  // The constants are identified by their types and their bits.
+  //
+  [[nodiscard]] static Derived_Key
+  make_constant_key(ir::Constant const* const gconstant)
   {
+    Derived_Key key{.kind = Derived_Kind::e_constant, .type = gconstant->type};
     switch(gconstant->constant_kind) {
     case ir::Constant_Kind::e_constant_bool: {
       auto const constant = static_cast<ir::Constant_bool const*>(gconstant);
-      hash.feed("constant_bool");
-      hash.feed(constant->value ? "true" : "false");
+      key.value = constant->value;
     } break;
 
     case ir::Constant_Kind::e_constant_i32: {
       auto const constant = static_cast<ir::Constant_i32 const*>(gconstant);
-      hash.feed("constant_i32");
-      hash.feed((u32)constant->value);
+      key.value = static_cast<u32>(constant->value);
     } break;
 
     case ir::Constant_Kind::e_constant_u32: {
       auto const constant = static_cast<ir::Constant_u32 const*>(gconstant);
-      hash.feed("constant_u32");
-      hash.feed(constant->value);
+      key.value = constant->value;
     } break;
 
     case ir::Constant_Kind::e_constant_f32: {
       auto const constant = static_cast<ir::Constant_f32 const*>(gconstant);
-      hash.feed("constant_f32");
-      hash.feed(*reinterpret_cast<u32 const*>(&constant->value));
+      key.value = *reinterpret_cast<u32 const*>(&constant->value);
     } break;
 
     case ir::Constant_Kind::e_constant_f64: {
       auto const constant = static_cast<ir::Constant_f64 const*>(gconstant);
-      hash.feed("constant_f64");
-      hash.feed(*reinterpret_cast<u64 const*>(&constant->value));
+      key.value = *reinterpret_cast<u64 const*>(&constant->value);
     } break;
 
     case ir::Constant_Kind::e_undef:
-      hash.feed("constant_undef");
+      key.kind = Derived_Kind::e_undef;
       break;
     }
+    return key;
   }
 
   [[nodiscard]] static spirv::Instr*
@@ -483,7 +608,7 @@ namespace vush {
     } break;
 
     case ir::Constant_Kind::e_undef: {
-      ANTON_UNREACHABLE("undef unimplemented");
+      return spirv::make_instr_undef(ctx.allocator, ctx.next_id(), type);
     } break;
     }
   }
@@ -491,36 +616,33 @@ namespace vush {
   [[nodiscard]] static spirv::Instr*
   lower_constant(Lowering_Context& ctx, ir::Constant const* const constant)
   {
-    Running_Hash hash;
-    hash.start();
-    hash_constant(hash, constant);
-    u64 const value = hash.finish();
-    auto iter = ctx.type_map.find(value);
-    if(iter == ctx.type_map.end()) {
-      auto const instr = make_new_constant_instance(ctx, constant);
-      ctx.globals.insert_back(*instr);
-      iter = ctx.type_map.emplace(value, instr);
+    Derived_Key const key = make_constant_key(constant);
+    if(auto const instr = find_derived(ctx, key)) {
+      return instr;
     }
-    return iter->value;
+
+    auto const instr = make_new_constant_instance(ctx, constant);
+    ctx.globals.insert_back(*instr);
+    add_derived(ctx, key, instr);
+    return instr;
   }
 
   [[nodiscard]] static spirv::Instr*
   lower_u32_to_constant(Lowering_Context& ctx, u32 const constant)
   {
-    Running_Hash hash;
-    hash.start();
-    hash.feed("constant_u32");
-    hash.feed(constant);
-    u64 const value = hash.finish();
-    auto iter = ctx.type_map.find(value);
-    if(iter == ctx.type_map.end()) {
-      auto const type = lower_type(ctx, ir::get_type_uint32());
-      auto const instr = spirv::make_instr_constant_u32(
-        ctx.allocator, ctx.next_id(), type, constant);
-      ctx.globals.insert_back(*instr);
-      iter = ctx.type_map.emplace(value, instr);
+    Derived_Key const key{.kind = Derived_Kind::e_constant,
+                          .type = ir::get_type_uint32(),
+                          .value = constant};
+    if(auto const instr = find_derived(ctx, key)) {
+      return instr;
     }
-    return iter->value;
+
+    auto const type = lower_type(ctx, ir::get_type_uint32());
+    auto const instr = spirv::make_instr_constant_u32(
+      ctx.allocator, ctx.next_id(), type, constant);
+    ctx.globals.insert_back(*instr);
+    add_derived(ctx, key, instr);
+    return instr;
   }
 
   // make_annotated_buffer_type
@@ -530,15 +652,9 @@ namespace vush {
   [[nodiscard]] static spirv::Instr*
   make_annotated_buffer_type(Lowering_Context& ctx, ir::Type const* const type)
   {
-    Running_Hash hash;
-    hash.start();
-    hash_type(hash, type);
-    u64 const value = hash.finish();
-    {
-      auto iter = ctx.type_map.find(value);
-      if(iter != ctx.type_map.end()) {
-        return iter->value;
-      }
+    Derived_Key const key{.kind = Derived_Kind::e_buffer, .type = type};
+    if(auto const instr = find_derived(ctx, key)) {
+      return instr;
     }
 
     switch(type->kind) {
@@ -558,7 +674,7 @@ namespace vush {
           ctx.allocator, ctx.next_id(), element_type);
       }
       ctx.globals.insert_back(instr);
-      ctx.type_map.emplace(value, instr);
+      add_derived(ctx, key, instr);
 
       // SPIR-V 2.16.2: Arrays require the ArrayStride decoration.
       {
@@ -620,7 +736,7 @@ namespace vush {
       }
       // We must insert after all constituent types have been created.
       ctx.globals.insert_back(instr);
-      ctx.type_map.emplace(value, instr);
+      add_derived(ctx, key, instr);
       return instr;
     }
 
@@ -632,11 +748,8 @@ namespace vush {
   [[nodiscard]] static spirv::Instr_variable*
   lower_buffer(Lowering_Context& ctx, ir::Buffer const* const buffer)
   {
-    {
-      auto const iterator = ctx.buffer_map.find(buffer);
-      if(iterator != ctx.buffer_map.end()) {
-        return iterator->value;
-      }
+    if(auto const variable = ctx.buffer_map.find(buffer->id)) {
+      return variable;
     }
 
     // TODO: Always lowers as storage buffer.
@@ -654,7 +767,7 @@ namespace vush {
       spirv::make_instr_variable(ctx.allocator, ctx.next_id(), pointer_type,
                                  spirv::Storage_Class::e_storage_buffer);
     ctx.globals.insert_back(*variable);
-    ctx.buffer_map.emplace(buffer, variable);
+    ctx.buffer_map.emplace(buffer->id, variable);
     // Binding and DescriptorSet decorations.
     auto const decoration_set = spirv::make_instr_decorate(
       ctx.allocator, variable, spirv::Decoration::e_descriptor_set,
@@ -667,35 +780,74 @@ namespace vush {
     return variable;
   }
 
-  [[nodiscard]] static i64
-  get_integer_constant_as_i64(ir::Constant const* const constant)
+  // reserve_label
+  // Get the label of a block without lowering the block. The block is lowered
+  // once it is reached by a branch. Unlike the converge blocks of selections,
+  // the merge blocks of loops may use values defined in the loop, hence they
+  // cannot be lowered before the loop.
+  //
+  [[nodiscard]] static spirv::Instr_label*
+  reserve_label(Lowering_Context& ctx, ir::Basic_Block const* const block)
   {
-    if(instanceof<ir::Constant_i32>(constant)) {
-      return static_cast<ir::Constant_i32 const*>(constant)->value;
-    } else if(instanceof<ir::Constant_u32>(constant)) {
-      return static_cast<ir::Constant_u32 const*>(constant)->value;
-    } else {
-      ANTON_UNREACHABLE("non-integer constant cannot be converted to integer");
+    if(auto const label = ctx.bb_map.find(block->id)) {
+      return label;
+    }
+
+    if(auto const label = ctx.reserved_labels.find(block->id)) {
+      return label;
+    }
+
+    auto const label = spirv::make_instr_label(ctx.allocator, ctx.next_id());
+    ctx.reserved_labels.emplace(block->id, label);
+    ctx.reserved_blocks.push_back(block);
+    return label;
+  }
+
+  [[nodiscard]] static spirv::Loop_Control
+  lower_unroll_hint(ir::Unroll_Hint const hint)
+  {
+    switch(hint) {
+    case ir::Unroll_Hint::e_none:
+      return spirv::Loop_Control::e_none;
+    case ir::Unroll_Hint::e_unroll:
+      return spirv::Loop_Control::e_unroll;
+    case ir::Unroll_Hint::e_nounroll:
+      return spirv::Loop_Control::e_dont_unroll;
     }
   }
 
   [[nodiscard]] static spirv::Instr_label*
   lower_block(Lowering_Context& ctx, ir::Basic_Block const* const block)
   {
-    {
-      auto const iterator = ctx.bb_map.find(block);
-      if(iterator != ctx.bb_map.end()) {
-        return iterator->value;
-      }
+    if(auto const label = ctx.bb_map.find(block->id)) {
+      return label;
     }
 
-    auto const label = spirv::make_instr_label(ctx.allocator, ctx.next_id());
-    ctx.bb_map.emplace(block, label);
+    auto const reserved = ctx.reserved_labels.find(block->id);
+    spirv::Instr_label* const label =
+      reserved != nullptr
+        ? reserved
+        : spirv::make_instr_label(ctx.allocator, ctx.next_id());
+    ctx.bb_map.emplace(block->id, label);
     ctx.pending_blocks.push_back(label);
 
     Builder builder;
     builder.set_current_instruction(label);
+    // OpLoopMerge must immediately precede the terminator of the header.
+    ir::Intrinsic_scf_loop_head const* scf_loop_head = nullptr;
     for(auto const& instruction: block->instructions) {
+      if(scf_loop_head != nullptr &&
+         ir::is_control_flow_instruction(&instruction)) {
+        auto const merge_block = reserve_label(ctx, scf_loop_head->merge_block);
+        auto const continue_block =
+          reserve_label(ctx, scf_loop_head->continue_block);
+        auto const loop_merge = spirv::make_instr_loop_merge(
+          ctx.allocator, merge_block, continue_block,
+          lower_unroll_hint(scf_loop_head->unroll_hint));
+        builder.insert(loop_merge);
+        loop_merge->block = label;
+      }
+
       switch(instruction.instr_kind) {
       case ir::Instr_Kind::e_intrinsic: {
         auto const instr_intrinsic =
@@ -713,6 +865,11 @@ namespace vush {
           builder.insert(selection_merge);
           selection_merge->block = label;
         } break;
+
+        case ir::Intrinsic_Kind::e_scf_loop_head: {
+          scf_loop_head =
+            static_cast<ir::Intrinsic_scf_loop_head const*>(instr_intrinsic);
+        } break;
         }
       } break;
 
@@ -726,7 +883,7 @@ namespace vush {
                                      spirv::Storage_Class::e_function);
         builder.insert(instr);
         instr->block = label;
-        ctx.instr_map.emplace(&instruction, instr);
+        ctx.instr_map.emplace(instruction.id, instr);
       } break;
 
       case ir::Instr_Kind::e_load: {
@@ -738,7 +895,7 @@ namespace vush {
           spirv::make_instr_load(ctx.allocator, ctx.next_id(), type, address);
         builder.insert(instr);
         instr->block = label;
-        ctx.instr_map.emplace(&instruction, instr);
+        ctx.instr_map.emplace(instruction.id, instr);
       } break;
 
       case ir::Instr_Kind::e_store: {
@@ -750,7 +907,7 @@ namespace vush {
           spirv::make_instr_store(ctx.allocator, pointer, object);
         builder.insert(instr);
         instr->block = label;
-        ctx.instr_map.emplace(&instruction, instr);
+        ctx.instr_map.emplace(instruction.id, instr);
       } break;
 
       case ir::Instr_Kind::e_getptr: {
@@ -761,50 +918,22 @@ namespace vush {
         auto const base_type =
           safe_cast<spirv::Instr_type_pointer*>(spirv::get_result_type(base));
         spirv::Storage_Class const storage_class = base_type->storage_class;
-        ir::Type const* const type = instr_getptr->addressed_type;
-        // When the type is a composite, the indices must be constant integers.
-        // We can use those indices to get the type of the member.
-        // Otherwise, the type is an array, vector or matrix and all elements
-        // are the same regardless of the index.
-        spirv::Instr_type_pointer* result_type = nullptr;
-        switch(type->kind) {
-        case ir::Type_Kind::e_composite: {
-          auto const type_composite =
-            static_cast<ir::Type_Composite const*>(type);
-          i64 const index = get_integer_constant_as_i64(
-            safe_cast<ir::Constant const*>(instr_getptr->index));
-          auto const element_type = type_composite->elements[index];
-          result_type = lower_type_as_pointer(ctx, element_type, storage_class);
-        } break;
-
-        case ir::Type_Kind::e_array: {
-          auto const type_array = static_cast<ir::Type_Array const*>(type);
-          result_type =
-            lower_type_as_pointer(ctx, type_array->element_type, storage_class);
-        } break;
-
-        case ir::Type_Kind::e_mat: {
-          auto const type_mat = static_cast<ir::Type_Mat const*>(type);
-          result_type =
-            lower_type_as_pointer(ctx, type_mat->column_type, storage_class);
-        } break;
-
-        case ir::Type_Kind::e_vec: {
-          auto const type_vec = static_cast<ir::Type_Vec const*>(type);
-          result_type =
-            lower_type_as_pointer(ctx, type_vec->element_type, storage_class);
-        } break;
-
-        default:
-          ANTON_UNREACHABLE("invalid getptr base type");
+        // The indices into composites are constant integers, hence the type
+        // of the addressed element is known.
+        ir::Type* const element_type = ir::get_indexed_type(instr_getptr);
+        spirv::Instr_type_pointer* const result_type =
+          lower_type_as_pointer(ctx, element_type, storage_class);
+        Array<spirv::Instr*> indices(ctx.allocator);
+        for(ir::Value const* const index: instr_getptr->indices) {
+          indices.push_back(ctx.get_instr(index));
         }
-
-        auto const index = ctx.get_instr(instr_getptr->index);
         auto const instr = spirv::make_instr_access_chain(
-          ctx.allocator, ctx.next_id(), result_type, base, index);
+          ctx.allocator, ctx.next_id(), result_type, base,
+          anton::Slice<spirv::Instr* const>(indices.data(),
+                                            indices.data() + indices.size()));
         builder.insert(instr);
         instr->block = label;
-        ctx.instr_map.emplace(&instruction, instr);
+        ctx.instr_map.emplace(instruction.id, instr);
       } break;
 
       case ir::Instr_Kind::e_alu: {
@@ -838,13 +967,34 @@ namespace vush {
           ALU_BINARY_CASE(e_or, bit_or)
           ALU_BINARY_CASE(e_xor, bit_xor)
           ALU_BINARY_CASE(e_shl, shl)
-          // All SHR operations are logical for now.
           ALU_BINARY_CASE(e_shr, shr_logical)
+          ALU_BINARY_CASE(e_ashr, shr_arithmetic)
           ALU_UNARY_CASE(e_neg, snegate)
           ALU_BINARY_CASE(e_iadd, iadd)
           ALU_BINARY_CASE(e_imul, imul)
           ALU_BINARY_CASE(e_uadd, iadd)
           ALU_BINARY_CASE(e_umul, imul)
+        case ir::ALU_Opcode::e_imulhi:
+        case ir::ALU_Opcode::e_umulhi: {
+          auto const operand1 = ctx.get_instr(instr_alu->src1);
+          auto const operand2 = ctx.get_instr(instr_alu->src2);
+          auto const product_type =
+            lower_type_mul_extended(ctx, instr_alu->type);
+          spirv::Instr* product = nullptr;
+          if(instr_alu->op == ir::ALU_Opcode::e_imulhi) {
+            product = spirv::make_instr_smul_extended(
+              ctx.allocator, ctx.next_id(), product_type, operand1, operand2);
+          } else {
+            product = spirv::make_instr_umul_extended(
+              ctx.allocator, ctx.next_id(), product_type, operand1, operand2);
+          }
+          builder.insert(product);
+          product->block = label;
+          auto const high = spirv::make_instr_composite_extract(
+            ctx.allocator, ctx.next_id(), result_type, product);
+          high->indices.push_back(1);
+          instr = high;
+        } break;
           ALU_BINARY_CASE(e_idiv, sdiv)
           ALU_BINARY_CASE(e_udiv, udiv)
           ALU_BINARY_CASE(e_irem, srem)
@@ -872,7 +1022,7 @@ namespace vush {
         }
         builder.insert(instr);
         instr->block = label;
-        ctx.instr_map.emplace(&instruction, instr);
+        ctx.instr_map.emplace(instruction.id, instr);
       } break;
 
       case ir::Instr_Kind::e_vector_extract: {
@@ -886,7 +1036,7 @@ namespace vush {
         instr->indices.push_back(instr_extract->index);
         builder.insert(instr);
         instr->block = label;
-        ctx.instr_map.emplace(&instruction, instr);
+        ctx.instr_map.emplace(instruction.id, instr);
       } break;
 
       case ir::Instr_Kind::e_vector_insert: {
@@ -901,7 +1051,7 @@ namespace vush {
         instr->indices.push_back(instr_insert->index);
         builder.insert(instr);
         instr->block = label;
-        ctx.instr_map.emplace(&instruction, instr);
+        ctx.instr_map.emplace(instruction.id, instr);
       } break;
 
       case ir::Instr_Kind::e_composite_extract: {
@@ -917,7 +1067,7 @@ namespace vush {
         }
         builder.insert(instr);
         instr->block = label;
-        ctx.instr_map.emplace(&instruction, instr);
+        ctx.instr_map.emplace(instruction.id, instr);
       } break;
 
       case ir::Instr_Kind::e_composite_construct: {
@@ -932,7 +1082,22 @@ namespace vush {
         }
         builder.insert(instr);
         instr->block = label;
-        ctx.instr_map.emplace(&instruction, instr);
+        ctx.instr_map.emplace(instruction.id, instr);
+      } break;
+
+      case ir::Instr_Kind::e_select: {
+        auto const instr_select =
+          static_cast<ir::Instr_select const*>(&instruction);
+        auto const result_type = lower_type(ctx, instr_select->type);
+        auto const condition = ctx.get_instr(instr_select->condition);
+        auto const operand1 = ctx.get_instr(instr_select->then_value);
+        auto const operand2 = ctx.get_instr(instr_select->else_value);
+        auto const instr =
+          spirv::make_instr_select(ctx.allocator, ctx.next_id(), result_type,
+                                   condition, operand1, operand2);
+        builder.insert(instr);
+        instr->block = label;
+        ctx.instr_map.emplace(instruction.id, instr);
       } break;
 
         // TODO: Lower the remaining instructions.
@@ -945,10 +1110,38 @@ namespace vush {
       case ir::Instr_Kind::e_cvt_fp2si:
       case ir::Instr_Kind::e_cvt_ui2fp:
       case ir::Instr_Kind::e_cvt_fp2ui:
-      case ir::Instr_Kind::e_call:
-      case ir::Instr_Kind::e_phi:
         break;
 
+      case ir::Instr_Kind::e_call: {
+        // The calls that have not been inlined, e.g. to noinline or recursive
+        // functions, lower to OpFunctionCall.
+        auto const instr_call =
+          static_cast<ir::Instr_call const*>(&instruction);
+        auto const function = declare_function(ctx, instr_call->function);
+        auto const instr = spirv::make_instr_function_call(
+          ctx.allocator, ctx.next_id(), function);
+        for(ir::Value const* const argument: instr_call->args) {
+          instr->arguments.push_back(ctx.get_instr(argument));
+        }
+        builder.insert(instr);
+        instr->block = label;
+        ctx.instr_map.emplace(instruction.id, instr);
+      } break;
+
+      case ir::Instr_Kind::e_phi: {
+        auto const instr_phi = static_cast<ir::Instr_phi const*>(&instruction);
+        auto const result_type = lower_type(ctx, instr_phi->type);
+        auto const instr =
+          spirv::make_instr_phi(ctx.allocator, ctx.next_id(), result_type);
+        builder.insert(instr);
+        instr->block = label;
+        ctx.instr_map.emplace(instruction.id, instr);
+        // The sources might be defined in blocks that have not been lowered
+        // yet, e.g. along the back edge of a loop. The operands are filled in
+        // once the entire function has been lowered.
+        ctx.pending_phis.push_back(Pending_Phi{instr_phi, instr});
+      } break;
+
       case ir::Instr_Kind::e_ext_call: {
         auto const instr_ext_call =
           static_cast<ir::Instr_ext_call const*>(&instruction);
@@ -964,7 +1157,7 @@ namespace vush {
             coordinate);
           builder.insert(instr);
           instr->block = label;
-          ctx.instr_map.emplace(&instruction, instr);
+          ctx.instr_map.emplace(instruction.id, instr);
         } break;
         }
       } break;
@@ -978,12 +1171,12 @@ namespace vush {
             spirv::make_instr_return_value(ctx.allocator, value);
           builder.insert(instr);
           instr->block = label;
-          ctx.instr_map.emplace(&instruction, instr);
+          ctx.instr_map.emplace(instruction.id, instr);
         } else {
           auto const instr = spirv::make_instr_return(ctx.allocator);
           builder.insert(instr);
           instr->block = label;
-          ctx.instr_map.emplace(&instruction, instr);
+          ctx.instr_map.emplace(instruction.id, instr);
         }
       } break;
 
@@ -991,7 +1184,7 @@ namespace vush {
         auto const instr = spirv::make_instr_terminate(ctx.allocator);
         builder.insert(instr);
         instr->block = label;
-        ctx.instr_map.emplace(&instruction, instr);
+        ctx.instr_map.emplace(instruction.id, instr);
       } break;
 
       case ir::Instr_Kind::e_branch: {
@@ -1001,7 +1194,7 @@ namespace vush {
         auto const instr = spirv::make_instr_branch(ctx.allocator, label);
         builder.insert(instr);
         instr->block = label;
-        ctx.instr_map.emplace(&instruction, instr);
+        ctx.instr_map.emplace(instruction.id, instr);
       } break;
 
       case ir::Instr_Kind::e_brcond: {
@@ -1014,7 +1207,7 @@ namespace vush {
                                                     then_label, else_label);
         builder.insert(instr);
         instr->block = label;
-        ctx.instr_map.emplace(&instruction, instr);
+        ctx.instr_map.emplace(instruction.id, instr);
       } break;
 
       case ir::Instr_Kind::e_switch: {
@@ -1027,7 +1220,7 @@ namespace vush {
           spirv::make_instr_switch(ctx.allocator, selector, default_label);
         builder.insert(instr);
         instr->block = label;
-        ctx.instr_map.emplace(&instruction, instr);
+        ctx.instr_map.emplace(instruction.id, instr);
         for(auto const label: instr_switch->labels) {
           auto const target = lower_block(ctx, label.target);
           instr->labels.push_back({(u64)label.value, target});
@@ -1035,9 +1228,56 @@ namespace vush {
       } break;
       }
     }
+
+    // The blocks emptied by the optimisations are unreachable, but may still
+    // be referenced as the merge blocks of selections.
+    if(block->empty()) {
+      auto const instr = spirv::make_instr_unreachable(ctx.allocator);
+      builder.insert(instr);
+      instr->block = label;
+    }
     return label;
   }
 
+  // lower_unreached_blocks
+  // Lower the merge and continue blocks that have been reserved, but were
+  // never reached, e.g. the merge blocks of infinite loops. Such blocks are
+  // unreachable.
+  //
+  static void lower_unreached_blocks(Lowering_Context& ctx)
+  {
+    for(ir::Basic_Block const* const block: ctx.reserved_blocks) {
+      if(ctx.bb_map.find(block->id) != nullptr) {
+        continue;
+      }
+
+      auto const label = ctx.reserved_labels.find(block->id);
+      ctx.bb_map.emplace(block->id, label);
+      ctx.pending_blocks.push_back(label);
+      auto const instr = spirv::make_instr_unreachable(ctx.allocator);
+      anton::ilist_insert_after(label, instr);
+      instr->block = label;
+    }
+    ctx.reserved_blocks.clear();
+  }
+
+  // resolve_phis
+  // Lower the operands of the pending phis. All blocks of the function must
+  // have been lowered.
+  //
+  static void resolve_phis(Lowering_Context& ctx)
+  {
+    for(Pending_Phi const& pending: ctx.pending_phis) {
+      for(ir::Phi_Source const& source: pending.ir_phi->srcs) {
+        auto const variable = ctx.get_instr(source.value);
+        auto const label = ctx.bb_map.find(source.block->id);
+        ANTON_ASSERT(label != nullptr, "phi source block has not been lowered");
+        pending.phi->operands.push_back(spirv::Phi_Operand{variable, label});
+      }
+    }
+    ctx.pending_phis.clear();
+  }
+
   static void hoist_variables(spirv::Instr* instruction)
   {
     spirv::Instr* label = nullptr;
@@ -1066,9 +1306,7 @@ namespace vush {
   [[nodiscard]] static anton::IList<spirv::Instr>
   lower_function(Lowering_Context& ctx, ir::Function const* const function)
   {
-    auto const function_type = lower_type(ctx, function);
-    auto const instr_function =
-      spirv::make_instr_function(ctx.allocator, ctx.next_id(), function_type);
+    auto const instr_function = declare_function(ctx, function);
     Builder builder;
     builder.set_current_instruction(instr_function);
     // Lower parameters.
@@ -1078,16 +1316,18 @@ namespace vush {
       auto const parameter = spirv::make_instr_function_parameter(
         ctx.allocator, ctx.next_id(), result_type);
       builder.insert(parameter);
-      ctx.instr_map.emplace(&argument, parameter);
+      ctx.instr_map.emplace(argument.id, parameter);
     }
     auto const entry_label = lower_block(ctx, function->entry_block);
     // We intentionally ignore the entry_label as it is automatically added to
     // the list of pending blocks at the first position.
     ANTON_UNUSED(entry_label);
+    lower_unreached_blocks(ctx);
     for(auto const label: ctx.pending_blocks) {
       builder.splice(label);
     }
     ctx.pending_blocks.clear();
+    resolve_phis(ctx);
 
     auto const instr_end = spirv::make_instr_function_end(ctx.allocator);
     builder.insert(instr_end);
@@ -1101,20 +1341,18 @@ namespace vush {
   make_entry_function_type(Lowering_Context& ctx)
   {
     auto const ir_return_type = ir::get_type_void();
-    Running_Hash hash;
-    hash.start();
-    hash.feed("function");
-    hash_type(hash, ir_return_type);
-    u64 const value = hash.finish();
-    auto iter = ctx.type_map.find(value);
-    if(iter == ctx.type_map.end()) {
-      auto const return_type = lower_type(ctx, ir_return_type);
-      auto const instr =
-        make_instr_type_function(ctx.allocator, ctx.next_id(), return_type);
-      ctx.globals.insert_back(*instr);
-      iter = ctx.type_map.emplace(value, instr);
+    Derived_Key const key{.kind = Derived_Kind::e_function,
+                          .type = ir_return_type};
+    if(auto const instr = find_derived(ctx, key)) {
+      return safe_cast<spirv::Instr_type_function*>(instr);
     }
-    return safe_cast<spirv::Instr_type_function*>(iter->value);
+
+    auto const return_type = lower_type(ctx, ir_return_type);
+    auto const instr =
+      make_instr_type_function(ctx.allocator, ctx.next_id(), return_type);
+    ctx.globals.insert_back(*instr);
+    add_derived(ctx, key, instr);
+    return instr;
   }
 
   struct Module_Entry {
@@ -1209,7 +1447,7 @@ namespace vush {
         decorate_interface(ctx, argument.decorations, variable);
         interface.push_back(variable);
         ctx.globals.insert_back(*variable);
-        ctx.instr_map.emplace(&argument, variable);
+        ctx.instr_map.emplace(argument.id, variable);
       } else {
         auto const buffer = lower_buffer(ctx, argument.buffer);
         interface.push_back(buffer);
@@ -1224,17 +1462,19 @@ namespace vush {
           ctx.allocator, ctx.next_id(), pointer_type, buffer, index);
         // Store the AccessChains to insert them after the entry label.
         parameter_pointers.push_back(field_pointer);
-        ctx.instr_map.emplace(&argument, field_pointer);
+        ctx.instr_map.emplace(argument.id, field_pointer);
       }
     }
 
     auto const entry_label = lower_block(ctx, function->entry_block);
     // We intentionally ignore the entry_label as it is automatically added to
     // the list of pending blocks at the first position.
+    lower_unreached_blocks(ctx);
     for(auto const label: ctx.pending_blocks) {
       builder.splice(label);
     }
     ctx.pending_blocks.clear();
+    resolve_phis(ctx);
 
     // Insert the missing parameter pointers.
     for(auto const pointer: parameter_pointers) {
@@ -1317,6 +1557,13 @@ namespace vush {
         ctx.declarations.insert_back(*origin);
       }
     }
+    // Lower the functions called from the entry function. Lowering a function
+    // may declare further functions, hence the list grows while iterating.
+    for(i64 i = 0; i < ctx.pending_functions.size(); i += 1) {
+      anton::IList<spirv::Instr> instructions =
+        lower_function(ctx, ctx.pending_functions[i]);
+      ctx.functions.splice(instructions);
+    }
     spirv::Module spirv_module{
       .capabilities = ANTON_MOV(ctx.capabilities),
       .extensions = ANTON_MOV(ctx.extensions),
@@ -355,6 +355,19 @@ namespace vush::spirv {
     }
   }
 
+  [[nodiscard]] static anton::String_View
+  stringify(Loop_Control const loop_control)
+  {
+    switch(loop_control) {
+    case Loop_Control::e_none:
+      return "None"_sv;
+    case Loop_Control::e_unroll:
+      return "Unroll"_sv;
+    case Loop_Control::e_dont_unroll:
+      return "DontUnroll"_sv;
+    }
+  }
+
   void print_instruction(Allocator* allocator, anton::Output_Stream& stream,
                          Prettyprint_Options const& options,
                          Instr const* const ginstruction)
@@ -548,6 +561,8 @@ namespace vush::spirv {
       }
     } break;
 
+      CASE_TYPED_INSTR(e_undef, Instr_undef, "OpUndef")
+
       CASE_TYPED_INSTR(e_constant_true, Instr_constant_true, "OpConstantTrue")
       CASE_TYPED_INSTR(e_constant_false, Instr_constant_false,
                        "OpConstantFalse")
@@ -711,6 +726,10 @@ namespace vush::spirv {
                         "OpMatrixTimesMatrix")
       CASE_BINARY_INSTR(e_outer_product, Instr_outer_product, "OpOuterProduct")
       CASE_BINARY_INSTR(e_dot, Instr_dot, "OpDot")
+      CASE_BINARY_INSTR(e_umul_extended, Instr_umul_extended,
+                        "OpUMulExtended")
+      CASE_BINARY_INSTR(e_smul_extended, Instr_smul_extended,
+                        "OpSMulExtended")
       CASE_BINARY_INSTR(e_shr_logical, Instr_shr_logical, "OpShiftRightLogical")
       CASE_BINARY_INSTR(e_shr_arithmetic, Instr_shr_arithmetic,
                         "OpShiftRightArithmetic")
@@ -748,7 +767,7 @@ namespace vush::spirv {
       CASE_BINARY_INSTR(e_fuge, Instr_fuge, "OpFUnordGreaterThanEqual")
 
       CASE_GENERIC_INSTR(e_select, Instr_select,
-                         "%{} = OpSelect %{} %{} %{} %{} %{}", instruction->id,
+                         "%{} = OpSelect %{} %{} %{} %{}", instruction->id,
                          instruction->result_type->id,
                          instruction->condition->id, instruction->operand1->id,
                          instruction->operand2->id)
@@ -767,12 +786,17 @@ namespace vush::spirv {
       auto const instruction = static_cast<Instr_phi const*>(ginstruction);
       stream.write(anton::format(allocator, "%{} = OpPhi %{}", instruction->id,
                                  instruction->result_type->id));
-      for(auto const variable: instruction->operands) {
-        stream.write(anton::format(allocator, " %{} %{}", variable->id,
-                                   variable->block->id));
+      for(auto const operand: instruction->operands) {
+        stream.write(anton::format(allocator, " %{} %{}", operand.variable->id,
+                                   operand.parent->id));
       }
     } break;
 
+      CASE_GENERIC_INSTR(e_loop_merge, Instr_loop_merge,
+                         "OpLoopMerge %{} %{} {}",
+                         instruction->merge_block->id,
+                         instruction->continue_block->id,
+                         stringify(instruction->loop_control))
       CASE_GENERIC_INSTR(e_selection_merge, Instr_selection_merge,
                          "OpSelectionMerge %{} None",
                          instruction->merge_block->id)
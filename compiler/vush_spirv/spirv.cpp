@@ -3,6 +3,12 @@
 #include <vush_core/memory.hpp>
 
 namespace vush::spirv {
+  template<>
+  bool instanceof<Instr_undef>(Instr const* const instr)
+  {
+    return instr->instr_kind == Instr_Kind::e_undef;
+  }
+
   template<>
   bool instanceof<Instr_string>(Instr const* const instr)
   {
@@ -429,6 +435,18 @@ namespace vush::spirv {
     return instr->instr_kind == Instr_Kind::e_dot;
   }
 
+  template<>
+  bool instanceof<Instr_umul_extended>(Instr const* const instr)
+  {
+    return instr->instr_kind == Instr_Kind::e_umul_extended;
+  }
+
+  template<>
+  bool instanceof<Instr_smul_extended>(Instr const* const instr)
+  {
+    return instr->instr_kind == Instr_Kind::e_smul_extended;
+  }
+
   template<>
   bool instanceof<Instr_shr_logical>(Instr const* const instr)
   {
@@ -750,6 +768,8 @@ namespace vush::spirv {
   Instr* get_result_type(Instr* const instruction)
   {
     switch(instruction->instr_kind) {
+    case Instr_Kind::e_undef:
+      return static_cast<Instr_undef*>(instruction)->result_type;
     case Instr_Kind::e_ext_instr:
       return static_cast<Instr_ext_instr*>(instruction)->result_type;
     case Instr_Kind::e_constant_true:
@@ -845,6 +865,10 @@ namespace vush::spirv {
       return static_cast<Instr_outer_product*>(instruction)->result_type;
     case Instr_Kind::e_dot:
       return static_cast<Instr_dot*>(instruction)->result_type;
+    case Instr_Kind::e_umul_extended:
+      return static_cast<Instr_umul_extended*>(instruction)->result_type;
+    case Instr_Kind::e_smul_extended:
+      return static_cast<Instr_smul_extended*>(instruction)->result_type;
     case Instr_Kind::e_shr_logical:
       return static_cast<Instr_shr_logical*>(instruction)->result_type;
     case Instr_Kind::e_shr_arithmetic:
@@ -1243,6 +1267,8 @@ namespace vush::spirv {
     return instr;
   }
 
+  TYPED_INSTR_MAKE_FN(undef)
+
   TYPED_INSTR_MAKE_FN(constant_true)
   TYPED_INSTR_MAKE_FN(constant_false)
 
@@ -1321,6 +1347,14 @@ namespace vush::spirv {
 
   TYPED_INSTR_MAKE_FN(function_parameter)
 
+  Instr_function_call* make_instr_function_call(Allocator* allocator, u32 id,
+                                                Instr_function* function)
+  {
+    auto const instr =
+      VUSH_ALLOCATE(Instr_function_call, allocator, id, function, allocator);
+    return instr;
+  }
+
   Instr_function_end* make_instr_function_end(Allocator* allocator)
   {
     auto const instr = VUSH_ALLOCATE(Instr_function_end, allocator);
@@ -1378,6 +1412,8 @@ namespace vush::spirv {
   BINARY_INSTR_MAKE_FN(mat_times_mat);
   BINARY_INSTR_MAKE_FN(outer_product);
   BINARY_INSTR_MAKE_FN(dot);
+  BINARY_INSTR_MAKE_FN(umul_extended);
+  BINARY_INSTR_MAKE_FN(smul_extended);
   BINARY_INSTR_MAKE_FN(shr_logical);
   BINARY_INSTR_MAKE_FN(shr_arithmetic);
   BINARY_INSTR_MAKE_FN(shl); // ShiftLeftLogical
@@ -1390,6 +1426,16 @@ namespace vush::spirv {
   BINARY_INSTR_MAKE_FN(logical_or);
   BINARY_INSTR_MAKE_FN(logical_and);
   BINARY_INSTR_MAKE_FN(logical_not);
+
+  Instr_select* make_instr_select(Allocator* allocator, u32 id,
+                                  Instr* result_type, Instr* condition,
+                                  Instr* operand1, Instr* operand2)
+  {
+    auto const instr = VUSH_ALLOCATE(Instr_select, allocator, id, result_type,
+                                     condition, operand1, operand2);
+    return instr;
+  }
+
   BINARY_INSTR_MAKE_FN(ieq); // IEqual
   BINARY_INSTR_MAKE_FN(ineq); // INotEqual
   BINARY_INSTR_MAKE_FN(ugt); // UGreaterThan
@@ -1413,6 +1459,23 @@ namespace vush::spirv {
   BINARY_INSTR_MAKE_FN(foge); // FOrdGreaterThanEqual
   BINARY_INSTR_MAKE_FN(fuge); // FUnordGreaterThanEqual
 
+  Instr_phi* make_instr_phi(Allocator* allocator, u32 id, Instr* result_type)
+  {
+    auto const instr =
+      VUSH_ALLOCATE(Instr_phi, allocator, id, result_type, allocator);
+    return instr;
+  }
+
+  Instr_loop_merge* make_instr_loop_merge(Allocator* allocator,
+                                          Instr_label* merge_block,
+                                          Instr_label* continue_block,
+                                          Loop_Control loop_control)
+  {
+    auto const instr = VUSH_ALLOCATE(Instr_loop_merge, allocator, merge_block,
+                                     continue_block, loop_control);
+    return instr;
+  }
+
   Instr_selection_merge* make_instr_selection_merge(Allocator* allocator,
                                                     Instr_label* merge_block)
   {
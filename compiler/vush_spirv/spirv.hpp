@@ -8,6 +8,8 @@
 
 namespace vush::spirv {
   enum struct Instr_Kind {
+    // Miscellaneous instructions
+    e_undef = 1,
     // Debug instructions
     e_string = 7,
     e_line = 8,
@@ -94,6 +96,8 @@ namespace vush::spirv {
     e_mat_times_mat = 146,
     e_outer_product = 147,
     e_dot = 148,
+    e_umul_extended = 151,
+    e_smul_extended = 152,
     // Bit instructions
     e_shr_logical = 194,
     e_shr_arithmetic = 195,
@@ -143,7 +147,7 @@ namespace vush::spirv {
     e_fwidth_coarse = 215,
     // Control-flow instructions
     e_phi = 245,
-    // e_loop_merge,
+    e_loop_merge = 246,
     e_selection_merge = 247,
     e_label = 248,
     e_branch = 249,
@@ -840,6 +844,8 @@ namespace vush::spirv {
   [[nodiscard]] Instr_type_function*
   make_instr_type_function(Allocator* allocator, u32 id, Instr* return_type);
 
+  TYPED_INSTR(undef, e_undef);
+
   TYPED_INSTR(constant_true, e_constant_true);
   TYPED_INSTR(constant_false, e_constant_false);
 
@@ -1033,6 +1039,10 @@ namespace vush::spirv {
     }
   };
 
+  [[nodiscard]] Instr_function_call*
+  make_instr_function_call(Allocator* allocator, u32 id,
+                           Instr_function* function);
+
   UNARY_INSTR(Instr_convert_f2u, e_convert_f2u);
   UNARY_INSTR(Instr_convert_f2s, e_convert_f2s);
   UNARY_INSTR(Instr_convert_s2f, e_convert_s2f);
@@ -1154,6 +1164,9 @@ namespace vush::spirv {
   BINARY_INSTR(mat_times_mat, e_mat_times_mat);
   BINARY_INSTR(outer_product, e_outer_product);
   BINARY_INSTR(dot, e_dot);
+  // The result type is a struct of the low and the high half of the product.
+  BINARY_INSTR(umul_extended, e_umul_extended);
+  BINARY_INSTR(smul_extended, e_smul_extended);
   BINARY_INSTR(shr_logical, e_shr_logical);
   BINARY_INSTR(shr_arithmetic, e_shr_arithmetic);
   BINARY_INSTR(shl, e_shl); // ShiftLeftLogical
@@ -1186,6 +1199,12 @@ namespace vush::spirv {
     }
   };
 
+  [[nodiscard]] Instr_select* make_instr_select(Allocator* allocator, u32 id,
+                                                Instr* result_type,
+                                                Instr* condition,
+                                                Instr* operand1,
+                                                Instr* operand2);
+
   BINARY_INSTR(ieq, e_ieq); // IEqual
   BINARY_INSTR(ineq, e_ineq); // INotEqual
   BINARY_INSTR(ugt, e_ugt); // UGreaterThan
@@ -1219,25 +1238,48 @@ namespace vush::spirv {
   UNARY_INSTR(Instr_dPdy_coarse, e_dPdy_coarse);
   UNARY_INSTR(Instr_fwidth_coarse, e_fwidth_coarse);
 
+  struct Phi_Operand {
+    Instr* variable;
+    Instr_label* parent;
+  };
+
   struct Instr_phi: public Instr {
     Instr* result_type;
-    Array<Instr*> operands;
+    Array<Phi_Operand> operands;
 
     Instr_phi(u32 id, Instr* result_type, Allocator* allocator)
       : Instr(Instr_Kind::e_phi, id), result_type(result_type),
         operands(allocator)
     {
     }
+  };
 
-    Instr_phi(u32 id, Instr* result_type, Allocator* allocator,
-              anton::Slice<Instr* const> operands)
-      : Instr(Instr_Kind::e_phi, id), result_type(result_type),
-        operands(allocator, anton::range_construct, operands.begin(),
-                 operands.end())
+  [[nodiscard]] Instr_phi* make_instr_phi(Allocator* allocator, u32 id,
+                                          Instr* result_type);
+
+  enum struct Loop_Control {
+    e_none = 0x0,
+    e_unroll = 0x1,
+    e_dont_unroll = 0x2,
+  };
+
+  struct Instr_loop_merge: public Instr {
+    Instr_label* merge_block;
+    Instr_label* continue_block;
+    Loop_Control loop_control;
+
+    Instr_loop_merge(Instr_label* merge_block, Instr_label* continue_block,
+                     Loop_Control loop_control)
+      : Instr(Instr_Kind::e_loop_merge, 0), merge_block(merge_block),
+        continue_block(continue_block), loop_control(loop_control)
     {
     }
   };
 
+  [[nodiscard]] Instr_loop_merge*
+  make_instr_loop_merge(Allocator* allocator, Instr_label* merge_block,
+                        Instr_label* continue_block, Loop_Control loop_control);
+
   struct Instr_selection_merge: public Instr {
     Instr_label* merge_block;
     // Selection control omitted.
@@ -1,6 +1,7 @@
 #pragma once
 
 namespace vush::spirv {
+  struct Instr_undef;
   struct Instr_string;
   struct Instr_line;
   struct Instr_extension;
@@ -72,6 +73,8 @@ namespace vush::spirv {
   struct Instr_mat_times_mat;
   struct Instr_outer_product;
   struct Instr_dot;
+  struct Instr_umul_extended;
+  struct Instr_smul_extended;
   struct Instr_shr_logical;
   struct Instr_shr_arithmetic;
   struct Instr_shl;
@@ -87,6 +87,9 @@ namespace vush {
     }
   }
 
+  [[nodiscard]] static anton::Expected<ast::Expr*, Error>
+  transform_expr(Context const& ctx, SNOT const* const node);
+
   [[nodiscard]] static anton::Expected<ast::Type*, Error>
   transform_type(Context const& ctx, SNOT const* const node)
   {
@@ -123,14 +126,24 @@ namespace vush {
       SNOT const* const base_node = get_type_array_base(node);
       RETURN_ON_FAIL(base, transform_type, ctx, base_node);
       ast::Lt_Integer* size = nullptr;
+      ast::Expr* size_expression = nullptr;
       if(auto const size_node = get_type_array_size(node)) {
-        RETURN_ON_FAIL(size_result, lower_lt_integer, ctx, size_node);
-        size = size_result.value();
+        // Literal sizes are used directly. Other expressions are evaluated by
+        // sema.
+        if(size_node->kind == SNOT_Kind::expr_lt_integer) {
+          RETURN_ON_FAIL(size_result, lower_lt_integer, ctx, size_node);
+          size = size_result.value();
+        } else {
+          RETURN_ON_FAIL(size_result, transform_expr, ctx, size_node);
+          size_expression = size_result.value();
+        }
       }
 
-      return {anton::expected_value,
-              VUSH_ALLOCATE(ast::Type_Array, ctx.bump_allocator,
-                            node->source_info, qualifiers, base.value(), size)};
+      auto const type =
+        VUSH_ALLOCATE(ast::Type_Array, ctx.bump_allocator, node->source_info,
+                      qualifiers, base.value(), size);
+      type->size_expression = size_expression;
+      return {anton::expected_value, type};
     } break;
 
     default:
@@ -661,6 +674,8 @@ namespace vush {
     } break;
 
     case SNOT_Kind::stmt_for: {
+      RETURN_ON_FAIL(attribute_list, transform_attribute_list, ctx,
+                     get_stmt_for_attribute_list(node));
       ast::Variable_List declarations;
       if(auto const variable_node = get_stmt_for_variable(node)) {
         RETURN_ON_FAIL(variable, transform_variable, ctx, variable_node);
@@ -683,29 +698,36 @@ namespace vush {
                      get_stmt_for_body(node));
 
       return {anton::expected_value,
-              VUSH_ALLOCATE(ast::Stmt_For, ctx.bump_allocator, condition,
+              VUSH_ALLOCATE(ast::Stmt_For, ctx.bump_allocator,
+                            ANTON_MOV(attribute_list.value()), condition,
                             ANTON_MOV(declarations), ANTON_MOV(actions),
                             ANTON_MOV(statements.value()), node->source_info)};
     } break;
 
     case SNOT_Kind::stmt_while: {
+      RETURN_ON_FAIL(attribute_list, transform_attribute_list, ctx,
+                     get_stmt_while_attribute_list(node));
       RETURN_ON_FAIL(condition, transform_expr, ctx,
                      get_stmt_while_condition(node));
       RETURN_ON_FAIL(statements, transform_stmt_block_child_stmts, ctx,
                      get_stmt_while_statements(node));
       return {anton::expected_value,
               VUSH_ALLOCATE(ast::Stmt_While, ctx.bump_allocator,
+                            ANTON_MOV(attribute_list.value()),
                             condition.value(), ANTON_MOV(statements.value()),
                             node->source_info)};
     } break;
 
     case SNOT_Kind::stmt_do_while: {
+      RETURN_ON_FAIL(attribute_list, transform_attribute_list, ctx,
+                     get_stmt_do_while_attribute_list(node));
       RETURN_ON_FAIL(statements, transform_stmt_block_child_stmts, ctx,
                      get_stmt_do_while_body(node));
       RETURN_ON_FAIL(condition, transform_expr, ctx,
                      get_stmt_do_while_condition(node));
       return {anton::expected_value,
               VUSH_ALLOCATE(ast::Stmt_Do_While, ctx.bump_allocator,
+                            ANTON_MOV(attribute_list.value()),
                             condition.value(), ANTON_MOV(statements.value()),
                             node->source_info)};
     } break;
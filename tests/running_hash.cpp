@@ -0,0 +1,133 @@
+// Checks Running_Hash against the reference xxhash64 and checks that the
+// result does not depend on how the input is split into the calls to feed.
+//
+// The input is a fixed sequence of 128 bytes. The reference values have been
+// computed with the reference implementation of xxhash64 over prefixes of the
+// input, hence they cover the lengths below, at and above the 32 byte stripe.
+//
+
+#include <stdlib.h>
+
+#include <anton/format.hpp>
+#include <anton/stdio.hpp>
+#include <anton/string7_view.hpp>
+
+#include <vush_core/running_hash.hpp>
+
+namespace vush {
+  using namespace anton::literals;
+
+  static constexpr i64 input_size = 128;
+
+  struct Reference {
+    i64 length;
+    u64 seed;
+    u64 hash;
+  };
+
+  static constexpr Reference references[] = {
+    {0, 0, 0xEF46DB3751D8E999},    {1, 0, 0x1F25C8D0BC1F4BB6},
+    {2, 0, 0xF5BEDEC232706303},    {3, 0, 0x31D2363F52E564C9},
+    {4, 0, 0x9BB64B7D66EE9FDA},    {8, 0, 0xDAB99D95C6F90092},
+    {31, 0, 0xA2AA5F33CC4A6119},   {32, 0, 0x23C3C17EF790FD97},
+    {33, 0, 0x50A7CFC7BA588784},   {63, 0, 0x5E3E54B431C7493C},
+    {64, 0, 0x0EB64B3EF6EEB01F},   {65, 0, 0xA383B724B2BD12F1},
+    {100, 0, 0xA61F8D4C170FE531},  {128, 0, 0x46FBCFBF0150793F},
+    {100, 0x1F0D3804, 0xA31B41C66BB5DB1F},
+  };
+
+  static constexpr i64 steps[] = {1, 3, 7, 31, 32, 33, 64};
+
+  static void generate_input(u8* const input)
+  {
+    for(i64 i = 0; i < input_size; i += 1) {
+      input[i] = static_cast<u8>(i * 7 + 3);
+    }
+  }
+
+  [[nodiscard]] static u64 hash(u8 const* const input, i64 const length,
+                                u64 const seed)
+  {
+    Running_Hash h;
+    h.start(seed);
+    h.feed(input, length);
+    return h.finish();
+  }
+
+  // hash_split
+  // Hash the input by feeding the first split bytes in one call and the rest
+  // in calls of step bytes.
+  //
+  [[nodiscard]] static u64 hash_split(u8 const* const input,
+                                      i64 const length, i64 const split,
+                                      i64 const step)
+  {
+    Running_Hash h;
+    h.start(0);
+    h.feed(input, split);
+    for(i64 offset = split; offset < length; offset += step) {
+      i64 const size = offset + step < length ? step : length - offset;
+      h.feed(input + offset, size);
+    }
+    return h.finish();
+  }
+
+  i32 test_running_hash_main()
+  {
+    anton::Allocator allocator;
+    u8 input[input_size];
+    generate_input(input);
+    bool success = true;
+    for(Reference const& reference: references) {
+      u64 const result = hash(input, reference.length, reference.seed);
+      if(result != reference.hash) {
+        anton::print(anton::format(
+          &allocator, "error: wrong hash of {} bytes with seed {}\n"_sv,
+          reference.length, reference.seed));
+        success = false;
+      }
+    }
+
+    {
+      Running_Hash h;
+      h.start(0);
+      h.feed("abc"_sv);
+      if(h.finish() != 0x44BC2CF5AD770999) {
+        anton::print("error: wrong hash of 'abc'\n"_sv);
+        success = false;
+      }
+    }
+
+    u64 const whole = hash(input, input_size, 0);
+    for(i64 split = 0; split <= input_size; split += 1) {
+      for(i64 const step: steps) {
+        if(hash_split(input, input_size, split, step) != whole) {
+          anton::print(anton::format(
+            &allocator, "error: wrong hash when split at {}, step {}\n"_sv,
+            split, step));
+          success = false;
+        }
+      }
+    }
+
+    // finish does not modify the state, hence feeding may continue.
+    {
+      Running_Hash h;
+      h.start(0);
+      h.feed(input, 40);
+      (void)h.finish();
+      h.feed(input + 40, input_size - 40);
+      if(h.finish() != whole) {
+        anton::print("error: finish modified the state\n"_sv);
+        success = false;
+      }
+    }
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+} // namespace vush
+
+int main()
+{
+  return vush::test_running_hash_main();
+}
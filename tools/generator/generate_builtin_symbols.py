@@ -205,7 +205,7 @@ def write_builtin_extensions(file):
 
 namespace vush {
   ir::Instr_ext_call*
-  select_ext(Allocator* const allocator, i64 const id, ir::Type* const type,
+  select_ext(Allocator* const allocator, u32 const id, ir::Type* const type,
              ast::Expr_Call const* const expr) {
     anton::String_View const identifier = expr->identifier.value;
     bool const result_is_fp = ast::is_fp_based(*expr->evaluated_type);
@@ -283,13 +283,15 @@ syntax_nodes = [
     {
         "syntax_name": "stmt_while",
         "members": [
-            Syntax_Member(Node_Kind.node, "condition", Lookup_Kind.index, 1),
-            Syntax_Member(Node_Kind.node, "statements", Lookup_Kind.index, 2),
+            Syntax_Member(Node_Kind.node, "attribute_list", Lookup_Kind.index, 0),
+            Syntax_Member(Node_Kind.node, "condition", Lookup_Kind.index, 2),
+            Syntax_Member(Node_Kind.node, "statements", Lookup_Kind.index, 3),
         ]
     },
     {
         "syntax_name": "stmt_for",
         "members": [
+            Syntax_Member(Node_Kind.node, "attribute_list", Lookup_Kind.index, 0),
             Syntax_Member(Node_Kind.node, "variable", Lookup_Kind.search, "for_variable", optional = True, unwrap = True),
             Syntax_Member(Node_Kind.node, "condition", Lookup_Kind.search, "for_condition", optional = True, unwrap = True),
             Syntax_Member(Node_Kind.node, "expression", Lookup_Kind.search, "for_expression", optional = True, unwrap = True),
@@ -299,8 +301,9 @@ syntax_nodes = [
     {
         "syntax_name": "stmt_do_while",
         "members": [
-            Syntax_Member(Node_Kind.node, "body", Lookup_Kind.index, 1),
-            Syntax_Member(Node_Kind.node, "condition", Lookup_Kind.index, 3),
+            Syntax_Member(Node_Kind.node, "attribute_list", Lookup_Kind.index, 0),
+            Syntax_Member(Node_Kind.node, "body", Lookup_Kind.index, 2),
+            Syntax_Member(Node_Kind.node, "condition", Lookup_Kind.index, 4),
         ]
     },
     {
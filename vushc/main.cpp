@@ -27,8 +27,19 @@ namespace vush {
       "The Vush Compiler (vushc)\n"
       "\n"
       "Options:\n"
-      "  -h, --help  Print this help page.\n"
-      "  -I DIR      Add DIR to the end of the list of import search paths\n"_sv);
+      "  -h, --help            Print this help page.\n"
+      "  -I DIR                Add DIR to the end of the list of import search\n"
+      "                        paths\n"
+      "  -O LEVEL              Optimise at LEVEL, one of 0, 1 or 2. Defaults\n"
+      "                        to 0\n"
+      "  --flatten             Inline all calls into the stage entry at -O1\n"
+      "                        and -O2 instead of inlining calls by the cost\n"
+      "                        model at -O2\n"
+      "  --sema-threads COUNT  Analyse function bodies using COUNT threads\n"
+      "  --module-cache DIR    Store the precompiled modules of the imported\n"
+      "                        sources in DIR\n"
+      "  --print-pass-stats    Print the number of changes made by and the\n"
+      "                        time spent in each optimisation pass\n"_sv);
 
     exit(EXIT_HELP);
   }
@@ -249,6 +260,7 @@ namespace vush {
     // TODO: Rework arena to wrap an allocator.
     anton::Arena_Allocator arena_allocator(16384);
     vush::Array<anton::String> import_directories{&allocator};
+    bool print_pass_stats = false;
 
     vush::Configuration config;
     config.buffer_definition_cb = nullptr;
@@ -257,14 +269,24 @@ namespace vush {
     enum {
       option_help,
       option_import,
+      option_optimisation_level,
+      option_sema_threads,
+      option_module_cache,
+      option_print_pass_stats,
+      option_flatten,
     };
 
     Option_Definition const short_options[] = {
       {"h", option_help, false},
       {"I", option_import, true},
+      {"O", option_optimisation_level, true},
     };
     Option_Definition const long_options[] = {
       {"help", option_help, false},
+      {"sema-threads", option_sema_threads, true},
+      {"module-cache", option_module_cache, true},
+      {"print-pass-stats", option_print_pass_stats, false},
+      {"flatten", option_flatten, false},
     };
     anton::Expected<Parse_Result, anton::String> options_result =
       parse_options(&allocator, short_options, long_options, argc, argv);
@@ -283,6 +305,37 @@ namespace vush {
         import_directories.push_back(
           string7_to_string(option.value, &allocator));
         break;
+
+      case option_optimisation_level:
+        if(option.value == "0"_sv7) {
+          config.optimisation_level = vush::Optimisation_Level::o0;
+        } else if(option.value == "1"_sv7) {
+          config.optimisation_level = vush::Optimisation_Level::o1;
+        } else if(option.value == "2"_sv7) {
+          config.optimisation_level = vush::Optimisation_Level::o2;
+        } else {
+          error(executable, "invalid optimisation level"_sv);
+        }
+        break;
+
+      case option_sema_threads: {
+        anton::String const value =
+          string7_to_string(option.value, &allocator);
+        config.sema_threads = anton::str_to_i64(value, 10);
+      } break;
+
+      case option_module_cache:
+        config.module_cache_directory =
+          string7_to_string(option.value, &allocator);
+        break;
+
+      case option_print_pass_stats:
+        print_pass_stats = true;
+        break;
+
+      case option_flatten:
+        config.flatten = true;
+        break;
       }
     }
 
@@ -301,6 +354,14 @@ namespace vush {
       return EXIT_FAILURE;
     }
 
+    if(print_pass_stats) {
+      for(Pass_Statistics const& stats: compilation_result->statistics) {
+        anton::print(anton::format(&allocator, "{}: {} changes, {} us\n"_sv,
+                                   stats.pass_name, stats.changes,
+                                   stats.time_ns / 1000));
+      }
+    }
+
     for(auto const& shader: compilation_result->shaders) {
       anton::STDOUT_Stream stdout;
       spirv::Prettyprint_Options options;